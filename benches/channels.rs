@@ -0,0 +1,75 @@
+//! Throughput of a [`StandardChannel`] mixing increasing numbers of voices,
+//! one sample at a time and a block at a time, and of a 7.1 channel panning
+//! every voice to a new position each block.
+
+use std::sync::Arc;
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use bae_rs::{*, channels::*, generators::*, modifiers::*, sounds::*};
+
+/// Number of samples processed per iteration, one block of the default
+/// context.
+const BLOCK: usize = DEFAULT_MAX_BLOCK;
+
+/// Numbers of voices playing in the channel.
+const VOICES: [usize; 4] = [1, 16, 128, 512];
+
+/// Returns a filtered sawtooth voice.
+fn voice(i: usize) -> SoundSP {
+    let mut s = SimpleSound::new(1.0, 1.0,
+        Arc::new(StandardBlock::from_generator(Sawtooth::new(55.0 + i as MathT)))
+    );
+    s.add_modifier(Arc::new(StandardBlock::from_modifier(LowPass::new(2000.0, 0.7))));
+
+    Box::new(s)
+}
+
+/// Returns a channel of the given number of voices, processing `len` samples
+/// at a time.
+fn channel<SF: SampleFormat>(voices: usize, len: usize) -> StandardChannel<SF> {
+    let ctx = Context::new(SAMPLE_RATE as MathT, len);
+    let mut c = StandardChannel::with_context(1.0 / voices as MathT, voices, ctx);
+    for i in 0..voices {
+        c.add_sound(voice(i));
+    }
+
+    c
+}
+
+fn channels(c: &mut Criterion) {
+    let mut group = c.benchmark_group("channels");
+    group.throughput(Throughput::Elements(BLOCK as u64));
+
+    for &voices in VOICES.iter() {
+        let mut ch = channel::<Mono>(voices, 1);
+        group.bench_function(BenchmarkId::new("StandardChannel/sample", voices), |b| b.iter(|| {
+            for _ in 0..BLOCK {
+                ch.process();
+                black_box(ch.get_output());
+            }
+        }));
+
+        let mut ch = channel::<Mono>(voices, BLOCK);
+        group.bench_function(BenchmarkId::new("StandardChannel/block", voices), |b| b.iter(|| {
+            ch.process();
+            black_box(ch.get_output());
+        }));
+
+        let ctx = Context::new(SAMPLE_RATE as MathT, BLOCK);
+        let mut ch = StandardChannel::<Surround71>::with_context(1.0 / voices as MathT, voices, ctx);
+        let handles: Vec<_> = (0..voices).map(|i| ch.add_sound(voice(i))).collect();
+        let mut azimuth = 0.0;
+        group.bench_function(BenchmarkId::new("StandardChannel/panned71", voices), |b| b.iter(|| {
+            for (i, h) in handles.iter().enumerate() {
+                ch.set_sound_pan(*h, azimuth + i as MathT);
+            }
+            azimuth += 1.0;
+            ch.process();
+            black_box(ch.get_output());
+        }));
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, channels);
+criterion_main!(benches);
@@ -0,0 +1,100 @@
+//! Throughput of every [`Generator`], one sample at a time and through the
+//! block API.
+
+use std::io::Cursor;
+use std::sync::Arc;
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkGroup, BenchmarkId, Criterion, Throughput};
+use criterion::measurement::WallTime;
+use bae_rs::{*, generators::*, utils::*, utils::wav_stream::WavAsset};
+
+/// Number of samples processed per iteration, one block of the default
+/// context.
+const BLOCK: usize = DEFAULT_MAX_BLOCK;
+
+fn bench<G: Generator>(group: &mut BenchmarkGroup<WallTime>, name: &str, g: G) {
+    bench_rewound(group, name, g, |_| ());
+}
+
+/// Benchmarks a generator, calling `rewind` before each block so that players
+/// of finite sources never run out of data.
+fn bench_rewound<G, F>(group: &mut BenchmarkGroup<WallTime>, name: &str, mut g: G, mut rewind: F)
+    where G: Generator,
+          F: FnMut(&mut G)
+{
+    let mut buf = vec![0.0; BLOCK];
+
+    group.bench_function(BenchmarkId::new(name, "sample"), |b| b.iter(|| {
+        rewind(&mut g);
+        for x in buf.iter_mut() {
+            *x = g.process();
+        }
+        black_box(&buf);
+    }));
+    group.bench_function(BenchmarkId::new(name, "block"), |b| b.iter(|| {
+        rewind(&mut g);
+        g.process_block(&mut buf);
+        black_box(&buf);
+    }));
+}
+
+/// Returns a second of noise at the given rate, encoded as a 16-bit WAV file.
+fn wav_bytes(rate: u32) -> Vec<u8> {
+    let mut n = Noise::with_seed(0);
+    let t = (0..rate).map(|_| (n.process() * 16_384.0) as i16).collect();
+
+    let mut bytes = Vec::new();
+    wav::write_wav(wav::Header::new(1, 1, rate, 16), wav::BitDepth::Sixteen(t), &mut bytes).unwrap();
+
+    bytes
+}
+
+fn generators(c: &mut Criterion) {
+    let mut group = c.benchmark_group("generators");
+    group.throughput(Throughput::Elements(BLOCK as u64));
+
+    bench(&mut group, "Zero", Zero::new());
+    bench(&mut group, "Noise/White", Noise::with_color(NoiseColor::White, 0));
+    bench(&mut group, "Noise/Pink", Noise::with_color(NoiseColor::Pink, 0));
+    bench(&mut group, "Noise/Brown", Noise::with_color(NoiseColor::Brown, 0));
+    bench(&mut group, "Sine", Sine::new(440.0));
+    bench(&mut group, "Sawtooth", Sawtooth::new(440.0));
+    bench(&mut group, "Square", Square::new(440.0));
+    bench(&mut group, "Triangle", Triangle::new(440.0));
+    for (name, w) in [
+        ("Sine", Waveform::Sine),
+        ("Sawtooth", Waveform::Sawtooth),
+        ("Square", Waveform::Square),
+        ("Pulse", Waveform::Pulse(0.25)),
+        ("Triangle", Waveform::Triangle),
+    ] {
+        bench(&mut group, &format!("Oscillator/{}", name), Oscillator::with_waveform(w, 440.0));
+    }
+    for voices in [1, 8, 64] {
+        bench(&mut group, &format!("OscillatorBank/{}", voices), OscillatorBank::unison(Waveform::Sawtooth, 440.0, voices, 0.2));
+    }
+    bench(&mut group, "Automated/Sine", {
+        let mut g = Automated::frequency(Sine::new(220.0));
+        g.ramp_to(880.0, std::time::Duration::from_secs(3600), Curve::Linear);
+        g
+    });
+
+    // Sources at the engine rate and at a rate which has to be resampled.
+    for rate in [48_000, 44_100] {
+        let bytes = wav_bytes(rate);
+        let end = (rate as usize - 2 * BLOCK) as MathT;
+        bench_rewound(&mut group, &format!("MonoWav/{}", rate), MonoWav::from_source(&mut Cursor::new(&bytes[..])), |g| {
+            if g.get().get_position() > end {
+                g.get_mut().set_position(0.0);
+            }
+        });
+
+        let mut g = StreamingWav::new(WavAsset::from_bytes(Arc::from(bytes)).unwrap()).unwrap();
+        g.get_mut().set_loop_points(0, rate as u64);
+        bench(&mut group, &format!("StreamingWav/{}", rate), g);
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, generators);
+criterion_main!(benches);
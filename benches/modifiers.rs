@@ -0,0 +1,124 @@
+//! Throughput of every [`Modifier`], one sample at a time and through the
+//! block API, and of the recursive ones ringing out on silence long after an
+//! impulse, where unflushed state would have decayed into subnormal values.
+
+use std::time::Duration;
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkGroup, BenchmarkId, Criterion, Throughput};
+use criterion::measurement::WallTime;
+use bae_rs::{*, generators::*, modifiers::*, utils::*};
+
+/// Number of samples processed per iteration, one block of the default
+/// context.
+const BLOCK: usize = DEFAULT_MAX_BLOCK;
+
+/// Number of blocks of silence run after an impulse before timing a decay
+/// tail, 10s at the default context.
+const DECAY_BLOCKS: usize = 1000;
+
+fn bench<M: Modifier>(group: &mut BenchmarkGroup<WallTime>, name: &str, mut m: M) {
+    let mut input = vec![0.0; BLOCK];
+    Noise::with_seed(0).process_block(&mut input);
+    let mut buf = input.clone();
+
+    group.bench_function(BenchmarkId::new(name, "sample"), |b| b.iter(|| {
+        for (y, x) in buf.iter_mut().zip(&input) {
+            *y = m.process(*x);
+        }
+        black_box(&buf);
+    }));
+    group.bench_function(BenchmarkId::new(name, "block"), |b| b.iter(|| {
+        buf.copy_from_slice(&input);
+        m.process_block(&mut buf);
+        black_box(&buf);
+    }));
+}
+
+/// Times blocks of silence processed by `m` after it has rung out for
+/// [`DECAY_BLOCKS`] blocks. No `DenormalGuard` is held, so only the
+/// modifier's own flushing keeps this as fast as processing signal.
+/// 
+/// [`DECAY_BLOCKS`]: constant.DECAY_BLOCKS.html
+fn bench_decay<M: Modifier>(group: &mut BenchmarkGroup<WallTime>, name: &str, mut m: M) {
+    let mut buf = vec![0.0; BLOCK];
+    buf[0] = 1.0;
+    for _ in 0..DECAY_BLOCKS {
+        m.process_block(&mut buf);
+        buf.iter_mut().for_each(|x| *x = 0.0);
+    }
+
+    group.bench_function(BenchmarkId::new(name, "decay"), |b| b.iter(|| {
+        buf.iter_mut().for_each(|x| *x = 0.0);
+        m.process_block(&mut buf);
+        black_box(&buf);
+    }));
+}
+
+fn modifiers(c: &mut Criterion) {
+    let ms = Duration::from_millis;
+
+    let mut group = c.benchmark_group("modifiers");
+    group.throughput(Throughput::Elements(BLOCK as u64));
+
+    bench(&mut group, "Passthrough", Passthrough::new());
+    bench(&mut group, "Gain", Gain::new(0.5));
+    bench(&mut group, "Envelope", Envelope::new(20.0, 2000.0));
+    bench(&mut group, "LowPass", LowPass::new(1000.0, 0.7));
+    bench(&mut group, "HighPass", HighPass::new(1000.0, 0.7));
+    bench(&mut group, "BandPass", BandPass::new(1000.0, 2.0));
+    bench(&mut group, "Biquad", Biquad::lowpass(1000.0, 0.7));
+    bench(&mut group, "Iir/4x2", Iir::new([0.2, 0.3, -0.1, 0.05], [-0.5, 0.25]));
+    bench(&mut group, "BiquadCascade/4", BiquadCascade::new([
+        Biquad::lowpass(200.0, 0.7),
+        Biquad::lowpass(400.0, 0.8),
+        Biquad::lowpass(800.0, 0.9),
+        Biquad::lowpass(1600.0, 1.0),
+    ]));
+    bench(&mut group, "Generic", Generic::new(
+        vec![(0, 0.69), (1, 0.32), (2, 0.13), (6, 0.4892)].into_iter().collect(),
+        vec![(1, 0.378_946_24), (5, 0.125_012_84), (300, 0.104_536_59)].into_iter().collect(),
+    ));
+    for &(name, min, max) in &[("Convolution/2s,uniform", 256, 256), ("Convolution/2s,64-4096", 64, 4096)] {
+        let mut taps = vec![0.0; 2 * SAMPLE_RATE as usize];
+        Noise::with_seed(1).process_block(&mut taps);
+        let ir = ImpulseResponse::with_partitions(&taps, SAMPLE_RATE as MathT, min, max);
+        bench(&mut group, name, Convolution::new(std::sync::Arc::new(ir)));
+    }
+    bench(&mut group, "ADSR", {
+        // Sustain is the state voices spend most of their time in.
+        let mut a = ADSR::new(ms(1), ms(1), -6.0, ms(100));
+        let mut t = vec![0.0; 480];
+        a.process_block(&mut t);
+        a
+    });
+    bench(&mut group, "Delay", Delay::new(ms(250)));
+    bench(&mut group, "Echo", Echo::new(ms(250), 0.5));
+    bench(&mut group, "MultiTap/4", {
+        let mut m = MultiTap::new(ms(1000));
+        for i in 1..=4 {
+            let t = m.tap(ms(200 * i), 0.5 / i as MathT);
+            m.add_tap(t);
+        }
+        m
+    });
+    bench(&mut group, "Automated/LowPass", {
+        let mut m = Automated::new(LowPass::new(100.0, 0.5), 100.0, LowPass::glide_central_frequency);
+        m.ramp_to(5000.0, Duration::from_secs(3600), Curve::Exponential);
+        m
+    });
+    bench(&mut group, "Series/LowPass,ADSR,Gain", (LowPass::new(1000.0, 0.7), ADSR::new(ms(1), ms(1), -6.0, ms(100)), Gain::new(0.5)));
+
+    bench_decay(&mut group, "Envelope", Envelope::new(20.0, 2000.0));
+    bench_decay(&mut group, "LowPass", LowPass::new(1000.0, 0.7));
+    bench_decay(&mut group, "Biquad", Biquad::lowpass(100.0, 0.7));
+    bench_decay(&mut group, "BiquadCascade/4", BiquadCascade::<4>::butterworth_lowpass(100.0));
+    bench_decay(&mut group, "Echo", Echo::new(ms(10), 0.9));
+    bench_decay(&mut group, "Generic", Generic::new(
+        vec![(0, 1.0)].into_iter().collect(),
+        vec![(0, 0.999)].into_iter().collect(),
+    ));
+
+    group.finish();
+}
+
+criterion_group!(benches, modifiers);
+criterion_main!(benches);
@@ -0,0 +1,119 @@
+//! Throughput of [`SimpleSound`], [`ComplexSound`], and [`Chain`] running a
+//! generator through chains of increasing depth, one sample at a time and
+//! through the block API, and of the same [`ComplexSound`]s with the chain
+//! frozen.
+
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkGroup, BenchmarkId, Criterion, Throughput};
+use criterion::measurement::WallTime;
+use bae_rs::{*, generators::*, modifiers::*, sounds::*};
+
+/// Number of samples processed per iteration, one block of the default
+/// context.
+const BLOCK: usize = DEFAULT_MAX_BLOCK;
+
+/// Numbers of modifiers following the generator.
+const DEPTHS: [usize; 5] = [0, 1, 4, 16, 64];
+
+fn bench<S: Sound>(group: &mut BenchmarkGroup<WallTime>, name: &str, depth: usize, mut s: S) {
+    let mut buf = vec![0.0; BLOCK];
+
+    group.bench_function(BenchmarkId::new(format!("{}/sample", name), depth), |b| b.iter(|| {
+        for x in buf.iter_mut() {
+            *x = s.process(0.0);
+        }
+        black_box(&buf);
+    }));
+    group.bench_function(BenchmarkId::new(format!("{}/block", name), depth), |b| b.iter(|| {
+        s.process_block(&mut buf);
+        black_box(&buf);
+    }));
+}
+
+/// Returns the `i`th filter of a chain, alternating between a low and a high
+/// pass so that the signal never decays to nothing.
+fn filter(i: usize) -> StandardBlock {
+    if i % 2 == 0 {
+        StandardBlock::from_modifier(LowPass::new(4000.0, 0.7))
+    } else {
+        StandardBlock::from_modifier(HighPass::new(100.0, 0.7))
+    }
+}
+
+fn simple_sound(depth: usize) -> SimpleSound {
+    let mut s = SimpleSound::from_block(1.0, 1.0, StandardBlock::from_generator(Sawtooth::new(220.0)));
+    for i in 0..depth {
+        s.add_standard_modifier(filter(i));
+    }
+
+    s
+}
+
+fn complex_sound(depth: usize) -> ComplexSound {
+    complex_chain(depth).0
+}
+
+/// Returns the sound of [`complex_sound`] with its chain frozen, rendered for
+/// a second.
+fn frozen_sound(depth: usize) -> ComplexSound {
+    let (mut s, n) = complex_chain(depth);
+    assert!(s.freeze(n, &Context::default(), SAMPLE_RATE as usize));
+
+    s
+}
+
+/// Returns a [`ComplexSound`] running a generator through `depth` filters,
+/// along with the node of the last of them.
+fn complex_chain(depth: usize) -> (ComplexSound, GraphNode) {
+    let mut s = ComplexSound::new(1.0, 1.0);
+
+    let mut n = s.add_standard_block(StandardBlock::from_generator(Sawtooth::new(220.0)));
+    for i in 0..depth {
+        let m = s.add_standard_block(filter(i));
+        s.add_connection(n, m);
+        n = m;
+    }
+    s.add_connection(n, s.get_output_gain());
+
+    (s, n)
+}
+
+/// Returns a [`ComplexSound`] of `width` independent generator and filter
+/// pairs mixed together, the kind of graph the `parallel` feature spreads
+/// over threads.
+fn wide_sound(width: usize) -> ComplexSound {
+    let mut s = ComplexSound::new(1.0, 1.0 / width as MathT);
+
+    for i in 0..width {
+        let g = s.add_standard_block(StandardBlock::from_generator(Sawtooth::new(110.0 * (i + 1) as MathT)));
+        let f = s.add_standard_block(filter(0));
+        s.add_connection(g, f);
+        s.add_connection(f, s.get_output_gain());
+    }
+
+    s
+}
+
+fn sounds(c: &mut Criterion) {
+    let mut group = c.benchmark_group("sounds");
+    group.throughput(Throughput::Elements(BLOCK as u64));
+
+    for &depth in DEPTHS.iter() {
+        bench(&mut group, "SimpleSound", depth, simple_sound(depth));
+        bench(&mut group, "ComplexSound", depth, complex_sound(depth));
+        bench(&mut group, "ComplexSound/frozen", depth, frozen_sound(depth));
+    }
+    for &width in DEPTHS.iter().skip(1) {
+        bench(&mut group, "ComplexSound/wide", width, wide_sound(width));
+    }
+
+    // The statically typed equivalents of the chains of depth 1 and 4.
+    let (lp, hp) = (|| LowPass::new(4000.0, 0.7), || HighPass::new(100.0, 0.7));
+    bench(&mut group, "Chain", 0, Chain::from_generator(Sawtooth::new(220.0)));
+    bench(&mut group, "Chain", 1, Chain::new(Sawtooth::new(220.0), (lp(),)));
+    bench(&mut group, "Chain", 4, Chain::new(Sawtooth::new(220.0), (lp(), hp(), lp(), hp())));
+
+    group.finish();
+}
+
+criterion_group!(benches, sounds);
+criterion_main!(benches);
@@ -0,0 +1,44 @@
+//! Throughput of reading and writing WAV files at each supported bit depth.
+
+use std::io::Cursor;
+use criterion::{black_box, criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput};
+use bae_rs::{*, generators::*, utils::*};
+
+/// Number of samples per channel of the benchmarked files, one second at
+/// the engine rate.
+const FRAMES: usize = SAMPLE_RATE as usize;
+
+/// Bit depths supported by [`write_wav`].
+const DEPTHS: [u16; 3] = [8, 16, 24];
+
+fn wav(c: &mut Criterion) {
+    let mut n = Noise::with_seed(0);
+    let tracks: Vec<SampleTrackT> = (0..2)
+        .map(|_| (0..FRAMES).map(|_| n.process() * 0.5).collect())
+        .collect();
+
+    let mut group = c.benchmark_group("wav");
+    group.throughput(Throughput::Elements((2 * FRAMES) as u64));
+
+    for &bps in DEPTHS.iter() {
+        let mut bytes = Vec::new();
+        write_wav(tracks.clone(), bps, &mut bytes, false).unwrap();
+
+        group.bench_function(BenchmarkId::new("write_wav", bps), |b| b.iter_batched(
+            || (tracks.clone(), Vec::with_capacity(bytes.len())),
+            |(t, mut out)| {
+                write_wav(t, bps, &mut out, false).unwrap();
+                out
+            },
+            BatchSize::LargeInput,
+        ));
+        group.bench_function(BenchmarkId::new("read_wav", bps), |b| b.iter(|| {
+            black_box(read_wav(&mut Cursor::new(&bytes[..])).unwrap());
+        }));
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, wav);
+criterion_main!(benches);
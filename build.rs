@@ -0,0 +1,114 @@
+//! Generates the lookup tables of the crate at build time, so that they are
+//! plain statics in the binary instead of being computed when first used.
+//! 
+//! Each table is written to its own file in `OUT_DIR` and included by the
+//! module that uses it, which also defines the constants sizing the table, so
+//! a table generated with different constants fails to compile. The tables are
+//! computed in `f64` and stored as `f32`.
+
+use std::env;
+use std::f64::consts::PI;
+use std::fmt::Write as _;
+use std::fs;
+use std::path::Path;
+
+/// Number of intervals of the sine wavetable, `WAVETABLE_SIZE` of
+/// `src/generators/sine.rs`.
+const WAVETABLE_SIZE: usize = 4_800;
+
+/// Number of taps and phases of the windowed-sinc kernel, from
+/// `src/utils/mono_resampler.rs`, and its cutoff relative to the source
+/// Nyquist rate.
+const SINC_TAPS: usize = 16;
+const SINC_PHASES: usize = 1 << 8;
+const SINC_CUTOFF: f64 = 0.9;
+
+/// Number of intervals of the constant power table, `PAN_STEPS` of
+/// `src/sample_format/pan.rs`.
+const PAN_STEPS: usize = 1024;
+
+fn main() {
+    println!("cargo:rerun-if-changed=build.rs");
+
+    let out = env::var("OUT_DIR").expect("OUT_DIR is set by cargo");
+    let out = Path::new(&out);
+
+    write_table(out, "sine_table.rs", "WAVETABLE", "[SampleT; WAVETABLE_SIZE as usize + 1]", &sine(), None);
+    write_table(out, "sinc_table.rs", "SINC_TABLE", "[[SampleT; SINC_TAPS]; SINC_PHASES + 1]", &sinc(), Some(SINC_TAPS));
+    write_table(out, "pan_table.rs", "PAN_TABLE", "[SampleT; PAN_STEPS + 2]", &pan(), None);
+}
+
+/// Writes `static NAME: TY = [...];` to `file`, with the values nested in rows
+/// of `row` values if given, to match the type. The values are written with
+/// enough digits to round trip exactly.
+fn write_table(out: &Path, file: &str, name: &str, ty: &str, values: &[f32], row: Option<usize>) {
+    let mut s = String::new();
+    writeln!(s, "static {}: {} = [", name, ty).unwrap();
+
+    match row {
+        Some(n) => for r in values.chunks(n) {
+            write!(s, "    [").unwrap();
+            for x in r {
+                write!(s, "{:?}, ", x).unwrap();
+            }
+            writeln!(s, "],").unwrap();
+        },
+        None => for x in values {
+            writeln!(s, "    {:?},", x).unwrap();
+        },
+    }
+    writeln!(s, "];").unwrap();
+
+    fs::write(out.join(file), s).expect("failed to write a generated table");
+}
+
+/// One period of a sine, with a guard sample equal to the first sample at the
+/// end so that interpolating never wraps around.
+fn sine() -> Vec<f32> {
+    (0..=WAVETABLE_SIZE)
+        .map(|i| (2.0 * PI * (i % WAVETABLE_SIZE) as f64 / WAVETABLE_SIZE as f64).sin() as f32)
+        .collect()
+}
+
+/// Polyphase table of the windowed-sinc kernel. Row `p` holds the taps for a
+/// fractional position of `p / SINC_PHASES`, with one extra row so adjacent
+/// rows can always be interpolated between.
+fn sinc() -> Vec<f32> {
+    let half = (SINC_TAPS / 2) as f64;
+
+    (0..=SINC_PHASES).flat_map(|p| {
+        let frac = p as f64 / SINC_PHASES as f64;
+
+        let h: Vec<f64> = (0..SINC_TAPS).map(|k| {
+            // Distance from the tap to the interpolated position.
+            let x = k as f64 - (half - 1.0) - frac;
+            let sinc = if x == 0.0 {
+                1.0
+            } else {
+                (PI * SINC_CUTOFF * x).sin() / (PI * SINC_CUTOFF * x)
+            };
+
+            // Blackman-Harris window over the span of the kernel.
+            let u = 2.0 * PI * (x / SINC_TAPS as f64 + 0.5);
+            let w = 0.35875 - 0.48829 * u.cos() + 0.14128 * (2.0 * u).cos() - 0.01168 * (3.0 * u).cos();
+
+            sinc * w
+        }).collect();
+
+        // Normalize each phase to unity gain at DC.
+        let sum: f64 = h.iter().sum();
+        h.into_iter().map(move |h| (h / sum) as f32)
+    }).collect()
+}
+
+/// `cos` of a quarter wave, with one guard value past the end so that
+/// interpolation never reads out of bounds.
+fn pan() -> Vec<f32> {
+    let mut t: Vec<f32> = (0..=PAN_STEPS)
+        .map(|i| (i as f64 * std::f64::consts::FRAC_PI_2 / PAN_STEPS as f64).cos() as f32)
+        .collect();
+    t[PAN_STEPS] = 0.0;
+    t.push(0.0);
+
+    t
+}
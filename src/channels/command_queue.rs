@@ -0,0 +1,319 @@
+//! # Command Queue
+//!
+//! Types for controlling a [`StandardChannel`] from another thread while it is
+//! rendering. Commands are pushed onto a wait-free queue by a
+//! [`ChannelController`] and executed by the channel at the start of each call
+//! to [`process`]. Anything the channel lets go of is sent back through a
+//! second queue so that it is dropped on the controlling thread rather than
+//! the render thread.
+//!
+//! [`StandardChannel`]: ../standard_channel/struct.StandardChannel.html
+//! [`ChannelController`]: struct.ChannelController.html
+//! [`process`]: ../trait.Channel.html#tymethod.process
+
+use super::*;
+use crate::modifiers::Biquad;
+use crate::utils::spsc::{self, Producer, Consumer};
+
+/// Closure applied to a registered [`Sound`] by [`Command::Modify`], used to
+/// change parameters of the [`Sound`] on the render thread.
+///
+/// [`Sound`]: ../../sounds/trait.Sound.html
+/// [`Command::Modify`]: enum.Command.html#variant.Modify
+pub type ModifyFn = Box<dyn FnMut(&mut dyn Sound) + Send>;
+
+/// Commands understood by a [`StandardChannel`].
+///
+/// Commands referring to a stale [`SoundHandle`] are ignored.
+///
+/// [`StandardChannel`]: ../standard_channel/struct.StandardChannel.html
+/// [`SoundHandle`]: ../struct.SoundHandle.html
+pub enum Command {
+    /// Registers the given [`Sound`] with the given handle.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    AddSound(SoundHandle, SoundSP),
+    /// Removes the [`Sound`] with the given handle.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    RemoveSound(SoundHandle),
+    /// Calls [`Sound::toggle_pause`] on the [`Sound`] with the given handle.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`Sound::toggle_pause`]: ../../sounds/trait.Sound.html#tymethod.toggle_pause
+    TogglePause(SoundHandle),
+    /// Calls [`Sound::toggle_mute`] on the [`Sound`] with the given handle.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`Sound::toggle_mute`]: ../../sounds/trait.Sound.html#tymethod.toggle_mute
+    ToggleMute(SoundHandle),
+    /// Sets the linear output gain of the channel.
+    SetGain(MathT),
+    /// Sets the linear gain the channel applies to the [`Sound`] with the given
+    /// handle when mixing it.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    SetSoundGain(SoundHandle, MathT),
+    /// Pans the [`Sound`] with the given handle to the given azimuth, as
+    /// [`StandardChannel::set_sound_pan`] does.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`StandardChannel::set_sound_pan`]: ../standard_channel/struct.StandardChannel.html#method.set_sound_pan
+    SetSoundPan(SoundHandle, MathT),
+    /// Applies the given closure to the [`Sound`] with the given handle.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    Modify(SoundHandle, ModifyFn),
+    /// Sets the coefficients of the given insert filter stage of the [`Sound`]
+    /// with the given handle, as [`StandardChannel::set_insert`] does.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`StandardChannel::set_insert`]: ../standard_channel/struct.StandardChannel.html#method.set_insert
+    SetInsert(SoundHandle, usize, Biquad),
+    /// Ramps the coefficients of the given insert filter stage of the
+    /// [`Sound`] with the given handle over the next block, as
+    /// [`StandardChannel::ramp_insert`] does.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`StandardChannel::ramp_insert`]: ../standard_channel/struct.StandardChannel.html#method.ramp_insert
+    RampInsert(SoundHandle, usize, Biquad),
+}
+
+/// Objects released by a [`StandardChannel`], sent back to its
+/// [`ChannelController`] to be dropped off the render thread.
+///
+/// [`StandardChannel`]: ../standard_channel/struct.StandardChannel.html
+/// [`ChannelController`]: struct.ChannelController.html
+pub enum Retired {
+    /// A [`Sound`] that was removed from the channel, along with the handle it
+    /// was registered with.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    Sound(SoundHandle, SoundSP),
+    /// A handle whose [`Sound`] was removed directly through
+    /// [`Channel::remove_sound`] rather than through the controller.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`Channel::remove_sound`]: ../trait.Channel.html#tymethod.remove_sound
+    Handle(SoundHandle),
+    /// A closure from a [`Command::Modify`] that has been applied or whose
+    /// handle was stale.
+    ///
+    /// [`Command::Modify`]: enum.Command.html#variant.Modify
+    Modify(ModifyFn),
+}
+
+/// The render-thread half of a command queue, held by the channel.
+pub(crate) struct CommandReceiver {
+    pub(crate) commands: Consumer<Command>,
+    pub(crate) retired: Producer<Retired>,
+}
+
+impl CommandReceiver {
+    /// Sends the given object back to the controller. The retired queue is
+    /// sized so that this cannot fail unless the controller stops collecting,
+    /// in which case the object is dropped here as a last resort.
+    pub(crate) fn retire(&mut self, r: Retired) {
+        let _ = self.retired.push(r);
+    }
+}
+
+/// The controlling half of a command queue, created by
+/// [`StandardChannel::connect`].
+///
+/// The controller allocates the [`SoundHandle`]s for the [`Sound`]s it adds
+/// from a range of slots reserved for it by the channel, so handles are
+/// available immediately without waiting on the render thread. Call
+/// [`collect`] regularly to drop retired objects and recycle their slots.
+///
+/// [`StandardChannel::connect`]: ../standard_channel/struct.StandardChannel.html#method.connect
+/// [`SoundHandle`]: ../struct.SoundHandle.html
+/// [`Sound`]: ../../sounds/trait.Sound.html
+/// [`collect`]: struct.ChannelController.html#method.collect
+pub struct ChannelController {
+    commands: Producer<Command>,
+    retired: Consumer<Retired>,
+    first_slot: usize,
+    generations: Vec<u32>,
+    free_slots: Vec<usize>,
+    context: Context,
+}
+
+impl ChannelController {
+    /// Creates the two halves of a command queue for `sounds` slots starting
+    /// at `first_slot`, able to hold `commands` pending commands, adding
+    /// sounds in the given context.
+    pub(crate) fn new(first_slot: usize, sounds: usize, commands: usize, context: Context) -> (Self, CommandReceiver) {
+        let (cp, cc) = spsc::spsc(commands);
+        let (rp, rc) = spsc::spsc(sounds + cp.capacity());
+
+        (
+            ChannelController {
+                commands: cp,
+                retired: rc,
+                first_slot,
+                generations: vec![0; sounds],
+                free_slots: (0..sounds).rev().collect(),
+                context,
+            },
+            CommandReceiver {
+                commands: cc,
+                retired: rp,
+            }
+        )
+    }
+
+    /// Queues the given [`Sound`] to be added to the channel, returning the
+    /// handle it will be registered with. If there is no free slot or the
+    /// queue is full, the [`Sound`] is handed back in the `Err` variant.
+    ///
+    /// The channel's [`Context`] is applied to the [`Sound`] here, on the
+    /// calling thread, so the render thread never does it.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn add_sound(&mut self, mut sound: SoundSP) -> Result<SoundHandle, SoundSP> {
+        if self.commands.free_space() == 0 {
+            return Err(sound);
+        }
+
+        let local = match self.free_slots.pop() {
+            Some(l) => l,
+            None => return Err(sound),
+        };
+
+        let handle = SoundHandle::new(self.first_slot + local, self.generations[local]);
+        sound.set_context(&self.context);
+
+        match self.commands.push(Command::AddSound(handle, sound)) {
+            Ok(()) => Ok(handle),
+            Err(Command::AddSound(_, sound)) => {
+                self.free_slots.push(local);
+                Err(sound)
+            },
+            Err(_) => unreachable!(),
+        }
+    }
+
+    /// Queues the [`Sound`] with the given handle to be removed. The removed
+    /// [`Sound`] is returned through [`collect`].
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`collect`]: struct.ChannelController.html#method.collect
+    pub fn remove_sound(&mut self, handle: SoundHandle) -> Result<(), Command> {
+        self.commands.push(Command::RemoveSound(handle))
+    }
+
+    /// Queues a toggle of the pause state of the [`Sound`] with the given
+    /// handle.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn toggle_pause(&mut self, handle: SoundHandle) -> Result<(), Command> {
+        self.commands.push(Command::TogglePause(handle))
+    }
+
+    /// Queues a toggle of the mute state of the [`Sound`] with the given
+    /// handle.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn toggle_mute(&mut self, handle: SoundHandle) -> Result<(), Command> {
+        self.commands.push(Command::ToggleMute(handle))
+    }
+
+    /// Queues a change of the channel's output gain.
+    pub fn set_gain(&mut self, gain: MathT) -> Result<(), Command> {
+        self.commands.push(Command::SetGain(gain))
+    }
+
+    /// Queues a change of the gain the channel applies to the [`Sound`] with
+    /// the given handle.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn set_sound_gain(&mut self, handle: SoundHandle, gain: MathT) -> Result<(), Command> {
+        self.commands.push(Command::SetSoundGain(handle, gain))
+    }
+
+    /// Queues a pan of the [`Sound`] with the given handle to the given
+    /// azimuth, in degrees clockwise from front center.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn set_sound_pan(&mut self, handle: SoundHandle, azimuth: MathT) -> Result<(), Command> {
+        self.commands.push(Command::SetSoundPan(handle, azimuth))
+    }
+
+    /// Queues the given closure to be applied to the [`Sound`] with the given
+    /// handle on the render thread. The closure itself is returned through
+    /// [`collect`] once it has run.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`collect`]: struct.ChannelController.html#method.collect
+    pub fn modify<F>(&mut self, handle: SoundHandle, f: F) -> Result<(), Command>
+        where F: 'static + FnMut(&mut dyn Sound) + Send
+    {
+        self.commands.push(Command::Modify(handle, Box::new(f)))
+    }
+
+    /// Queues a change of the coefficients of the given insert filter stage of
+    /// the [`Sound`] with the given handle.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn set_insert(&mut self, handle: SoundHandle, stage: usize, f: Biquad) -> Result<(), Command> {
+        self.commands.push(Command::SetInsert(handle, stage, f))
+    }
+
+    /// Queues a ramp of the coefficients of the given insert filter stage of
+    /// the [`Sound`] with the given handle over the next rendered block.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn ramp_insert(&mut self, handle: SoundHandle, stage: usize, f: Biquad) -> Result<(), Command> {
+        self.commands.push(Command::RampInsert(handle, stage, f))
+    }
+
+    /// Returns the number of [`Sound`]s that can still be added through this
+    /// controller.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn free_sounds(&self) -> usize {
+        self.free_slots.len()
+    }
+
+    /// Drains the objects retired by the channel, passing each one to `f`
+    /// (which typically just drops them) and recycling the slots of removed
+    /// [`Sound`]s. Returns the number of objects collected.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn collect_with<F>(&mut self, mut f: F) -> usize
+        where F: FnMut(Retired)
+    {
+        let mut n = 0;
+
+        while let Some(r) = self.retired.pop() {
+            match &r {
+                Retired::Sound(h, _) | Retired::Handle(h) => self.release(*h),
+                Retired::Modify(_) => (),
+            }
+
+            f(r);
+            n += 1;
+        }
+
+        n
+    }
+
+    /// Drops all objects retired by the channel and recycles the slots of
+    /// removed [`Sound`]s. Returns the number of objects collected.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn collect(&mut self) -> usize {
+        self.collect_with(|_| ())
+    }
+
+    fn release(&mut self, handle: SoundHandle) {
+        let local = handle.index().wrapping_sub(self.first_slot);
+
+        if local < self.generations.len() && self.generations[local] == handle.generation() {
+            self.generations[local] = self.generations[local].wrapping_add(1);
+            self.free_slots.push(local);
+        }
+    }
+}
@@ -7,13 +7,61 @@
 
 use super::*;
 use std::time::Duration;
-use std::sync::Arc;
 use crate::sounds::Sound;
 
+pub mod command_queue;
 pub mod standard_channel;
+pub mod voice_pool;
+pub use command_queue::*;
 pub use standard_channel::*;
+pub use voice_pool::*;
 
-type SoundSP = Arc<dyn Sound>;
+/// Alias for a [`Sound`] object owned by a [`Channel`].
+/// 
+/// [`Sound`]: ../sounds/trait.Sound.html
+/// [`Channel`]: trait.Channel.html
+pub type SoundSP = Box<dyn Sound>;
+
+/// Alias for a [`Channel`] object owned by a [`Mixer`].
+/// 
+/// [`Channel`]: trait.Channel.html
+/// [`Mixer`]: ../tools/mixer/struct.Mixer.html
+pub type ChannelSP<SF> = Box<dyn Channel<SF> + Send>;
+
+/// Handle referring to a [`Sound`] registered with a [`Channel`].
+/// 
+/// A handle pairs the index of the slot the [`Sound`] occupies with the
+/// generation of that slot. Slots are reused once their [`Sound`] is removed,
+/// and each reuse increments the generation, so a stale handle is rejected
+/// instead of referring to whichever [`Sound`] took its place.
+/// 
+/// [`Sound`]: ../sounds/trait.Sound.html
+/// [`Channel`]: trait.Channel.html
+#[derive(Copy,Clone,Debug,PartialEq,Eq,Hash)]
+pub struct SoundHandle {
+    index: u32,
+    generation: u32,
+}
+
+impl SoundHandle {
+    /// Creates a handle from the given slot index and generation.
+    pub fn new(index: usize, generation: u32) -> Self {
+        SoundHandle {
+            index: index as u32,
+            generation,
+        }
+    }
+
+    /// Returns the index of the slot the handle refers to.
+    pub fn index(&self) -> usize {
+        self.index as usize
+    }
+
+    /// Returns the generation of the slot the handle refers to.
+    pub fn generation(&self) -> u32 {
+        self.generation
+    }
+}
 
 /// Trait defining the simplest possible interface for a channel, with the
 /// ability to process a batch of samples at a time.
@@ -26,9 +74,39 @@ pub trait Channel<SF>
     /// [`process`]: trait.Channel.html#tymethod.process
     fn set_process_time(&mut self, d: Duration);
 
+    /// Applies the given [`Context`] to the channel and every [`Sound`]
+    /// registered with it, and sizes the internal track for blocks of
+    /// [`max_block`] samples. [`Sound`]s added later are given the same
+    /// context.
+    /// 
+    /// The default implementation does nothing.
+    /// 
+    /// [`Context`]: ../context/struct.Context.html
+    /// [`Sound`]: ../sounds/trait.Sound.html
+    /// [`max_block`]: ../context/struct.Context.html#method.max_block
+    fn set_context(&mut self, _ctx: &Context) {}
+
     /// Returns a reference to the internal track of samples.
     fn get_output(&self) -> &Vec<SF>;
 
+    /// Adds the internal track of samples to the channels of the given
+    /// [`PlanarBuffer`], which must have [`SampleFormat::num_samples`]
+    /// channels.
+    /// 
+    /// The default implementation reads one value at a time from
+    /// [`get_output`]. Channels that mix in planar layout should override it.
+    /// 
+    /// [`PlanarBuffer`]: ../sample_format/planar/struct.PlanarBuffer.html
+    /// [`SampleFormat::num_samples`]: ../sample_format/trait.SampleFormat.html#tymethod.num_samples
+    /// [`get_output`]: trait.Channel.html#tymethod.get_output
+    fn mix_output(&self, planar: &mut PlanarBuffer) {
+        for (c, ch) in planar.iter_mut().enumerate() {
+            for (x, s) in ch.iter_mut().zip(self.get_output()) {
+                *x += s.get_channel(c);
+            }
+        }
+    }
+
     /// Sets the gain of the output of the channel.
     fn set_gain(&mut self, gain: MathT);
 
@@ -36,17 +114,21 @@ pub trait Channel<SF>
     /// internal track of samples.
     fn process(&mut self);
 
-    /// Adds a [`Sound`] to the [`Channel`] for processing.
+    /// Adds a [`Sound`] to the [`Channel`] for processing, returning the
+    /// [`SoundHandle`] it was registered with.
     /// 
     /// [`Channel`]: trait.Channel.html
     /// [`Sound`]: ../sounds/trait.Sound.html
-    fn add_sound(&mut self, sound: &mut SoundSP);
+    /// [`SoundHandle`]: struct.SoundHandle.html
+    fn add_sound(&mut self, sound: SoundSP) -> SoundHandle;
 
-    /// Removes a [`Sound`] from the [`Channel`].
+    /// Removes a [`Sound`] from the [`Channel`], returning it if the given
+    /// handle was still valid.
     /// 
-    /// The `id` parameter can be accessed from the registered [`Sound`] itself.
+    /// The `handle` parameter can also be accessed from the registered
+    /// [`Sound`] itself.
     /// 
     /// [`Channel`]: trait.Channel.html
     /// [`Sound`]: ../sounds/trait.Sound.html
-    fn remove_sound(&mut self, id: usize);
+    fn remove_sound(&mut self, handle: SoundHandle) -> Option<SoundSP>;
 }
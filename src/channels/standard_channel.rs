@@ -2,84 +2,776 @@
 
 use super::*;
 
-use std::sync::Arc;
-use std::collections::HashMap;
-use crate::sample_format::SampleFormat;
+use crate::modifiers::{Biquad, BiquadBank};
+use crate::sample_format::{SampleFormat, PlanarBuffer, pan_gains};
+use crate::utils::{denormal::DenormalGuard, simd};
+use std::ops::Range;
+#[cfg(feature = "parallel")]
+use rayon::prelude::*;
+#[cfg(feature = "instrumentation")]
+use crate::instrumentation::RenderStats;
+#[cfg(feature = "instrumentation")]
+use std::{sync::Arc, time::Instant};
+
+/// Number of insert filter stages available to each [`Sound`] of a
+/// [`StandardChannel`], enough for a low pass and a high pass section.
+///
+/// [`Sound`]: ../../sounds/trait.Sound.html
+/// [`StandardChannel`]: struct.StandardChannel.html
+pub const INSERT_STAGES: usize = 2;
+
+/// Entry in the slot table of a [`StandardChannel`], mapping a
+/// [`SoundHandle`] to the position of its [`Sound`] in the dense sound list.
+///
+/// [`StandardChannel`]: struct.StandardChannel.html
+/// [`SoundHandle`]: ../struct.SoundHandle.html
+/// [`Sound`]: ../../sounds/trait.Sound.html
+///
+/// With the `instrumentation` feature enabled, the slot also holds the render
+/// time statistics of the [`Sound`] occupying it.
+struct Slot {
+    generation: u32,
+    dense: Option<usize>,
+    #[cfg(feature = "instrumentation")]
+    stats: Arc<RenderStats>,
+}
+
+impl Slot {
+    fn new(_ctx: &Context) -> Self {
+        Slot {
+            generation: 0,
+            dense: None,
+            #[cfg(feature = "instrumentation")]
+            stats: Arc::new(RenderStats::with_context(_ctx)),
+        }
+    }
+}
 
 /// Standard implementation of the [`Channel`] trait.
-/// 
+///
+/// Registered [`Sound`]s are kept in a dense, contiguous list which is
+/// iterated once per call to [`process`]. Each [`Sound`] renders a whole block
+/// into a scratch buffer which is then summed into a planar mix buffer with
+/// the vectorized kernels in [`utils::simd`], so no lookups or reference
+/// counting happen inside the sample loop. The mix is available directly
+/// through [`get_planar_output`], or interleaved through [`get_output`].
+///
+/// A channel that is rendered on its own thread can be controlled without
+/// locking through a [`ChannelController`] created with [`connect`].
+///
+/// Each [`Sound`] can be given up to [`INSERT_STAGES`] insert filter sections
+/// with [`set_insert`], applied to its output before it is mixed. The inserts
+/// of all registered [`Sound`]s are kept in one [`BiquadBank`] per stage, so
+/// they are filtered together in SIMD lanes rather than one at a time.
+///
+/// Each [`Sound`] is mixed into every channel with the gains of
+/// [`SampleFormat::from_sample`] until it is panned with [`set_sound_pan`].
+/// The pan gains are computed once when they are set and ramped to over the
+/// next block, so moving sounds cost one ramped mix per channel.
+///
+/// [`Sound`]s that are paused or [finished] are not processed at all, so a
+/// voice that has faded out costs nothing until it is changed again. With
+/// [`set_auto_retire`], finished [`Sound`]s are removed from the channel
+/// instead once their inserts have rung out, as for one-shots that are never
+/// played again.
+///
+/// With the `parallel` feature enabled, each [`Sound`] renders into its
+/// scratch buffer on the global [`rayon`] thread pool, and the buffers are
+/// then summed in order on the calling thread, so the output is identical to
+/// that of the serial path.
+///
+/// With the `instrumentation` feature enabled, the channel records the time
+/// taken by each call to [`process`] and the number of [`Sound`]s it rendered
+/// in a [`RenderStats`], returned by [`stats`], and the time taken by each
+/// [`Sound`] in one [`RenderStats`] per slot, returned by [`sound_stats`].
+/// Slot statistics are cleared whenever a new [`Sound`] takes the slot.
+///
 /// [`Channel`]: ../trait.Channel.html
-#[derive(Clone)]
+/// [`Sound`]: ../../sounds/trait.Sound.html
+/// [`process`]: ../trait.Channel.html#tymethod.process
+/// [`ChannelController`]: ../command_queue/struct.ChannelController.html
+/// [`connect`]: struct.StandardChannel.html#method.connect
+/// [`utils::simd`]: ../../utils/simd/index.html
+/// [`get_planar_output`]: struct.StandardChannel.html#method.get_planar_output
+/// [`get_output`]: ../trait.Channel.html#tymethod.get_output
+/// [`INSERT_STAGES`]: constant.INSERT_STAGES.html
+/// [`set_insert`]: struct.StandardChannel.html#method.set_insert
+/// [`SampleFormat::from_sample`]: ../../sample_format/trait.SampleFormat.html#tymethod.from_sample
+/// [`set_sound_pan`]: struct.StandardChannel.html#method.set_sound_pan
+/// [finished]: ../../sounds/trait.Sound.html#method.is_finished
+/// [`set_auto_retire`]: struct.StandardChannel.html#method.set_auto_retire
+/// [`BiquadBank`]: ../../modifiers/biquad_bank/struct.BiquadBank.html
+/// [`rayon`]: https://docs.rs/rayon
+/// [`RenderStats`]: ../../instrumentation/struct.RenderStats.html
+/// [`stats`]: struct.StandardChannel.html#method.stats
+/// [`sound_stats`]: struct.StandardChannel.html#method.sound_stats
 pub struct StandardChannel<SF>
     where SF: SampleFormat
 {
     output: Vec<SF>,
-    sounds: HashMap<usize, SoundSP>,
+    mix: PlanarBuffer,
+    unit: Vec<SampleT>,
+    sounds: Vec<SoundSP>,
+    gains: Vec<SampleT>,
+    pans: Vec<SampleT>,
+    applied: Vec<SampleT>,
+    owners: Vec<usize>,
+    slots: Vec<Slot>,
+    free_slots: Vec<usize>,
+    reserved: Range<usize>,
+    remote: Option<CommandReceiver>,
+    scratch: Vec<SampleTrackT>,
+    inserts: [BiquadBank; INSERT_STAGES],
     gain: SampleT,
-    id_counter: usize
+    auto_retire: bool,
+    context: Context,
+    #[cfg(feature = "instrumentation")]
+    stats: Arc<RenderStats>,
 }
 
 impl<SF> StandardChannel<SF>
     where SF: SampleFormat
 {
     /// Creates a new channel with the given gain.
-    /// 
+    ///
     /// The internal track is initialized for 10ms' worth of samples. Call
     /// [`set_process_time`] to change this.
-    /// 
+    ///
     /// [`set_process_time`]: ../trait.Channel.html#tymethod.set_process_time
     pub fn new(gain: MathT) -> Self {
+        Self::with_capacity(gain, 0)
+    }
+
+    /// Creates a new channel with the given gain and room for `sounds`
+    /// [`Sound`]s to be added without reallocating.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn with_capacity(gain: MathT, sounds: usize) -> Self {
+        Self::with_context(gain, sounds, Context::default())
+    }
+
+    /// Creates a new channel with the given gain and room for `sounds`
+    /// [`Sound`]s, running at the sample rate of the given [`Context`]. The
+    /// internal track is initialized for blocks of its maximum size, and
+    /// every [`Sound`] added is given the context.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn with_context(gain: MathT, sounds: usize, context: Context) -> Self {
+        let len = context.max_block();
+
+        let mut output = Vec::with_capacity(len);
+        output.resize_with(len, SF::default);
+
+        let unit = SF::from_sample(1.0);
+
         StandardChannel {
-            output: Vec::with_capacity((0.01 * SAMPLE_RATE as MathT) as usize),
-            sounds: HashMap::new(),
+            output,
+            mix: PlanarBuffer::new(SF::num_samples(), len),
+            unit: (0..SF::num_samples()).map(|c| unit.get_channel(c)).collect(),
+            sounds: Vec::with_capacity(sounds),
+            gains: Vec::with_capacity(sounds),
+            pans: Vec::with_capacity(sounds * SF::num_samples()),
+            applied: Vec::with_capacity(sounds * SF::num_samples()),
+            owners: Vec::with_capacity(sounds),
+            slots: Vec::with_capacity(sounds),
+            free_slots: Vec::with_capacity(sounds),
+            reserved: 0..0,
+            remote: None,
+            scratch: (0..sounds).map(|_| vec![SampleT::default(); len]).collect(),
+            inserts: [(); INSERT_STAGES].map(|_| {
+                let mut bank = BiquadBank::new(0);
+                bank.set_context(&context);
+                bank.reserve_voices(sounds);
+                bank.reserve_frames(len);
+                bank
+            }),
             gain: gain as SampleT,
-            id_counter: 0
+            auto_retire: false,
+            context,
+            #[cfg(feature = "instrumentation")]
+            stats: Arc::new(RenderStats::with_context(&context)),
+        }
+    }
+
+    /// Returns the [`Context`] the channel runs in.
+    ///
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn get_context(&self) -> &Context {
+        &self.context
+    }
+
+    /// Creates a [`ChannelController`] for this channel, reserving room for
+    /// `sounds` [`Sound`]s to be added through it and queueing up to
+    /// `commands` commands between calls to [`process`].
+    ///
+    /// All memory needed to execute the controller's commands is allocated
+    /// here, so [`process`] never allocates on their behalf. Connecting again
+    /// detaches the previous controller, whose reserved slots are not reused.
+    ///
+    /// The controller applies the channel's [`Context`] to the [`Sound`]s it
+    /// adds before queueing them, so the context should be set before
+    /// connecting.
+    ///
+    /// [`ChannelController`]: ../command_queue/struct.ChannelController.html
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`process`]: ../trait.Channel.html#tymethod.process
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn connect(&mut self, sounds: usize, commands: usize) -> ChannelController {
+        let first = self.slots.len();
+
+        self.slots.reserve(sounds);
+        self.scratch.reserve(sounds);
+        for _ in 0..sounds {
+            self.push_slot();
+        }
+
+        self.sounds.reserve(sounds);
+        self.gains.reserve(sounds);
+        self.pans.reserve(sounds * SF::num_samples());
+        self.applied.reserve(sounds * SF::num_samples());
+        self.owners.reserve(sounds);
+        for bank in &mut self.inserts {
+            bank.reserve_voices(sounds);
+        }
+
+        self.reserved = first..first + sounds;
+
+        let (controller, receiver) = ChannelController::new(first, sounds, commands, self.context);
+        self.remote = Some(receiver);
+
+        controller
+    }
+
+    /// Returns the output of the last call to [`process`] in planar layout,
+    /// with one channel for each of [`SampleFormat::num_samples`].
+    /// 
+    /// [`process`]: ../trait.Channel.html#tymethod.process
+    /// [`SampleFormat::num_samples`]: ../../sample_format/trait.SampleFormat.html#tymethod.num_samples
+    pub fn get_planar_output(&self) -> &PlanarBuffer {
+        &self.mix
+    }
+
+    /// Returns the render time statistics of the channel.
+    #[cfg(feature = "instrumentation")]
+    pub fn stats(&self) -> &Arc<RenderStats> {
+        &self.stats
+    }
+
+    /// Returns the render time statistics of the [`Sound`] registered with
+    /// the given handle, or `None` if the handle is stale.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    #[cfg(feature = "instrumentation")]
+    pub fn sound_stats(&self, handle: SoundHandle) -> Option<&Arc<RenderStats>> {
+        self.dense_index(handle)?;
+        Some(&self.slots[handle.index()].stats)
+    }
+
+    /// Sets whether [`Sound`]s are removed from the channel once they are
+    /// [finished] and their inserts have rung out, off by default. Removed
+    /// [`Sound`]s are dropped along with their inserts, unless they were added
+    /// through a [`ChannelController`], which gets them back when it collects
+    /// and releases their handles.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [finished]: ../../sounds/trait.Sound.html#method.is_finished
+    /// [`ChannelController`]: ../command_queue/struct.ChannelController.html
+    pub fn set_auto_retire(&mut self, retire: bool) {
+        self.auto_retire = retire;
+    }
+
+    /// Returns whether finished [`Sound`]s are removed from the channel.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn get_auto_retire(&self) -> bool {
+        self.auto_retire
+    }
+
+    /// Returns the number of [`Sound`]s registered with the channel.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn sound_count(&self) -> usize {
+        self.sounds.len()
+    }
+
+    /// Returns a reference to the [`Sound`] registered with the given handle,
+    /// or `None` if the handle is stale.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn get_sound(&self, handle: SoundHandle) -> Option<&SoundSP> {
+        let dense = self.dense_index(handle)?;
+        Some(&self.sounds[dense])
+    }
+
+    /// Returns a mutable reference to the [`Sound`] registered with the given
+    /// handle, or `None` if the handle is stale.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn get_sound_mut(&mut self, handle: SoundHandle) -> Option<&mut SoundSP> {
+        let dense = self.dense_index(handle)?;
+        Some(&mut self.sounds[dense])
+    }
+
+    /// Sets the gain of the [`Sound`] registered with the given handle.
+    /// Returns false if the handle is stale.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn set_sound_gain(&mut self, handle: SoundHandle, gain: MathT) -> bool {
+        match self.dense_index(handle) {
+            Some(d) => {
+                self.gains[d] = gain as SampleT;
+                true
+            },
+            None => false,
+        }
+    }
+
+    /// Returns the gain of the [`Sound`] registered with the given handle, or
+    /// `None` if the handle is stale.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn get_sound_gain(&self, handle: SoundHandle) -> Option<MathT> {
+        Some(self.gains[self.dense_index(handle)?] as MathT)
+    }
+
+    /// Pans the [`Sound`] registered with the given handle to the given
+    /// azimuth, in degrees clockwise from front center, with the gains of
+    /// [`pan_gains`]. The gains are ramped to over the next block. Returns
+    /// false if the handle is stale.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`pan_gains`]: ../../sample_format/pan/fn.pan_gains.html
+    pub fn set_sound_pan(&mut self, handle: SoundHandle, azimuth: MathT) -> bool {
+        match self.dense_index(handle) {
+            Some(d) => {
+                let n = self.unit.len();
+                pan_gains::<SF>(azimuth, &mut self.pans[d * n..(d + 1) * n]);
+                true
+            },
+            None => false,
+        }
+    }
+
+    /// Returns the gain of each channel the [`Sound`] registered with the
+    /// given handle is being panned to, or `None` if the handle is stale.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn get_sound_pan_gains(&self, handle: SoundHandle) -> Option<&[SampleT]> {
+        let (d, n) = (self.dense_index(handle)?, self.unit.len());
+        Some(&self.pans[d * n..(d + 1) * n])
+    }
+
+    /// Sets the coefficients of the given insert filter stage of the
+    /// [`Sound`] registered with the given handle. Returns false if the handle
+    /// is stale or there is no such stage.
+    ///
+    /// Every stage of a newly added [`Sound`] passes its output through
+    /// unchanged. Filters made by a design constructor of [`Biquad`] are
+    /// designed for the sample rate of the channel's [`Context`], and again
+    /// whenever the context changes.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`Biquad`]: ../../modifiers/iir/type.Biquad.html
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn set_insert(&mut self, handle: SoundHandle, stage: usize, f: &Biquad) -> bool {
+        match (self.dense_index(handle), self.inserts.get_mut(stage)) {
+            (Some(d), Some(bank)) => {
+                bank.set_voice(d, f);
+                true
+            },
+            _ => false,
+        }
+    }
+
+    /// Ramps the coefficients of the given insert filter stage of the
+    /// [`Sound`] registered with the given handle to those of `f` over the next
+    /// call to [`process`], for modulating a filter without zipper noise.
+    /// Returns false if the handle is stale or there is no such stage.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`process`]: ../trait.Channel.html#tymethod.process
+    pub fn ramp_insert(&mut self, handle: SoundHandle, stage: usize, f: &Biquad) -> bool {
+        match (self.dense_index(handle), self.inserts.get_mut(stage)) {
+            (Some(d), Some(bank)) => {
+                bank.ramp_voice(d, f);
+                true
+            },
+            _ => false,
+        }
+    }
+
+    /// Returns the current coefficients of the given insert filter stage of
+    /// the [`Sound`] registered with the given handle, or `None` if the handle
+    /// is stale or there is no such stage.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn get_insert(&self, handle: SoundHandle, stage: usize) -> Option<Biquad> {
+        let d = self.dense_index(handle)?;
+        Some(self.inserts.get(stage)?.get_voice(d))
+    }
+
+    /// Makes every insert filter stage of the [`Sound`] registered with the
+    /// given handle pass its output through unchanged. Returns false if the
+    /// handle is stale.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn clear_inserts(&mut self, handle: SoundHandle) -> bool {
+        match self.dense_index(handle) {
+            Some(d) => {
+                for bank in &mut self.inserts {
+                    bank.reset_voice(d);
+                }
+                true
+            },
+            None => false,
+        }
+    }
+
+    fn dense_index(&self, handle: SoundHandle) -> Option<usize> {
+        let slot = self.slots.get(handle.index())?;
+
+        if slot.generation == handle.generation() {
+            slot.dense
+        } else {
+            None
+        }
+    }
+
+    fn insert(&mut self, handle: SoundHandle, mut sound: SoundSP) {
+        sound.register(handle);
+
+        let slot = &mut self.slots[handle.index()];
+        slot.generation = handle.generation();
+        slot.dense = Some(self.sounds.len());
+        #[cfg(feature = "instrumentation")]
+        slot.stats.reset();
+
+        self.sounds.push(sound);
+        self.gains.push(1.0);
+        self.pans.extend_from_slice(&self.unit);
+        self.applied.extend_from_slice(&self.unit);
+        self.owners.push(handle.index());
+
+        for bank in &mut self.inserts {
+            bank.push();
         }
     }
 
-    fn get_id(&mut self) -> usize {
-        let old = self.id_counter;
+    fn detach(&mut self, dense: usize) -> SoundSP {
+        let index = self.owners.swap_remove(dense);
+        let mut sound = self.sounds.swap_remove(dense);
+        self.gains.swap_remove(dense);
+        swap_remove_gains(&mut self.pans, dense, self.unit.len());
+        swap_remove_gains(&mut self.applied, dense, self.unit.len());
+        for bank in &mut self.inserts {
+            bank.swap_remove(dense);
+        }
+
+        if let Some(&moved) = self.owners.get(dense) {
+            self.slots[moved].dense = Some(dense);
+        }
+
+        let slot = &mut self.slots[index];
+        slot.dense = None;
+        slot.generation = slot.generation.wrapping_add(1);
+
+        if !self.reserved.contains(&index) {
+            self.free_slots.push(index);
+        }
+
+        sound.unregister();
+
+        sound
+    }
+
+    fn execute(&mut self, command: Command, remote: &mut CommandReceiver) {
+        match command {
+            Command::AddSound(h, s) => {
+                if self.reserved.contains(&h.index()) && self.slots[h.index()].dense.is_none() {
+                    self.insert(h, s);
+                } else {
+                    remote.retire(Retired::Sound(h, s));
+                }
+            },
+            Command::RemoveSound(h) => {
+                if let Some(d) = self.dense_index(h) {
+                    let s = self.detach(d);
+                    remote.retire(Retired::Sound(h, s));
+                }
+            },
+            Command::TogglePause(h) => {
+                if let Some(s) = self.get_sound_mut(h) {
+                    s.toggle_pause();
+                }
+            },
+            Command::ToggleMute(h) => {
+                if let Some(s) = self.get_sound_mut(h) {
+                    s.toggle_mute();
+                }
+            },
+            Command::SetGain(g) => {
+                self.gain = g as SampleT;
+            },
+            Command::SetSoundGain(h, g) => {
+                self.set_sound_gain(h, g);
+            },
+            Command::SetSoundPan(h, a) => {
+                self.set_sound_pan(h, a);
+            },
+            Command::Modify(h, mut f) => {
+                if let Some(s) = self.get_sound_mut(h) {
+                    f(s.as_mut());
+                }
+                remote.retire(Retired::Modify(f));
+            },
+            Command::SetInsert(h, stage, f) => {
+                self.set_insert(h, stage, &f);
+            },
+            Command::RampInsert(h, stage, f) => {
+                self.ramp_insert(h, stage, &f);
+            },
+        }
+    }
+
+    /// Renders a block of the given [`Sound`] into its scratch buffer, timing
+    /// it in the statistics of its slot. Paused and finished [`Sound`]s render
+    /// silence without being processed. The silence still runs through the
+    /// inserts, so those of finished [`Sound`]s ring out, but paused
+    /// [`Sound`]s are left out of the mix, which cuts their inserts off.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    fn render(sound: &mut SoundSP, scratch: &mut [SampleT], _slot: &Slot) {
+        #[cfg(feature = "instrumentation")]
+        let start = Instant::now();
+
+        for x in scratch.iter_mut() {
+            *x = SampleT::default();
+        }
+
+        if !sound.is_paused() && !sound.is_finished() {
+            sound.process_block(scratch);
+        }
+
+        #[cfg(feature = "instrumentation")]
+        _slot.stats.record(start.elapsed(), scratch.len());
+    }
 
-        self.id_counter += 1;
+    /// Adds a [`Sound`] that has already been given the channel's
+    /// [`Context`], as for a voice moving between the real and virtual
+    /// states.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`Context`]: ../../context/struct.Context.html
+    pub(crate) fn add_configured_sound(&mut self, sound: SoundSP) -> SoundHandle {
+        let handle = self.allocate_slot();
 
-        old
+        self.insert(handle, sound);
+
+        handle
+    }
+
+    /// Resizes the internal track and every buffer sized with it to `len`
+    /// samples.
+    fn set_length(&mut self, len: usize) {
+        self.output.clear();
+        self.output.resize_with(len, SF::default);
+        self.mix.resize(SF::num_samples(), len);
+
+        for s in &mut self.scratch {
+            s.resize(len, SampleT::default());
+        }
+        for bank in &mut self.inserts {
+            bank.reserve_frames(len);
+        }
+    }
+
+    /// Removes every finished, unpaused [`Sound`] whose inserts have rung
+    /// out, handing those added through the controller back to it.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    fn retire_finished(&mut self) {
+        for d in (0..self.sounds.len()).rev() {
+            let sound = &self.sounds[d];
+            if sound.is_paused() || !sound.is_finished() || !self.inserts.iter().all(|b| b.is_voice_silent(d)) {
+                continue;
+            }
+
+            let index = self.owners[d];
+            let handle = SoundHandle::new(index, self.slots[index].generation);
+            let sound = self.detach(d);
+
+            if self.reserved.contains(&index) {
+                if let Some(remote) = &mut self.remote {
+                    remote.retire(Retired::Sound(handle, sound));
+                }
+            }
+        }
+    }
+
+    fn allocate_slot(&mut self) -> SoundHandle {
+        if let Some(index) = self.free_slots.pop() {
+            SoundHandle::new(index, self.slots[index].generation)
+        } else {
+            self.push_slot();
+            SoundHandle::new(self.slots.len() - 1, 0)
+        }
+    }
+
+    /// Adds a new slot, along with a scratch buffer for the [`Sound`] that
+    /// takes it unless one is left over, so that there are always at least
+    /// as many scratch buffers as slots and inserting a [`Sound`] never
+    /// allocates one.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    fn push_slot(&mut self) {
+        self.slots.push(Slot::new(&self.context));
+
+        if self.scratch.len() < self.slots.len() {
+            self.scratch.push(vec![SampleT::default(); self.output.len()]);
+        }
     }
 }
 
+/// Removes the `n` gains of the given sound, replacing them with those of the
+/// last sound, as `swap_remove` does for single values.
+fn swap_remove_gains(v: &mut Vec<SampleT>, dense: usize, n: usize) {
+    let last = v.len() - n;
+    if dense * n != last {
+        v.copy_within(last.., dense * n);
+    }
+    v.truncate(last);
+}
+
 impl<SF> Channel<SF> for StandardChannel<SF>
     where SF: SampleFormat
 {
     fn set_process_time(&mut self, d: Duration) {
-        self.output = Vec::with_capacity((d.as_secs_f64() * SAMPLE_RATE as MathT) as usize);
+        self.set_length((d.as_secs_f64() * self.context.sample_rate()) as usize);
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        self.context = *ctx;
+        for s in &mut self.sounds {
+            s.set_context(ctx);
+        }
+        for bank in &mut self.inserts {
+            bank.set_context(ctx);
+        }
+
+        #[cfg(feature = "instrumentation")]
+        {
+            self.stats.set_context(ctx);
+            for slot in &self.slots {
+                slot.stats.set_context(ctx);
+            }
+        }
+
+        self.set_length(ctx.max_block());
     }
 
     fn get_output(&self) -> &Vec<SF> {
         &self.output
     }
 
+    fn mix_output(&self, planar: &mut PlanarBuffer) {
+        planar.add(&self.mix);
+    }
+
     fn set_gain(&mut self, gain: MathT) {
         self.gain = gain as SampleT;
     }
 
     fn process(&mut self) {
-        self.output.resize_with(self.output.len(), SF::default);
+        #[cfg(feature = "instrumentation")]
+        let start = Instant::now();
+        let _guard = DenormalGuard::new();
 
-        for sample in &mut self.output {
-            for mut sound in &mut self.sounds {
-                *sample += SF::from_sample(Arc::get_mut(&mut sound.1).unwrap().process(Default::default()));
+        if let Some(mut remote) = self.remote.take() {
+            while let Some(c) = remote.commands.pop() {
+                self.execute(c, &mut remote);
             }
+            self.remote = Some(remote);
+        }
 
-            *sample *= self.gain;
+        self.mix.clear();
+
+        let scratch = &mut self.scratch[..self.sounds.len()];
+        let slots = &self.slots;
+
+        #[cfg(not(feature = "parallel"))]
+        for ((sound, scratch), &o) in self.sounds.iter_mut().zip(scratch.iter_mut()).zip(&self.owners) {
+            Self::render(sound, scratch, &slots[o]);
+        }
+
+        #[cfg(feature = "parallel")]
+        self.sounds.par_iter_mut()
+            .zip(scratch.par_iter_mut())
+            .zip(self.owners.par_iter())
+            .for_each(|((sound, scratch), &o)| {
+                let _guard = DenormalGuard::new();
+                Self::render(sound, scratch, &slots[o]);
+            });
+
+        for bank in &mut self.inserts {
+            bank.process(scratch);
+        }
+
+        let n = self.unit.len();
+        let pans = self.pans.chunks_exact(n).zip(self.applied.chunks_exact_mut(n));
+        for (((sound, g), scratch), (to, from)) in self.sounds.iter().zip(&self.gains).zip(scratch.iter()).zip(pans) {
+            if sound.is_paused() {
+                continue;
+            }
+
+            for ((ch, t), f) in self.mix.iter_mut().zip(to).zip(from) {
+                if *t == *f {
+                    simd::mix(ch, scratch, *g * *t);
+                } else {
+                    let dg = *g * (*t - *f) / scratch.len() as SampleT;
+                    simd::mix_ramp(ch, scratch, *g * *f, dg);
+                    *f = *t;
+                }
+            }
+        }
+
+        self.mix.mul(self.gain);
+
+        SF::from_planar(&self.mix, &mut self.output);
+
+        if self.auto_retire {
+            self.retire_finished();
+        }
+
+        #[cfg(feature = "instrumentation")]
+        {
+            self.stats.record_voices(self.sounds.len());
+            self.stats.record(start.elapsed(), self.output.len());
         }
     }
 
-    fn add_sound(&mut self, sound: &mut SoundSP) {
-        let id = self.get_id();
-        SoundSP::get_mut(sound).unwrap().register(id);
-        self.sounds.insert(id, sound.clone());
+    /// Adds a [`Sound`] to the channel, applying the channel's [`Context`]
+    /// to it first.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`Context`]: ../../context/struct.Context.html
+    fn add_sound(&mut self, mut sound: SoundSP) -> SoundHandle {
+        sound.set_context(&self.context);
+
+        self.add_configured_sound(sound)
     }
 
-    fn remove_sound(&mut self, id: usize) {
-        self.sounds.remove(&id);
+    fn remove_sound(&mut self, handle: SoundHandle) -> Option<SoundSP> {
+        let dense = self.dense_index(handle)?;
+
+        let sound = self.detach(dense);
+
+        if self.reserved.contains(&handle.index()) {
+            if let Some(remote) = &mut self.remote {
+                remote.retire(Retired::Handle(handle));
+            }
+        }
+
+        Some(sound)
     }
 }
@@ -0,0 +1,587 @@
+//! # Voice Pool
+
+use super::*;
+
+use crate::sample_format::PlanarBuffer;
+use std::ops::Range;
+
+/// Default level below which the voices of a [`VoicePool`] are made virtual,
+/// -60dB.
+///
+/// [`VoicePool`]: struct.VoicePool.html
+pub const VIRTUAL_THRESHOLD: MathT = 0.001;
+
+/// Rule a [`VoicePool`] follows to pick the voice to take over when a
+/// template is played while all of its voices are busy.
+///
+/// Whatever the policy, a voice is only taken over by a sound of the same or
+/// a higher priority.
+///
+/// [`VoicePool`]: struct.VoicePool.html
+#[derive(Copy,Clone,Debug,PartialEq,Eq)]
+pub enum StealPolicy {
+    /// Never takes over a playing voice.
+    None,
+    /// Takes over the voice that has been playing the longest.
+    Oldest,
+    /// Takes over the voice with the lowest volume, the oldest of them on
+    /// ties.
+    Quietest,
+    /// Takes over the voice with the lowest priority, the oldest of them on
+    /// ties.
+    LowestPriority,
+}
+
+impl Default for StealPolicy {
+    fn default() -> Self {
+        StealPolicy::Oldest
+    }
+}
+
+/// Identifier of a template registered with a [`VoicePool`].
+///
+/// [`VoicePool`]: struct.VoicePool.html
+#[derive(Copy,Clone,Debug,PartialEq,Eq,Hash)]
+pub struct TemplateId(usize);
+
+/// Handle referring to one playback of a template of a [`VoicePool`].
+///
+/// Like a [`SoundHandle`], it pairs the index of the voice with the
+/// generation of that voice, so a handle becomes stale once its voice is
+/// stopped, retired, or taken over by another playback.
+///
+/// [`VoicePool`]: struct.VoicePool.html
+/// [`SoundHandle`]: ../struct.SoundHandle.html
+#[derive(Copy,Clone,Debug,PartialEq,Eq,Hash)]
+pub struct VoiceHandle {
+    index: u32,
+    generation: u32,
+}
+
+/// Voices of a template, and how to play them.
+struct Template {
+    voices: Range<usize>,
+    policy: StealPolicy,
+    duration: Option<Duration>,
+    length: Option<u64>,
+}
+
+/// Where the [`Sound`] of a voice currently is.
+///
+/// [`Sound`]: ../../sounds/trait.Sound.html
+#[derive(Copy,Clone,PartialEq)]
+enum State {
+    /// Stopped, the sound is held by the voice.
+    Free,
+    /// Rendered by the channel, which holds the sound.
+    Real(SoundHandle),
+    /// Playing without being rendered, the sound is held by the voice.
+    Virtual,
+}
+
+/// Preallocated voice of a [`VoicePool`].
+///
+/// [`VoicePool`]: struct.VoicePool.html
+struct Voice {
+    sound: Option<SoundSP>,
+    template: usize,
+    state: State,
+    generation: u32,
+    priority: i32,
+    volume: MathT,
+    age: u64,
+    lag: u64,
+    tail: Option<u64>,
+    audible: bool,
+}
+
+/// [`Channel`] playing [`Sound`]s from a fixed pool of preallocated voices.
+///
+/// Each template registered with [`add_template`] creates all of its voices
+/// up front, so [`play`] only resets one of them with [`Sound::reset`]
+/// instead of building a [`Sound`]. When all voices of a template are busy,
+/// one is taken over according to the [`StealPolicy`] of the template.
+///
+/// Only the loudest [`Sound`]s are rendered: on each call to [`process`],
+/// the playing voices are ranked by priority then volume, and at most
+/// `max_real` of them above the threshold set by [`set_threshold`] are
+/// registered with the wrapped [`StandardChannel`]. The others are virtual:
+/// they keep their place in time without being rendered, and when they are
+/// made real again they catch up with [`Sound::skip`], so they resume where
+/// they would have been.
+///
+/// No memory is allocated by [`play`] or [`process`] once the pool is built.
+///
+/// [`Channel`]: ../trait.Channel.html
+/// [`Sound`]: ../../sounds/trait.Sound.html
+/// [`add_template`]: struct.VoicePool.html#method.add_template
+/// [`play`]: struct.VoicePool.html#method.play
+/// [`Sound::reset`]: ../../sounds/trait.Sound.html#method.reset
+/// [`Sound::skip`]: ../../sounds/trait.Sound.html#method.skip
+/// [`StealPolicy`]: enum.StealPolicy.html
+/// [`process`]: ../trait.Channel.html#tymethod.process
+/// [`set_threshold`]: struct.VoicePool.html#method.set_threshold
+/// [`StandardChannel`]: ../standard_channel/struct.StandardChannel.html
+pub struct VoicePool<SF>
+    where SF: SampleFormat
+{
+    channel: StandardChannel<SF>,
+    templates: Vec<Template>,
+    voices: Vec<Voice>,
+    order: Vec<usize>,
+    max_real: usize,
+    threshold: MathT,
+}
+
+impl<SF> VoicePool<SF>
+    where SF: SampleFormat
+{
+    /// Creates a new pool with the given gain, rendering at most `max_real`
+    /// voices at a time.
+    pub fn new(gain: MathT, max_real: usize) -> Self {
+        Self::with_context(gain, max_real, Context::default())
+    }
+
+    /// Creates a new pool with the given gain, rendering at most `max_real`
+    /// voices at a time in the given [`Context`].
+    ///
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn with_context(gain: MathT, max_real: usize, context: Context) -> Self {
+        VoicePool {
+            channel: StandardChannel::with_context(gain, max_real, context),
+            templates: Vec::new(),
+            voices: Vec::new(),
+            order: Vec::new(),
+            max_real,
+            threshold: VIRTUAL_THRESHOLD,
+        }
+    }
+
+    /// Registers a template of `voices` voices, each holding a [`Sound`]
+    /// built by `factory`, and returns its identifier.
+    ///
+    /// Voices are taken over following `policy` when the template is played
+    /// with all of them busy. If `length` is given, voices stop by
+    /// themselves once they have played for that long. Voices also stop as
+    /// soon as their [`Sound`] is finished, as reported by
+    /// [`Sound::is_finished`], or for virtual voices, which aren't processed,
+    /// once they have been virtual for the [`Sound::tail`] they had.
+    ///
+    /// The pool's [`Context`] is applied to every [`Sound`] here, so making a
+    /// voice real doesn't do it again.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`Sound::is_finished`]: ../../sounds/trait.Sound.html#method.is_finished
+    /// [`Sound::tail`]: ../../sounds/trait.Sound.html#method.tail
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn add_template<F>(&mut self, voices: usize, policy: StealPolicy, length: Option<Duration>, mut factory: F) -> TemplateId
+        where F: FnMut() -> SoundSP
+    {
+        let t = self.templates.len();
+        let start = self.voices.len();
+        let context = *self.channel.get_context();
+
+        self.voices.extend((0..voices).map(|_| {
+            let mut sound = factory();
+            sound.set_context(&context);
+
+            Voice {
+                sound: Some(sound),
+                template: t,
+                state: State::Free,
+                generation: 0,
+                priority: 0,
+                volume: 1.0,
+                age: 0,
+                lag: 0,
+                tail: None,
+                audible: false,
+            }
+        }));
+        self.order.reserve(self.voices.len() - self.order.len());
+
+        self.templates.push(Template {
+            voices: start..self.voices.len(),
+            policy,
+            duration: length,
+            length: length.map(|d| context.seconds_to_samples(d) as u64),
+        });
+
+        TemplateId(t)
+    }
+
+    /// Plays the given template with the given priority and linear volume,
+    /// returning the handle of the voice it plays on.
+    ///
+    /// A free voice is used if there is one, otherwise one is taken over as
+    /// described by [`StealPolicy`]. Returns `None` if no voice could be
+    /// found, or if the template doesn't exist. The voice starts rendering
+    /// on the next call to [`process`] if it is loud enough.
+    ///
+    /// [`StealPolicy`]: enum.StealPolicy.html
+    /// [`process`]: ../trait.Channel.html#tymethod.process
+    pub fn play(&mut self, template: TemplateId, priority: i32, volume: MathT) -> Option<VoiceHandle> {
+        let t = self.templates.get(template.0)?;
+        let range = t.voices.clone();
+
+        let v = match range.clone().find(|&v| self.voices[v].state == State::Free && self.has_sound(v)) {
+            Some(v) => v,
+            None => {
+                let candidates = range.filter(|&v| self.voices[v].priority <= priority && self.has_sound(v));
+                let voices = &self.voices;
+
+                let v = match t.policy {
+                    StealPolicy::None => None,
+                    StealPolicy::Oldest => candidates.max_by_key(|&v| voices[v].age),
+                    StealPolicy::Quietest => candidates.min_by(|&a, &b| {
+                        voices[a].volume.partial_cmp(&voices[b].volume)
+                            .unwrap_or(std::cmp::Ordering::Equal)
+                            .then(voices[b].age.cmp(&voices[a].age))
+                    }),
+                    StealPolicy::LowestPriority => candidates.min_by_key(|&v| {
+                        (voices[v].priority, std::cmp::Reverse(voices[v].age))
+                    }),
+                }?;
+
+                self.release(v);
+                v
+            },
+        };
+
+        let voice = &mut self.voices[v];
+        if let Some(s) = voice.sound.as_mut() {
+            s.reset();
+        }
+        voice.tail = voice.sound.as_ref().and_then(|s| s.tail()).map(|t| t as u64);
+        voice.state = State::Virtual;
+        voice.priority = priority;
+        voice.volume = volume;
+        voice.age = 0;
+        voice.lag = 0;
+
+        Some(VoiceHandle {
+            index: v as u32,
+            generation: voice.generation,
+        })
+    }
+
+    /// Stops the given voice. Returns false if the handle is stale.
+    pub fn stop(&mut self, voice: VoiceHandle) -> bool {
+        match self.voice_index(voice) {
+            Some(v) => {
+                self.release(v);
+                true
+            },
+            None => false,
+        }
+    }
+
+    /// Sets the linear volume of the given voice. Returns false if the handle
+    /// is stale.
+    pub fn set_volume(&mut self, voice: VoiceHandle, volume: MathT) -> bool {
+        match self.voice_index(voice) {
+            Some(v) => {
+                let voice = &mut self.voices[v];
+                voice.volume = volume;
+                if let State::Real(h) = voice.state {
+                    self.channel.set_sound_gain(h, volume);
+                }
+                true
+            },
+            None => false,
+        }
+    }
+
+    /// Returns the linear volume of the given voice, or `None` if the handle
+    /// is stale.
+    pub fn get_volume(&self, voice: VoiceHandle) -> Option<MathT> {
+        Some(self.voices[self.voice_index(voice)?].volume)
+    }
+
+    /// Sets the priority of the given voice. Returns false if the handle is
+    /// stale.
+    pub fn set_priority(&mut self, voice: VoiceHandle, priority: i32) -> bool {
+        match self.voice_index(voice) {
+            Some(v) => {
+                self.voices[v].priority = priority;
+                true
+            },
+            None => false,
+        }
+    }
+
+    /// Returns the priority of the given voice, or `None` if the handle is
+    /// stale.
+    pub fn get_priority(&self, voice: VoiceHandle) -> Option<i32> {
+        Some(self.voices[self.voice_index(voice)?].priority)
+    }
+
+    /// Returns the [`Sound`] of the given voice, or `None` if the handle is
+    /// stale.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    pub fn get_sound_mut(&mut self, voice: VoiceHandle) -> Option<&mut SoundSP> {
+        let v = self.voice_index(voice)?;
+
+        match self.voices[v].state {
+            State::Real(h) => self.channel.get_sound_mut(h),
+            _ => self.voices[v].sound.as_mut(),
+        }
+    }
+
+    /// Returns true if the given voice is still playing.
+    pub fn is_playing(&self, voice: VoiceHandle) -> bool {
+        self.voice_index(voice).is_some()
+    }
+
+    /// Returns true if the given voice is playing without being rendered.
+    pub fn is_virtual(&self, voice: VoiceHandle) -> bool {
+        match self.voice_index(voice) {
+            Some(v) => self.voices[v].state == State::Virtual,
+            None => false,
+        }
+    }
+
+    /// Returns the total number of voices of all templates.
+    pub fn voice_count(&self) -> usize {
+        self.voices.len()
+    }
+
+    /// Returns the number of voices playing, real or virtual.
+    pub fn playing_count(&self) -> usize {
+        self.voices.iter().filter(|v| v.state != State::Free).count()
+    }
+
+    /// Returns the number of voices being rendered.
+    pub fn real_count(&self) -> usize {
+        self.voices.iter().filter(|v| match v.state {
+            State::Real(_) => true,
+            _ => false,
+        }).count()
+    }
+
+    /// Sets the maximum number of voices rendered at a time.
+    pub fn set_max_real(&mut self, max_real: usize) {
+        self.max_real = max_real;
+    }
+
+    /// Returns the maximum number of voices rendered at a time.
+    pub fn get_max_real(&self) -> usize {
+        self.max_real
+    }
+
+    /// Sets the linear volume below which voices are made virtual even if
+    /// there is room to render them.
+    pub fn set_threshold(&mut self, threshold: MathT) {
+        self.threshold = threshold;
+    }
+
+    /// Returns the linear volume below which voices are made virtual.
+    pub fn get_threshold(&self) -> MathT {
+        self.threshold
+    }
+
+    /// Returns the channel rendering the real voices.
+    pub fn get_channel(&self) -> &StandardChannel<SF> {
+        &self.channel
+    }
+
+    /// Returns the channel rendering the real voices. [`Sound`]s added to it
+    /// directly are rendered alongside them.
+    ///
+    /// The pool stops finished voices by itself. If auto-retiring is enabled
+    /// on the channel with [`set_auto_retire`], the channel retires finished
+    /// voices before the pool does, and their [`Sound`]s are dropped, so the
+    /// voices can't be played again.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`set_auto_retire`]: ../standard_channel/struct.StandardChannel.html#method.set_auto_retire
+    pub fn get_channel_mut(&mut self) -> &mut StandardChannel<SF> {
+        &mut self.channel
+    }
+
+    /// Returns the index of the voice the given handle refers to, if it is
+    /// still playing.
+    fn voice_index(&self, voice: VoiceHandle) -> Option<usize> {
+        let v = voice.index as usize;
+
+        match self.voices.get(v) {
+            Some(x) if x.generation == voice.generation && x.state != State::Free => Some(v),
+            _ => None,
+        }
+    }
+
+    /// Returns true if the [`Sound`] of the given voice still exists, which
+    /// is not the case once the channel has retired it by itself.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    fn has_sound(&self, v: usize) -> bool {
+        match self.voices[v].state {
+            State::Real(h) => self.channel.get_sound(h).is_some(),
+            _ => self.voices[v].sound.is_some(),
+        }
+    }
+
+    /// Stops the given voice, taking its sound back from the channel and
+    /// invalidating its handles.
+    fn release(&mut self, v: usize) {
+        let voice = &mut self.voices[v];
+
+        if let State::Real(h) = voice.state {
+            voice.sound = self.channel.remove_sound(h);
+        }
+        voice.state = State::Free;
+        voice.generation = voice.generation.wrapping_add(1);
+    }
+
+    /// Retires finished voices, then decides which voices are rendered.
+    fn update(&mut self) {
+        for v in 0..self.voices.len() {
+            let voice = &self.voices[v];
+            let length = self.templates[voice.template].length;
+
+            // Virtual sounds aren't processed, so they are finished once they
+            // have lagged behind for the whole tail they had when they were
+            // made virtual.
+            let finished = match voice.state {
+                State::Free => continue,
+                State::Real(h) => self.channel.get_sound(h).map_or(true, |s| s.is_finished()),
+                State::Virtual => voice.sound.as_ref().map_or(true, |s| {
+                    s.is_finished() || (!s.is_paused() && voice.tail.map_or(false, |t| voice.lag >= t))
+                }),
+            };
+
+            if finished || length.map_or(false, |l| voice.age >= l) {
+                self.release(v);
+            }
+        }
+
+        let voices = &mut self.voices;
+        let threshold = self.threshold;
+
+        self.order.clear();
+        self.order.extend((0..voices.len()).filter(|&v| {
+            voices[v].state != State::Free && voices[v].volume.abs() >= threshold
+        }));
+        self.order.sort_unstable_by(|&a, &b| {
+            voices[b].priority.cmp(&voices[a].priority)
+                .then(voices[b].volume.abs().partial_cmp(&voices[a].volume.abs())
+                    .unwrap_or(std::cmp::Ordering::Equal))
+                .then(a.cmp(&b))
+        });
+
+        for voice in voices.iter_mut() {
+            voice.audible = false;
+        }
+        for &v in self.order.iter().take(self.max_real) {
+            voices[v].audible = true;
+        }
+
+        // Demote first, so the channel never holds more than max_real voices.
+        for voice in voices.iter_mut() {
+            if let (State::Real(h), false) = (voice.state, voice.audible) {
+                voice.sound = self.channel.remove_sound(h);
+                voice.tail = voice.sound.as_ref().and_then(|s| s.tail()).map(|t| t as u64);
+                voice.state = State::Virtual;
+            }
+        }
+
+        for voice in voices.iter_mut() {
+            match (voice.state, voice.audible) {
+                (State::Virtual, true) => {
+                    if let Some(mut s) = voice.sound.take() {
+                        s.skip(voice.lag as usize);
+                        let h = self.channel.add_configured_sound(s);
+                        self.channel.set_sound_gain(h, voice.volume);
+                        voice.state = State::Real(h);
+                    }
+                    voice.lag = 0;
+                },
+                (State::Real(h), true) => {
+                    self.channel.set_sound_gain(h, voice.volume);
+                },
+                _ => (),
+            }
+        }
+    }
+
+    /// Returns true if the given handle belongs to a real voice.
+    fn owns(&self, handle: SoundHandle) -> bool {
+        self.voices.iter().any(|v| v.state == State::Real(handle))
+    }
+}
+
+impl<SF> Channel<SF> for VoicePool<SF>
+    where SF: SampleFormat
+{
+    fn set_process_time(&mut self, d: Duration) {
+        self.channel.set_process_time(d);
+    }
+
+    /// Applies the given [`Context`] to the wrapped channel, to the [`Sound`]
+    /// of every voice, and to the lengths of the templates.
+    ///
+    /// [`Context`]: ../../context/struct.Context.html
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    fn set_context(&mut self, ctx: &Context) {
+        self.channel.set_context(ctx);
+
+        for s in self.voices.iter_mut().filter_map(|v| v.sound.as_mut()) {
+            s.set_context(ctx);
+        }
+        for t in &mut self.templates {
+            t.length = t.duration.map(|d| ctx.seconds_to_samples(d) as u64);
+        }
+    }
+
+    fn get_output(&self) -> &Vec<SF> {
+        self.channel.get_output()
+    }
+
+    fn mix_output(&self, planar: &mut PlanarBuffer) {
+        self.channel.mix_output(planar);
+    }
+
+    fn set_gain(&mut self, gain: MathT) {
+        self.channel.set_gain(gain);
+    }
+
+    fn process(&mut self) {
+        self.update();
+        self.channel.process();
+
+        let n = self.channel.get_output().len() as u64;
+        for voice in &mut self.voices {
+            match voice.state {
+                State::Free => (),
+                State::Real(_) => voice.age += n,
+                State::Virtual => {
+                    voice.age += n;
+                    voice.lag += n;
+                },
+            }
+        }
+    }
+
+    /// Adds a [`Sound`] to the wrapped channel, to be rendered alongside the
+    /// voices of the pool.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    fn add_sound(&mut self, sound: SoundSP) -> SoundHandle {
+        self.channel.add_sound(sound)
+    }
+
+    /// Removes a [`Sound`] added with [`add_sound`]. Handles of [`Sound`]s
+    /// belonging to voices are refused, use [`stop`] for those.
+    ///
+    /// [`Sound`]: ../../sounds/trait.Sound.html
+    /// [`add_sound`]: ../trait.Channel.html#tymethod.add_sound
+    /// [`stop`]: struct.VoicePool.html#method.stop
+    fn remove_sound(&mut self, handle: SoundHandle) -> Option<SoundSP> {
+        if self.owns(handle) {
+            return None;
+        }
+
+        self.channel.remove_sound(handle)
+    }
+}
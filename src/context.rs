@@ -0,0 +1,117 @@
+//! # Context
+//! 
+//! The sample rate and block size the engine runs at.
+
+use super::*;
+use std::time::Duration;
+
+/// Largest block processed by default, 10ms at [`SAMPLE_RATE`].
+/// 
+/// [`SAMPLE_RATE`]: constant.SAMPLE_RATE.html
+pub const DEFAULT_MAX_BLOCK: usize = (SAMPLE_RATE / 100) as usize;
+
+/// Sample rate and maximum block size of an engine.
+/// 
+/// A context is given to channels when they are created, and from there to
+/// every [`Sound`] added to them, down to the [`Generator`]s and
+/// [`Modifier`]s they are made of, through the `set_context` method of each
+/// trait. Objects keep their parameters in physical units such as hertz and
+/// seconds, and derive their increments, coefficients, and buffer sizes from
+/// the context they were last given, so the same sound can be rendered at
+/// 24kHz on low-end hardware, or at 44.1kHz to play assets of that rate
+/// without resampling them.
+/// 
+/// Objects start out configured for the default context, which runs at
+/// [`SAMPLE_RATE`] with blocks of up to [`DEFAULT_MAX_BLOCK`] samples, so code
+/// that never creates a context behaves as before. Applying a context may
+/// allocate, so it should be done before a sound is handed to the render
+/// thread.
+/// 
+/// [`Sound`]: sounds/trait.Sound.html
+/// [`Generator`]: generators/trait.Generator.html
+/// [`Modifier`]: modifiers/trait.Modifier.html
+/// [`SAMPLE_RATE`]: constant.SAMPLE_RATE.html
+/// [`DEFAULT_MAX_BLOCK`]: constant.DEFAULT_MAX_BLOCK.html
+#[derive(Copy,Clone,Debug,PartialEq)]
+pub struct Context {
+    sample_rate: MathT,
+    inv_sample_rate: MathT,
+    max_block: usize,
+}
+
+impl Context {
+    /// Creates a new context of the given sample rate, processing blocks of
+    /// up to `max_block` samples.
+    /// 
+    /// # Panics
+    /// 
+    /// Panics if the sample rate isn't positive or the block size is 0.
+    pub fn new(sample_rate: MathT, max_block: usize) -> Self {
+        assert!(sample_rate > 0.0, "Sample rate must be positive");
+        assert!(max_block > 0, "Block size must be positive");
+
+        Context {
+            sample_rate,
+            inv_sample_rate: 1.0 / sample_rate,
+            max_block,
+        }
+    }
+
+    /// Creates a new context of the given sample rate, processing blocks of
+    /// up to the given duration, rounded to the nearest sample.
+    pub fn with_block_time(sample_rate: MathT, d: Duration) -> Self {
+        Context::new(sample_rate, ((d.as_secs_f64() * sample_rate).round() as usize).max(1))
+    }
+
+    /// Returns the sample rate.
+    pub fn sample_rate(&self) -> MathT {
+        self.sample_rate
+    }
+
+    /// Returns the inverse of the sample rate, the duration of a sample in
+    /// seconds.
+    pub fn inv_sample_rate(&self) -> MathT {
+        self.inv_sample_rate
+    }
+
+    /// Returns the Nyquist frequency, half the sample rate.
+    pub fn nyquist(&self) -> MathT {
+        self.sample_rate / 2.0
+    }
+
+    /// Returns the largest number of samples processed at once.
+    pub fn max_block(&self) -> usize {
+        self.max_block
+    }
+
+    /// Returns the duration of the largest block, rounded up past the
+    /// nanosecond so that truncating it back to samples, as
+    /// [`Channel::set_process_time`] does, gives exactly [`max_block`].
+    /// 
+    /// [`Channel::set_process_time`]: channels/trait.Channel.html#tymethod.set_process_time
+    /// [`max_block`]: struct.Context.html#method.max_block
+    pub fn block_time(&self) -> Duration {
+        Duration::from_nanos((self.max_block as MathT * 1e9 * self.inv_sample_rate) as u64 + 1)
+    }
+
+    /// Converts the given duration to samples, rounded to the nearest sample.
+    pub fn seconds_to_samples(&self, d: Duration) -> usize {
+        (d.as_secs_f64() * self.sample_rate).round() as usize
+    }
+
+    /// Converts the given sample count to a duration.
+    pub fn samples_to_seconds(&self, s: usize) -> Duration {
+        Duration::from_secs_f64(s as MathT * self.inv_sample_rate)
+    }
+}
+
+impl Default for Context {
+    /// Creates the context of [`SAMPLE_RATE`] with blocks of up to
+    /// [`DEFAULT_MAX_BLOCK`] samples.
+    /// 
+    /// [`SAMPLE_RATE`]: constant.SAMPLE_RATE.html
+    /// [`DEFAULT_MAX_BLOCK`]: constant.DEFAULT_MAX_BLOCK.html
+    fn default() -> Self {
+        Context::new(SAMPLE_RATE as MathT, DEFAULT_MAX_BLOCK)
+    }
+}
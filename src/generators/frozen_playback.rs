@@ -0,0 +1,85 @@
+//! # Frozen Playback
+//! 
+//! A player for pre-rendered sounds.
+
+use super::*;
+use crate::utils::asset_cache::SampleBuffer;
+
+/// Struct playing a [`SampleBuffer`] sample for sample, as rendered by a
+/// freeze of a [`FrozenSound`] or a [`ComplexSound`] region.
+/// 
+/// Unlike a [`MonoWav`], the buffer is neither resampled nor interpolated, so
+/// playing it costs no more than a copy, and it must have been rendered at
+/// the sample rate it is played at. The data is shared between clones, so
+/// cloning a player to play another voice of the same sound is cheap.
+/// 
+/// [`SampleBuffer`]: ../../utils/asset_cache/struct.SampleBuffer.html
+/// [`FrozenSound`]: ../../sounds/frozen_sound/struct.FrozenSound.html
+/// [`ComplexSound`]: ../../sounds/complex_sound/struct.ComplexSound.html#method.freeze
+/// [`MonoWav`]: ../mono_wav/struct.MonoWav.html
+#[derive(Clone)]
+pub struct FrozenPlayback {
+    buffer: SampleBuffer,
+    pos: usize,
+}
+
+impl FrozenPlayback {
+    /// Plays the given shared buffer from its start, without copying its
+    /// data.
+    pub fn new(buffer: &SampleBuffer) -> Self {
+        FrozenPlayback {
+            buffer: buffer.clone(),
+            pos: 0,
+        }
+    }
+
+    /// Returns the buffer being played.
+    pub fn buffer(&self) -> &SampleBuffer {
+        &self.buffer
+    }
+
+    /// Returns the number of samples played since the start of the buffer.
+    /// This keeps counting past the end of the buffer.
+    pub fn position(&self) -> usize {
+        self.pos
+    }
+
+    /// Sets the number of samples played since the start of the buffer.
+    pub fn set_position(&mut self, pos: usize) {
+        self.pos = pos;
+    }
+}
+
+impl Generator for FrozenPlayback {
+    fn process(&mut self) -> SampleT {
+        let y = self.buffer.samples().get(self.pos).copied().unwrap_or_default();
+        self.pos = self.pos.saturating_add(1);
+
+        y
+    }
+
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        let data = self.buffer.samples();
+        let start = self.pos.min(data.len());
+        let n = (data.len() - start).min(out.len());
+
+        out[..n].copy_from_slice(&data[start..start + n]);
+        for y in &mut out[n..] {
+            *y = SampleT::default();
+        }
+
+        self.pos = self.pos.saturating_add(out.len());
+    }
+
+    fn reset(&mut self) {
+        self.pos = 0;
+    }
+
+    fn skip(&mut self, n: usize) {
+        self.pos = self.pos.saturating_add(n);
+    }
+
+    fn tail(&self) -> Option<usize> {
+        Some(self.buffer.len().saturating_sub(self.pos))
+    }
+}
@@ -7,19 +7,27 @@ use super::*;
 
 pub mod zero;
 pub mod noise;
+pub mod oscillator;
+pub mod oscillator_bank;
 pub mod sawtooth;
 pub mod sine;
 pub mod square;
 pub mod triangle;
 pub mod mono_wav;
+pub mod frozen_playback;
+pub mod streaming_wav;
 
 pub use zero::*;
 pub use noise::*;
+pub use oscillator::*;
+pub use oscillator_bank::*;
 pub use sawtooth::*;
 pub use sine::*;
 pub use square::*;
 pub use triangle::*;
 pub use mono_wav::*;
+pub use frozen_playback::*;
+pub use streaming_wav::*;
 
 /// Frequency Moderator. This trait defines types who take in a frequency as a
 /// primary argument.
@@ -43,8 +51,70 @@ pub trait FreqMod {
 }
 
 /// The `Generator` trait defines types that create audio samples.
-pub trait Generator
+/// 
+/// Generators are required to be [`Send`] and [`Sync`] so that the blocks and
+/// sounds sharing them can be handed to the render thread.
+/// 
+/// [`Send`]: https://doc.rust-lang.org/std/marker/trait.Send.html
+/// [`Sync`]: https://doc.rust-lang.org/std/marker/trait.Sync.html
+pub trait Generator: Send + Sync
 {
     /// Generates a rendered audio sample
     fn process(&mut self) -> SampleT;
+
+    /// Generates a block of rendered audio samples, overwriting the contents
+    /// of `out`.
+    /// 
+    /// The default implementation calls [`process`] once per sample. Types
+    /// that can keep their state in locals for the duration of the block should
+    /// override it.
+    /// 
+    /// [`process`]: trait.Generator.html#tymethod.process
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        for s in out {
+            *s = self.process();
+        }
+    }
+
+    /// Returns the generator to the state it was created in, keeping its
+    /// parameters, so it can be reused for a new voice.
+    /// 
+    /// The default implementation does nothing, which suits generators
+    /// without processing state.
+    fn reset(&mut self) {}
+
+    /// Advances the generator by `n` samples without producing them, as for a
+    /// voice that is playing but inaudible.
+    /// 
+    /// The default implementation generates the samples and discards them.
+    /// Generators that can jump ahead directly should override it.
+    fn skip(&mut self, n: usize) {
+        let mut scratch = [SampleT::default(); 64];
+        let mut n = n;
+
+        while n > 0 {
+            let k = n.min(scratch.len());
+            self.process_block(&mut scratch[..k]);
+            n -= k;
+        }
+    }
+
+    /// Derives the generator's increments and tables from the given
+    /// [`Context`], keeping its parameters such as frequency.
+    /// 
+    /// The default implementation does nothing, which suits generators that
+    /// don't depend on the sample rate.
+    /// 
+    /// [`Context`]: ../context/struct.Context.html
+    fn set_context(&mut self, _ctx: &Context) {}
+
+    /// Returns the number of samples left before the generator only outputs
+    /// silence, such as the rest of a file that doesn't loop, or `None` if it
+    /// may never stop.
+    /// 
+    /// The default implementation returns `None`, which suits oscillators
+    /// and noise.
+    fn tail(&self) -> Option<usize> {
+        None
+    }
 }
@@ -4,9 +4,18 @@
 
 use super::*;
 use crate::utils::mono_resampler::*;
+use crate::utils::asset_cache::SampleBuffer;
 use crate::sample_format::MonoTrackT;
 
 /// Struct for playing wave files.
+/// 
+/// The audio data is shared between clones, so cloning a `MonoWav` to play
+/// another voice of the same sound is cheap. To share the data between
+/// separately loaded voices, load it once through an [`AssetCache`] and use
+/// [`from_buffer`].
+/// 
+/// [`AssetCache`]: ../../utils/asset_cache/struct.AssetCache.html
+/// [`from_buffer`]: struct.MonoWav.html#method.from_buffer
 #[derive(Clone)]
 pub struct MonoWav {
     resam: MonoResampler,
@@ -15,16 +24,17 @@ pub struct MonoWav {
 impl MonoWav {
     /// Constructs from a given path.
     pub fn from_source(s: &mut dyn std::io::Read) -> Self {
-        let (h, t) = utils::read_wav(s)
+        let b = SampleBuffer::from_wav(s)
         .expect("File could not be read");
 
-        let mut mt = MonoTrackT::new();
+        MonoWav::from_buffer(&b)
+    }
 
-        for s in t.first().expect("No audio data read") {
-            mt.push(Mono::from_sample(*s));
+    /// Plays the given shared buffer, without copying its data.
+    pub fn from_buffer(b: &SampleBuffer) -> Self {
+        MonoWav{
+            resam: MonoResampler::from_buffer(b, 0, 0)
         }
-
-        MonoWav::from_track(h.sampling_rate as MathT, mt)
     }
 
     /// Converts from the given track and source sample rate.
@@ -49,4 +59,24 @@ impl Generator for MonoWav {
     fn process(&mut self) -> SampleT {
         self.resam.process()
     }
+
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        self.resam.process_block(out);
+    }
+
+    fn reset(&mut self) {
+        self.resam.set_position(0.0);
+    }
+
+    fn skip(&mut self, n: usize) {
+        self.resam.skip(n);
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        self.resam.set_context(ctx);
+    }
+
+    fn tail(&self) -> Option<usize> {
+        self.resam.remaining()
+    }
 }
@@ -1,29 +1,278 @@
 //! # Noise
 //! 
-//! A white noise generator.
+//! A seedable white, pink, and brown noise generator.
 
 use super::*;
-use rand;
+use crate::utils::simd;
 
-#[derive(Default,Clone)]
-/// Struct for generating white noise audio samples.
+/// Spectrum of the output of a [`Noise`] generator.
+/// 
+/// [`Noise`]: struct.Noise.html
+#[derive(Copy,Clone,Debug,PartialEq,Eq)]
+pub enum NoiseColor {
+    /// Equal power at every frequency.
+    White,
+    /// Power falling by 3dB per octave, equal in every octave.
+    Pink,
+    /// Power falling by 6dB per octave, like a random walk.
+    Brown,
+}
+
+impl Default for NoiseColor {
+    fn default() -> Self {
+        NoiseColor::White
+    }
+}
+
+/// Struct for generating noise audio samples.
+/// 
+/// Samples are computed by hashing their position in the output with a key
+/// derived from a seed and a stream number, so a generator can be reproduced
+/// exactly from its seed, can jump anywhere in its output with [`seek`], and
+/// a voice given its own stream with [`set_stream`] sounds the same whichever
+/// thread renders it and in whichever order. The hash only uses 32-bit integer
+/// operations, and blocks of white noise are generated in vector registers.
+/// 
+/// Pink noise is filtered from the white noise with Paul Kellet's refined
+/// filter and brown noise with a leaky integrator, both scaled to about the
+/// loudness of the white noise, which spans [-1,1).
+/// 
+/// Cloning gives a generator of the same seed, stream, and color, restarted
+/// from the beginning of its output.
+/// 
+/// [`seek`]: struct.Noise.html#method.seek
+/// [`set_stream`]: struct.Noise.html#method.set_stream
 pub struct Noise {
-    engine: rand::rngs::ThreadRng,
+    color: NoiseColor,
+    seed: u64,
+    stream: u64,
+    position: u64,
+    key: [u32; 2],
+    pink: [SampleT; 7],
+    brown: SampleT,
 }
 
 impl Noise {
-    /// Creates a new white noise generator.
+    /// Creates a new white noise generator with a random seed.
     pub fn new() -> Self {
-        Noise{
-            engine: rand::thread_rng()
+        use std::hash::{BuildHasher, Hasher};
+
+        let seed = std::collections::hash_map::RandomState::new().build_hasher().finish();
+        Noise::with_seed(seed)
+    }
+
+    /// Creates a new white noise generator with the given seed.
+    pub fn with_seed(seed: u64) -> Self {
+        Noise::with_color(NoiseColor::White, seed)
+    }
+
+    /// Creates a new noise generator of the given color and seed.
+    pub fn with_color(color: NoiseColor, seed: u64) -> Self {
+        let mut n = Noise {
+            color,
+            seed,
+            stream: 0,
+            position: 0,
+            key: [0; 2],
+            pink: [0.0; 7],
+            brown: 0.0,
+        };
+        n.rekey();
+
+        n
+    }
+
+    /// Returns the color of the noise.
+    pub fn get_color(&self) -> NoiseColor {
+        self.color
+    }
+
+    /// Sets the color of the noise, keeping the position in the output.
+    pub fn set_color(&mut self, color: NoiseColor) {
+        self.color = color;
+    }
+
+    /// Returns the seed of the generator.
+    pub fn get_seed(&self) -> u64 {
+        self.seed
+    }
+
+    /// Sets the seed of the generator, restarting its output.
+    pub fn set_seed(&mut self, seed: u64) {
+        self.seed = seed;
+        self.seek(0);
+    }
+
+    /// Returns the stream of the generator.
+    pub fn get_stream(&self) -> u64 {
+        self.stream
+    }
+
+    /// Sets the stream of the generator, restarting its output. Generators of
+    /// the same seed and different streams are independent, so voices which
+    /// need their own noise can use their index as the stream.
+    pub fn set_stream(&mut self, stream: u64) {
+        self.stream = stream;
+        self.seek(0);
+    }
+
+    /// Returns the number of samples generated since the start of the output.
+    pub fn get_position(&self) -> u64 {
+        self.position
+    }
+
+    /// Moves to the given number of samples from the start of the output.
+    /// 
+    /// White noise continues exactly as it would have at that position. Pink
+    /// and brown noise depend on every earlier sample, so their filters are
+    /// silenced instead, and settle within a few hundred samples.
+    pub fn seek(&mut self, position: u64) {
+        self.position = position;
+        self.pink = [0.0; 7];
+        self.brown = 0.0;
+        self.rekey();
+    }
+
+    /// Derives the key hashed with the low 32 bits of the position from the
+    /// seed, stream, and high 32 bits of the position.
+    fn rekey(&mut self) {
+        let k = splitmix(splitmix(self.seed ^ splitmix(self.stream)) ^ (self.position >> 32));
+        self.key = [k as u32, (k >> 32) as u32];
+    }
+
+    /// Writes white noise to `out`, advancing the position.
+    fn white(&mut self, out: &mut [SampleT]) {
+        let mut i = 0;
+
+        while i < out.len() {
+            // Split blocks where the low half of the position wraps, since
+            // the key changes there.
+            let c = self.position as u32;
+            let n = ((1u64 << 32) - c as u64).min((out.len() - i) as u64) as usize;
+
+            fill(self.key, c, &mut out[i..i + n]);
+
+            self.position += n as u64;
+            i += n;
+            if self.position as u32 == 0 {
+                self.rekey();
+            }
         }
     }
 }
 
+impl Default for Noise {
+    fn default() -> Self {
+        Noise::new()
+    }
+}
+
+impl Clone for Noise {
+    fn clone(&self) -> Self {
+        let mut n = Noise::with_color(self.color, self.seed);
+        n.set_stream(self.stream);
+
+        n
+    }
+}
+
 impl Generator for Noise {
     fn process(&mut self) -> SampleT {
-        use rand::Rng;
+        let mut y = 0.0;
+        self.process_block(std::slice::from_mut(&mut y));
+        y
+    }
+
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        self.white(out);
+
+        match self.color {
+            NoiseColor::White => (),
+            NoiseColor::Pink => {
+                let b = &mut self.pink;
+
+                for s in out {
+                    let w = *s;
+                    b[0] = 0.99886 * b[0] + w * 0.055_517_9;
+                    b[1] = 0.99332 * b[1] + w * 0.075_075_9;
+                    b[2] = 0.96900 * b[2] + w * 0.153_852;
+                    b[3] = 0.86650 * b[3] + w * 0.310_485_6;
+                    b[4] = 0.55000 * b[4] + w * 0.532_952_2;
+                    b[5] = -0.7616 * b[5] - w * 0.016_898;
+                    let y = b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + w * 0.5362;
+                    b[6] = w * 0.115_926;
+
+                    *s = y * 0.11;
+                }
+            },
+            NoiseColor::Brown => {
+                let mut b = self.brown;
+
+                for s in out {
+                    b = (b + 0.02 * *s) * (1.0 / 1.02);
+                    *s = b * 3.5;
+                }
+
+                self.brown = b;
+            },
+        }
+    }
+
+    fn reset(&mut self) {
+        self.seek(0);
+    }
+
+    fn skip(&mut self, n: usize) {
+        self.seek(self.position + n as u64);
+    }
+}
+
+/// SplitMix64 finalizer, used to derive keys from seeds.
+fn splitmix(z: u64) -> u64 {
+    let z = z.wrapping_add(0x9e37_79b9_7f4a_7c15);
+    let z = (z ^ (z >> 30)).wrapping_mul(0xbf58_476d_1ce4_e5b9);
+    let z = (z ^ (z >> 27)).wrapping_mul(0x94d0_49bb_1331_11eb);
+
+    z ^ (z >> 31)
+}
+
+/// Returns the white noise sample at position `c` for the given key, in
+/// [-1,1).
+#[inline(always)]
+fn hash(c: u32, key: [u32; 2]) -> SampleT {
+    let mut x = c ^ key[0];
+    x ^= x >> 16;
+    x = x.wrapping_mul(0x7feb_352d);
+    x ^= x >> 15;
+    x = (x ^ key[1]).wrapping_mul(0x846c_a68b);
+    x ^= x >> 16;
+
+    // The top 24 bits fit in an i32, which converts to a float in a single
+    // vector instruction where an unsigned integer doesn't.
+    (x >> 8) as i32 as SampleT * (2.0 / 16_777_216.0) - 1.0
+}
+
+/// Writes the white noise samples starting at position `c` to `out`, with the
+/// implementation for the detected instruction set.
+fn fill(key: [u32; 2], c: u32, out: &mut [SampleT]) {
+    match simd::isa() {
+        #[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+        simd::Isa::Avx2 => unsafe { fill_avx2(key, c, out) },
+        _ => fill_lanes(key, c, out),
+    }
+}
+
+#[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+#[target_feature(enable = "avx2")]
+unsafe fn fill_avx2(key: [u32; 2], c: u32, out: &mut [SampleT]) {
+    fill_lanes(key, c, out)
+}
 
-        self.engine.gen::<SampleT>()*2.0-1.0
+/// Loop of independent hashes, which compiles to vector instructions for
+/// whichever instruction set it is inlined into.
+#[inline(always)]
+fn fill_lanes(key: [u32; 2], c: u32, out: &mut [SampleT]) {
+    for (i, y) in out.iter_mut().enumerate() {
+        *y = hash(c.wrapping_add(i as u32), key);
     }
 }
@@ -0,0 +1,260 @@
+//! # Oscillator
+//! 
+//! A band-limited oscillator with several waveforms, computed without tables.
+
+use super::*;
+
+/// Waveforms an [`Oscillator`] or [`OscillatorBank`] can produce.
+/// 
+/// Every waveform spans the range [-1,1]. The sawtooth and triangle waves start
+/// at their lowest point, the square and pulse waves at their highest, and the
+/// sine at 0 going up.
+/// 
+/// The discontinuities of the sawtooth, square, and pulse waves are smoothed
+/// with 2-point polynomial band-limited steps (PolyBLEP), and the corners of
+/// the triangle wave with their integrals (PolyBLAMP), so they alias far less
+/// than the naive [`Sawtooth`], [`Square`], and [`Triangle`] generators
+/// without needing a table per pitch range.
+/// 
+/// [`Oscillator`]: struct.Oscillator.html
+/// [`OscillatorBank`]: ../oscillator_bank/struct.OscillatorBank.html
+/// [`Sawtooth`]: ../sawtooth/struct.Sawtooth.html
+/// [`Square`]: ../square/struct.Square.html
+/// [`Triangle`]: ../triangle/struct.Triangle.html
+#[derive(Copy,Clone,Debug,PartialEq)]
+pub enum Waveform {
+    /// Sinusoid, from a polynomial approximation accurate to about 1e-7.
+    Sine,
+    /// Rising sawtooth.
+    Sawtooth,
+    /// Square wave, high for the first half of each period.
+    Square,
+    /// Pulse wave, high for the given fraction of each period, in (0,1).
+    Pulse(SampleT),
+    /// Triangle wave, rising for the first half of each period.
+    Triangle,
+}
+
+impl Default for Waveform {
+    fn default() -> Self {
+        Waveform::Sine
+    }
+}
+
+/// Returns `sin(2 pi p)` for a phase `p` in [0,1).
+#[inline(always)]
+pub(crate) fn sin_turns(p: SampleT) -> SampleT {
+    // Reduce to [-1/4,1/4] of a turn, where a Taylor polynomial of degree 11
+    // is accurate to well below the precision of the output.
+    let x = 0.5 - p;
+    let x = if x > 0.25 { 0.5 - x } else if x < -0.25 { -0.5 - x } else { x };
+
+    let t = 2.0 * std::f32::consts::PI * x;
+    let t2 = t * t;
+
+    t * (1.0 + t2 * (-1.0 / 6.0 + t2 * (1.0 / 120.0 + t2 * (-1.0 / 5040.0
+        + t2 * (1.0 / 362_880.0 + t2 * (-1.0 / 39_916_800.0))))))
+}
+
+/// Residual of a band-limited unit step at phase 0, at phase `t` of an
+/// oscillator advancing `dt` per sample, with `idt` the inverse of `dt`.
+#[inline(always)]
+fn blep(t: SampleT, dt: SampleT, idt: SampleT) -> SampleT {
+    let a = 1.0 - t * idt;
+    let b = 1.0 + (t - 1.0) * idt;
+
+    let after = if t < dt { -0.5 * a * a } else { 0.0 };
+    let before = if t > 1.0 - dt { 0.5 * b * b } else { 0.0 };
+
+    after + before
+}
+
+/// Residual of a band-limited unit change of slope per sample at phase 0,
+/// the integral of [`blep`].
+/// 
+/// [`blep`]: fn.blep.html
+#[inline(always)]
+fn blamp(t: SampleT, dt: SampleT, idt: SampleT) -> SampleT {
+    let a = 1.0 - t * idt;
+    let b = 1.0 + (t - 1.0) * idt;
+
+    let after = if t < dt { a * a * a / 6.0 } else { 0.0 };
+    let before = if t > 1.0 - dt { b * b * b / 6.0 } else { 0.0 };
+
+    after + before
+}
+
+/// Wraps a phase in [0,2) to [0,1).
+#[inline(always)]
+pub(crate) fn wrap(p: SampleT) -> SampleT {
+    if p >= 1.0 { p - 1.0 } else { p }
+}
+
+#[inline(always)]
+pub(crate) fn sawtooth(p: SampleT, dt: SampleT, idt: SampleT) -> SampleT {
+    2.0 * p - 1.0 - 2.0 * blep(p, dt, idt)
+}
+
+#[inline(always)]
+pub(crate) fn pulse(p: SampleT, dt: SampleT, idt: SampleT, w: SampleT) -> SampleT {
+    let y = if p < w { 1.0 } else { -1.0 };
+
+    y + 2.0 * blep(p, dt, idt) - 2.0 * blep(wrap(p + 1.0 - w), dt, idt)
+}
+
+#[inline(always)]
+pub(crate) fn triangle(p: SampleT, dt: SampleT, idt: SampleT) -> SampleT {
+    let y = 1.0 - 4.0 * (p - 0.5).abs();
+    let k = 8.0 * dt;
+
+    y + k * blamp(p, dt, idt) - k * blamp(wrap(p + 0.5), dt, idt)
+}
+
+/// Returns the phase increment per sample for the given frequency and inverse
+/// sample rate, at most half a period, along with its inverse.
+pub(crate) fn increment(f: MathT, inv_rate: MathT) -> (SampleT, SampleT) {
+    let inc = (f.abs() * inv_rate).min(0.5) as SampleT;
+
+    (inc, 1.0 / inc.max(SampleT::EPSILON))
+}
+
+/// Clamps the width of a pulse wave away from 0 and 1, where it would vanish.
+pub(crate) fn pulse_width(w: SampleT) -> SampleT {
+    w.max(0.001).min(0.999)
+}
+
+/// Band-limited oscillator producing any [`Waveform`].
+/// 
+/// The phase is kept in single precision, so an `Oscillator` gives exactly
+/// the output of a single voice of an [`OscillatorBank`] with the same
+/// frequency.
+/// 
+/// [`Waveform`]: enum.Waveform.html
+/// [`OscillatorBank`]: ../oscillator_bank/struct.OscillatorBank.html
+pub struct Oscillator {
+    waveform: Waveform,
+    phase: SampleT,
+    inc: SampleT,
+    inv: SampleT,
+    freq: MathT,
+    inv_rate: MathT,
+}
+
+impl Oscillator {
+    /// Creates a new oscillator of the given waveform and frequency.
+    pub fn with_waveform(waveform: Waveform, f: MathT) -> Self {
+        let mut o = Oscillator {
+            waveform: Waveform::Sine,
+            phase: 0.0,
+            inc: 0.0,
+            inv: 0.0,
+            freq: 0.0,
+            inv_rate: INV_SAMPLE_RATE,
+        };
+        o.set_waveform(waveform);
+        o.set_frequency(f);
+
+        o
+    }
+
+    /// Returns the waveform of the oscillator.
+    pub fn get_waveform(&self) -> Waveform {
+        self.waveform
+    }
+
+    /// Sets the waveform of the oscillator, keeping its phase.
+    pub fn set_waveform(&mut self, waveform: Waveform) {
+        self.waveform = match waveform {
+            Waveform::Pulse(w) => Waveform::Pulse(pulse_width(w)),
+            w => w,
+        };
+    }
+
+    /// Returns the phase of the oscillator, as a fraction of a period.
+    pub fn get_phase(&self) -> SampleT {
+        self.phase
+    }
+
+    /// Sets the phase of the oscillator, as a fraction of a period.
+    pub fn set_phase(&mut self, p: SampleT) {
+        self.phase = p - p.floor();
+    }
+}
+
+impl FreqMod for Oscillator {
+    /// Creates a new sine oscillator of the given frequency.
+    fn new(f: MathT) -> Self {
+        Oscillator::with_waveform(Waveform::Sine, f)
+    }
+
+    fn set_frequency(&mut self, f: MathT) {
+        let (inc, inv) = increment(f, self.inv_rate);
+        self.inc = inc;
+        self.inv = inv;
+        self.freq = f;
+    }
+
+    /// Returns the frequency the oscillator was last given, which may be
+    /// above the Nyquist frequency it is limited to while playing.
+    fn get_frequency(&self) -> MathT {
+        self.freq
+    }
+}
+
+impl Generator for Oscillator {
+    fn process(&mut self) -> SampleT {
+        let mut y = 0.0;
+        self.process_block(std::slice::from_mut(&mut y));
+        y
+    }
+
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        let (dt, idt) = (self.inc, self.inv);
+        let mut p = self.phase;
+
+        macro_rules! run {
+            ($f:expr) => {
+                for s in out {
+                    *s = $f(p);
+                    p = wrap(p + dt);
+                }
+            };
+        }
+
+        match self.waveform {
+            Waveform::Sine => run!(sin_turns),
+            Waveform::Sawtooth => run!(|p| sawtooth(p, dt, idt)),
+            Waveform::Square => run!(|p| pulse(p, dt, idt, 0.5)),
+            Waveform::Pulse(w) => run!(|p| pulse(p, dt, idt, w)),
+            Waveform::Triangle => run!(|p| triangle(p, dt, idt)),
+        }
+
+        self.phase = p;
+    }
+
+    fn reset(&mut self) {
+        self.phase = 0.0;
+    }
+
+    fn skip(&mut self, n: usize) {
+        self.phase = (self.phase as MathT + n as MathT * self.inc as MathT).fract() as SampleT;
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        self.inv_rate = ctx.inv_sample_rate();
+        self.set_frequency(self.freq);
+    }
+}
+
+impl Clone for Oscillator {
+    fn clone(&self) -> Self {
+        Oscillator {
+            waveform: self.waveform,
+            phase: 0.0,
+            inc: self.inc,
+            inv: self.inv,
+            freq: self.freq,
+            inv_rate: self.inv_rate,
+        }
+    }
+}
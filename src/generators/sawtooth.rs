@@ -10,6 +10,7 @@ use super::Generator;
 pub struct Sawtooth {
     irate: MathT,
     inc: MathT,
+    inv_rate: MathT,
 }
 
 impl FreqMod for Sawtooth {
@@ -17,15 +18,16 @@ impl FreqMod for Sawtooth {
         Sawtooth {
             irate: 2.0*f*INV_SAMPLE_RATE,
             inc: 0.0,
+            inv_rate: INV_SAMPLE_RATE,
         }
     }
 
     fn set_frequency(&mut self, f: MathT) {
-        self.irate = 2.0*f*INV_SAMPLE_RATE;
+        self.irate = 2.0*f*self.inv_rate;
     }
 
     fn get_frequency(&self) -> MathT {
-        self.irate / (2.0 * INV_SAMPLE_RATE)
+        self.irate / (2.0 * self.inv_rate)
     }
 }
 
@@ -41,13 +43,41 @@ impl Generator for Sawtooth {
 
         y as SampleT
     }
+
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        let irate = self.irate;
+        let mut inc = self.inc;
+
+        for s in out {
+            *s = inc as SampleT;
+
+            inc += irate;
+
+            if inc >= 1.0 {
+                inc -= 2.0;
+            }
+        }
+
+        self.inc = inc;
+    }
+
+    fn reset(&mut self) {
+        self.inc = 0.0;
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        let f = self.get_frequency();
+        self.inv_rate = ctx.inv_sample_rate();
+        self.set_frequency(f);
+    }
 }
 
 impl Clone for Sawtooth {
     fn clone(&self) -> Self {
         Sawtooth {
             irate: self.irate,
-            inc: 0.0
+            inc: 0.0,
+            inv_rate: self.inv_rate,
         }
     }
 }
@@ -2,76 +2,113 @@
 //! 
 //! A sinusoidal sample generator.
 
-use lazy_static::lazy_static;
 use super::*;
 
-/// The frequency used by the wavetable.
-const WAVETABLE_FREQ:u64 = 10;
-/// The number of elements in the wavetable.
-const WAVETABLE_SIZE:u64 = SAMPLE_RATE/WAVETABLE_FREQ;
-
-lazy_static! {
-    /// Lazy static initialization of the static WAVETABLE object.
-    static ref WAVETABLE: [MathT; WAVETABLE_SIZE as usize] = {
-        let mut wt = [0.0 ; WAVETABLE_SIZE as usize];
-        for i in 0..WAVETABLE_SIZE {
-            wt[i as usize] = MathT::sin(2.0*std::f64::consts::PI*INV_SAMPLE_RATE*(WAVETABLE_FREQ as MathT)*(i as MathT));
-        }
-        wt
-    };
-}
+/// The number of intervals in the wavetable, which holds a single period. This
+/// is a period of 10Hz at the default [`SAMPLE_RATE`].
+/// 
+/// [`SAMPLE_RATE`]: ../../constant.SAMPLE_RATE.html
+const WAVETABLE_SIZE:u64 = 4_800;
+
+// One period of a sine generated by the build script, `WAVETABLE`, followed by
+// a guard sample equal to the first sample so that the sample after any index
+// in the period can be read without wrapping around.
+include!(concat!(env!("OUT_DIR"), "/sine_table.rs"));
 
 /// Struct for generating sinusoidal samples.
+/// 
+/// The table is shared by every sine and doesn't depend on the sample rate,
+/// only the step through it does.
 pub struct Sine {
     ind:MathT,
     inc:MathT,
+    rate:MathT,
 }
 
 impl FreqMod for Sine {
     fn new(f: MathT) -> Self {
-        Sine{
+        let mut s = Sine{
             ind: 0.0,
-            inc: f/(WAVETABLE_FREQ as MathT),
-        }
+            inc: 0.0,
+            rate: SAMPLE_RATE as MathT,
+        };
+        s.set_frequency(f);
+
+        s
     }
 
     fn set_frequency(&mut self, f: MathT) {
-        self.inc = f / (WAVETABLE_FREQ as MathT);
+        self.inc = f * (WAVETABLE_SIZE as MathT) / self.rate;
     }
 
     fn get_frequency(&self) -> MathT {
-        self.inc * (WAVETABLE_FREQ as MathT)
+        self.inc * self.rate / (WAVETABLE_SIZE as MathT)
     }
 }
 
 impl Generator for Sine {
     fn process(&mut self) -> SampleT {
-        let k = MathT::floor(self.ind);
-        let g:MathT = self.ind - k;
-        let k1 = if k+1.0 >= WAVETABLE_SIZE as MathT {
-            0.0
-        } else {
-            k+1.0
-        } as usize;
-        let k = k as usize;
+        let k = self.ind as usize;
+        let g = (self.ind - k as MathT) as SampleT;
 
-        let y = ((1.0-g)*WAVETABLE[k] + g*WAVETABLE[k1]) as SampleT;
+        let y = WAVETABLE[k] + (WAVETABLE[k+1] - WAVETABLE[k])*g;
 
         self.ind += self.inc;
 
-        if self.ind >= (WAVETABLE_SIZE as MathT)-1.0 {
+        if self.ind >= WAVETABLE_SIZE as MathT {
             self.ind -= WAVETABLE_SIZE as MathT;
         }
 
         y
     }
+
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        let size = WAVETABLE_SIZE as MathT;
+        let inc = self.inc;
+        let mut ind = self.ind;
+
+        for s in out {
+            let k = ind as usize;
+            let g = (ind - k as MathT) as SampleT;
+
+            *s = WAVETABLE[k] + (WAVETABLE[k+1] - WAVETABLE[k])*g;
+
+            ind += inc;
+
+            if ind >= size {
+                ind -= size;
+            }
+        }
+
+        self.ind = ind;
+    }
+
+    fn reset(&mut self) {
+        self.ind = 0.0;
+    }
+
+    fn skip(&mut self, n: usize) {
+        let size = WAVETABLE_SIZE as MathT;
+
+        let ind = (self.ind + n as MathT * self.inc).rem_euclid(size);
+
+        // rem_euclid rounds tiny negative values up to the size itself.
+        self.ind = if ind >= size { ind - size } else { ind };
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        let f = self.get_frequency();
+        self.rate = ctx.sample_rate();
+        self.set_frequency(f);
+    }
 }
 
 impl Clone for Sine {
     fn clone(&self) -> Self {
         Sine {
             ind: 0.0,
-            inc: self.inc
+            inc: self.inc,
+            rate: self.rate,
         }
     }
 }
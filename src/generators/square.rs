@@ -8,22 +8,24 @@ use super::*;
 pub struct Square {
     ind:MathT,
     inv:MathT,
+    rate:MathT,
 }
 
 impl FreqMod for Square {
     fn new(f:MathT) -> Self {
         Square {
             ind: 0.0,
-            inv: SAMPLE_RATE as MathT/(2.0 * f)
+            inv: SAMPLE_RATE as MathT/(2.0 * f),
+            rate: SAMPLE_RATE as MathT,
         }
     }
 
     fn set_frequency(&mut self, f: MathT) {
-        self.inv = SAMPLE_RATE as MathT/(2.0 * f);
+        self.inv = self.rate/(2.0 * f);
     }
 
     fn get_frequency(&self) -> MathT {
-        SAMPLE_RATE as MathT/(2.0 * self.inv)
+        self.rate/(2.0 * self.inv)
     }
 }
 
@@ -43,13 +45,45 @@ impl Generator for Square {
 
         y
     }
+
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        let inv = self.inv;
+        let mut ind = self.ind;
+
+        for s in out {
+            *s = if ind >= inv && ind < 2.0 * inv {
+                -1.0
+            } else {
+                1.0
+            };
+
+            if ind >= 2.0 * inv {
+                ind -= 2.0 * inv;
+            }
+
+            ind += 1.0;
+        }
+
+        self.ind = ind;
+    }
+
+    fn reset(&mut self) {
+        self.ind = 0.0;
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        let f = self.get_frequency();
+        self.rate = ctx.sample_rate();
+        self.set_frequency(f);
+    }
 }
 
 impl Clone for Square {
     fn clone(&self) -> Self {
         Square {
             ind: 0.0,
-            inv: self.inv
+            inv: self.inv,
+            rate: self.rate,
         }
     }
 }
@@ -0,0 +1,222 @@
+//! # Streaming WAV
+//! 
+//! A wave data player which streams its file from disk instead of decoding it
+//! into memory up front.
+
+use super::*;
+use crate::utils::wav_stream::*;
+use std::sync::Arc;
+
+/// Struct for playing wave files too large to hold in memory.
+/// 
+/// Unlike [`MonoWav`], which decodes the whole file into a track, this reads
+/// the first channel of a shared [`WavAsset`] through a [`WavStream`], so only
+/// a few chunks of the file are held in memory at a time. Any number of
+/// players can be opened from the same asset.
+/// 
+/// Players aren't `Clone`, since each one opens the file again and runs its
+/// own prefetch thread, which can fail. Use [`try_clone`] to open another
+/// player with the same settings.
+/// 
+/// [`MonoWav`]: ../mono_wav/struct.MonoWav.html
+/// [`try_clone`]: struct.StreamingWav.html#method.try_clone
+/// [`WavAsset`]: ../../utils/wav_stream/struct.WavAsset.html
+/// [`WavStream`]: ../../utils/wav_stream/struct.WavStream.html
+pub struct StreamingWav {
+    stream: WavStream,
+    base: MathT,
+    inc: SampleT,
+    speed: MathT,
+    phase: SampleT,
+    x: [SampleT; 2],
+    primed: bool,
+    buf: Vec<SampleT>,
+}
+
+impl StreamingWav {
+    /// Opens a new player of the given asset for the default [`Context`],
+    /// starting from its first frame with no looping.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if the asset's file can't be opened.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn new(asset: Arc<WavAsset>) -> std::io::Result<Self> {
+        StreamingWav::with_context(asset, &Context::default())
+    }
+
+    /// Opens a new player of the given asset for the given [`Context`],
+    /// starting from its first frame with no looping.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if the asset's file can't be opened.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn with_context(asset: Arc<WavAsset>, ctx: &Context) -> std::io::Result<Self> {
+        let mut sw = StreamingWav {
+            stream: WavStream::new(asset)?,
+            base: 0.0,
+            inc: 0.0,
+            speed: 1.0,
+            phase: 0.0,
+            x: [0.0; 2],
+            primed: false,
+            buf: Vec::new(),
+        };
+        sw.set_context(ctx);
+
+        Ok(sw)
+    }
+
+    /// Opens a new player of the same asset, starting from its first frame
+    /// with the same speed, loop points, and sample rate.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if the asset's file can no longer be opened.
+    pub fn try_clone(&self) -> std::io::Result<Self> {
+        let mut sw = StreamingWav::new(self.stream.asset().clone())?;
+        let (s, e) = self.stream.get_loop_points();
+
+        sw.stream.set_loop_points(s, e);
+        sw.base = self.base;
+        sw.inc = self.inc;
+        sw.speed = self.speed;
+        sw.buf.resize(self.buf.len(), 0.0);
+
+        Ok(sw)
+    }
+
+    /// Opens a new player of the WAV file at the given path.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails under the conditions of [`WavAsset::open`].
+    /// 
+    /// [`WavAsset::open`]: ../../utils/wav_stream/struct.WavAsset.html#method.open
+    pub fn from_path<P: AsRef<std::path::Path>>(path: P) -> std::io::Result<Self> {
+        StreamingWav::new(WavAsset::open(path)?)
+    }
+
+    /// Borrows the underlying stream, for seeking, setting loop points, and
+    /// checking for underruns.
+    pub fn get(&self) -> &WavStream {
+        &self.stream
+    }
+
+    /// Mutably borrows the underlying stream. Seeking through this directly
+    /// leaves stale frames in the interpolator, use [`seek`] instead.
+    /// 
+    /// [`seek`]: struct.StreamingWav.html#method.seek
+    pub fn get_mut(&mut self) -> &mut WavStream {
+        &mut self.stream
+    }
+
+    /// Restarts playback from the given frame of the source file.
+    pub fn seek(&mut self, frame: u64) {
+        self.stream.seek(frame);
+        self.phase = 0.0;
+        self.primed = false;
+    }
+
+    /// Sets the playback speed. A speed of 1 plays the file at its original
+    /// pitch.
+    pub fn set_speed(&mut self, speed: MathT) {
+        self.speed = speed;
+        self.inc = (self.base * speed) as SampleT;
+    }
+
+    /// Returns the playback speed.
+    pub fn get_speed(&self) -> MathT {
+        self.speed
+    }
+
+    /// Returns true once the end of a non-looping file has been played, or
+    /// once every frame decoded before reading the file failed has.
+    pub fn is_finished(&self) -> bool {
+        self.stream.is_finished()
+    }
+}
+
+impl Generator for StreamingWav {
+    fn process(&mut self) -> SampleT {
+        let mut y = 0.0;
+        self.process_block(std::slice::from_mut(&mut y));
+        y
+    }
+
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        // The first two frames are loaded lazily, giving the prefetch thread
+        // until the first block to decode them.
+        if !self.primed {
+            self.stream.read(&mut self.x);
+            self.primed = true;
+        }
+
+        // Count the source frames this block advances over, then read them
+        // from the stream in one go.
+        let mut need = 0;
+        let mut p = self.phase;
+        for _ in 0..out.len() {
+            p += self.inc;
+            while p >= 1.0 {
+                p -= 1.0;
+                need += 1;
+            }
+        }
+
+        if self.buf.len() < need {
+            self.buf.resize(need, 0.0);
+        }
+        self.stream.read(&mut self.buf[..need]);
+
+        let mut src = self.buf[..need].iter();
+        for y in out {
+            *y = self.x[0] + self.phase * (self.x[1] - self.x[0]);
+
+            self.phase += self.inc;
+            while self.phase >= 1.0 {
+                self.phase -= 1.0;
+                self.x[0] = self.x[1];
+                self.x[1] = *src.next().unwrap_or(&0.0);
+            }
+        }
+    }
+
+    fn reset(&mut self) {
+        self.seek(0);
+    }
+
+    /// Sets the increment for the sample rate of the given [`Context`], and
+    /// reserves room to read the source frames of a block of its maximum
+    /// size.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    fn set_context(&mut self, ctx: &Context) {
+        let rate = self.stream.asset().info().sampling_rate as MathT;
+        self.base = rate * ctx.inv_sample_rate();
+        self.inc = (self.base * self.speed) as SampleT;
+
+        let need = (ctx.max_block() as MathT * self.inc as MathT).ceil() as usize + 1;
+        if self.buf.len() < need {
+            self.buf.resize(need, 0.0);
+        }
+    }
+
+    /// Returns the number of samples it takes to play the last frames read
+    /// once the end of a non-looping file has been reached, or `None` before
+    /// then.
+    fn tail(&self) -> Option<usize> {
+        if !self.is_finished() {
+            None
+        } else if self.x == [0.0; 2] {
+            Some(0)
+        } else if self.inc > 0.0 {
+            Some((2.0 / self.inc).ceil() as usize + 1)
+        } else {
+            None
+        }
+    }
+}
@@ -8,6 +8,7 @@ use super::*;
 pub struct Triangle {
     irate: MathT,
     inc: MathT,
+    inv_rate: MathT,
 }
 
 impl FreqMod for Triangle {
@@ -15,15 +16,16 @@ impl FreqMod for Triangle {
         Triangle {
             irate: 4.0 * f * INV_SAMPLE_RATE,
             inc: 0.0,
+            inv_rate: INV_SAMPLE_RATE,
         }
     }
 
     fn set_frequency(&mut self, f: MathT) {
-        self.irate = 4.0 * f * INV_SAMPLE_RATE;
+        self.irate = 4.0 * f * self.inv_rate;
     }
 
     fn get_frequency(&self) -> MathT {
-        self.irate / (4.0 * INV_SAMPLE_RATE)
+        self.irate / (4.0 * self.inv_rate)
     }
 }
 
@@ -45,13 +47,50 @@ impl Generator for Triangle {
 
         y as SampleT
     }
+
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        let mut irate = self.irate;
+        let mut inc = self.inc;
+
+        for s in out {
+            *s = inc as SampleT;
+
+            inc += irate;
+
+            if inc >= 1.0 || inc <= -1.0 {
+                irate = -irate;
+
+                inc = if inc >= 1.0 {
+                    2.0 - inc
+                } else {
+                    -2.0 - inc
+                };
+            }
+        }
+
+        self.irate = irate;
+        self.inc = inc;
+    }
+
+    fn reset(&mut self) {
+        self.irate = self.irate.abs();
+        self.inc = 0.0;
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        // Keep the direction the wave is currently heading in.
+        let r = self.inv_rate;
+        self.inv_rate = ctx.inv_sample_rate();
+        self.irate *= self.inv_rate / r;
+    }
 }
 
 impl Clone for Triangle {
     fn clone(&self) -> Self {
         Triangle {
-            irate: self.irate,
-            inc: 0.0
+            irate: self.irate.abs(),
+            inc: 0.0,
+            inv_rate: self.inv_rate,
         }
     }
 }
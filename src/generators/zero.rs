@@ -20,4 +20,16 @@ impl Generator for Zero {
     fn process(&mut self) -> SampleT {
         0.0
     }
+
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        for s in out {
+            *s = 0.0;
+        }
+    }
+
+    fn skip(&mut self, _n: usize) {}
+
+    fn tail(&self) -> Option<usize> {
+        Some(0)
+    }
 }
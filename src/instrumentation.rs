@@ -0,0 +1,297 @@
+//! # Instrumentation
+//! 
+//! Lock-free render time statistics, compiled in with the `instrumentation`
+//! feature.
+
+use super::*;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::time::{Duration, Instant};
+
+/// Number of buckets in the load histogram of a [`RenderStats`].
+/// 
+/// [`RenderStats`]: struct.RenderStats.html
+pub const LOAD_BUCKETS: usize = 100;
+
+/// Fixed point scale of the loads counted in the histogram, which tells apart
+/// loads down to about a millionth of the deadline.
+const LOAD_SCALE: MathT = (1u64 << 20) as MathT;
+
+/// Render time statistics of a channel, a [`Sound`], or a [`Block`].
+/// 
+/// Every call to [`record`] counts one block of audio taking the given time
+/// to render, against the deadline of the same number of samples played in
+/// real time at the sample rate of the last [`Context`] the statistics were
+/// given. The ratio of the two, the load of the block, is counted in a
+/// histogram of [`LOAD_BUCKETS`] buckets, four per octave, from which
+/// [`RenderSnapshot::load_percentile`] reads percentiles to within 25%.
+/// 
+/// All counters are atomics updated with relaxed ordering, so recording
+/// never blocks or allocates, and any thread holding a reference, usually a
+/// monitoring thread given a clone of the [`Arc`] the statistics live in, can
+/// read them with [`snapshot`] while the render thread records. A snapshot
+/// taken during a call to [`record`] may count that block in some fields but
+/// not yet in others.
+/// 
+/// Cloning gives statistics of the same sample rate with nothing recorded.
+/// 
+/// [`Sound`]: ../sounds/trait.Sound.html
+/// [`Block`]: ../sounds/trait.Block.html
+/// [`record`]: struct.RenderStats.html#method.record
+/// [`Context`]: ../context/struct.Context.html
+/// [`LOAD_BUCKETS`]: constant.LOAD_BUCKETS.html
+/// [`RenderSnapshot::load_percentile`]: struct.RenderSnapshot.html#method.load_percentile
+/// [`Arc`]: https://doc.rust-lang.org/std/sync/struct.Arc.html
+/// [`snapshot`]: struct.RenderStats.html#method.snapshot
+pub struct RenderStats {
+    sample_ns: AtomicU64,
+    blocks: AtomicU64,
+    samples: AtomicU64,
+    render_ns: AtomicU64,
+    budget_ns: AtomicU64,
+    peak_ns: AtomicU64,
+    peak_load: AtomicU64,
+    overruns: AtomicU64,
+    voices: AtomicUsize,
+    peak_voices: AtomicUsize,
+    histogram: [AtomicU64; LOAD_BUCKETS],
+}
+
+impl RenderStats {
+    /// Creates new statistics for the default [`Context`].
+    /// 
+    /// [`Context`]: ../context/struct.Context.html
+    pub fn new() -> Self {
+        Self::with_context(&Context::default())
+    }
+
+    /// Creates new statistics for the given [`Context`].
+    /// 
+    /// [`Context`]: ../context/struct.Context.html
+    pub fn with_context(ctx: &Context) -> Self {
+        let stats = RenderStats {
+            sample_ns: AtomicU64::new(0),
+            blocks: AtomicU64::new(0),
+            samples: AtomicU64::new(0),
+            render_ns: AtomicU64::new(0),
+            budget_ns: AtomicU64::new(0),
+            peak_ns: AtomicU64::new(0),
+            peak_load: AtomicU64::new(0),
+            overruns: AtomicU64::new(0),
+            voices: AtomicUsize::new(0),
+            peak_voices: AtomicUsize::new(0),
+            histogram: [(); LOAD_BUCKETS].map(|_| AtomicU64::new(0)),
+        };
+        stats.set_context(ctx);
+
+        stats
+    }
+
+    /// Measures blocks recorded from now on against the sample rate of the
+    /// given [`Context`]. Blocks already recorded keep their deadlines.
+    /// 
+    /// [`Context`]: ../context/struct.Context.html
+    pub fn set_context(&self, ctx: &Context) {
+        self.sample_ns.store((1e9 * ctx.inv_sample_rate()).to_bits(), Ordering::Relaxed);
+    }
+
+    /// Records a block of `samples` samples which took `elapsed` to render.
+    /// Blocks taking longer than the samples last in real time are counted
+    /// as overruns.
+    pub fn record(&self, elapsed: Duration, samples: usize) {
+        let ns = elapsed.as_nanos() as u64;
+        let budget = samples as MathT * MathT::from_bits(self.sample_ns.load(Ordering::Relaxed));
+        let load = if budget > 0.0 { ns as MathT / budget } else { 0.0 };
+        let x = (load * LOAD_SCALE) as u64;
+
+        self.blocks.fetch_add(1, Ordering::Relaxed);
+        self.samples.fetch_add(samples as u64, Ordering::Relaxed);
+        self.render_ns.fetch_add(ns, Ordering::Relaxed);
+        self.budget_ns.fetch_add(budget as u64, Ordering::Relaxed);
+        self.peak_ns.fetch_max(ns, Ordering::Relaxed);
+        self.peak_load.fetch_max(x, Ordering::Relaxed);
+        if load > 1.0 {
+            self.overruns.fetch_add(1, Ordering::Relaxed);
+        }
+        self.histogram[bucket(x)].fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Runs `f`, recording the time it takes as a block of `samples`
+    /// samples, and returns its result.
+    #[inline]
+    pub fn measure<R, F>(&self, samples: usize, f: F) -> R
+        where F: FnOnce() -> R
+    {
+        let start = Instant::now();
+        let r = f();
+        self.record(start.elapsed(), samples);
+
+        r
+    }
+
+    /// Records the number of voices rendered in the current block.
+    pub fn record_voices(&self, voices: usize) {
+        self.voices.store(voices, Ordering::Relaxed);
+        self.peak_voices.fetch_max(voices, Ordering::Relaxed);
+    }
+
+    /// Returns a copy of the statistics recorded so far.
+    pub fn snapshot(&self) -> RenderSnapshot {
+        let ns = |a: &AtomicU64| Duration::from_nanos(a.load(Ordering::Relaxed));
+
+        let mut histogram = [0; LOAD_BUCKETS];
+        for (h, a) in histogram.iter_mut().zip(&self.histogram) {
+            *h = a.load(Ordering::Relaxed);
+        }
+
+        RenderSnapshot {
+            blocks: self.blocks.load(Ordering::Relaxed),
+            samples: self.samples.load(Ordering::Relaxed),
+            render_time: ns(&self.render_ns),
+            budget: ns(&self.budget_ns),
+            peak_block_time: ns(&self.peak_ns),
+            peak_load: self.peak_load.load(Ordering::Relaxed) as MathT / LOAD_SCALE,
+            overruns: self.overruns.load(Ordering::Relaxed),
+            voices: self.voices.load(Ordering::Relaxed),
+            peak_voices: self.peak_voices.load(Ordering::Relaxed),
+            histogram,
+        }
+    }
+
+    /// Clears everything recorded so far, keeping the sample rate. Blocks
+    /// recorded during the reset may be partially cleared.
+    pub fn reset(&self) {
+        for a in [&self.blocks, &self.samples, &self.render_ns, &self.budget_ns, &self.peak_ns, &self.peak_load, &self.overruns] {
+            a.store(0, Ordering::Relaxed);
+        }
+        for a in &self.histogram {
+            a.store(0, Ordering::Relaxed);
+        }
+        self.voices.store(0, Ordering::Relaxed);
+        self.peak_voices.store(0, Ordering::Relaxed);
+    }
+}
+
+impl Default for RenderStats {
+    fn default() -> Self {
+        RenderStats::new()
+    }
+}
+
+impl Clone for RenderStats {
+    fn clone(&self) -> Self {
+        let stats = RenderStats::new();
+        stats.sample_ns.store(self.sample_ns.load(Ordering::Relaxed), Ordering::Relaxed);
+
+        stats
+    }
+}
+
+/// Copy of the counters of a [`RenderStats`], taken with
+/// [`RenderStats::snapshot`].
+/// 
+/// [`RenderStats`]: struct.RenderStats.html
+/// [`RenderStats::snapshot`]: struct.RenderStats.html#method.snapshot
+#[derive(Copy,Clone,Debug,PartialEq)]
+pub struct RenderSnapshot {
+    /// Number of blocks rendered.
+    pub blocks: u64,
+    /// Number of samples rendered.
+    pub samples: u64,
+    /// Total time spent rendering.
+    pub render_time: Duration,
+    /// Total time the rendered samples last in real time.
+    pub budget: Duration,
+    /// Longest time taken to render a block.
+    pub peak_block_time: Duration,
+    /// Largest ratio of the time taken to render a block to its deadline.
+    pub peak_load: MathT,
+    /// Number of blocks that took longer to render than their deadline.
+    pub overruns: u64,
+    /// Number of voices rendered in the last block of a channel.
+    pub voices: usize,
+    /// Largest number of voices rendered in a block of a channel.
+    pub peak_voices: usize,
+    histogram: [u64; LOAD_BUCKETS],
+}
+
+impl RenderSnapshot {
+    /// Returns the ratio of the total render time to the total deadline, the
+    /// share of real time spent rendering.
+    pub fn load(&self) -> MathT {
+        if self.budget == Duration::from_secs(0) {
+            0.0
+        } else {
+            self.render_time.as_secs_f64() / self.budget.as_secs_f64()
+        }
+    }
+
+    /// Returns the average time taken to render a block.
+    pub fn mean_block_time(&self) -> Duration {
+        if self.blocks == 0 {
+            Duration::from_secs(0)
+        } else {
+            Duration::from_nanos((self.render_time.as_nanos() / self.blocks as u128) as u64)
+        }
+    }
+
+    /// Returns the average render time of a sample, in nanoseconds.
+    pub fn ns_per_sample(&self) -> MathT {
+        if self.samples == 0 {
+            0.0
+        } else {
+            self.render_time.as_nanos() as MathT / self.samples as MathT
+        }
+    }
+
+    /// Returns the average number of cycles spent rendering a sample on a
+    /// processor clocked at `clock_hz`.
+    pub fn cycles_per_sample(&self, clock_hz: MathT) -> MathT {
+        self.ns_per_sample() * clock_hz * 1e-9
+    }
+
+    /// Returns the load that the given fraction of blocks, in [0,1], stayed
+    /// under, so that `load_percentile(0.99)` is the 99th percentile load.
+    /// The value is the upper bound of the histogram bucket the percentile
+    /// falls in, and never more than the peak load.
+    pub fn load_percentile(&self, p: MathT) -> MathT {
+        let rank = (p.max(0.0).min(1.0) * self.blocks as MathT).ceil() as u64;
+
+        let mut count = 0;
+        for (i, h) in self.histogram.iter().enumerate() {
+            count += h;
+            if count >= rank.max(1) {
+                return (bucket_floor(i + 1) as MathT / LOAD_SCALE).min(self.peak_load);
+            }
+        }
+
+        self.peak_load
+    }
+
+    /// Returns the number of blocks counted in each bucket of the load
+    /// histogram. Bucket 4 and above cover a quarter octave each, bucket `i`
+    /// starting at a load of `(4 + i % 4) * 2^(i / 4 - 1) / 2^20`.
+    pub fn histogram(&self) -> &[u64] {
+        &self.histogram
+    }
+}
+
+/// Returns the histogram bucket of the given fixed point load.
+fn bucket(x: u64) -> usize {
+    if x < 4 {
+        return x as usize;
+    }
+
+    let e = 63 - x.leading_zeros() as usize;
+    let sub = ((x >> (e - 2)) & 3) as usize;
+
+    (4 * (e - 1) + sub).min(LOAD_BUCKETS - 1)
+}
+
+/// Returns the smallest fixed point load counted in the given bucket.
+fn bucket_floor(i: usize) -> u64 {
+    if i < 4 {
+        i as u64
+    } else {
+        (4 + (i % 4) as u64) << (i / 4 - 1)
+    }
+}
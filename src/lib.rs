@@ -18,9 +18,8 @@
 //! 
 //! ## Dependencies
 //! 
-//! * [`lazy_static`](https://crates.io/crates/lazy_static): For initializing large arrays at run-time for some systems that use a wavetable.
 //! * [`petgrah`](https://crates.io/crates/petgraph): For the graph structure used by the [`ComplexSound`](https://docs.rs/bae_rs/0.13.2/bae_rs/sounds/complex_sound/struct.ComplexSound.html) struct.
-//! * [`rand`](https://crates.io/crates/rand): To generate white noise.
+//! * [`rayon`](https://crates.io/crates/rayon) (optional, `parallel` feature): For rendering independent sounds and graph nodes concurrently.
 //! * [`version-sync`](https://crates.io/crates/version-sync): Ensures that crate version numbers are correct in various locations.
 //! * [`wav`](https://crates.io/crates/wav): To read and write WAV files.
 //! 
@@ -32,7 +31,6 @@
 //! * Modifiers:
 //! * Features:
 //!   * Side-chain (?)
-//!   * FFT (use FFTW?)
 //!   * Read/write multiple audio formats (not just WAV)
 //! 
 //! ## License
@@ -58,12 +56,16 @@ pub const SAMPLE_RATE:u64 = 48_000;
 pub const INV_SAMPLE_RATE:MathT = 1.0/(SAMPLE_RATE as MathT);
 
 pub mod channels;
+pub mod context;
 pub mod debug;
 pub mod generators;
+#[cfg(feature = "instrumentation")]
+pub mod instrumentation;
 pub mod modifiers;
 pub mod sounds;
 pub mod sample_format;
-// pub mod tools;
+pub mod tools;
 pub mod utils;
 
+pub use context::*;
 pub use sample_format::*;
@@ -18,20 +18,30 @@ pub enum ADSRState {
     Stopped,
 }
 
+/// Level an exponential release stops at, -100dB.
+const RELEASE_FLOOR: MathT = 1e-5;
+
 /// Attack-decay-sustain-release filter.
 /// 
-/// Creates a simple envelope for the given signal.
+/// Creates a simple envelope for the given signal. Each stage is a [`Ramp`]
+/// applied a block at a time. The attack is always linear, while the decay and
+/// release can be linear or exponential. An exponential release falls to
+/// -100dB over the release time and then stops.
+/// 
+/// [`Ramp`]: ../../utils/automation/struct.Ramp.html
 pub struct ADSR {
-    a:SampleT,
-    d:SampleT,
-    s:SampleT,
-    r:SampleT,
+    a:usize,
+    d:usize,
+    s:MathT,
+    r:usize,
+    times:[Duration; 3],
+    curve:Curve,
     state:ADSRState,
-    g:SampleT,
+    g:Ramp,
 }
 
 impl ADSR {
-    /// Constructs an ADSR filter object.
+    /// Constructs an ADSR filter object with linear stages.
     /// 
     /// # Parameters
     /// 
@@ -40,65 +50,180 @@ impl ADSR {
     /// * `s` - Sustain level in decibels. Value is clamped to be less than 0.
     /// * `r` - Release time.
     pub fn new(a:Duration,d:Duration,s:MathT,r:Duration) -> Self {
-        let s = s.min(0.0);
-        ADSR {
-            a: 1.0/(a.as_secs_f64() * SAMPLE_RATE as MathT) as SampleT,
-            d: ((db_to_linear(s)-1.0)/(d.as_secs_f64() * SAMPLE_RATE as MathT)) as SampleT,
-            s: db_to_linear(s) as SampleT,
-            r: ((-db_to_linear(s))/(r.as_secs_f64() * SAMPLE_RATE as MathT)) as SampleT,
+        ADSR::with_curve(a, d, s, r, Curve::Linear)
+    }
+
+    /// Constructs an ADSR filter object whose decay and release follow the
+    /// given curve.
+    pub fn with_curve(a:Duration,d:Duration,s:MathT,r:Duration,curve:Curve) -> Self {
+        let mut adsr = ADSR {
+            a: seconds_to_samples(a),
+            d: seconds_to_samples(d),
+            s: db_to_linear(s.min(0.0)),
+            r: seconds_to_samples(r),
+            times: [a, d, r],
+            curve,
             state: ADSRState::Attack,
-            g: 0.0
-        }
+            g: Ramp::new(0.0),
+        };
+        adsr.trigger();
+
+        adsr
+    }
+
+    /// Restarts the envelope from silence at the start of its attack.
+    pub fn trigger(&mut self) {
+        self.state = ADSRState::Attack;
+        self.g.set(0.0);
+        self.g.ramp_over(1.0, self.a, Curve::Linear);
     }
 
     /// Changes adsr state to release
     pub fn release(&mut self) {
         self.state = ADSRState::Release;
+
+        match self.curve {
+            // The release keeps the slope it has when started from the sustain
+            // level.
+            Curve::Linear => {
+                let n = (self.g.value() / self.s * self.r as MathT).round() as usize;
+                self.g.ramp_over(0.0, n, Curve::Linear);
+            },
+            Curve::Exponential => {
+                self.g.ramp_over(RELEASE_FLOOR, self.r, Curve::Exponential);
+            },
+        }
     }
-}
 
-impl Modifier for ADSR {
-    fn process(&mut self, x: SampleT) -> SampleT {
+    /// Returns the current gain of the envelope.
+    pub fn get_gain(&self) -> MathT {
+        match self.state {
+            ADSRState::Stopped => 0.0,
+            _ => self.g.value(),
+        }
+    }
+
+    /// Moves on to the next stage once the ramp of the current one has ended.
+    fn advance(&mut self) {
         match self.state {
             ADSRState::Attack => {
-                self.g += self.a;
-                if self.g >= 1.0 {
-                    self.state = ADSRState::Decay;
-                    self.g = 1.0;
-                }
+                self.state = ADSRState::Decay;
+                self.g.ramp_over(self.s, self.d, self.curve);
             },
             ADSRState::Decay => {
-                self.g += self.d;
-                if self.g <= self.s {
-                    self.state = ADSRState::Sustain;
-                    self.g = self.s;
-                }
-            },
-            ADSRState::Sustain => {
+                self.state = ADSRState::Sustain;
             },
             ADSRState::Release => {
-                self.g += self.r;
-                if self.g <= 0.0 {
-                    self.state = ADSRState::Stopped;
-                    self.g = 0.0;
-                }
+                self.state = ADSRState::Stopped;
+                self.g.set(0.0);
             },
-            ADSRState::Stopped => return SampleT::default(),
+            ADSRState::Sustain | ADSRState::Stopped => (),
         }
+    }
+}
 
-        x * self.g
+impl Modifier for ADSR {
+    fn process(&mut self, x: SampleT) -> SampleT {
+        let mut y = x;
+        self.process_block(std::slice::from_mut(&mut y));
+        y
+    }
+
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        let mut i = 0;
+
+        while i < inout.len() {
+            match self.state {
+                ADSRState::Sustain => {
+                    self.g.apply(&mut inout[i..]);
+                    return;
+                },
+                ADSRState::Stopped => {
+                    for x in &mut inout[i..] {
+                        *x = SampleT::default();
+                    }
+                    return;
+                },
+                _ => {
+                    let n = self.g.remaining().min(inout.len() - i);
+                    self.g.apply(&mut inout[i..i + n]);
+                    i += n;
+
+                    if !self.g.is_active() {
+                        self.advance();
+                    }
+                },
+            }
+        }
+    }
+
+    /// Restarts the envelope, as [`trigger`] does.
+    /// 
+    /// [`trigger`]: struct.ADSR.html#method.trigger
+    fn reset(&mut self) {
+        self.trigger();
+    }
+
+    /// Moves the envelope on by `n` samples, through as many stages as it
+    /// takes.
+    fn skip(&mut self, mut n: usize) {
+        while n > 0 {
+            match self.state {
+                ADSRState::Sustain | ADSRState::Stopped => return,
+                _ => {
+                    let k = self.g.remaining().min(n);
+                    self.g.advance(k);
+                    n -= k;
+
+                    if !self.g.is_active() {
+                        self.advance();
+                    }
+                },
+            }
+        }
+    }
+
+    /// Converts the stage durations to samples at the rate of the given
+    /// [`Context`]. An envelope still in its attack is restarted, so the
+    /// attack started at construction has the right length.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    fn set_context(&mut self, ctx: &Context) {
+        let [a, d, r] = self.times;
+        self.a = ctx.seconds_to_samples(a);
+        self.d = ctx.seconds_to_samples(d);
+        self.r = ctx.seconds_to_samples(r);
+
+        if let ADSRState::Attack = self.state {
+            self.trigger();
+        }
+    }
+
+    fn tail(&self) -> Option<usize> {
+        Some(0)
+    }
+
+    /// Returns true once the envelope has stopped, until it is triggered
+    /// again.
+    fn is_silent(&self) -> bool {
+        matches!(self.state, ADSRState::Stopped)
     }
 }
 
 impl Clone for ADSR {
     fn clone(&self) -> Self {
-        ADSR {
+        let mut adsr = ADSR {
             a: self.a,
             d: self.d,
             s: self.s,
             r: self.r,
+            times: self.times,
+            curve: self.curve,
             state: ADSRState::Attack,
-            g: 0.0
-        }
+            g: Ramp::new(0.0),
+        };
+        adsr.trigger();
+
+        adsr
     }
 }
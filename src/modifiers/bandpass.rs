@@ -1,18 +1,15 @@
 //! # Band Pass
 
 use super::*;
+use crate::utils::fast_tan;
 
 /// -12dB per octave BandPass filter.
+#[derive(Clone)]
 pub struct BandPass {
     central_f: MathT,
     quality: MathT,
-    a0: MathT,
-    b1: MathT,
-    b2: MathT,
-    x1: SampleT,
-    x2: SampleT,
-    y1: SampleT,
-    y2: SampleT,
+    iir: Biquad,
+    inv_rate: MathT,
 }
 
 impl BandPass {
@@ -25,16 +22,11 @@ impl BandPass {
         let mut bp = BandPass {
             central_f: f,
             quality: q,
-            a0: 0.0,
-            b1: 0.0,
-            b2: 0.0,
-            x1: SampleT::default(),
-            x2: SampleT::default(),
-            y1: SampleT::default(),
-            y2: SampleT::default(),
+            iir: Biquad::new([0.0; 3], [0.0; 2]),
+            inv_rate: INV_SAMPLE_RATE,
         };
 
-        bp.reset();
+        bp.update_coefficients();
 
         bp
     }
@@ -44,16 +36,11 @@ impl BandPass {
         let mut bp = BandPass {
             central_f: (f.0*f.1).abs().sqrt(),
             quality: (f.0*f.1).abs().sqrt()/(f.1-f.0).abs(),
-            a0: 0.0,
-            b1: 0.0,
-            b2: 0.0,
-            x1: SampleT::default(),
-            x2: SampleT::default(),
-            y1: SampleT::default(),
-            y2: SampleT::default(),
+            iir: Biquad::new([0.0; 3], [0.0; 2]),
+            inv_rate: INV_SAMPLE_RATE,
         };
 
-        bp.reset();
+        bp.update_coefficients();
 
         bp
     }
@@ -67,7 +54,21 @@ impl BandPass {
     pub fn set_central_frequency(&mut self, f: MathT) {
         self.central_f = f;
 
-        self.reset();
+        self.update_coefficients();
+    }
+
+    /// Sets the central frequency, interpolating the filter's coefficients to
+    /// the new value over the next processed block instead of switching at
+    /// once. The coefficients are designed with [`fast_tan`], so this is
+    /// cheap enough to call at control rate from an [`Automated`] ramp.
+    /// 
+    /// [`fast_tan`]: ../../utils/fn.fast_tan.html
+    /// [`Automated`]: ../../utils/automation/struct.Automated.html
+    pub fn glide_central_frequency(&mut self, f: MathT) {
+        self.central_f = f;
+
+        let (b, a) = self.coefficients(fast_tan);
+        self.iir.glide_coefficients(b, a);
     }
 
     /// Returns the quality of the filter.
@@ -82,7 +83,7 @@ impl BandPass {
     pub fn set_quality(&mut self, q: MathT) {
         self.quality = q;
 
-        self.reset();
+        self.update_coefficients();
     }
 
     /// Returns the corner frequencies of the filter.
@@ -109,14 +110,19 @@ impl BandPass {
         self.central_f = (f.0 * f.1).sqrt();
         self.quality = self.central_f/(f.0-f.1).abs();
 
-        self.reset();
+        self.update_coefficients();
     }
 
-    fn reset(&mut self) {
+    fn update_coefficients(&mut self) {
+        let (b, a) = self.coefficients(MathT::tan);
+        self.iir.set_coefficients(b, a);
+    }
+
+    fn coefficients(&self, tan: fn(MathT) -> MathT) -> ([SampleT; 3], [SampleT; 2]) {
         let (fh, fl) = self.get_corner_frequencies();
 
-        let theta_l = (std::f64::consts::PI * fl * INV_SAMPLE_RATE).tan();
-        let theta_h = (std::f64::consts::PI * fh * INV_SAMPLE_RATE).tan();
+        let theta_l = tan(std::f64::consts::PI * fl * self.inv_rate);
+        let theta_h = tan(std::f64::consts::PI * fh * self.inv_rate);
 
         let al = 1.0 / (1.0+theta_l);
         let ah = 1.0 / (1.0+theta_h);
@@ -124,24 +130,32 @@ impl BandPass {
         let bl = (1.0-theta_l) / (1.0+theta_l);
         let bh = (1.0-theta_h) / (1.0+theta_h);
 
-        self.a0 = (1.0-al) * ah;
-        self.b1 = bl + bh;
-        self.b2 = bl * bh;
+        let a0 = ((1.0-al) * ah) as SampleT;
+
+        ([a0, 0.0, -a0], [-(bl + bh) as SampleT, (bl * bh) as SampleT])
     }
 }
 
 impl Modifier for BandPass {
     fn process(&mut self, x: SampleT) -> SampleT {
-        let y = (self.a0 * (x - self.x2) as MathT +
-            self.b1 * self.y1 as MathT - 
-            self.b2 * self.y2 as MathT) as SampleT;
+        self.iir.process(x)
+    }
 
-        self.y2 = self.y1;
-        self.y1 = y;
-        self.x2 = self.x1;
-        self.x1 = x;
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        self.iir.process_block(inout);
+    }
+
+    fn reset(&mut self) {
+        self.iir.reset();
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        self.inv_rate = ctx.inv_sample_rate();
+        self.update_coefficients();
+    }
 
-        y
+    fn tail(&self) -> Option<usize> {
+        self.iir.tail()
     }
 }
 
@@ -151,19 +165,3 @@ fn quadratic(a: MathT, b: MathT, c: MathT) -> (MathT,MathT) {
         (-b - (b*b - 4.0*a*c).sqrt())/(2.0*a)
     )
 }
-
-impl Clone for BandPass {
-    fn clone(&self) -> Self {
-        BandPass {
-            central_f: self.central_f,
-            quality: self.quality,
-            a0: self.a0,
-            b1: self.b1,
-            b2: self.b2,
-            x1: SampleT::default(),
-            x2: SampleT::default(),
-            y1: SampleT::default(),
-            y2: SampleT::default(),
-        }
-    }
-}
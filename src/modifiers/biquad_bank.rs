@@ -0,0 +1,374 @@
+//! # Biquad Bank
+//! 
+//! Biquad sections for many independent voices, processed together in SIMD
+//! lanes.
+
+use super::*;
+use crate::utils::denormal;
+use crate::utils::simd::{self, Lanes, LANES};
+
+/// Coefficients of a section passing its input through unchanged.
+const IDENTITY: [SampleT; 5] = [1.0, 0.0, 0.0, 0.0, 0.0];
+
+/// State and coefficients of [`LANES`] voices, one voice per lane.
+/// 
+/// [`LANES`]: ../../utils/simd/constant.LANES.html
+#[derive(Clone)]
+struct Group {
+    c: [Lanes; 5],
+    target: [Lanes; 5],
+    s: [Lanes; 2],
+    ramp: bool,
+    bypass: bool,
+}
+
+impl Group {
+    fn new() -> Self {
+        Group {
+            c: IDENTITY.map(|k| [k; LANES]),
+            target: IDENTITY.map(|k| [k; LANES]),
+            s: [[0.0; LANES]; 2],
+            ramp: false,
+            bypass: true,
+        }
+    }
+
+    fn set(&mut self, l: usize, c: [SampleT; 5]) {
+        for (k, c) in c.iter().enumerate() {
+            self.c[k][l] = *c;
+            self.target[k][l] = *c;
+        }
+        self.check();
+    }
+
+    fn ramp_to(&mut self, l: usize, c: [SampleT; 5]) {
+        for (k, c) in c.iter().enumerate() {
+            self.target[k][l] = *c;
+        }
+        self.ramp = self.target != self.c;
+        self.check();
+    }
+
+    fn clear(&mut self, l: usize) {
+        self.s[0][l] = 0.0;
+        self.s[1][l] = 0.0;
+    }
+
+    /// A group can be skipped while every lane passes its input through,
+    /// except for state left over from earlier coefficients.
+    fn check(&mut self) {
+        self.bypass = !self.ramp
+            && self.s.iter().all(|s| s.iter().all(|s| *s == 0.0))
+            && self.c.iter().zip(&IDENTITY).all(|(c, k)| c.iter().all(|c| c == k));
+    }
+}
+
+/// Bank of [`Biquad`] sections for many independent voices.
+/// 
+/// Voices are packed [`LANES`] at a time into the lanes of the vector
+/// registers and filtered over a whole block together with
+/// [`simd::biquad_lanes`], so a chain of filters on every voice of a scene
+/// costs a fraction of running each voice's filters on its own. Each voice has
+/// its own coefficients and state, and gives the same output as a [`Biquad`]
+/// with the same coefficients.
+/// 
+/// Coefficients can be switched immediately with [`set_voice`], or ramped
+/// linearly over the next processed block with [`ramp_voice`], which is cheap
+/// enough to do every block when a cutoff is being modulated. Groups of voices
+/// that all pass their input through unchanged are skipped.
+/// 
+/// Voices set from a [`Biquad`] made by one of its design constructors are
+/// designed for the sample rate of the bank, that of the last [`Context`]
+/// given to [`set_context`], and designed again whenever it changes. Voices
+/// set from coefficients keep them as they are.
+/// 
+/// [`Biquad`]: ../iir/type.Biquad.html
+/// [`LANES`]: ../../utils/simd/constant.LANES.html
+/// [`simd::biquad_lanes`]: ../../utils/simd/fn.biquad_lanes.html
+/// [`set_voice`]: struct.BiquadBank.html#method.set_voice
+/// [`ramp_voice`]: struct.BiquadBank.html#method.ramp_voice
+/// [`Context`]: ../../context/struct.Context.html
+/// [`set_context`]: struct.BiquadBank.html#method.set_context
+pub struct BiquadBank {
+    groups: Vec<Group>,
+    designs: Vec<Option<BiquadDesign>>,
+    voices: usize,
+    frames: Vec<Lanes>,
+    sample_rate: MathT,
+}
+
+impl BiquadBank {
+    /// Creates a new bank of `voices` voices which pass their input through
+    /// unchanged.
+    pub fn new(voices: usize) -> Self {
+        let mut bank = BiquadBank {
+            groups: Vec::new(),
+            designs: Vec::new(),
+            voices: 0,
+            frames: Vec::new(),
+            sample_rate: SAMPLE_RATE as MathT,
+        };
+        bank.resize(voices);
+
+        bank
+    }
+
+    /// Returns the number of voices in the bank.
+    pub fn voices(&self) -> usize {
+        self.voices
+    }
+
+    /// Changes the number of voices in the bank. New voices pass their input
+    /// through unchanged.
+    pub fn resize(&mut self, voices: usize) {
+        for v in voices..self.voices {
+            self.reset_voice(v);
+        }
+
+        self.groups.resize_with((voices + LANES - 1) / LANES, Group::new);
+        self.designs.resize(voices, None);
+        self.voices = voices;
+    }
+
+    /// Adds a voice which passes its input through unchanged, returning its
+    /// index.
+    pub fn push(&mut self) -> usize {
+        self.resize(self.voices + 1);
+        self.voices - 1
+    }
+
+    /// Removes the given voice, moving the last voice into its place like
+    /// [`Vec::swap_remove`].
+    /// 
+    /// [`Vec::swap_remove`]: https://doc.rust-lang.org/std/vec/struct.Vec.html#method.swap_remove
+    pub fn swap_remove(&mut self, v: usize) {
+        let last = self.voices - 1;
+
+        if v != last {
+            let (g, l) = (last / LANES, last % LANES);
+            let c = [0, 1, 2, 3, 4].map(|k| self.groups[g].c[k][l]);
+            let t = [0, 1, 2, 3, 4].map(|k| self.groups[g].target[k][l]);
+            let s = [self.groups[g].s[0][l], self.groups[g].s[1][l]];
+
+            let (g, l) = (v / LANES, v % LANES);
+            let group = &mut self.groups[g];
+            for k in 0..5 {
+                group.c[k][l] = c[k];
+                group.target[k][l] = t[k];
+            }
+            group.s[0][l] = s[0];
+            group.s[1][l] = s[1];
+            group.ramp = group.target != group.c;
+            group.check();
+
+            self.designs[v] = self.designs[last];
+        }
+
+        self.resize(last);
+    }
+
+    /// Sets the coefficients of the given voice to those of `f`, keeping its
+    /// state.
+    pub fn set_voice(&mut self, v: usize, f: &Biquad) {
+        assert!(v < self.voices, "Voice index out of range");
+        let c = self.coefficients(f);
+        self.groups[v / LANES].set(v % LANES, c);
+        self.designs[v] = f.design();
+    }
+
+    /// Ramps the coefficients of the given voice linearly to those of `f`
+    /// over the next call to [`process`].
+    /// 
+    /// Linear interpolation of the coefficients is only guaranteed to stay
+    /// stable between nearby filters, such as those of a smoothly modulated
+    /// cutoff.
+    /// 
+    /// [`process`]: struct.BiquadBank.html#method.process
+    pub fn ramp_voice(&mut self, v: usize, f: &Biquad) {
+        assert!(v < self.voices, "Voice index out of range");
+        let c = self.coefficients(f);
+        self.groups[v / LANES].ramp_to(v % LANES, c);
+        self.designs[v] = f.design();
+    }
+
+    /// Returns a [`Biquad`] with the current coefficients and the design of
+    /// the given voice.
+    /// 
+    /// [`Biquad`]: ../iir/type.Biquad.html
+    pub fn get_voice(&self, v: usize) -> Biquad {
+        assert!(v < self.voices, "Voice index out of range");
+        let (g, l) = (&self.groups[v / LANES], v % LANES);
+
+        Biquad::new([g.c[0][l], g.c[1][l], g.c[2][l]], [g.c[3][l], g.c[4][l]])
+            .with_design(self.designs[v])
+    }
+
+    /// Makes the given voice pass its input through unchanged, and silences
+    /// its state.
+    pub fn reset_voice(&mut self, v: usize) {
+        let group = &mut self.groups[v / LANES];
+        group.clear(v % LANES);
+        group.set(v % LANES, IDENTITY);
+        self.designs[v] = None;
+    }
+
+    /// Returns true if the state of the given voice has decayed below
+    /// [`SILENCE`], so that it outputs silence while its input is silent.
+    /// 
+    /// [`SILENCE`]: ../constant.SILENCE.html
+    pub fn is_voice_silent(&self, v: usize) -> bool {
+        assert!(v < self.voices, "Voice index out of range");
+        let (g, l) = (&self.groups[v / LANES], v % LANES);
+
+        g.s.iter().all(|s| s[l].abs() <= SILENCE)
+    }
+
+    /// Silences the state of the given voice.
+    pub fn clear_voice(&mut self, v: usize) {
+        let group = &mut self.groups[v / LANES];
+        group.clear(v % LANES);
+        group.check();
+    }
+
+    /// Silences the state of every voice.
+    pub fn clear(&mut self) {
+        for group in &mut self.groups {
+            group.s = [[0.0; LANES]; 2];
+            group.check();
+        }
+    }
+
+    /// Reserves room for `voices` more voices to be added without
+    /// reallocating.
+    pub fn reserve_voices(&mut self, voices: usize) {
+        let groups = (self.voices + voices + LANES - 1) / LANES;
+        self.groups.reserve(groups.saturating_sub(self.groups.len()));
+        self.designs.reserve((self.voices + voices).saturating_sub(self.designs.len()));
+    }
+
+    /// Sets the sample rate of the bank to that of the given [`Context`], and
+    /// designs every voice set from a designed [`Biquad`] again for it,
+    /// keeping its state and completing any ramp in progress.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    /// [`Biquad`]: ../iir/type.Biquad.html
+    pub fn set_context(&mut self, ctx: &Context) {
+        self.sample_rate = ctx.sample_rate();
+
+        for (v, d) in self.designs.iter().enumerate() {
+            if let Some(d) = d {
+                let (b, a) = d.coefficients(self.sample_rate);
+                let group = &mut self.groups[v / LANES];
+                group.c = group.target;
+                group.ramp = false;
+                group.set(v % LANES, [b[0], b[1], b[2], a[0], a[1]]);
+            }
+        }
+    }
+
+    /// Reserves room for blocks of up to `len` samples, so [`process`]
+    /// doesn't allocate.
+    /// 
+    /// [`process`]: struct.BiquadBank.html#method.process
+    pub fn reserve_frames(&mut self, len: usize) {
+        if self.frames.len() < len {
+            self.frames.resize(len, [0.0; LANES]);
+        }
+    }
+
+    /// Filters a block of samples of each voice in place, with `voices[v]`
+    /// holding the samples of voice `v`. Every block must be the same length.
+    /// 
+    /// Voices without a block are run on silence, and blocks past the number
+    /// of voices are left unchanged.
+    pub fn process<B: AsMut<[SampleT]>>(&mut self, voices: &mut [B]) {
+        let n = match voices.first_mut() {
+            Some(b) => b.as_mut().len(),
+            None => return,
+        };
+        if n == 0 {
+            return;
+        }
+        self.reserve_frames(n);
+
+        let frames = &mut self.frames[..n];
+        let count = self.voices.min(voices.len());
+
+        for (g, group) in self.groups.iter_mut().enumerate() {
+            if group.bypass {
+                continue;
+            }
+
+            let lanes = g * LANES..((g + 1) * LANES).min(count);
+
+            for f in frames.iter_mut() {
+                *f = [0.0; LANES];
+            }
+            for (l, v) in lanes.clone().enumerate() {
+                for (f, x) in frames.iter_mut().zip(voices[v].as_mut().iter()) {
+                    f[l] = *x;
+                }
+            }
+
+            if group.ramp {
+                let mut dc = [[0.0; LANES]; 5];
+                for k in 0..5 {
+                    for l in 0..LANES {
+                        dc[k][l] = (group.target[k][l] - group.c[k][l]) / n as SampleT;
+                    }
+                }
+
+                simd::biquad_lanes(frames, &mut group.c, Some(&dc), &mut group.s);
+
+                group.c = group.target;
+                group.ramp = false;
+            } else {
+                simd::biquad_lanes(frames, &mut group.c, None, &mut group.s);
+            }
+
+            for (l, v) in lanes.enumerate() {
+                for (f, x) in frames.iter().zip(voices[v].as_mut().iter_mut()) {
+                    *x = f[l];
+                }
+            }
+
+            for s in &mut group.s {
+                denormal::flush_slice(s);
+            }
+
+            group.check();
+        }
+    }
+
+    /// Returns the coefficients of the given section at the sample rate of
+    /// the bank.
+    fn coefficients(&self, f: &Biquad) -> [SampleT; 5] {
+        let (b, a) = match f.design() {
+            Some(d) => d.coefficients(self.sample_rate),
+            None => (*f.get_b(), *f.get_a()),
+        };
+        [b[0], b[1], b[2], a[0], a[1]]
+    }
+}
+
+impl Clone for BiquadBank {
+    /// Creates a silent bank of the same voices, with every pending ramp
+    /// completed.
+    fn clone(&self) -> Self {
+        let mut bank = BiquadBank {
+            groups: self.groups.clone(),
+            designs: self.designs.clone(),
+            voices: self.voices,
+            frames: vec![[0.0; LANES]; self.frames.len()],
+            sample_rate: self.sample_rate,
+        };
+
+        for group in &mut bank.groups {
+            group.c = group.target;
+            group.ramp = false;
+        }
+        bank.clear();
+
+        bank
+    }
+}
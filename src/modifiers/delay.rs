@@ -1,56 +1,114 @@
 //! # Delay
 
 use super::*;
+use crate::utils::delay_line::DelayLine;
 use std::time::Duration;
-use std::collections::VecDeque;
 
-/// Delay modifier, delays a signal by a given amount of time rounded to the
-/// nearest sample.
+/// Extra samples allocated past the maximum delay, so blocks can be written
+/// and read back in large chunks.
+const BLOCK_HEADROOM: usize = 256;
+
+/// Delay modifier, delays a signal by a given amount of time.
+/// 
+/// The delay can be changed while processing, up to the maximum given at
+/// construction, and needn't be a whole number of samples. Fractional delays
+/// are linearly interpolated.
+#[derive(Clone)]
 pub struct Delay {
-    delay: VecDeque<SampleT>,
+    line: DelayLine,
+    delay: SampleT,
+    max: SampleT,
+    rate: MathT,
+    quiet: QuietCounter,
 }
 
 impl Delay {
     /// Creates a new Delay object from the given duration rounded to the
     /// nearest sample.
     pub fn new(d: Duration) -> Self {
-        let mut v = VecDeque::new();
+        let mut delay = Delay::with_max_delay(d, d);
+        delay.delay = delay.delay.round();
 
-        for _ in 0..((d.as_secs_f64()*SAMPLE_RATE as MathT).round() as usize) {
-            v.push_back(SampleT::default());
-        }
+        delay
+    }
+
+    /// Creates a new Delay object from the given duration, which can later be
+    /// changed to anything up to `max` without reallocating.
+    pub fn with_max_delay(d: Duration, max: Duration) -> Self {
+        let max = (max.max(d).as_secs_f64() * SAMPLE_RATE as MathT).ceil();
 
         Delay {
-            delay:v
+            line: DelayLine::new(max as usize + BLOCK_HEADROOM),
+            delay: (d.as_secs_f64() * SAMPLE_RATE as MathT) as SampleT,
+            max: max as SampleT,
+            rate: SAMPLE_RATE as MathT,
+            quiet: QuietCounter::new(),
         }
     }
 
     /// Returns the delay of the Modifier in a Duration value.
     pub fn get_delay(&self) -> Duration {
-        Duration::from_secs_f64(self.delay.len() as MathT / SAMPLE_RATE as MathT)
+        Duration::from_secs_f64(self.delay as MathT / self.rate)
+    }
+
+    /// Sets the delay, clamped to the maximum given at construction.
+    pub fn set_delay(&mut self, d: Duration) {
+        self.delay = ((d.as_secs_f64() * self.rate) as SampleT).min(self.max);
     }
 }
 
 impl Modifier for Delay {
     fn process(&mut self, x: SampleT) -> SampleT {
-        self.delay.push_back(x);
+        self.quiet.sample(x);
+        self.line.write(x);
 
-        self.delay.pop_front().unwrap()
+        self.line.tap_linear(self.delay)
     }
-}
 
-impl Clone for Delay {
-    fn clone(&self) -> Self {
-        Delay {
-            delay: {
-                let mut v = VecDeque::new();
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        if self.delay.fract() != 0.0 {
+            for x in inout {
+                *x = self.process(*x);
+            }
+            return;
+        }
 
-                for _ in 0..(self.delay.len() * SAMPLE_RATE as usize) {
-                    v.push_back(SampleT::default());
-                }
+        let d = self.delay as usize;
+        self.quiet.block(inout);
 
-                v
-            }
+        for chunk in inout.chunks_mut(self.line.len() - d) {
+            self.line.write_block(chunk);
+            self.line.read_block(d, chunk);
         }
     }
+
+    fn reset(&mut self) {
+        self.line.clear();
+        self.quiet = QuietCounter::new();
+    }
+
+    /// Converts the delay and its maximum to samples at the rate of the given
+    /// [`Context`], reallocating the buffer if it no longer fits. A delay of a
+    /// whole number of samples stays whole.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    fn set_context(&mut self, ctx: &Context) {
+        let scale = ctx.sample_rate() / self.rate;
+        let whole = self.delay.fract() == 0.0;
+
+        self.rate = ctx.sample_rate();
+        self.max = (self.max as MathT * scale).ceil() as SampleT;
+        self.delay = ((self.delay as MathT * scale) as SampleT).min(self.max);
+        if whole {
+            self.delay = self.delay.round().min(self.max.floor());
+        }
+
+        if self.line.max_delay() < self.max as usize + BLOCK_HEADROOM {
+            self.line = DelayLine::new(self.max as usize + BLOCK_HEADROOM);
+        }
+    }
+
+    fn tail(&self) -> Option<usize> {
+        Some(self.quiet.tail(self.delay.ceil() as usize + 1))
+    }
 }
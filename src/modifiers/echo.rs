@@ -1,13 +1,22 @@
 //! # Echo
 
 use super::*;
-use std::collections::VecDeque;
+use crate::utils::{delay_line::DelayLine, denormal};
 use std::time::Duration;
 
 /// Simple Echo filter: H(z) = 1/(1-az^-d)
+/// 
+/// The delay can be changed while processing, up to the maximum given at
+/// construction, and needn't be a whole number of samples. Fractional delays
+/// are linearly interpolated.
+#[derive(Clone)]
 pub struct Echo {
-    delay: VecDeque<SampleT>,
+    line: DelayLine,
+    delay: SampleT,
+    max: SampleT,
     gain: SampleT,
+    rate: MathT,
+    quiet: QuietCounter,
 }
 
 impl Echo {
@@ -16,40 +25,126 @@ impl Echo {
     /// 
     /// [`Echo`]: struct.Echo.html
     pub fn new(d: Duration, g: MathT) -> Self{
-        let mut v = VecDeque::new();
-        for _ in 0..((d.as_secs_f64()*SAMPLE_RATE as MathT) as usize) {
-            v.push_back(SampleT::default());
-        }
+        let mut e = Echo::with_max_delay(d, d, g);
+        e.delay = e.delay.trunc().max(1.0);
+
+        e
+    }
+
+    /// Creates a new [`Echo`] object with the given delay duration, which can
+    /// later be changed to anything up to `max` without reallocating, and
+    /// feedback amount.
+    /// 
+    /// [`Echo`]: struct.Echo.html
+    pub fn with_max_delay(d: Duration, max: Duration, g: MathT) -> Self {
+        let max = (max.max(d).as_secs_f64() * SAMPLE_RATE as MathT).ceil().max(1.0);
 
         Echo {
-            delay: v,
+            line: DelayLine::new(max as usize),
+            delay: ((d.as_secs_f64() * SAMPLE_RATE as MathT) as SampleT).max(1.0),
+            max: max as SampleT,
             gain: g as SampleT,
+            rate: SAMPLE_RATE as MathT,
+            quiet: QuietCounter::new(),
         }
     }
+
+    /// Returns the delay of the echo in a Duration value.
+    pub fn get_delay(&self) -> Duration {
+        Duration::from_secs_f64(self.delay as MathT / self.rate)
+    }
+
+    /// Sets the delay, clamped between one sample and the maximum given at
+    /// construction.
+    pub fn set_delay(&mut self, d: Duration) {
+        self.delay = ((d.as_secs_f64() * self.rate) as SampleT).max(1.0).min(self.max);
+    }
+
+    /// Returns the feedback amount.
+    pub fn get_gain(&self) -> MathT {
+        self.gain as MathT
+    }
+
+    /// Sets the feedback amount.
+    pub fn set_gain(&mut self, g: MathT) {
+        self.gain = g as SampleT;
+    }
 }
 
 impl Modifier for Echo {
     fn process(&mut self, x: SampleT) -> SampleT {
-        let wet = self.delay.pop_front().unwrap() * self.gain + x;
-        self.delay.push_back(wet);
+        self.quiet.sample(x);
+
+        // The most recent output is at a delay of 0, one sample before this
+        // one.
+        let wet = denormal::flush(self.line.tap_linear(self.delay - 1.0) * self.gain + x);
+        self.line.write(wet);
 
         wet
     }
-}
 
-impl Clone for Echo {
-    fn clone(&self) -> Self {
-        Echo {
-            delay: {
-                let mut v = VecDeque::new();
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        if self.delay.fract() != 0.0 {
+            for x in inout {
+                *x = self.process(*x);
+            }
+            return;
+        }
+
+        let d = self.delay as usize;
+        let gain = self.gain;
+        self.quiet.block(inout);
+
+        // Within a chunk no longer than the delay, every fed back sample was
+        // written before the chunk.
+        for chunk in inout.chunks_mut(d) {
+            for (i, x) in chunk.iter_mut().enumerate() {
+                *x = self.line.tap(d - 1 - i) * gain + *x;
+            }
+            denormal::flush_slice(chunk);
 
-                for _ in 0..(self.delay.len() * SAMPLE_RATE as usize) {
-                    v.push_back(SampleT::default());
-                }
+            self.line.write_block(chunk);
+        }
+    }
+
+    fn reset(&mut self) {
+        self.line.clear();
+        self.quiet = QuietCounter::new();
+    }
+
+    /// Converts the delay and its maximum to samples at the rate of the given
+    /// [`Context`], reallocating the buffer if it no longer fits. A delay of a
+    /// whole number of samples stays whole.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    fn set_context(&mut self, ctx: &Context) {
+        let scale = ctx.sample_rate() / self.rate;
+        let whole = self.delay.fract() == 0.0;
 
-                v
-            },
-            gain: self.gain,
+        self.rate = ctx.sample_rate();
+        self.max = (self.max as MathT * scale).ceil().max(1.0) as SampleT;
+        self.delay = ((self.delay as MathT * scale) as SampleT).max(1.0).min(self.max);
+        if whole {
+            self.delay = self.delay.trunc();
         }
+
+        if self.line.max_delay() < self.max as usize {
+            self.line = DelayLine::new(self.max as usize);
+        }
+    }
+
+    /// Returns the time it takes the echoes of a full scale input to decay
+    /// below [`SILENCE`], or `None` if their gain is 1 or more.
+    /// 
+    /// [`SILENCE`]: ../constant.SILENCE.html
+    fn tail(&self) -> Option<usize> {
+        let g = self.gain.abs();
+        if g >= 1.0 {
+            return None;
+        }
+
+        let echoes = if g > 0.0 { (SILENCE.ln() / g.ln()).ceil() as usize } else { 0 };
+
+        Some(self.quiet.tail((self.delay.ceil() as usize).saturating_mul(echoes + 1) + 1))
     }
 }
@@ -4,12 +4,21 @@ use super::*;
 
 /// Envelope Follower filter. I don't remember my lectures well enough to write
 /// a detailed description.
+/// 
+/// Runs the rectified input through a first order [`Iir`], switching between
+/// an attack and a release response depending on whether the input is above
+/// or below the current envelope.
+/// 
+/// [`Iir`]: ../iir/struct.Iir.html
+#[derive(Clone)]
 pub struct Envelope {
-    au: SampleT,
-    bu: SampleT,
-    ad: SampleT,
-    bd: SampleT,
+    up: ([SampleT; 2], [SampleT; 1]),
+    down: ([SampleT; 2], [SampleT; 1]),
+    rising: bool,
+    lower: SampleT,
+    upper: SampleT,
 
+    iir: Iir<2, 1>,
     x1: SampleT,
     y1: SampleT,
 }
@@ -20,46 +29,92 @@ impl Envelope {
     /// 
     /// [`Envelope`]: struct.Envelope.html
     pub fn new(lower: SampleT, upper: SampleT) -> Envelope{
-        let theta_u = (std::f32::consts::PI * upper * INV_SAMPLE_RATE as SampleT).tan();
-        let theta_d = (std::f32::consts::PI * lower * INV_SAMPLE_RATE as SampleT).tan();
-
-        Envelope {
-            au: theta_u / (1.0 + theta_u),
-            bu: (1.0 - theta_u) / (1.0 + theta_u),
-            ad: theta_d / (1.0 + theta_d),
-            bd: (1.0 - theta_d) / (1.0 + theta_d),
+        let mut e = Envelope {
+            up: ([0.0; 2], [0.0; 1]),
+            down: ([0.0; 2], [0.0; 1]),
+            rising: false,
+            lower,
+            upper,
 
+            iir: Iir::new([0.0; 2], [0.0; 1]),
             x1: SampleT::default(),
             y1: SampleT::default(),
-        }
+        };
+        e.update_coefficients(INV_SAMPLE_RATE);
+
+        e
     }
-}
 
-impl Modifier for Envelope {
-    fn process(&mut self, x: SampleT) -> SampleT {
-        let y = if x.abs() > self.y1 {
-            self.au * (x.abs() + self.x1.abs()) + self.bu * self.y1
-        } else {
-            self.ad * (x.abs() + self.x1.abs()) + self.bd * self.y1
+    /// Derives the attack and release responses for the given inverse sample
+    /// rate.
+    fn update_coefficients(&mut self, inv_rate: MathT) {
+        let theta_u = (std::f32::consts::PI * self.upper * inv_rate as SampleT).tan();
+        let theta_d = (std::f32::consts::PI * self.lower * inv_rate as SampleT).tan();
+
+        let coefficients = |theta: SampleT| {
+            let a = theta / (1.0 + theta);
+            ([a, a], [-(1.0 - theta) / (1.0 + theta)])
         };
+        self.up = coefficients(theta_u);
+        self.down = coefficients(theta_d);
+
+        let (b, a) = if self.rising { self.up } else { self.down };
+        self.iir.set_coefficients(b, a);
+    }
+
+    #[inline(always)]
+    fn tick(&mut self, x: SampleT) -> SampleT {
+        let x = x.abs();
+        let rising = x > self.y1;
+
+        if rising != self.rising {
+            let (b, a) = if rising { self.up } else { self.down };
+
+            // Carry the history over so the switch is seamless.
+            self.iir.set_coefficients(b, a);
+            self.iir.set_history(&[self.x1], &[self.y1]);
+            self.rising = rising;
+        }
+
+        let y = self.iir.process(x);
 
-        self.y1 = y;
         self.x1 = x;
+        self.y1 = y;
 
         y
     }
 }
 
-impl Clone for Envelope {
-    fn clone(&self) -> Self {
-        Envelope {
-            au: self.au,
-            bu: self.bu,
-            ad: self.ad,
-            bd: self.bd,
-            
-            x1: Default::default(),
-            y1: Default::default(),
+impl Modifier for Envelope {
+    fn process(&mut self, x: SampleT) -> SampleT {
+        self.tick(x)
+    }
+
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        for x in inout {
+            *x = self.tick(*x);
+        }
+    }
+
+    fn reset(&mut self) {
+        let (b, a) = self.down;
+
+        self.iir.set_coefficients(b, a);
+        self.iir.clear();
+        self.rising = false;
+        self.x1 = SampleT::default();
+        self.y1 = SampleT::default();
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        self.update_coefficients(ctx.inv_sample_rate());
+    }
+
+    fn tail(&self) -> Option<usize> {
+        if self.x1.abs() <= SILENCE && self.y1.abs() <= SILENCE {
+            self.iir.tail()
+        } else {
+            None
         }
     }
 }
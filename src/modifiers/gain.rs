@@ -22,4 +22,20 @@ impl Modifier for Gain {
     fn process(&mut self, x: SampleT) -> SampleT {
         x * self.a
     }
+
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        let a = self.a;
+
+        for x in inout {
+            *x *= a;
+        }
+    }
+
+    fn tail(&self) -> Option<usize> {
+        Some(0)
+    }
+
+    fn is_silent(&self) -> bool {
+        self.a == 0.0
+    }
 }
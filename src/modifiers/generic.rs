@@ -1,6 +1,7 @@
 //! # Generic
 
 use super::*;
+use crate::utils::{delay_line::DelayLine, denormal};
 use std::collections::VecDeque;
 
 /// Alias for a [`VecDeque`] describing a list of zeros for a filter.
@@ -19,43 +20,32 @@ pub type Poles = VecDeque<(usize,SampleT)>;
 pub type Samples = VecDeque<SampleT>;
 
 /// Generic filter object.
+/// 
+/// Each zero `(i, g)` adds the input from `i` samples ago scaled by `g`, and
+/// each pole `(i, g)` adds the output from `i + 1` samples ago scaled by `g`.
+/// The history is kept in ring buffers, so processing never allocates. For
+/// filters with consecutive coefficients, [`Iir`] is faster.
+/// 
+/// [`Iir`]: ../iir/struct.Iir.html
+#[derive(Clone)]
 pub struct Generic {
-    zeros:Zeros,
-    poles:Poles,
-    inputs:Samples,
-    outputs:Samples,
+    zeros: Vec<(usize,SampleT)>,
+    poles: Vec<(usize,SampleT)>,
+    inputs: DelayLine,
+    outputs: DelayLine,
 }
 
 impl Generic {
     /// Creates a new Generic filter from the given pole and zero parameters.
     pub fn new(zeros: Zeros, poles: Poles) -> Generic {
-        let z_back = if let Some(z) = zeros.back() {
-            z.0 + 1
-        } else {
-            0
-        };
-        let p_back = if let Some(p) = poles.back() {
-            p.0 + 1
-        } else {
-            0
-        };
+        let z_max = zeros.iter().map(|z| z.0).max().unwrap_or(0);
+        let p_max = poles.iter().map(|p| p.0).max().unwrap_or(0);
+
         Generic {
-            zeros,
-            poles,
-            inputs: {
-                let mut v = Samples::new();
-                for _ in 0..z_back {
-                    v.push_back(SampleT::default());
-                }
-                v
-            },
-            outputs: {
-                let mut v = Samples::new();
-                for _ in 0..p_back {
-                    v.push_back(SampleT::default());
-                }
-                v
-            }
+            zeros: zeros.into_iter().collect(),
+            poles: poles.into_iter().collect(),
+            inputs: DelayLine::new(z_max),
+            outputs: DelayLine::new(p_max),
         }
     }
 }
@@ -64,42 +54,44 @@ impl Modifier for Generic {
     fn process(&mut self, x: SampleT) -> SampleT {
         let mut y = SampleT::default();
 
-        self.inputs.push_front(x);
-        self.inputs.pop_back();
+        self.inputs.write(x);
 
         for z in &self.zeros {
-            y += self.inputs[z.0] * z.1;
+            y += self.inputs.tap(z.0) * z.1;
         }
         for p in &self.poles {
-            y += self.outputs[p.0] * p.1;
+            y += self.outputs.tap(p.0) * p.1;
         }
 
-        self.outputs.push_front(y);
-        self.outputs.pop_back();
+        let y = denormal::flush(y);
+        self.outputs.write(y);
 
         y
     }
-}
 
-impl Clone for Generic {
-    fn clone(&self) -> Self {
-        Generic {
-            zeros: self.zeros.clone(),
-            poles: self.poles.clone(),
-            inputs: {
-                let mut v = Samples::new();
-                for _ in 0..self.inputs.len() {
-                    v.push_back(SampleT::default());
-                }
-                v
-            },
-            outputs: {
-                let mut v = Samples::new();
-                for _ in 0..self.outputs.len() {
-                    v.push_back(SampleT::default());
-                }
-                v
-            }
+    fn reset(&mut self) {
+        self.inputs.clear();
+        self.outputs.clear();
+    }
+
+    /// Returns 0 once the input and output history has decayed below
+    /// [`SILENCE`]. Otherwise a filter without poles has a tail of its
+    /// longest zero, and a filter with poles has an unknown tail.
+    /// 
+    /// [`SILENCE`]: ../constant.SILENCE.html
+    fn tail(&self) -> Option<usize> {
+        let z_max = self.zeros.iter().map(|z| z.0).max().unwrap_or(0);
+        let p_max = self.poles.iter().map(|p| p.0).max().unwrap_or(0);
+
+        let quiet = (0..=z_max).all(|d| self.inputs.tap(d).abs() <= SILENCE)
+            && (0..=p_max).all(|d| self.outputs.tap(d).abs() <= SILENCE);
+
+        if quiet {
+            Some(0)
+        } else if self.poles.is_empty() {
+            Some(z_max + 1)
+        } else {
+            None
         }
     }
 }
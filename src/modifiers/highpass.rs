@@ -7,24 +7,13 @@ use super::*;
 
 /// High pass filter adapted from the 3rd Order Butterworth Low Pass Filter with
 /// resonance.
+#[derive(Clone)]
 pub struct HighPass {
-    a0: SampleT,
-    a1: SampleT,
-    a2: SampleT,
-    a3: SampleT,
-    b1: SampleT,
-    b2: SampleT,
-    b3: SampleT,
-
-    x1: SampleT,
-    x2: SampleT,
-    x3: SampleT,
-    y1: SampleT,
-    y2: SampleT,
-    y3: SampleT,
+    iir: Iir<4, 3>,
 
     fc: MathT,
-    r: MathT
+    r: MathT,
+    inv_rate: MathT,
 }
 
 impl HighPass {
@@ -40,24 +29,13 @@ impl HighPass {
         let fc = fc.min(SAMPLE_RATE as MathT / 2.0);
         let r = r.min(1.0).max(0.0);
         let mut hp = HighPass {
-            a0: SampleT::default(),
-            a1: SampleT::default(),
-            a2: SampleT::default(),
-            a3: SampleT::default(),
-            b1: SampleT::default(),
-            b2: SampleT::default(),
-            b3: SampleT::default(),
-            x1: SampleT::default(),
-            x2: SampleT::default(),
-            x3: SampleT::default(),
-            y1: SampleT::default(),
-            y2: SampleT::default(),
-            y3: SampleT::default(),
+            iir: Iir::new([0.0; 4], [0.0; 3]),
+            inv_rate: INV_SAMPLE_RATE,
             fc,
             r,
         };
 
-        hp.reset();
+        hp.update_coefficients();
 
         hp
     }
@@ -69,10 +47,23 @@ impl HighPass {
 
     /// Sets the central frequency of the filter.
     pub fn set_central_frequency(&mut self, fc: MathT) {
-        let fc = fc.min(SAMPLE_RATE as MathT / 2.0);
+        let fc = fc.min(0.5 / self.inv_rate);
 
         self.fc = fc;
-        self.reset();
+        self.update_coefficients();
+    }
+
+    /// Sets the central frequency of the filter, interpolating the filter's
+    /// coefficients to the new value over the next processed block instead of
+    /// switching at once. This is the setter to drive with an [`Automated`]
+    /// ramp.
+    /// 
+    /// [`Automated`]: ../../utils/automation/struct.Automated.html
+    pub fn glide_central_frequency(&mut self, fc: MathT) {
+        self.fc = fc.min(0.5 / self.inv_rate);
+
+        let (b, a) = self.coefficients();
+        self.iir.glide_coefficients(b, a);
     }
 
     /// Returns the resonance of the filter.
@@ -85,61 +76,56 @@ impl HighPass {
         let r = r.min(1.0).max(0.0);
 
         self.r = r;
-        self.reset();
+        self.update_coefficients();
     }
 
-    fn reset(&mut self) {
+    fn update_coefficients(&mut self) {
+        let (b, a) = self.coefficients();
+        self.iir.set_coefficients(b, a);
+    }
+
+    fn coefficients(&self) -> ([SampleT; 4], [SampleT; 3]) {
         let theta = std::f64::consts::PI * (4.0 - self.r) / 6.0;
         let k = 1.0 - 2.0 * theta.cos();
-        let w = 2.0 * std::f64::consts::PI * self.fc;
-        let t = w * INV_SAMPLE_RATE;
-        let g = t.powf(3.0) + k*t.powf(2.0) + k*t + 1.0;
-
-        self.a0 = ( 1.0/g) as SampleT;
-        self.a1 = (-3.0/g) as SampleT;
-        self.a2 = ( 3.0/g) as SampleT;
-        self.a3 = (-1.0/g) as SampleT;
-
-        self.b1 = ((k*t.powf(2.0) + 2.0*k*t + 3.0)/g) as SampleT;
-        self.b2 = ((-k*t - 3.0)/g) as SampleT;
-        self.b3 = (1.0/g) as SampleT;
+        let w = 2.0 * std::f64::consts::PI * self.fc.min(0.5 / self.inv_rate);
+        let t = w * self.inv_rate;
+        let g = t*t*t + k*t*t + k*t + 1.0;
+
+        (
+            [
+                ( 1.0/g) as SampleT,
+                (-3.0/g) as SampleT,
+                ( 3.0/g) as SampleT,
+                (-1.0/g) as SampleT,
+            ],
+            [
+                (-(k*t*t + 2.0*k*t + 3.0)/g) as SampleT,
+                ((k*t + 3.0)/g) as SampleT,
+                (-1.0/g) as SampleT,
+            ]
+        )
     }
 }
 
 impl Modifier for HighPass {
     fn process(&mut self, x: SampleT) -> SampleT {
-        let y = self.a0*x + self.a1*self.x1 + self.a2*self.x2 + self.a3*self.x3 +
-            self.b1*self.y1 + self.b2*self.y2 + self.b3*self.y3;
+        self.iir.process(x)
+    }
 
-        self.x3 = self.x2;
-        self.x2 = self.x1;
-        self.x1 = x;
-        self.y3 = self.y2;
-        self.y2 = self.y1;
-        self.y1 = y;
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        self.iir.process_block(inout);
+    }
 
-        y
+    fn reset(&mut self) {
+        self.iir.reset();
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        self.inv_rate = ctx.inv_sample_rate();
+        self.update_coefficients();
     }
-}
 
-impl Clone for HighPass {
-    fn clone(&self) -> Self {
-        HighPass {
-            a0: self.a0,
-            a1: self.a1,
-            a2: self.a2,
-            a3: self.a3,
-            b1: self.b1,
-            b2: self.b2,
-            b3: self.b3,
-            x1: SampleT::default(),
-            x2: SampleT::default(),
-            x3: SampleT::default(),
-            y1: SampleT::default(),
-            y2: SampleT::default(),
-            y3: SampleT::default(),
-            fc: self.fc,
-            r: self.r,
-        }
+    fn tail(&self) -> Option<usize> {
+        self.iir.tail()
     }
 }
@@ -0,0 +1,518 @@
+//! # IIR
+//! 
+//! Fixed-order infinite impulse response filters, and cascades of biquad
+//! sections built from them.
+
+use super::*;
+use crate::utils::denormal;
+
+/// Infinite impulse response filter with `NB` feed-forward and `NA` feedback
+/// coefficients, implementing the difference equation
+/// 
+/// y\[n\] = b0 x\[n\] + ... + b(NB-1) x\[n-NB+1\] - a1 y\[n-1\] - ... - aNA y\[n-NA\]
+/// 
+/// Coefficients and state are stored in fixed-size arrays, in transposed
+/// direct form II, so processing never allocates and the per-sample loop is
+/// fully unrolled. High order filters should be built as a [`BiquadCascade`]
+/// instead of a single `Iir`, as a single high order section is numerically
+/// fragile in single precision.
+/// 
+/// Coefficients can be changed at once with [`set_coefficients`], or
+/// interpolated linearly over the next processed block with
+/// [`glide_coefficients`] to avoid zipper noise when they are modulated.
+/// 
+/// State values below [`FLUSH_THRESHOLD`] are flushed to zero after every
+/// call to `process` or `process_block`, so filters ringing out never run on
+/// subnormal values.
+/// 
+/// Coefficients given directly are bound to the sample rate they were
+/// computed for. Only [`Biquad`]s made by its design constructors, such as
+/// [`Biquad::with_context`], remember their design and are designed again
+/// for the sample rate of any [`Context`] applied to them.
+/// 
+/// [`BiquadCascade`]: struct.BiquadCascade.html
+/// [`set_coefficients`]: struct.Iir.html#method.set_coefficients
+/// [`glide_coefficients`]: struct.Iir.html#method.glide_coefficients
+/// [`FLUSH_THRESHOLD`]: ../../utils/denormal/constant.FLUSH_THRESHOLD.html
+/// [`Biquad`]: type.Biquad.html
+/// [`Biquad::with_context`]: struct.Iir.html#method.with_context
+/// [`Context`]: ../../context/struct.Context.html
+pub struct Iir<const NB: usize, const NA: usize> {
+    b: [SampleT; NB],
+    a: [SampleT; NA],
+    // The state has max(NB - 1, NA) elements, which can't be written as an
+    // array length yet, so it is spread over two arrays of NB and NA.
+    s: [SampleT; NB],
+    t: [SampleT; NA],
+    glide: Option<([SampleT; NB], [SampleT; NA])>,
+    design: Option<BiquadDesign>,
+}
+
+/// Second order IIR section.
+pub type Biquad = Iir<3, 2>;
+
+/// Response of a [`Biquad`] made by [`Biquad::with_context`].
+/// 
+/// [`Biquad`]: type.Biquad.html
+/// [`Biquad::with_context`]: struct.Iir.html#method.with_context
+#[derive(Copy,Clone,Debug,PartialEq,Eq)]
+pub enum BiquadShape {
+    /// Second order low pass.
+    LowPass,
+    /// Second order high pass.
+    HighPass,
+    /// Second order band pass with a peak gain of 0dB.
+    BandPass,
+    /// Second order notch.
+    Notch,
+}
+
+/// Parameters a [`Biquad`] was designed from, kept so that it can be designed
+/// again at another sample rate.
+/// 
+/// [`Biquad`]: type.Biquad.html
+#[derive(Copy,Clone,Debug,PartialEq)]
+pub(crate) struct BiquadDesign {
+    shape: BiquadShape,
+    fc: MathT,
+    q: MathT,
+}
+
+impl BiquadDesign {
+    /// Computes the coefficients of the design at the given sample rate with
+    /// the bilinear transform designs from Robert Bristow-Johnson's Audio EQ
+    /// Cookbook.
+    pub(crate) fn coefficients(&self, sample_rate: MathT) -> ([SampleT; 3], [SampleT; 2]) {
+        let w = 2.0 * std::f64::consts::PI * self.fc.max(0.0).min(sample_rate / 2.0) / sample_rate;
+        let (c, alpha) = (w.cos(), w.sin() / (2.0 * self.q.max(MathT::EPSILON)));
+
+        let b = match self.shape {
+            BiquadShape::LowPass => [(1.0 - c) / 2.0, 1.0 - c, (1.0 - c) / 2.0],
+            BiquadShape::HighPass => [(1.0 + c) / 2.0, -(1.0 + c), (1.0 + c) / 2.0],
+            BiquadShape::BandPass => [alpha, 0.0, -alpha],
+            BiquadShape::Notch => [1.0, -2.0 * c, 1.0],
+        };
+        let a = [1.0 + alpha, -2.0 * c, 1.0 - alpha];
+
+        (
+            [(b[0] / a[0]) as SampleT, (b[1] / a[0]) as SampleT, (b[2] / a[0]) as SampleT],
+            [(a[1] / a[0]) as SampleT, (a[2] / a[0]) as SampleT],
+        )
+    }
+}
+
+impl<const NB: usize, const NA: usize> Iir<NB, NA> {
+    /// Creates a new filter from the given coefficients. `a` holds the
+    /// feedback coefficients starting from a1, as a0 is always 1.
+    pub fn new(b: [SampleT; NB], a: [SampleT; NA]) -> Self {
+        Iir {
+            b,
+            a,
+            s: [SampleT::default(); NB],
+            t: [SampleT::default(); NA],
+            glide: None,
+            design: None,
+        }
+    }
+
+    /// Returns the order of the filter.
+    pub fn order() -> usize {
+        NA.max(NB.saturating_sub(1))
+    }
+
+    /// Returns the feed-forward coefficients.
+    pub fn get_b(&self) -> &[SampleT; NB] {
+        &self.b
+    }
+
+    /// Returns the feedback coefficients, starting from a1.
+    pub fn get_a(&self) -> &[SampleT; NA] {
+        &self.a
+    }
+
+    /// Replaces the coefficients, keeping the state. The filter is then bound
+    /// to the sample rate the coefficients were computed for.
+    pub fn set_coefficients(&mut self, b: [SampleT; NB], a: [SampleT; NA]) {
+        self.b = b;
+        self.a = a;
+        self.glide = None;
+        self.design = None;
+    }
+
+    /// Interpolates the coefficients linearly from their current values to
+    /// the given ones over the next call to [`process_block`], keeping the
+    /// state. A call to [`process`] switches to them at once.
+    /// 
+    /// Linear interpolation of the coefficients is only guaranteed to stay
+    /// stable between nearby filters, such as those of a smoothly modulated
+    /// cutoff. The filter is then bound to the sample rate the coefficients
+    /// were computed for.
+    /// 
+    /// [`process_block`]: ../trait.Modifier.html#method.process_block
+    /// [`process`]: ../trait.Modifier.html#tymethod.process
+    pub fn glide_coefficients(&mut self, b: [SampleT; NB], a: [SampleT; NA]) {
+        self.glide = Some((b, a));
+        self.design = None;
+    }
+
+    /// Silences the state of the filter.
+    pub fn clear(&mut self) {
+        self.s = [SampleT::default(); NB];
+        self.t = [SampleT::default(); NA];
+    }
+
+    /// Zeroes state values too small to be heard before they decay into
+    /// subnormals.
+    fn flush_state(&mut self) {
+        for s in self.s.iter_mut().chain(self.t.iter_mut()) {
+            *s = denormal::flush(*s);
+        }
+    }
+
+    /// Sets the state of the filter to what it would be after seeing the given
+    /// past inputs and outputs with the current coefficients, most recent
+    /// first. Missing values are treated as 0.
+    /// 
+    /// This lets the coefficients be switched as if the filter had been in
+    /// direct form all along.
+    pub fn set_history(&mut self, x: &[SampleT], y: &[SampleT]) {
+        let m = Self::order();
+
+        for k in 0..m {
+            let mut s = 0.0;
+
+            for j in k + 1..=m {
+                let i = j - k - 1;
+                s += self.b_at(j) * x.get(i).copied().unwrap_or(0.0)
+                    - self.a_at(j) * y.get(i).copied().unwrap_or(0.0);
+            }
+
+            self.set_state(k, s);
+        }
+    }
+
+    #[inline(always)]
+    fn b_at(&self, k: usize) -> SampleT {
+        if k < NB { self.b[k] } else { 0.0 }
+    }
+
+    #[inline(always)]
+    fn a_at(&self, k: usize) -> SampleT {
+        if k >= 1 && k <= NA { self.a[k - 1] } else { 0.0 }
+    }
+
+    #[inline(always)]
+    fn state(&self, k: usize) -> SampleT {
+        if k < NB { self.s[k] } else { self.t[k - NB] }
+    }
+
+    #[inline(always)]
+    fn set_state(&mut self, k: usize, v: SampleT) {
+        if k < NB { self.s[k] = v } else { self.t[k - NB] = v }
+    }
+
+    /// Processes a single sample.
+    #[inline(always)]
+    fn tick(&mut self, x: SampleT) -> SampleT {
+        let m = Self::order();
+        if m == 0 {
+            return self.b_at(0) * x;
+        }
+
+        let y = self.b_at(0) * x + self.state(0);
+
+        for k in 0..m - 1 {
+            let s = self.b_at(k + 1) * x - self.a_at(k + 1) * y + self.state(k + 1);
+            self.set_state(k, s);
+        }
+        let s = self.b_at(m) * x - self.a_at(m) * y;
+        self.set_state(m - 1, s);
+
+        y
+    }
+}
+
+impl<const NB: usize, const NA: usize> Modifier for Iir<NB, NA> {
+    fn process(&mut self, x: SampleT) -> SampleT {
+        let y = self.tick(x);
+        self.flush_state();
+
+        if let Some((b, a)) = self.glide.take() {
+            self.b = b;
+            self.a = a;
+        }
+
+        y
+    }
+
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        let (b, a) = match self.glide {
+            Some(g) if !inout.is_empty() => g,
+            _ => {
+                for x in inout {
+                    *x = self.tick(*x);
+                }
+                self.flush_state();
+                return;
+            },
+        };
+
+        let n = inout.len() as SampleT;
+        let mut db = [SampleT::default(); NB];
+        let mut da = [SampleT::default(); NA];
+        for k in 0..NB {
+            db[k] = (b[k] - self.b[k]) / n;
+        }
+        for k in 0..NA {
+            da[k] = (a[k] - self.a[k]) / n;
+        }
+
+        for x in inout {
+            *x = self.tick(*x);
+
+            for k in 0..NB {
+                self.b[k] += db[k];
+            }
+            for k in 0..NA {
+                self.a[k] += da[k];
+            }
+        }
+
+        self.flush_state();
+        self.b = b;
+        self.a = a;
+        self.glide = None;
+    }
+
+    /// Designs the filter again at the sample rate of the given [`Context`],
+    /// keeping its state, if it was made by a design constructor of
+    /// [`Biquad`]. Filters made from coefficients are left unchanged.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    /// [`Biquad`]: type.Biquad.html
+    fn set_context(&mut self, ctx: &Context) {
+        if let Some(d) = self.design {
+            let (b, a) = d.coefficients(ctx.sample_rate());
+
+            for k in 0..NB {
+                self.b[k] = b.get(k).copied().unwrap_or_default();
+            }
+            for k in 0..NA {
+                self.a[k] = a.get(k).copied().unwrap_or_default();
+            }
+            self.glide = None;
+        }
+    }
+
+    /// Silences the state, completing any glide in progress.
+    fn reset(&mut self) {
+        if let Some((b, a)) = self.glide.take() {
+            self.b = b;
+            self.a = a;
+        }
+        self.clear();
+    }
+
+    /// Returns 0 once the state has decayed below [`SILENCE`]. Otherwise a
+    /// filter without feedback has a tail of its order, and a filter with
+    /// feedback has an unknown tail.
+    /// 
+    /// [`SILENCE`]: ../constant.SILENCE.html
+    fn tail(&self) -> Option<usize> {
+        if self.s.iter().chain(&self.t).all(|s| s.abs() <= SILENCE) {
+            Some(0)
+        } else if NA == 0 {
+            Some(Self::order())
+        } else {
+            None
+        }
+    }
+}
+
+impl<const NB: usize, const NA: usize> Clone for Iir<NB, NA> {
+    fn clone(&self) -> Self {
+        let mut f = match self.glide {
+            Some((b, a)) => Iir::new(b, a),
+            None => Iir::new(self.b, self.a),
+        };
+        f.design = self.design;
+
+        f
+    }
+}
+
+impl Biquad {
+    /// Designs a section of the given shape, cutoff or central frequency and
+    /// quality for the sample rate of the given [`Context`], with the
+    /// bilinear transform designs from Robert Bristow-Johnson's Audio EQ
+    /// Cookbook. The section keeps its design, and is designed again for the
+    /// sample rate of any [`Context`] applied with [`set_context`].
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    /// [`set_context`]: ../trait.Modifier.html#method.set_context
+    pub fn with_context(shape: BiquadShape, fc: MathT, q: MathT, ctx: &Context) -> Self {
+        let design = BiquadDesign {
+            shape,
+            fc,
+            q,
+        };
+        let (b, a) = design.coefficients(ctx.sample_rate());
+
+        let mut f = Biquad::new(b, a);
+        f.design = Some(design);
+
+        f
+    }
+
+    /// Creates a second order low pass section with the given cutoff
+    /// frequency and quality, designed for the default [`Context`] as by
+    /// [`with_context`].
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    /// [`with_context`]: struct.Iir.html#method.with_context
+    pub fn lowpass(fc: MathT, q: MathT) -> Self {
+        Biquad::with_context(BiquadShape::LowPass, fc, q, &Context::default())
+    }
+
+    /// Creates a second order high pass section with the given cutoff
+    /// frequency and quality, designed for the default [`Context`] as by
+    /// [`with_context`].
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    /// [`with_context`]: struct.Iir.html#method.with_context
+    pub fn highpass(fc: MathT, q: MathT) -> Self {
+        Biquad::with_context(BiquadShape::HighPass, fc, q, &Context::default())
+    }
+
+    /// Creates a second order band pass section with the given central
+    /// frequency and quality, with a peak gain of 0dB, designed for the
+    /// default [`Context`] as by [`with_context`].
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    /// [`with_context`]: struct.Iir.html#method.with_context
+    pub fn bandpass(fc: MathT, q: MathT) -> Self {
+        Biquad::with_context(BiquadShape::BandPass, fc, q, &Context::default())
+    }
+
+    /// Creates a second order notch section with the given central frequency
+    /// and quality, designed for the default [`Context`] as by
+    /// [`with_context`].
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    /// [`with_context`]: struct.Iir.html#method.with_context
+    pub fn notch(fc: MathT, q: MathT) -> Self {
+        Biquad::with_context(BiquadShape::Notch, fc, q, &Context::default())
+    }
+
+    /// Returns the design the section was made from, if any.
+    pub(crate) fn design(&self) -> Option<BiquadDesign> {
+        self.design
+    }
+
+    /// Returns the section with the given design, whose coefficients it
+    /// already has.
+    pub(crate) fn with_design(mut self, design: Option<BiquadDesign>) -> Self {
+        self.design = design;
+        self
+    }
+}
+
+/// Cascade of `N` [`Biquad`] sections, processed in series, for filters of
+/// order `2N`.
+/// 
+/// [`Biquad`]: type.Biquad.html
+#[derive(Clone)]
+pub struct BiquadCascade<const N: usize> {
+    sections: [Biquad; N],
+}
+
+impl<const N: usize> BiquadCascade<N> {
+    /// Creates a new cascade from the given sections.
+    pub fn new(sections: [Biquad; N]) -> Self {
+        BiquadCascade {
+            sections,
+        }
+    }
+
+    /// Creates a Butterworth low pass of order `2N` with the given cutoff
+    /// frequency, designed for the default [`Context`]. Its sections are
+    /// designed again for the sample rate of any [`Context`] applied to it.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn butterworth_lowpass(fc: MathT) -> Self {
+        BiquadCascade::new(Self::butterworth_q().map(|q| Biquad::lowpass(fc, q)))
+    }
+
+    /// Creates a Butterworth high pass of order `2N` with the given cutoff
+    /// frequency, designed for the default [`Context`]. Its sections are
+    /// designed again for the sample rate of any [`Context`] applied to it.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn butterworth_highpass(fc: MathT) -> Self {
+        BiquadCascade::new(Self::butterworth_q().map(|q| Biquad::highpass(fc, q)))
+    }
+
+    /// Returns the quality of each section of a Butterworth filter of order
+    /// `2N`, from the positions of its poles on the unit circle.
+    fn butterworth_q() -> [MathT; N] {
+        let mut q = [0.0; N];
+
+        for (k, q) in q.iter_mut().enumerate() {
+            let theta = std::f64::consts::PI * (2 * k + 1) as MathT / (4 * N) as MathT;
+            *q = 1.0 / (2.0 * theta.cos());
+        }
+
+        q
+    }
+
+    /// Returns the sections of the cascade.
+    pub fn sections(&self) -> &[Biquad; N] {
+        &self.sections
+    }
+
+    /// Returns the sections of the cascade for changing their coefficients.
+    pub fn sections_mut(&mut self) -> &mut [Biquad; N] {
+        &mut self.sections
+    }
+
+    /// Silences the state of every section.
+    pub fn clear(&mut self) {
+        for s in &mut self.sections {
+            s.clear();
+        }
+    }
+}
+
+impl<const N: usize> Modifier for BiquadCascade<N> {
+    fn process(&mut self, mut x: SampleT) -> SampleT {
+        for s in &mut self.sections {
+            x = s.process(x);
+        }
+
+        x
+    }
+
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        // Each section runs over the whole block while its state and
+        // coefficients are in registers.
+        for s in &mut self.sections {
+            s.process_block(inout);
+        }
+    }
+
+    fn reset(&mut self) {
+        for s in &mut self.sections {
+            s.reset();
+        }
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        for s in &mut self.sections {
+            s.set_context(ctx);
+        }
+    }
+
+    fn tail(&self) -> Option<usize> {
+        series_tail(self.sections.iter().map(|s| (false, s.tail())))
+    }
+}
@@ -6,11 +6,12 @@
 use super::*;
 
 /// 3rd Order Butterworth Low Pass Filter with resonance.
+#[derive(Clone)]
 pub struct LowPass {
     fc: MathT,
     r: MathT,
-    coeff: [SampleT; 4],
-    outs: [SampleT; 3]
+    iir: Iir<1, 3>,
+    inv_rate: MathT,
 }
 
 impl LowPass {
@@ -29,11 +30,11 @@ impl LowPass {
         let mut lp = LowPass {
             fc,
             r,
-            coeff: [0.0; 4],
-            outs: [SampleT::default(); 3]
+            iir: Iir::new([0.0], [0.0; 3]),
+            inv_rate: INV_SAMPLE_RATE,
         };
 
-        lp.reset();
+        lp.update_coefficients();
 
         lp
     }
@@ -45,10 +46,23 @@ impl LowPass {
 
     /// Sets the central frequency of the filter.
     pub fn set_central_frequency(&mut self, fc: MathT) {
-        let fc = fc.min(SAMPLE_RATE as MathT / 2.0);
+        let fc = fc.min(0.5 / self.inv_rate);
 
         self.fc = fc;
-        self.reset();
+        self.update_coefficients();
+    }
+
+    /// Sets the central frequency of the filter, interpolating the filter's
+    /// coefficients to the new value over the next processed block instead of
+    /// switching at once. This is the setter to drive with an [`Automated`]
+    /// ramp.
+    /// 
+    /// [`Automated`]: ../../utils/automation/struct.Automated.html
+    pub fn glide_central_frequency(&mut self, fc: MathT) {
+        self.fc = fc.min(0.5 / self.inv_rate);
+
+        let (b, a) = self.coefficients();
+        self.iir.glide_coefficients(b, a);
     }
 
     /// Returns the resonance of the filter.
@@ -61,45 +75,51 @@ impl LowPass {
         let r = r.min(1.0).max(0.0);
 
         self.r = r;
-        self.reset();
+        self.update_coefficients();
     }
 
-    fn reset(&mut self) {
+    fn update_coefficients(&mut self) {
+        let (b, a) = self.coefficients();
+        self.iir.set_coefficients(b, a);
+    }
+
+    fn coefficients(&self) -> ([SampleT; 1], [SampleT; 3]) {
         let theta = (std::f64::consts::PI / 6.0) * (4.0 - self.r);
         let k = 1.0 - 2.0 * theta.cos();
-        let w = 2.0 * std::f64::consts::PI * self.fc;
-        let t = w * INV_SAMPLE_RATE;
-        let g = t.powf(3.0) + k*t.powf(2.0) + k*t + 1.0;
-
-        self.coeff[0] = (t.powf(3.0) / g) as SampleT;
-        self.coeff[1] = ((k*t.powf(2.0) + 2.0*k*t + 3.0) / g) as SampleT;
-        self.coeff[2] = ((-k*t - 3.0) / g) as SampleT;
-        self.coeff[3] = (1.0 / g) as SampleT;
+        let w = 2.0 * std::f64::consts::PI * self.fc.min(0.5 / self.inv_rate);
+        let t = w * self.inv_rate;
+        let g = t*t*t + k*t*t + k*t + 1.0;
+
+        (
+            [(t*t*t / g) as SampleT],
+            [
+                (-(k*t*t + 2.0*k*t + 3.0) / g) as SampleT,
+                ((k*t + 3.0) / g) as SampleT,
+                (-1.0 / g) as SampleT,
+            ]
+        )
     }
 }
 
 impl Modifier for LowPass {
     fn process(&mut self, x: SampleT) -> SampleT {
-        let y = self.coeff[0]*x +
-                self.coeff[1]*self.outs[0] +
-                self.coeff[2]*self.outs[1] +
-                self.coeff[3]*self.outs[2];
+        self.iir.process(x)
+    }
 
-        self.outs[2] = self.outs[1];
-        self.outs[1] = self.outs[0];
-        self.outs[0] = y;
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        self.iir.process_block(inout);
+    }
 
-        y
+    fn reset(&mut self) {
+        self.iir.reset();
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        self.inv_rate = ctx.inv_sample_rate();
+        self.update_coefficients();
     }
-}
 
-impl Clone for LowPass {
-    fn clone(&self) -> Self {
-        LowPass {
-            fc: self.fc,
-            r: self.r,
-            coeff: self.coeff,
-            outs: [SampleT::default(); 3]
-        }
+    fn tail(&self) -> Option<usize> {
+        self.iir.tail()
     }
 }
@@ -7,6 +7,8 @@ use super::*;
 
 pub mod adsr;
 pub mod bandpass;
+pub mod biquad_bank;
+pub mod convolution;
 pub mod delay;
 pub mod echo;
 pub mod passthrough;
@@ -14,10 +16,15 @@ pub mod envelope;
 pub mod gain;
 pub mod generic;
 pub mod highpass;
+pub mod iir;
 pub mod lowpass;
+pub mod multi_tap;
+pub mod series;
 
 pub use adsr::*;
 pub use bandpass::*;
+pub use biquad_bank::*;
+pub use convolution::*;
 pub use delay::*;
 pub use echo::*;
 pub use passthrough::*;
@@ -25,13 +32,20 @@ pub use envelope::*;
 pub use gain::*;
 pub use generic::*;
 pub use highpass::*;
+pub use iir::*;
 pub use lowpass::*;
+pub use multi_tap::*;
 
 /// The `Modifier` trait defines types that filter audio samples.
 /// 
+/// Modifiers are required to be [`Send`] and [`Sync`] so that the blocks and
+/// sounds sharing them can be handed to the render thread.
+/// 
 /// [`Modifier`]: trait.Modifier.html
 /// [`Clone`]: https://doc.rust-lang.org/std/clone/trait.Clone.html
-pub trait Modifier
+/// [`Send`]: https://doc.rust-lang.org/std/marker/trait.Send.html
+/// [`Sync`]: https://doc.rust-lang.org/std/marker/trait.Sync.html
+pub trait Modifier: Send + Sync
 {
     /// Filters the given audio sample.
     /// 
@@ -39,4 +53,128 @@ pub trait Modifier
     /// 
     /// * `x` - The "dry" audio sample before filtering.
     fn process(&mut self, x: SampleT) -> SampleT;
+
+    /// Filters a block of audio samples in place.
+    /// 
+    /// The default implementation calls [`process`] once per sample. Types
+    /// that can keep their state in locals for the duration of the block should
+    /// override it.
+    /// 
+    /// # Parameters
+    /// 
+    /// * `inout` - The "dry" audio samples before filtering, which are
+    /// overwritten with the filtered samples.
+    /// 
+    /// [`process`]: trait.Modifier.html#tymethod.process
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        for x in inout {
+            *x = self.process(*x);
+        }
+    }
+
+    /// Returns the modifier to the state it was created in, keeping its
+    /// parameters, so it can be reused for a new voice.
+    /// 
+    /// The default implementation does nothing, which suits modifiers without
+    /// processing state.
+    fn reset(&mut self) {}
+
+    /// Advances the modifier past `n` samples of input it doesn't see, as for
+    /// a voice that is playing but inaudible.
+    /// 
+    /// The default implementation calls [`reset`], since the state of most
+    /// modifiers only depends on input that was never rendered. Modifiers
+    /// whose state follows time instead, such as envelopes, should override
+    /// it.
+    /// 
+    /// [`reset`]: trait.Modifier.html#method.reset
+    fn skip(&mut self, _n: usize) {
+        self.reset();
+    }
+
+    /// Derives the modifier's coefficients and buffer sizes from the given
+    /// [`Context`], keeping its parameters such as cutoff frequency and delay
+    /// time.
+    /// 
+    /// The default implementation does nothing, which suits modifiers that
+    /// don't depend on the sample rate.
+    /// 
+    /// [`Context`]: ../context/struct.Context.html
+    fn set_context(&mut self, _ctx: &Context) {}
+
+    /// Returns the number of samples of output still to come if the input
+    /// stays below [`SILENCE`] from now on, or `None` if the modifier may
+    /// never fall silent, as for a feedback loop with a gain of 1 or more.
+    /// 
+    /// The default implementation returns `None`, which is always safe.
+    /// Sounds and channels use the tails of their modifiers to stop
+    /// processing sounds which only output silence.
+    /// 
+    /// [`SILENCE`]: constant.SILENCE.html
+    fn tail(&self) -> Option<usize> {
+        None
+    }
+
+    /// Returns true if the output of the modifier is silent whatever its
+    /// input, as for an envelope that has stopped.
+    /// 
+    /// The default implementation returns false.
+    fn is_silent(&self) -> bool {
+        false
+    }
+}
+
+/// Level below which samples are considered silent, -120dB.
+pub const SILENCE: SampleT = 1e-6;
+
+/// Returns the tail of a series of stages given as their silent state and
+/// tail, in processing order: the tail after the last silent stage, or the
+/// sum of all tails if none are silent.
+pub(crate) fn series_tail<I>(stages: I) -> Option<usize>
+    where I: IntoIterator<Item = (bool, Option<usize>)>
+{
+    let mut tail = Some(0usize);
+
+    for (silent, t) in stages {
+        tail = if silent {
+            Some(0)
+        } else {
+            tail.and_then(|a| t.map(|t| a.saturating_add(t)))
+        };
+    }
+
+    tail
+}
+
+/// Counter of the samples of input that have been silent in a row, for
+/// modifiers which ring for a fixed number of samples after their input
+/// falls silent, such as delays.
+#[derive(Copy, Clone, Debug)]
+pub(crate) struct QuietCounter(usize);
+
+impl QuietCounter {
+    /// Creates a new counter of a modifier which hasn't had any input.
+    pub(crate) fn new() -> Self {
+        QuietCounter(usize::MAX)
+    }
+
+    /// Counts the given sample of input.
+    #[inline(always)]
+    pub(crate) fn sample(&mut self, x: SampleT) {
+        self.0 = if x.abs() > SILENCE { 0 } else { self.0.saturating_add(1) };
+    }
+
+    /// Counts the given block of input.
+    pub(crate) fn block(&mut self, x: &[SampleT]) {
+        self.0 = match x.iter().rposition(|x| x.abs() > SILENCE) {
+            Some(i) => x.len() - 1 - i,
+            None => self.0.saturating_add(x.len()),
+        };
+    }
+
+    /// Returns the tail left of a modifier which rings for `len` samples
+    /// after its last input.
+    pub(crate) fn tail(&self, len: usize) -> usize {
+        len.saturating_sub(self.0)
+    }
 }
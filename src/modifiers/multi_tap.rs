@@ -0,0 +1,143 @@
+//! # Multi-Tap Delay
+
+use super::*;
+use crate::utils::delay_line::DelayLine;
+use std::time::Duration;
+
+/// A single read from the buffer of a [`MultiTap`].
+/// 
+/// [`MultiTap`]: struct.MultiTap.html
+#[derive(Copy,Clone,Debug,Default,PartialEq)]
+pub struct Tap {
+    /// Delay of the tap in samples. Fractional delays are linearly
+    /// interpolated.
+    pub delay: SampleT,
+    /// Gain applied to the tap.
+    pub gain: SampleT,
+}
+
+impl Tap {
+    /// Creates a new tap from the given delay and gain, at the default
+    /// [`SAMPLE_RATE`]. Use [`MultiTap::tap`] for taps of a multi-tap running
+    /// at another rate.
+    /// 
+    /// [`SAMPLE_RATE`]: ../../constant.SAMPLE_RATE.html
+    /// [`MultiTap::tap`]: struct.MultiTap.html#method.tap
+    pub fn new(d: Duration, g: MathT) -> Self {
+        Tap {
+            delay: (d.as_secs_f64() * SAMPLE_RATE as MathT) as SampleT,
+            gain: g as SampleT,
+        }
+    }
+}
+
+/// Multi-tap delay, outputting the sum of several delayed and scaled copies of
+/// its input read from a single shared buffer.
+/// 
+/// Taps can be added, moved, and rescaled while processing, which is enough to
+/// build chorus, flanger, and doppler effects.
+#[derive(Clone)]
+pub struct MultiTap {
+    line: DelayLine,
+    taps: Vec<Tap>,
+    max: SampleT,
+    rate: MathT,
+    quiet: QuietCounter,
+}
+
+impl MultiTap {
+    /// Creates a new multi-tap delay with no taps, able to hold delays of up
+    /// to `max`.
+    pub fn new(max: Duration) -> Self {
+        let max = (max.as_secs_f64() * SAMPLE_RATE as MathT).ceil();
+
+        MultiTap {
+            line: DelayLine::new(max as usize),
+            taps: Vec::new(),
+            max: max as SampleT,
+            rate: SAMPLE_RATE as MathT,
+            quiet: QuietCounter::new(),
+        }
+    }
+
+    /// Creates a new tap from the given delay and gain, at the sample rate of
+    /// the multi-tap.
+    pub fn tap(&self, d: Duration, g: MathT) -> Tap {
+        Tap {
+            delay: (d.as_secs_f64() * self.rate) as SampleT,
+            gain: g as SampleT,
+        }
+    }
+
+    /// Adds a tap, clamping its delay to the maximum, returning its index.
+    pub fn add_tap(&mut self, mut t: Tap) -> usize {
+        t.delay = t.delay.max(0.0).min(self.max);
+        self.taps.push(t);
+
+        self.taps.len() - 1
+    }
+
+    /// Replaces the tap at the given index, clamping its delay to the maximum.
+    /// 
+    /// # Panics
+    /// 
+    /// Panics if there's no tap at the given index.
+    pub fn set_tap(&mut self, i: usize, mut t: Tap) {
+        t.delay = t.delay.max(0.0).min(self.max);
+        self.taps[i] = t;
+    }
+
+    /// Returns the taps.
+    pub fn get_taps(&self) -> &[Tap] {
+        &self.taps
+    }
+
+    /// Removes all taps.
+    pub fn clear_taps(&mut self) {
+        self.taps.clear();
+    }
+}
+
+impl Modifier for MultiTap {
+    fn process(&mut self, x: SampleT) -> SampleT {
+        self.quiet.sample(x);
+        self.line.write(x);
+
+        let mut y = 0.0;
+        for t in &self.taps {
+            y += self.line.tap_linear(t.delay) * t.gain;
+        }
+
+        y
+    }
+
+    fn reset(&mut self) {
+        self.line.clear();
+        self.quiet = QuietCounter::new();
+    }
+
+    /// Converts the maximum delay and the delay of every tap to samples at
+    /// the rate of the given [`Context`], reallocating the buffer if it no
+    /// longer fits.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    fn set_context(&mut self, ctx: &Context) {
+        let scale = ctx.sample_rate() / self.rate;
+
+        self.rate = ctx.sample_rate();
+        self.max = (self.max as MathT * scale).ceil() as SampleT;
+        for t in &mut self.taps {
+            t.delay = ((t.delay as MathT * scale) as SampleT).min(self.max);
+        }
+
+        if self.line.max_delay() < self.max as usize {
+            self.line = DelayLine::new(self.max as usize);
+        }
+    }
+
+    fn tail(&self) -> Option<usize> {
+        let longest = self.taps.iter().fold(0.0, |m: SampleT, t| m.max(t.delay));
+
+        Some(self.quiet.tail(longest.ceil() as usize + 2))
+    }
+}
@@ -18,4 +18,11 @@ impl Modifier for Passthrough {
     fn process(&mut self, x: SampleT) -> SampleT {
         x
     }
+
+    fn process_block(&mut self, _inout: &mut [SampleT]) {
+    }
+
+    fn tail(&self) -> Option<usize> {
+        Some(0)
+    }
 }
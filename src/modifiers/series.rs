@@ -0,0 +1,81 @@
+//! # Series
+//! 
+//! Tuples of [`Modifier`]s, processed one after the other as a single
+//! [`Modifier`].
+//! 
+//! [`Modifier`]: ../trait.Modifier.html
+
+use super::*;
+
+/// The empty tuple passes its input through unchanged, so a [`Chain`] can be
+/// built without any modifiers.
+/// 
+/// [`Chain`]: ../../sounds/chain/struct.Chain.html
+impl Modifier for () {
+    fn process(&mut self, x: SampleT) -> SampleT {
+        x
+    }
+
+    fn process_block(&mut self, _inout: &mut [SampleT]) {
+    }
+
+    fn tail(&self) -> Option<usize> {
+        Some(0)
+    }
+}
+
+// Implements `Modifier` for a tuple of modifiers, applying them in order.
+// Every call is resolved at compile time, so the whole series can be inlined
+// into the caller.
+macro_rules! series {
+    ($($m:ident $i:tt),+) => {
+        impl<$($m),+> Modifier for ($($m,)+)
+            where $($m: Modifier),+
+        {
+            #[inline]
+            fn process(&mut self, x: SampleT) -> SampleT {
+                let y = x;
+                $(let y = self.$i.process(y);)+
+                y
+            }
+
+            #[inline]
+            fn process_block(&mut self, inout: &mut [SampleT]) {
+                $(self.$i.process_block(inout);)+
+            }
+
+            fn reset(&mut self) {
+                $(self.$i.reset();)+
+            }
+
+            fn skip(&mut self, n: usize) {
+                $(self.$i.skip(n);)+
+            }
+
+            fn set_context(&mut self, ctx: &Context) {
+                $(self.$i.set_context(ctx);)+
+            }
+
+            fn tail(&self) -> Option<usize> {
+                series_tail([$((self.$i.is_silent(), self.$i.tail())),+])
+            }
+
+            // Silent stages silence the series as long as every stage after
+            // them has already rung out.
+            fn is_silent(&self) -> bool {
+                let silent = false;
+                $(let silent = self.$i.is_silent() || (silent && self.$i.tail() == Some(0));)+
+                silent
+            }
+        }
+    };
+}
+
+series!(A 0);
+series!(A 0, B 1);
+series!(A 0, B 1, C 2);
+series!(A 0, B 1, C 2, D 3);
+series!(A 0, B 1, C 2, D 3, E 4);
+series!(A 0, B 1, C 2, D 3, E 4, F 5);
+series!(A 0, B 1, C 2, D 3, E 4, F 5, G 6);
+series!(A 0, B 1, C 2, D 3, E 4, F 5, G 6, H 7);
@@ -0,0 +1,284 @@
+//! # Convert
+//! 
+//! Slice-level versions of the `sample_from_*` and `sample_to_*` conversion
+//! functions, along with conversions fused with interleaving and
+//! deinterleaving for reading and writing multichannel audio files. The 16-bit
+//! and 24-bit paths use the vectorized kernels in [`utils::simd`], and every
+//! function produces exactly the same values as its per-sample counterpart.
+//! 
+//! [`utils::simd`]: ../../utils/simd/index.html
+
+use super::*;
+use crate::utils::simd;
+
+/// Number of samples converted at a time by the fused conversions, sized to
+/// keep the intermediate buffer in cache.
+const BLOCK: usize = 1024;
+
+/// Converts a slice of [`u8`] samples with [`sample_from_u8`].
+/// 
+/// [`u8`]: https://doc.rust-lang.org/std/primitive.u8.html
+/// [`sample_from_u8`]: ../fn.sample_from_u8.html
+pub fn samples_from_u8(src: &[u8], dst: &mut [SampleT]) {
+    for (d, s) in dst.iter_mut().zip(src) {
+        *d = sample_from_u8(*s);
+    }
+}
+
+/// Converts a slice of [`i16`] samples with [`sample_from_i16`].
+/// 
+/// [`i16`]: https://doc.rust-lang.org/std/primitive.i16.html
+/// [`sample_from_i16`]: ../fn.sample_from_i16.html
+pub fn samples_from_i16(src: &[i16], dst: &mut [SampleT]) {
+    simd::from_i16(src, dst);
+}
+
+/// Converts a slice of 24-bit samples stored in [`i32`]s with
+/// [`sample_from_i24`].
+/// 
+/// [`i32`]: https://doc.rust-lang.org/std/primitive.i32.html
+/// [`sample_from_i24`]: ../fn.sample_from_i24.html
+pub fn samples_from_i24(src: &[i32], dst: &mut [SampleT]) {
+    simd::from_i24(src, dst);
+}
+
+/// Converts packed little-endian 24-bit samples (three bytes each) with
+/// [`sample_from_i24_bytes`].
+/// 
+/// [`sample_from_i24_bytes`]: ../fn.sample_from_i24_bytes.html
+pub fn samples_from_i24_bytes(src: &[u8], dst: &mut [SampleT]) {
+    let mut ints = [0i32; BLOCK];
+
+    for (s, d) in src.chunks(3 * BLOCK).zip(dst.chunks_mut(BLOCK)) {
+        let n = d.len().min(s.len() / 3);
+
+        for (i, b) in ints.iter_mut().zip(s.chunks_exact(3)) {
+            // Shift the sign bit in place, then back down to sign extend.
+            *i = i32::from_le_bytes([0, b[0], b[1], b[2]]) >> 8;
+        }
+
+        simd::from_i24(&ints[..n], &mut d[..n]);
+    }
+}
+
+/// Converts a slice of samples with [`sample_to_u8`].
+/// 
+/// [`sample_to_u8`]: ../fn.sample_to_u8.html
+pub fn samples_to_u8(src: &[SampleT], dst: &mut [u8]) {
+    for (d, s) in dst.iter_mut().zip(src) {
+        *d = sample_to_u8(*s);
+    }
+}
+
+/// Converts a slice of samples with [`sample_to_i16`], optionally clipping
+/// them to [-1,1] and adding dither first.
+/// 
+/// [`sample_to_i16`]: ../fn.sample_to_i16.html
+pub fn samples_to_i16(src: &[SampleT], dst: &mut [i16], clip: bool, mut dither: Option<&mut Dither>) {
+    if !clip && dither.is_none() {
+        simd::to_i16(src, dst);
+        return;
+    }
+
+    let mut buf = [SampleT::default(); BLOCK];
+
+    for (s, d) in src.chunks(BLOCK).zip(dst.chunks_mut(BLOCK)) {
+        let buf = &mut buf[..s.len()];
+        buf.copy_from_slice(s);
+
+        if let Some(dither) = &mut dither {
+            dither.apply(buf, 1.0 / ((1 << 15) as SampleT - 1.0));
+        }
+        if clip {
+            simd::clip(buf, -1.0, 1.0);
+        }
+
+        simd::to_i16(buf, d);
+    }
+}
+
+/// Converts a slice of samples with [`sample_to_i24`].
+/// 
+/// [`sample_to_i24`]: ../fn.sample_to_i24.html
+pub fn samples_to_i24(src: &[SampleT], dst: &mut [i32]) {
+    for (d, s) in dst.iter_mut().zip(src) {
+        *d = sample_to_i24(*s);
+    }
+}
+
+/// Converts interleaved [`u8`] samples and splits them into the given tracks,
+/// one per channel. Each track must be at least `src.len() / tracks.len()`
+/// samples long.
+/// 
+/// [`u8`]: https://doc.rust-lang.org/std/primitive.u8.html
+pub fn deinterleave_u8(src: &[u8], tracks: &mut [SampleTrackT]) {
+    deinterleave_with(src, tracks, samples_from_u8);
+}
+
+/// Converts interleaved [`i16`] samples and splits them into the given tracks,
+/// one per channel. Each track must be at least `src.len() / tracks.len()`
+/// samples long.
+/// 
+/// [`i16`]: https://doc.rust-lang.org/std/primitive.i16.html
+pub fn deinterleave_i16(src: &[i16], tracks: &mut [SampleTrackT]) {
+    deinterleave_with(src, tracks, samples_from_i16);
+}
+
+/// Converts interleaved 24-bit samples stored in [`i32`]s and splits them into
+/// the given tracks, one per channel. Each track must be at least
+/// `src.len() / tracks.len()` samples long.
+/// 
+/// [`i32`]: https://doc.rust-lang.org/std/primitive.i32.html
+pub fn deinterleave_i24(src: &[i32], tracks: &mut [SampleTrackT]) {
+    deinterleave_with(src, tracks, samples_from_i24);
+}
+
+/// Interleaves the given channels and converts them to [`u8`] samples,
+/// optionally clipping them to [-1,1] first. `dst` must hold at least
+/// `channels.len()` times the length of the shortest channel.
+/// 
+/// [`u8`]: https://doc.rust-lang.org/std/primitive.u8.html
+pub fn interleave_u8(channels: &[&[SampleT]], dst: &mut [u8], clip: bool) {
+    interleave_with(channels, dst, clip, samples_to_u8);
+}
+
+/// Interleaves the given channels and converts them to [`i16`] samples,
+/// optionally clipping them to [-1,1] and adding dither first. `dst` must hold
+/// at least `channels.len()` times the length of the shortest channel.
+/// 
+/// [`i16`]: https://doc.rust-lang.org/std/primitive.i16.html
+pub fn interleave_i16(channels: &[&[SampleT]], dst: &mut [i16], clip: bool, mut dither: Option<&mut Dither>) {
+    interleave_with(channels, dst, false, |s, d| {
+        samples_to_i16(s, d, clip, dither.as_mut().map(|d| &mut **d))
+    });
+}
+
+/// Interleaves the given channels and converts them to 24-bit samples stored in
+/// [`i32`]s, optionally clipping them to [-1,1] first. `dst` must hold at least
+/// `channels.len()` times the length of the shortest channel.
+/// 
+/// [`i32`]: https://doc.rust-lang.org/std/primitive.i32.html
+pub fn interleave_i24(channels: &[&[SampleT]], dst: &mut [i32], clip: bool) {
+    interleave_with(channels, dst, clip, samples_to_i24);
+}
+
+/// Converts `src` one block at a time into an intermediate buffer, which is
+/// then split into the tracks while it is still in cache.
+fn deinterleave_with<T, F>(src: &[T], tracks: &mut [SampleTrackT], convert: F)
+    where F: Fn(&[T], &mut [SampleT])
+{
+    let n = tracks.len();
+    if n == 0 {
+        return;
+    }
+
+    if n == 1 {
+        convert(src, &mut tracks[0]);
+        return;
+    }
+
+    let frames = (BLOCK / n).max(1);
+    let mut buf = vec![SampleT::default(); frames * n];
+
+    for (i, s) in src.chunks(frames * n).enumerate() {
+        let f = s.len() / n;
+        let start = i * frames;
+        let buf = &mut buf[..s.len()];
+
+        convert(s, buf);
+
+        if n == 2 {
+            let (l, r) = tracks.split_at_mut(1);
+            simd::deinterleave2(buf, &mut l[0][start..start + f], &mut r[0][start..start + f]);
+        } else {
+            for (c, t) in tracks.iter_mut().enumerate() {
+                for (x, b) in t[start..start + f].iter_mut().zip(buf.iter().skip(c).step_by(n)) {
+                    *x = *b;
+                }
+            }
+        }
+    }
+}
+
+/// Interleaves the channels one block at a time into an intermediate buffer,
+/// which is then converted into `dst` while it is still in cache.
+fn interleave_with<T, F>(channels: &[&[SampleT]], dst: &mut [T], clip: bool, mut convert: F)
+    where F: FnMut(&[SampleT], &mut [T])
+{
+    let n = channels.len();
+    if n == 0 {
+        return;
+    }
+
+    let len = channels.iter().map(|c| c.len()).min().unwrap_or(0);
+    let frames = (BLOCK / n).max(1);
+    let mut buf = vec![SampleT::default(); frames * n];
+
+    for (i, d) in dst[..len * n].chunks_mut(frames * n).enumerate() {
+        let f = d.len() / n;
+        let start = i * frames;
+        let buf = &mut buf[..d.len()];
+
+        match n {
+            1 => buf.copy_from_slice(&channels[0][start..start + f]),
+            2 => simd::interleave2(&channels[0][start..start + f], &channels[1][start..start + f], buf),
+            _ => {
+                for (c, ch) in channels.iter().enumerate() {
+                    for (b, x) in buf.iter_mut().skip(c).step_by(n).zip(&ch[start..start + f]) {
+                        *b = *x;
+                    }
+                }
+            },
+        }
+
+        if clip {
+            simd::clip(buf, -1.0, 1.0);
+        }
+
+        convert(buf, d);
+    }
+}
+
+/// Triangular (TPDF) dither generator for reducing quantization distortion
+/// when converting to lower bit depths.
+/// 
+/// Uses a small xorshift generator, so the noise is reproducible for a given
+/// seed.
+#[derive(Copy,Clone)]
+pub struct Dither {
+    state: u32,
+}
+
+impl Dither {
+    /// Creates a new dither generator with the given seed. A seed of 0 is
+    /// replaced with 1, as the generator would otherwise only produce 0.
+    pub fn new(seed: u32) -> Self {
+        Dither {
+            state: if seed == 0 { 1 } else { seed },
+        }
+    }
+
+    fn next_uniform(&mut self) -> SampleT {
+        let mut x = self.state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        self.state = x;
+
+        (x >> 8) as SampleT / (1 << 24) as SampleT
+    }
+
+    /// Returns the next dither value, in the range (-1,1) with a triangular
+    /// distribution.
+    pub fn next(&mut self) -> SampleT {
+        self.next_uniform() - self.next_uniform()
+    }
+
+    /// Adds dither scaled to the given step size (one least significant bit of
+    /// the target format) to each sample of `t`.
+    pub fn apply(&mut self, t: &mut [SampleT], lsb: SampleT) {
+        for x in t {
+            *x += self.next() * lsb;
+        }
+    }
+}
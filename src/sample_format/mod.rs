@@ -1,6 +1,7 @@
 //! # Sample Format
 //!
 //! Module containing different output formats like stereo, 2.1, 5.1, 7.1, etc.
+//! along with the [`pan`] module for panning monophonic audio across them.
 //!
 //! All functions that deal with converting raw bytes to numeric types assume
 //! the bytes are in little-endian format.
@@ -8,13 +9,23 @@
 //! As there is no i24 built-in type, i32 is used in it's place where
 //! applicable. In most cases where a 24-bit sample is stored in a 32-bit data
 //! type, the upper byte is ignored or explicitly set to 0.
+//! 
+//! [`pan`]: pan/index.html
 
 use super::*;
 
+pub mod convert;
 pub mod mono;
+pub mod pan;
+pub mod planar;
 pub mod stereo;
+pub mod surround;
+pub use convert::*;
 pub use mono::*;
+pub use pan::*;
+pub use planar::*;
 pub use stereo::*;
+pub use surround::*;
 
 use std::convert::TryFrom;
 use std::ops::*;
@@ -85,6 +96,66 @@ pub trait SampleFormat:
     /// [`Vec`]: https://doc.rust-lang.org/std/vec/struct.Vec.html
     /// [`try_from`]: https://doc.rust-lang.org/std/convert/trait.TryFrom.html#tymethod.try_from
     fn num_samples() -> usize;
+
+    /// Returns the value of the given channel of the sample, where `c` is less
+    /// than [`num_samples`].
+    /// 
+    /// [`num_samples`]: #tymethod.num_samples
+    fn get_channel(&self, c: usize) -> SampleT;
+
+    /// Sets the value of the given channel of the sample, where `c` is less
+    /// than [`num_samples`].
+    /// 
+    /// [`num_samples`]: #tymethod.num_samples
+    fn set_channel(&mut self, c: usize, x: SampleT);
+
+    /// Returns the position of the speaker fed by each channel, in degrees
+    /// clockwise from front center, or `None` for channels that sounds aren't
+    /// panned to, like LFE. These positions are used by [`pan_gains`].
+    /// 
+    /// The default implementation returns no positions, so that sounds are
+    /// mixed into every channel with the gains of [`from_sample`] wherever
+    /// they are panned.
+    /// 
+    /// [`pan_gains`]: pan/fn.pan_gains.html
+    /// [`from_sample`]: #tymethod.from_sample
+    fn speakers() -> &'static [Option<MathT>] {
+        &[]
+    }
+
+    /// Writes the channels of the given [`PlanarBuffer`] to `track`, one
+    /// sample per frame. The buffer must have [`num_samples`] channels.
+    /// 
+    /// The default implementation copies one value at a time through
+    /// [`set_channel`].
+    /// 
+    /// [`PlanarBuffer`]: planar/struct.PlanarBuffer.html
+    /// [`num_samples`]: #tymethod.num_samples
+    /// [`set_channel`]: #tymethod.set_channel
+    fn from_planar(planar: &PlanarBuffer, track: &mut [Self]) where Self: Sized {
+        for (c, ch) in planar.iter().enumerate() {
+            for (s, x) in track.iter_mut().zip(ch) {
+                s.set_channel(c, *x);
+            }
+        }
+    }
+
+    /// Writes the samples of `track` to the channels of the given
+    /// [`PlanarBuffer`]. The buffer must have [`num_samples`] channels.
+    /// 
+    /// The default implementation copies one value at a time through
+    /// [`get_channel`].
+    /// 
+    /// [`PlanarBuffer`]: planar/struct.PlanarBuffer.html
+    /// [`num_samples`]: #tymethod.num_samples
+    /// [`get_channel`]: #tymethod.get_channel
+    fn to_planar(track: &[Self], planar: &mut PlanarBuffer) where Self: Sized {
+        for (c, ch) in planar.iter_mut().enumerate() {
+            for (x, s) in ch.iter_mut().zip(track) {
+                *x = s.get_channel(c);
+            }
+        }
+    }
 }
 
 /// Trait implementing the ability to pan a monophonic sample into a polyphonic
@@ -92,7 +163,13 @@ pub trait SampleFormat:
 /// how it is panned. To see an implementation, see
 /// [`Stereo::to_sample_format`].
 ///
+/// Every format with positioned [`speakers`] can be panned by [`Azimuth`].
+/// To pan whole blocks, compute the gains once with [`pan_gains`] instead.
+///
 /// [`Stereo::to_sample_format`]: stereo/struct.Stereo.html#method.to_sample_format
+/// [`speakers`]: trait.SampleFormat.html#method.speakers
+/// [`Azimuth`]: pan/struct.Azimuth.html
+/// [`pan_gains`]: pan/fn.pan_gains.html
 pub trait Panner<G>: SampleFormat {
     /// Converts the monophonic sample into a polyphonic sample.
     fn to_sample_format(s: SampleT, g: G) -> Self;
@@ -140,7 +217,7 @@ pub fn sample_from_i24(v: i32) -> SampleT {
 }
 /// Converts raw bytes to a `SampleT`.
 pub fn sample_from_i24_bytes(v:[u8;3]) -> SampleT {
-    (i32::from_le_bytes([v[0],v[1],v[2],0]) as SampleT) / ((1 << 23) as SampleT - 1.0)
+    (i32::from_le_bytes([0,v[0],v[1],v[2]]) >> 8) as SampleT / ((1 << 23) as SampleT - 1.0)
 }
 
 /// Converts a `SampleT` to an `i24`.
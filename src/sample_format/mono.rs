@@ -10,6 +10,7 @@ use super::*;
 pub type MonoTrackT = Vec<Mono>;
 
 /// Struct representing a monophonic audio sample.
+#[repr(transparent)]
 #[derive(Copy,Clone,Default)]
 pub struct Mono {
     /// The single, monophonic sample.
@@ -44,6 +45,26 @@ impl SampleFormat for Mono {
     fn num_samples() -> usize {
         1
     }
+
+    fn get_channel(&self, _: usize) -> SampleT {
+        self.mono
+    }
+
+    fn set_channel(&mut self, _: usize, x: SampleT) {
+        self.mono = x;
+    }
+
+    fn from_planar(planar: &PlanarBuffer, track: &mut [Self]) {
+        for (s, x) in track.iter_mut().zip(planar.channel(0)) {
+            s.mono = *x;
+        }
+    }
+
+    fn to_planar(track: &[Self], planar: &mut PlanarBuffer) {
+        for (x, s) in planar.channel_mut(0).iter_mut().zip(track) {
+            *x = s.mono;
+        }
+    }
 }
 
 impl<T> Panner<T> for Mono {
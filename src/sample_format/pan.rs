@@ -0,0 +1,135 @@
+//! # Pan
+//! 
+//! Constant power panning of monophonic audio across the speakers of a
+//! [`SampleFormat`].
+//! 
+//! Gains are interpolated from a precomputed quarter wave table rather than
+//! computed with trigonometric or exponential functions, so a whole gain
+//! vector costs about as much as a few multiplications. They are meant to be
+//! computed once per block and ramped across it, as a [`StandardChannel`]
+//! does for the [`Sound`]s panned with [`set_sound_pan`].
+//! 
+//! [`SampleFormat`]: ../trait.SampleFormat.html
+//! [`StandardChannel`]: ../../channels/standard_channel/struct.StandardChannel.html
+//! [`Sound`]: ../../sounds/trait.Sound.html
+//! [`set_sound_pan`]: ../../channels/standard_channel/struct.StandardChannel.html#method.set_sound_pan
+
+use super::*;
+
+/// Number of intervals in the quarter wave of the constant power table.
+pub const PAN_STEPS: usize = 1024;
+
+// `cos` of a quarter wave generated by the build script, `PAN_TABLE`, with one
+// guard value past the end so that interpolation never reads out of bounds.
+// `sin` is read backwards.
+include!(concat!(env!("OUT_DIR"), "/pan_table.rs"));
+
+/// Position of a sound around the listener, in degrees clockwise from front
+/// center, used to pan through [`Panner`].
+/// 
+/// [`Panner`]: ../trait.Panner.html
+#[derive(Copy,Clone,Debug,Default,PartialEq)]
+pub struct Azimuth(pub MathT);
+
+/// Returns the constant power gains of the two speakers of a pair for a sound
+/// at `p` of the way from the first to the second, clamped to [0,1]. These
+/// are `cos(p * pi/2)` and `sin(p * pi/2)` to within 1e-6, so their squares
+/// always sum to 1.
+pub fn constant_power(p: MathT) -> (SampleT, SampleT) {
+    let x = if p > 0.0 { p.min(1.0) * PAN_STEPS as MathT } else { 0.0 };
+    let i = x as usize;
+    let f = (x - i as MathT) as SampleT;
+
+    let t = &PAN_TABLE;
+    let r = PAN_STEPS - i;
+    let c = t[i] + (t[i + 1] - t[i]) * f;
+    let s = if r == 0 {
+        t[0]
+    } else {
+        t[r] + (t[r - 1] - t[r]) * f
+    };
+
+    (c, s)
+}
+
+/// Writes the gain of each channel of `SF` for a sound at the given azimuth,
+/// in degrees clockwise from front center, to `gains`, which must hold
+/// [`num_samples`] values.
+/// 
+/// The sound is panned with [`constant_power`] between the two nearest
+/// speakers of [`SampleFormat::speakers`] on either side of it, by the
+/// fraction of the angle between them. Channels without a position, like LFE,
+/// get no signal. Formats without positioned speakers get the gains of
+/// [`from_sample`] for any azimuth.
+/// 
+/// [`num_samples`]: ../trait.SampleFormat.html#tymethod.num_samples
+/// [`constant_power`]: fn.constant_power.html
+/// [`SampleFormat::speakers`]: ../trait.SampleFormat.html#method.speakers
+/// [`from_sample`]: ../trait.SampleFormat.html#tymethod.from_sample
+pub fn pan_gains<SF: SampleFormat>(azimuth: MathT, gains: &mut [SampleT]) {
+    let speakers = SF::speakers();
+
+    // Nearest speaker clockwise, at a distance in [0,360), and counter
+    // clockwise, at a distance in (0,360].
+    let mut cw: Option<(usize, MathT)> = None;
+    let mut ccw: Option<(usize, MathT)> = None;
+    for (c, a) in speakers.iter().enumerate() {
+        if let Some(a) = a {
+            let d = (a - azimuth).rem_euclid(360.0);
+            if cw.map_or(true, |(_, x)| d < x) {
+                cw = Some((c, d));
+            }
+
+            let d = 360.0 - d;
+            if ccw.map_or(true, |(_, x)| d < x) {
+                ccw = Some((c, d));
+            }
+        }
+    }
+
+    for g in gains.iter_mut() {
+        *g = 0.0;
+    }
+
+    match (ccw, cw) {
+        (Some((a, da)), Some((b, db))) => {
+            if a == b {
+                gains[a] = 1.0;
+            } else {
+                let (ga, gb) = constant_power(da / (da + db));
+                gains[a] = ga;
+                gains[b] = gb;
+            }
+        },
+        _ => {
+            let unit = SF::from_sample(1.0);
+            for (c, g) in gains.iter_mut().enumerate() {
+                *g = unit.get_channel(c);
+            }
+        },
+    }
+}
+
+/// Pans a sample into a sample format from the gains of [`pan_gains`].
+/// 
+/// [`pan_gains`]: fn.pan_gains.html
+pub(crate) fn pan_sample<SF: SampleFormat>(s: SampleT, azimuth: MathT) -> SF {
+    let mut gains = [0.0; 8];
+    let n = SF::num_samples();
+    let mut out = SF::default();
+
+    if n <= gains.len() {
+        pan_gains::<SF>(azimuth, &mut gains[..n]);
+        for (c, g) in gains[..n].iter().enumerate() {
+            out.set_channel(c, s * g);
+        }
+    } else {
+        let mut gains = vec![0.0; n];
+        pan_gains::<SF>(azimuth, &mut gains);
+        for (c, g) in gains.iter().enumerate() {
+            out.set_channel(c, s * g);
+        }
+    }
+
+    out
+}
@@ -0,0 +1,234 @@
+//! # Planar
+//! 
+//! Module containing a multichannel audio buffer storing each channel in its
+//! own contiguous, SIMD-aligned block of samples.
+
+use super::*;
+use crate::utils::simd;
+
+/// The number of samples in a single SIMD lane of a [`PlanarBuffer`]. Each
+/// channel is padded to a multiple of this, and starts on a boundary of it.
+/// 
+/// [`PlanarBuffer`]: struct.PlanarBuffer.html
+pub const LANE_SAMPLES: usize = 8;
+
+/// Storage unit of a [`PlanarBuffer`], aligned for the widest vectors used by
+/// the kernels in [`utils::simd`].
+/// 
+/// [`PlanarBuffer`]: struct.PlanarBuffer.html
+/// [`utils::simd`]: ../../utils/simd/index.html
+#[repr(C, align(32))]
+#[derive(Copy,Clone,Default)]
+struct Lane([SampleT; LANE_SAMPLES]);
+
+fn flatten(l: &[Lane]) -> &[SampleT] {
+    // Lanes are plain arrays of samples with no padding between them.
+    unsafe { std::slice::from_raw_parts(l.as_ptr() as *const SampleT, l.len() * LANE_SAMPLES) }
+}
+
+fn flatten_mut(l: &mut [Lane]) -> &mut [SampleT] {
+    unsafe { std::slice::from_raw_parts_mut(l.as_mut_ptr() as *mut SampleT, l.len() * LANE_SAMPLES) }
+}
+
+/// Multichannel buffer of audio data in planar (structure of arrays) layout.
+/// 
+/// Unlike a track of interleaved [`SampleFormat`] values such as
+/// [`StereoTrackT`], each channel is stored as its own contiguous slice of
+/// [`SampleT`]s, which lets block operations on a channel run on the
+/// vectorized kernels in [`utils::simd`].
+/// 
+/// [`SampleFormat`]: ../trait.SampleFormat.html
+/// [`StereoTrackT`]: ../stereo/type.StereoTrackT.html
+/// [`SampleT`]: ../../type.SampleT.html
+/// [`utils::simd`]: ../../utils/simd/index.html
+#[derive(Clone,Default)]
+pub struct PlanarBuffer {
+    data: Vec<Lane>,
+    channels: usize,
+    frames: usize,
+    stride: usize,
+}
+
+impl PlanarBuffer {
+    /// Creates a new buffer of silence with the given number of channels and
+    /// frames (samples per channel).
+    pub fn new(channels: usize, frames: usize) -> Self {
+        let mut b = PlanarBuffer {
+            data: Vec::new(),
+            channels: 0,
+            frames: 0,
+            stride: 0,
+        };
+
+        b.resize(channels, frames);
+
+        b
+    }
+
+    /// Returns the number of channels in the buffer.
+    pub fn channels(&self) -> usize {
+        self.channels
+    }
+
+    /// Returns the number of frames (samples per channel) in the buffer.
+    pub fn frames(&self) -> usize {
+        self.frames
+    }
+
+    /// Changes the shape of the buffer and silences it. Memory is only
+    /// allocated if the new shape is larger than any before it.
+    pub fn resize(&mut self, channels: usize, frames: usize) {
+        self.channels = channels;
+        self.frames = frames;
+        self.stride = (frames + LANE_SAMPLES - 1) / LANE_SAMPLES;
+
+        self.data.clear();
+        self.data.resize(self.channels * self.stride, Lane::default());
+    }
+
+    /// Silences all channels of the buffer.
+    pub fn clear(&mut self) {
+        for l in &mut self.data {
+            *l = Lane::default();
+        }
+    }
+
+    /// Returns the samples of the given channel.
+    pub fn channel(&self, c: usize) -> &[SampleT] {
+        let s = self.stride;
+        &flatten(&self.data[c * s..(c + 1) * s])[..self.frames]
+    }
+
+    /// Returns the samples of the given channel for writing.
+    pub fn channel_mut(&mut self, c: usize) -> &mut [SampleT] {
+        let s = self.stride;
+        let f = self.frames;
+        &mut flatten_mut(&mut self.data[c * s..(c + 1) * s])[..f]
+    }
+
+    /// Returns the samples of two different channels for writing at the same
+    /// time.
+    /// 
+    /// # Panics
+    /// 
+    /// Panics if `a` and `b` are equal.
+    pub fn channel_pair_mut(&mut self, a: usize, b: usize) -> (&mut [SampleT], &mut [SampleT]) {
+        assert_ne!(a, b, "Cannot borrow a channel twice.");
+
+        let s = self.stride;
+        let f = self.frames;
+        let (lo, hi) = (a.min(b), a.max(b));
+        let (x, y) = self.data.split_at_mut(hi * s);
+        let x = &mut flatten_mut(&mut x[lo * s..(lo + 1) * s])[..f];
+        let y = &mut flatten_mut(&mut y[..s])[..f];
+
+        if a < b {
+            (x, y)
+        } else {
+            (y, x)
+        }
+    }
+
+    /// Returns an iterator over the samples of each channel.
+    pub fn iter(&self) -> impl Iterator<Item = &[SampleT]> {
+        let f = self.frames;
+        self.data.chunks(self.stride.max(1))
+            .take(self.channels)
+            .map(move |l| &flatten(l)[..f])
+    }
+
+    /// Returns an iterator over the samples of each channel for writing.
+    pub fn iter_mut(&mut self) -> impl Iterator<Item = &mut [SampleT]> {
+        let f = self.frames;
+        let c = self.channels;
+        self.data.chunks_mut(self.stride.max(1))
+            .take(c)
+            .map(move |l| &mut flatten_mut(l)[..f])
+    }
+
+    /// Adds all channels of `other` to this buffer. Both buffers must have the
+    /// same number of channels.
+    pub fn add(&mut self, other: &PlanarBuffer) {
+        for (d, s) in self.iter_mut().zip(other.iter()) {
+            simd::add(d, s);
+        }
+    }
+
+    /// Adds `src` multiplied by the gain of each channel in `gains` to the
+    /// channels of this buffer.
+    pub fn mix(&mut self, src: &[SampleT], gains: &[SampleT]) {
+        for (d, g) in self.iter_mut().zip(gains) {
+            simd::mix(d, src, *g);
+        }
+    }
+
+    /// Multiplies all channels of the buffer by `g`.
+    pub fn mul(&mut self, g: SampleT) {
+        for d in self.iter_mut() {
+            simd::mul(d, g);
+        }
+    }
+
+    /// Clamps all channels of the buffer to the range [-1,1].
+    pub fn clip(&mut self) {
+        for d in self.iter_mut() {
+            simd::clip(d, -1.0, 1.0);
+        }
+    }
+
+    /// Writes the buffer to `out` in interleaved order (all channels of the
+    /// first frame, then all channels of the second frame, and so on). `out`
+    /// must hold at least `channels() * frames()` samples.
+    pub fn interleave(&self, out: &mut [SampleT]) {
+        match self.channels {
+            1 => out[..self.frames].copy_from_slice(self.channel(0)),
+            2 => simd::interleave2(self.channel(0), self.channel(1), out),
+            n => {
+                for (c, ch) in self.iter().enumerate() {
+                    for (o, x) in out.iter_mut().skip(c).step_by(n).zip(ch) {
+                        *o = *x;
+                    }
+                }
+            },
+        }
+    }
+
+    /// Fills the buffer from the interleaved samples in `src`, which must hold
+    /// at least `channels() * frames()` samples.
+    pub fn deinterleave(&mut self, src: &[SampleT]) {
+        let f = self.frames;
+
+        match self.channels {
+            1 => self.channel_mut(0).copy_from_slice(&src[..f]),
+            2 => {
+                let (l, r) = self.channel_pair_mut(0, 1);
+                simd::deinterleave2(src, l, r);
+            },
+            n => {
+                for (c, ch) in self.iter_mut().enumerate() {
+                    for (x, s) in ch.iter_mut().zip(src.iter().skip(c).step_by(n)) {
+                        *x = *s;
+                    }
+                }
+            },
+        }
+    }
+
+    /// Fills the buffer with the channels of the given [`SampleFormat`] track,
+    /// reshaping it to fit.
+    /// 
+    /// [`SampleFormat`]: ../trait.SampleFormat.html
+    pub fn read_track<SF: SampleFormat>(&mut self, track: &[SF]) {
+        self.resize(SF::num_samples(), track.len());
+        SF::to_planar(track, self);
+    }
+
+    /// Writes the channels of the buffer to the given [`SampleFormat`] track.
+    /// The buffer must have [`SampleFormat::num_samples`] channels.
+    /// 
+    /// [`SampleFormat`]: ../trait.SampleFormat.html
+    /// [`SampleFormat::num_samples`]: ../trait.SampleFormat.html#tymethod.num_samples
+    pub fn write_track<SF: SampleFormat>(&self, track: &mut [SF]) {
+        SF::from_planar(self, track);
+    }
+}
@@ -11,6 +11,10 @@ use crate::utils::*;
 pub type StereoTrackT = Vec<Stereo>;
 
 /// Struct representing a stereophonic audio sample.
+/// 
+/// The layout is guaranteed to be that of `[SampleT; 2]`, so a slice of
+/// stereo samples can be processed as interleaved audio data.
+#[repr(C)]
 #[derive(Copy,Clone,Default)]
 pub struct Stereo{
     /// Left sample value.
@@ -56,51 +60,84 @@ impl SampleFormat for Stereo
     fn num_samples() -> usize {
         2
     }
+
+    fn get_channel(&self, c: usize) -> SampleT {
+        if c == 0 {
+            self.left
+        } else {
+            self.right
+        }
+    }
+
+    fn set_channel(&mut self, c: usize, x: SampleT) {
+        if c == 0 {
+            self.left = x;
+        } else {
+            self.right = x;
+        }
+    }
+
+    fn speakers() -> &'static [Option<MathT>] {
+        &[Some(-30.0), Some(30.0)]
+    }
+
+    fn from_planar(planar: &PlanarBuffer, track: &mut [Self]) {
+        simd::interleave2(planar.channel(0), planar.channel(1), as_samples_mut(track));
+    }
+
+    fn to_planar(track: &[Self], planar: &mut PlanarBuffer) {
+        let (l, r) = planar.channel_pair_mut(0, 1);
+        simd::deinterleave2(as_samples(track), l, r);
+    }
+}
+
+/// Views a track of stereo samples as interleaved audio data.
+fn as_samples(t: &[Stereo]) -> &[SampleT] {
+    unsafe { std::slice::from_raw_parts(t.as_ptr() as *const SampleT, t.len() * 2) }
+}
+
+/// Views a track of stereo samples as interleaved audio data for writing.
+fn as_samples_mut(t: &mut [Stereo]) -> &mut [SampleT] {
+    unsafe { std::slice::from_raw_parts_mut(t.as_mut_ptr() as *mut SampleT, t.len() * 2) }
 }
 
 /// Pans a given sample between the left and right channels. The panning
 /// parameter `g` is a floating point value of the rang [-1,1], where -1 is 
 /// panned full left and 1 is panned full right. If the given value is not
 /// within this range, it is clamped to it.
+/// 
+/// The gains follow the constant power law of [`constant_power`], so a
+/// centered sample is the same as one made with [`from_sample`].
+/// 
+/// [`constant_power`]: ../pan/fn.constant_power.html
+/// [`from_sample`]: ../trait.SampleFormat.html#tymethod.from_sample
 impl Panner<f32> for Stereo {
     fn to_sample_format(s: SampleT, g: f32) -> Self {
-        let l_lerp = if g <= 0.0 {
-            utils::clerp(g as MathT, -1.0, 0.0, -3.0, -120.0)
-        } else {
-            utils::clerp(g as MathT, 0.0, 1.0, 0.0, -3.0)
-        };
-        let r_lerp = if g >= 0.0 {
-            utils::clerp(g as MathT, 0.0, 1.0, -3.0, -120.0)
-        } else {
-            utils::clerp(g as MathT, -1.0, 0.0, 0.0, -3.0)
-        };
-
-        Stereo {
-            left:  (db_to_linear(l_lerp) * s as MathT) as SampleT,
-            right: (db_to_linear(r_lerp) * s as MathT) as SampleT
-        }
+        Stereo::to_sample_format(s, g as f64)
     }
 }
 impl Panner<f64> for Stereo {
     fn to_sample_format(s: SampleT, g: f64) -> Self {
-        let l_lerp = if g <= 0.0 {
-            utils::clerp(g as MathT, -1.0, 0.0, -3.0, -120.0)
-        } else {
-            utils::clerp(g as MathT, 0.0, 1.0, 0.0, -3.0)
-        };
-        let r_lerp = if g >= 0.0 {
-            utils::clerp(g as MathT, 0.0, 1.0, -3.0, -120.0)
-        } else {
-            utils::clerp(g as MathT, -1.0, 0.0, 0.0, -3.0)
-        };
+        let (l, r) = constant_power((g + 1.0) / 2.0);
 
         Stereo {
-            left:  (db_to_linear(l_lerp) * s as MathT) as SampleT,
-            right: (db_to_linear(r_lerp) * s as MathT) as SampleT
+            left:  l * s,
+            right: r * s
         }
     }
 }
 
+/// Pans a given sample between the left and right speakers, at -30 and 30
+/// degrees, with [`pan_gains`]. Positions behind the listener are panned
+/// around the back.
+/// 
+/// [`pan_gains`]: ../pan/fn.pan_gains.html
+impl Panner<Azimuth> for Stereo {
+    fn to_sample_format(s: SampleT, g: Azimuth) -> Self {
+        pan::pan_sample(s, g.0)
+    }
+}
+
 impl std::ops::Neg for Stereo {
     type Output = Self;
 
@@ -0,0 +1,274 @@
+//! # Surround
+//! 
+//! Module containing types for handling 2.1, 5.1, and 7.1 surround audio data.
+//! 
+//! Channels are laid out in the order of the WAVE_FORMAT_EXTENSIBLE speaker
+//! masks, so a track of surround samples matches the interleaved data of a
+//! WAV file of the same layout. Speaker positions follow ITU-R BS.775.
+
+use super::*;
+use super::pan::pan_sample;
+
+/// Defines a surround sample type with one field per speaker, along with the
+/// operators and conversions required by [`SampleFormat`].
+/// 
+/// Each field is given as `name: azimuth, gain, downmix`, where `azimuth`
+/// is the position of the speaker in degrees clockwise from front center, or
+/// `None` if it isn't panned to, `gain` is its share of a sample made with
+/// [`from_sample`], and `downmix` its weight when folding the sample down to
+/// mono with [`into_sample`].
+/// 
+/// [`SampleFormat`]: trait.SampleFormat.html
+/// [`from_sample`]: trait.SampleFormat.html#tymethod.from_sample
+/// [`into_sample`]: trait.SampleFormat.html#tymethod.into_sample
+macro_rules! surround {
+    (
+        $(#[$m:meta])*
+        $name:ident, $track:ident, $n:expr;
+        $($(#[$fm:meta])* $f:ident: $az:expr, $g:expr, $dm:expr;)+
+    ) => {
+        #[doc = concat!("Type for a track of [`", stringify!($name), "`] samples")]
+        /// 
+        #[doc = concat!("[`", stringify!($name), "`]: struct.", stringify!($name), ".html")]
+        pub type $track = Vec<$name>;
+
+        $(#[$m])*
+        #[repr(C)]
+        #[derive(Copy,Clone,Default)]
+        pub struct $name {
+            $($(#[$fm])* pub $f: SampleT,)+
+        }
+
+        impl $name {
+            /// Returns a new sample with every channel set to 0.
+            pub fn new() -> Self {
+                Self::default()
+            }
+
+            /// Returns the channels of the sample as an array, in channel
+            /// order.
+            pub fn channels(&self) -> &[SampleT; $n] {
+                unsafe { &*(self as *const Self as *const [SampleT; $n]) }
+            }
+
+            /// Returns the channels of the sample as a mutable array, in
+            /// channel order.
+            pub fn channels_mut(&mut self) -> &mut [SampleT; $n] {
+                unsafe { &mut *(self as *mut Self as *mut [SampleT; $n]) }
+            }
+
+            fn map<F: Fn(SampleT) -> SampleT>(self, f: F) -> Self {
+                $name { $($f: f(self.$f),)+ }
+            }
+
+            fn zip<F: Fn(SampleT, SampleT) -> SampleT>(self, rhs: Self, f: F) -> Self {
+                $name { $($f: f(self.$f, rhs.$f),)+ }
+            }
+        }
+
+        impl SampleFormat for $name {
+            fn from_sample(x: SampleT) -> Self {
+                $name { $($f: x * $g,)+ }
+            }
+
+            fn into_sample(self) -> SampleT {
+                0.0 $(+ self.$f * $dm)+
+            }
+
+            fn num_samples() -> usize {
+                $n
+            }
+
+            fn get_channel(&self, c: usize) -> SampleT {
+                self.channels()[c]
+            }
+
+            fn set_channel(&mut self, c: usize, x: SampleT) {
+                self.channels_mut()[c] = x;
+            }
+
+            fn speakers() -> &'static [Option<MathT>] {
+                &[$($az),+]
+            }
+        }
+
+        /// Pans a given sample between the speakers nearest the given
+        /// azimuth with [`pan_gains`].
+        /// 
+        /// [`pan_gains`]: pan/fn.pan_gains.html
+        impl Panner<Azimuth> for $name {
+            fn to_sample_format(s: SampleT, g: Azimuth) -> Self {
+                pan_sample(s, g.0)
+            }
+        }
+
+        impl Neg for $name {
+            type Output = Self;
+
+            fn neg(self) -> Self::Output {
+                self.map(|x| -x)
+            }
+        }
+
+        impl Add<$name> for $name {
+            type Output = Self;
+
+            fn add(self, rhs: $name) -> Self::Output {
+                self.zip(rhs, |a, b| a + b)
+            }
+        }
+        impl AddAssign<$name> for $name {
+            fn add_assign(&mut self, rhs: $name) {
+                *self = *self + rhs;
+            }
+        }
+
+        impl Sub<$name> for $name {
+            type Output = Self;
+
+            fn sub(self, rhs: $name) -> Self::Output {
+                self.zip(rhs, |a, b| a - b)
+            }
+        }
+        impl SubAssign<$name> for $name {
+            fn sub_assign(&mut self, rhs: $name) {
+                *self = *self - rhs;
+            }
+        }
+
+        impl Mul<$name> for $name {
+            type Output = Self;
+
+            fn mul(self, rhs: $name) -> Self::Output {
+                self.zip(rhs, |a, b| a * b)
+            }
+        }
+        impl MulAssign<$name> for $name {
+            fn mul_assign(&mut self, rhs: $name) {
+                *self = *self * rhs;
+            }
+        }
+
+        impl Mul<SampleT> for $name {
+            type Output = Self;
+
+            fn mul(self, rhs: SampleT) -> Self::Output {
+                self.map(|x| x * rhs)
+            }
+        }
+        impl MulAssign<SampleT> for $name {
+            fn mul_assign(&mut self, rhs: SampleT) {
+                *self = *self * rhs;
+            }
+        }
+
+        impl Mul<MathT> for $name {
+            type Output = Self;
+
+            fn mul(self, rhs: MathT) -> Self::Output {
+                self.map(|x| (x as MathT * rhs) as SampleT)
+            }
+        }
+        impl MulAssign<MathT> for $name {
+            fn mul_assign(&mut self, rhs: MathT) {
+                *self = *self * rhs;
+            }
+        }
+
+        impl From<SampleT> for $name {
+            fn from(s: SampleT) -> Self {
+                $name::from_sample(s)
+            }
+        }
+        impl Into<SampleT> for $name {
+            fn into(self) -> SampleT {
+                self.into_sample()
+            }
+        }
+
+        surround!(@convert $name, $n, u8, sample_from_u8, sample_to_u8);
+        surround!(@convert $name, $n, i16, sample_from_i16, sample_to_i16);
+        surround!(@convert $name, $n, i32, sample_from_i24, sample_to_i24);
+    };
+
+    (@convert $name:ident, $n:expr, $t:ty, $from:ident, $to:ident) => {
+        impl TryFrom<Vec<$t>> for $name {
+            type Error = String;
+
+            fn try_from(v: Vec<$t>) -> Result<Self, Self::Error> {
+                if v.len() < $n {
+                    Err(format!("ERROR: Given vector was length {}. This function requires length {}.", v.len(), $n))
+                } else {
+                    let mut s = $name::default();
+                    for (x, v) in s.channels_mut().iter_mut().zip(v) {
+                        *x = $from(v);
+                    }
+                    Ok(s)
+                }
+            }
+        }
+        impl Into<Vec<$t>> for $name {
+            fn into(self) -> Vec<$t> {
+                self.channels().iter().map(|x| $to(*x)).collect()
+            }
+        }
+    };
+}
+
+const HALF_POWER: SampleT = std::f32::consts::FRAC_1_SQRT_2;
+
+surround! {
+    /// Struct representing a 2.1 surround audio sample: stereo with a low
+    /// frequency effects channel.
+    /// 
+    /// The layout is guaranteed to be that of `[SampleT; 3]`.
+    Surround21, Surround21TrackT, 3;
+    /// Front left sample value.
+    left: Some(-30.0), HALF_POWER, HALF_POWER;
+    /// Front right sample value.
+    right: Some(30.0), HALF_POWER, HALF_POWER;
+    /// Low frequency effects sample value.
+    lfe: None, 0.0, 0.0;
+}
+
+surround! {
+    /// Struct representing a 5.1 surround audio sample.
+    /// 
+    /// The layout is guaranteed to be that of `[SampleT; 6]`.
+    Surround51, Surround51TrackT, 6;
+    /// Front left sample value.
+    left: Some(-30.0), 0.0, HALF_POWER;
+    /// Front right sample value.
+    right: Some(30.0), 0.0, HALF_POWER;
+    /// Front center sample value.
+    center: Some(0.0), 1.0, 1.0;
+    /// Low frequency effects sample value.
+    lfe: None, 0.0, 0.0;
+    /// Surround left sample value.
+    surround_left: Some(-110.0), 0.0, HALF_POWER;
+    /// Surround right sample value.
+    surround_right: Some(110.0), 0.0, HALF_POWER;
+}
+
+surround! {
+    /// Struct representing a 7.1 surround audio sample.
+    /// 
+    /// The layout is guaranteed to be that of `[SampleT; 8]`.
+    Surround71, Surround71TrackT, 8;
+    /// Front left sample value.
+    left: Some(-30.0), 0.0, HALF_POWER;
+    /// Front right sample value.
+    right: Some(30.0), 0.0, HALF_POWER;
+    /// Front center sample value.
+    center: Some(0.0), 1.0, 1.0;
+    /// Low frequency effects sample value.
+    lfe: None, 0.0, 0.0;
+    /// Back left sample value.
+    back_left: Some(-150.0), 0.0, HALF_POWER;
+    /// Back right sample value.
+    back_right: Some(150.0), 0.0, HALF_POWER;
+    /// Side left sample value.
+    side_left: Some(-90.0), 0.0, HALF_POWER;
+    /// Side right sample value.
+    side_right: Some(90.0), 0.0, HALF_POWER;
+}
@@ -0,0 +1,264 @@
+//! # Block Arena
+//! 
+//! Contiguous storage for the [`Block`]s of a [`Sound`], addressed by index.
+//! 
+//! [`Block`]: ../trait.Block.html
+//! [`Sound`]: ../trait.Sound.html
+
+use super::*;
+#[cfg(feature = "instrumentation")]
+use crate::instrumentation::RenderStats;
+#[cfg(feature = "instrumentation")]
+use std::{sync::Arc, time::Instant};
+
+/// Entry of a [`BlockArena`].
+/// 
+/// [`BlockArena`]: struct.BlockArena.html
+#[derive(Clone)]
+enum Slot {
+    /// Block stored in place.
+    Owned(StandardBlock),
+    /// Block of any type, stored behind a smart pointer.
+    Shared(BlockSP),
+}
+
+impl Slot {
+    /// Returns the block of the slot, or `None` if it is shared.
+    fn block_mut(&mut self) -> Option<&mut dyn Block> {
+        match self {
+            Slot::Owned(b) => Some(b),
+            Slot::Shared(b) => BlockSP::get_mut(b).map(|b| b as &mut dyn Block),
+        }
+    }
+
+    /// Processes a block of samples, calling [`StandardBlock`] directly
+    /// rather than through a virtual call. Returns false without processing if
+    /// the block is shared.
+    /// 
+    /// [`StandardBlock`]: ../standard_block/struct.StandardBlock.html
+    #[inline]
+    fn process_block(&mut self, inout: &mut [SampleT]) -> bool {
+        match self {
+            Slot::Owned(b) => b.process_block(inout),
+            Slot::Shared(b) => match BlockSP::get_mut(b) {
+                Some(b) => b.process_block(inout),
+                None => return false,
+            },
+        }
+
+        true
+    }
+}
+
+/// Storage for the [`Block`]s of a [`Sound`], which keeps them one after the
+/// other in a single allocation and refers to them by index.
+/// 
+/// [`StandardBlock`]s are stored in place, so they cost no allocation of
+/// their own, no reference counting, and no virtual call to process. Blocks
+/// of other types, or blocks that need to be shared, are stored as a
+/// [`BlockSP`] instead, and can only be processed while the arena holds the
+/// only reference to them.
+/// 
+/// Cloning an arena clones its [`StandardBlock`]s, which share their
+/// [`Generator`]s and [`Modifier`]s with the originals, and the references of
+/// its shared blocks.
+/// 
+/// With the `instrumentation` feature enabled, the arena keeps a
+/// [`RenderStats`] for each block, which records the time taken by every call
+/// to process a block of samples. The clone of an arena starts with nothing
+/// recorded.
+/// 
+/// [`Block`]: ../trait.Block.html
+/// [`Sound`]: ../trait.Sound.html
+/// [`StandardBlock`]: ../standard_block/struct.StandardBlock.html
+/// [`BlockSP`]: ../type.BlockSP.html
+/// [`Generator`]: ../../generators/trait.Generator.html
+/// [`Modifier`]: ../../modifiers/trait.Modifier.html
+/// [`RenderStats`]: ../../instrumentation/struct.RenderStats.html
+#[derive(Default)]
+pub struct BlockArena {
+    slots: Vec<Slot>,
+    #[cfg(feature = "instrumentation")]
+    stats: Vec<Arc<RenderStats>>,
+}
+
+impl BlockArena {
+    /// Creates a new, empty arena.
+    pub fn new() -> Self {
+        Self::with_capacity(0)
+    }
+
+    /// Creates a new arena with room for `blocks` blocks to be added without
+    /// reallocating.
+    pub fn with_capacity(blocks: usize) -> Self {
+        BlockArena {
+            slots: Vec::with_capacity(blocks),
+            #[cfg(feature = "instrumentation")]
+            stats: Vec::with_capacity(blocks),
+        }
+    }
+
+    /// Stores the given [`StandardBlock`] in place, returning its index.
+    /// 
+    /// [`StandardBlock`]: ../standard_block/struct.StandardBlock.html
+    pub fn push(&mut self, block: StandardBlock) -> usize {
+        self.push_slot(Slot::Owned(block))
+    }
+
+    /// Stores the given shared [`Block`], returning its index.
+    /// 
+    /// [`Block`]: ../trait.Block.html
+    pub fn push_shared(&mut self, block: BlockSP) -> usize {
+        self.push_slot(Slot::Shared(block))
+    }
+
+    fn push_slot(&mut self, slot: Slot) -> usize {
+        self.slots.push(slot);
+        #[cfg(feature = "instrumentation")]
+        self.stats.push(Arc::new(RenderStats::new()));
+
+        self.slots.len() - 1
+    }
+
+    /// Returns the number of blocks in the arena.
+    pub fn len(&self) -> usize {
+        self.slots.len()
+    }
+
+    /// Returns true if the arena holds no blocks.
+    pub fn is_empty(&self) -> bool {
+        self.slots.is_empty()
+    }
+
+    /// Returns the block at the given index.
+    pub fn get(&self, index: usize) -> Option<&dyn Block> {
+        match self.slots.get(index)? {
+            Slot::Owned(b) => Some(b),
+            Slot::Shared(b) => Some(b.as_ref()),
+        }
+    }
+
+    /// Returns the block at the given index, or `None` if it doesn't exist or
+    /// is shared with another owner.
+    pub fn get_mut(&mut self, index: usize) -> Option<&mut dyn Block> {
+        self.slots.get_mut(index)?.block_mut()
+    }
+
+    /// Returns the [`StandardBlock`] stored in place at the given index.
+    /// 
+    /// [`StandardBlock`]: ../standard_block/struct.StandardBlock.html
+    pub fn get_standard(&self, index: usize) -> Option<&StandardBlock> {
+        match self.slots.get(index)? {
+            Slot::Owned(b) => Some(b),
+            Slot::Shared(_) => None,
+        }
+    }
+
+    /// Returns the [`StandardBlock`] stored in place at the given index.
+    /// 
+    /// [`StandardBlock`]: ../standard_block/struct.StandardBlock.html
+    pub fn get_standard_mut(&mut self, index: usize) -> Option<&mut StandardBlock> {
+        match self.slots.get_mut(index)? {
+            Slot::Owned(b) => Some(b),
+            Slot::Shared(_) => None,
+        }
+    }
+
+    /// Processes a block of samples with the block at the given index.
+    /// 
+    /// # Panics
+    /// 
+    /// Panics if a shared block is also owned elsewhere.
+    #[inline]
+    pub fn process_block(&mut self, index: usize, inout: &mut [SampleT]) {
+        assert!(self.try_process_block(index, inout), "Block is shared with another owner");
+    }
+
+    /// Processes a block of samples with the block at the given index,
+    /// returning false without processing if it is shared with another owner.
+    #[inline]
+    pub fn try_process_block(&mut self, index: usize, inout: &mut [SampleT]) -> bool {
+        #[cfg(feature = "instrumentation")]
+        let start = Instant::now();
+
+        let processed = self.slots[index].process_block(inout);
+
+        #[cfg(feature = "instrumentation")]
+        self.stats[index].record(start.elapsed(), inout.len());
+
+        processed
+    }
+
+    /// Processes the blocks accepted by `filter` concurrently on the global
+    /// [`rayon`] thread pool, each with the buffer of the same index.
+    /// 
+    /// [`rayon`]: https://docs.rs/rayon
+    #[cfg(feature = "parallel")]
+    pub(crate) fn par_process_blocks<F>(&mut self, buffers: &mut [SampleTrackT], filter: F)
+        where F: Fn(usize) -> bool + Sync
+    {
+        use rayon::prelude::*;
+
+        #[cfg(feature = "instrumentation")]
+        let stats = &self.stats;
+
+        self.slots.par_iter_mut()
+            .zip(buffers.par_iter_mut())
+            .enumerate()
+            .filter(|(n, _)| filter(*n))
+            .for_each(|(_n, (slot, buf))| {
+                #[cfg(feature = "instrumentation")]
+                let start = Instant::now();
+
+                assert!(slot.process_block(buf), "Block is shared with another owner");
+
+                #[cfg(feature = "instrumentation")]
+                stats[_n].record(start.elapsed(), buf.len());
+            });
+    }
+
+    /// Resets every block that isn't shared with another owner.
+    pub fn reset(&mut self) {
+        for b in self.slots.iter_mut().filter_map(Slot::block_mut) {
+            b.reset();
+        }
+    }
+
+    /// Skips every block that isn't shared with another owner by `n` samples.
+    pub fn skip(&mut self, n: usize) {
+        for b in self.slots.iter_mut().filter_map(Slot::block_mut) {
+            b.skip(n);
+        }
+    }
+
+    /// Applies the given [`Context`] to every block that isn't shared with
+    /// another owner.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn set_context(&mut self, ctx: &Context) {
+        for b in self.slots.iter_mut().filter_map(Slot::block_mut) {
+            b.set_context(ctx);
+        }
+
+        #[cfg(feature = "instrumentation")]
+        for s in &self.stats {
+            s.set_context(ctx);
+        }
+    }
+
+    /// Returns the render time statistics of the block at the given index.
+    #[cfg(feature = "instrumentation")]
+    pub fn stats(&self, index: usize) -> Option<&Arc<RenderStats>> {
+        self.stats.get(index)
+    }
+}
+
+impl Clone for BlockArena {
+    fn clone(&self) -> Self {
+        BlockArena {
+            slots: self.slots.clone(),
+            #[cfg(feature = "instrumentation")]
+            stats: self.stats.iter().map(|s| Arc::new(RenderStats::clone(s))).collect(),
+        }
+    }
+}
@@ -0,0 +1,258 @@
+//! # Chain
+//! 
+//! A [`Sound`] running a single [`Generator`] through a series of
+//! [`Modifier`]s whose types are known at compile time.
+//! 
+//! [`Sound`]: ../trait.Sound.html
+//! [`Generator`]: ../../generators/trait.Generator.html
+//! [`Modifier`]: ../../modifiers/trait.Modifier.html
+
+use super::*;
+use crate::channels::SoundHandle;
+use generators::Generator;
+use modifiers::Modifier;
+
+/// Statically typed counterpart of [`SimpleSound`], running a [`Generator`]
+/// through a series of [`Modifier`]s.
+/// 
+/// The modifiers are given as a single [`Modifier`], usually a tuple such as
+/// `(LowPass, ADSR, Gain)`, which applies its elements in order. Since every
+/// type in the chain is known to the compiler, no call goes through a virtual
+/// table or a reference count: each stage processes the whole block in a loop
+/// the compiler can inline and vectorize, where a [`SimpleSound`] makes a
+/// dynamic call per stage and block. A chain still implements [`Sound`], so it
+/// can be added to a [`Channel`] alongside dynamic sounds.
+/// 
+/// Chains can also be built up one modifier at a time with [`then`].
+/// 
+/// # Example
+/// 
+/// ```
+/// use std::time::Duration;
+/// use bae_rs::{*, generators::*, modifiers::*, sounds::*};
+/// 
+/// let ms = Duration::from_millis;
+/// let mut voice = Chain::new(Sine::new(440.0), (LowPass::new(2000.0, 0.7), ADSR::new(ms(5), ms(50), 0.7, ms(200))))
+///     .then(Gain::new(0.5));
+/// 
+/// let mut t = vec![0.0; 480];
+/// voice.process_block(&mut t);
+/// ```
+/// 
+/// [`SimpleSound`]: ../simple_sound/struct.SimpleSound.html
+/// [`Generator`]: ../../generators/trait.Generator.html
+/// [`Modifier`]: ../../modifiers/trait.Modifier.html
+/// [`Sound`]: ../trait.Sound.html
+/// [`Channel`]: ../../channels/trait.Channel.html
+/// [`then`]: struct.Chain.html#method.then
+pub struct Chain<G, M> {
+    generator: G,
+    modifiers: M,
+    gain: SampleT,
+    id: Option<SoundHandle>,
+    is_muted: bool,
+    is_paused: bool,
+}
+
+impl<G> Chain<G, ()>
+    where G: Generator
+{
+    /// Creates a new chain playing the given [`Generator`] without any
+    /// modifiers.
+    /// 
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    pub fn from_generator(generator: G) -> Self {
+        Chain::new(generator, ())
+    }
+}
+
+impl<G, M> Chain<G, M>
+    where G: Generator,
+          M: Modifier
+{
+    /// Creates a new chain running the given [`Generator`] through the given
+    /// [`Modifier`]s, with an output gain of 1.
+    /// 
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    pub fn new(generator: G, modifiers: M) -> Self {
+        Chain {
+            generator,
+            modifiers,
+            gain: 1.0,
+            id: None,
+            is_muted: false,
+            is_paused: false,
+        }
+    }
+
+    /// Returns the chain with the given [`Modifier`] appended to the end of
+    /// it.
+    /// 
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    pub fn then<N>(self, m: N) -> Chain<G, (M, N)>
+        where N: Modifier
+    {
+        Chain {
+            generator: self.generator,
+            modifiers: (self.modifiers, m),
+            gain: self.gain,
+            id: self.id,
+            is_muted: self.is_muted,
+            is_paused: self.is_paused,
+        }
+    }
+
+    /// Returns a reference to the [`Generator`].
+    /// 
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    pub fn get_generator(&self) -> &G {
+        &self.generator
+    }
+
+    /// Returns a mutable reference to the [`Generator`].
+    /// 
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    pub fn get_generator_mut(&mut self) -> &mut G {
+        &mut self.generator
+    }
+
+    /// Returns a reference to the [`Modifier`]s.
+    /// 
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    pub fn get_modifiers(&self) -> &M {
+        &self.modifiers
+    }
+
+    /// Returns a mutable reference to the [`Modifier`]s.
+    /// 
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    pub fn get_modifiers_mut(&mut self) -> &mut M {
+        &mut self.modifiers
+    }
+
+    /// Returns the linear gain applied to the output during processing.
+    pub fn get_gain(&self) -> MathT {
+        self.gain as MathT
+    }
+
+    /// Sets the linear gain applied to the output during processing.
+    pub fn set_gain(&mut self, g: MathT) {
+        self.gain = g as SampleT;
+    }
+}
+
+impl<G, M> Clone for Chain<G, M>
+    where G: Clone,
+          M: Clone
+{
+    fn clone(&self) -> Self {
+        Chain {
+            generator: self.generator.clone(),
+            modifiers: self.modifiers.clone(),
+            gain: self.gain,
+            id: None,
+            is_muted: self.is_muted,
+            is_paused: self.is_paused,
+        }
+    }
+}
+
+impl<G, M> Sound for Chain<G, M>
+    where G: Generator,
+          M: Modifier
+{
+    fn toggle_pause(&mut self) {
+        self.is_paused = !self.is_paused;
+    }
+
+    fn is_paused(&self) -> bool {
+        self.is_paused
+    }
+
+    fn toggle_mute(&mut self) {
+        self.is_muted = !self.is_muted;
+    }
+
+    fn is_muted(&self) -> bool {
+        self.is_muted
+    }
+
+    fn register(&mut self, handle: SoundHandle) {
+        self.id = Some(handle);
+    }
+
+    fn unregister(&mut self) {
+        self.id = None;
+    }
+
+    /// Processes one sample. The input is ignored, since the chain starts
+    /// with a [`Generator`].
+    /// 
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    fn process(&mut self, _input: SampleT) -> SampleT {
+        if self.is_paused {
+            return Default::default();
+        }
+
+        let y = self.modifiers.process(self.generator.process());
+
+        if self.is_muted {
+            Default::default()
+        } else {
+            y * self.gain
+        }
+    }
+
+    /// Processes a block. The input is overwritten by the [`Generator`].
+    /// 
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        if self.is_paused {
+            for x in inout {
+                *x = Default::default();
+            }
+            return;
+        }
+
+        self.generator.process_block(inout);
+        self.modifiers.process_block(inout);
+
+        let g = if self.is_muted { 0.0 } else { self.gain };
+        for x in inout {
+            *x *= g;
+        }
+    }
+
+    fn get_id(&self) -> Option<SoundHandle> {
+        self.id
+    }
+
+    fn reset(&mut self) {
+        self.generator.reset();
+        self.modifiers.reset();
+    }
+
+    fn skip(&mut self, n: usize) {
+        if self.is_paused {
+            return;
+        }
+
+        self.generator.skip(n);
+        self.modifiers.skip(n);
+    }
+
+    fn set_context(&mut self, ctx: &Context) {
+        self.generator.set_context(ctx);
+        self.modifiers.set_context(ctx);
+    }
+
+    fn tail(&self) -> Option<usize> {
+        let g = self.generator.tail();
+
+        modifiers::series_tail([
+            (g == Some(0), g),
+            (self.modifiers.is_silent(), self.modifiers.tail()),
+        ])
+    }
+}
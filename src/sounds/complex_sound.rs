@@ -8,14 +8,20 @@
 //! [`Modifier`]: ../../modifiers/trait.Modifier.html
 
 use super::*;
-use std::sync::Arc;
+use crate::channels::SoundHandle;
+use crate::generators::{Generator, FrozenPlayback};
+use crate::utils::asset_cache::{AssetCache, AssetKey, SampleBuffer};
+use crate::utils::topo::topological_levels;
+use std::sync::{Arc, Mutex};
 use std::collections::VecDeque;
-use petgraph::graph;
+use petgraph::{graph, Direction};
 
-/// Alias for the graph type used by [`ComplexSound`].
+/// Alias for the graph type describing the connections between the [`Block`]s
+/// of a [`ComplexSound`].
 /// 
+/// [`Block`]: ../trait.Block.html
 /// [`ComplexSound`]: struct.ComplexSound.html
-pub type Graph = graph::DiGraph<BlockSP, ()>;
+pub type Graph = graph::DiGraph<(), ()>;
 
 /// Alias for the nodes of the graph used by [`ComplexSound`].
 /// 
@@ -27,19 +33,167 @@ pub type GraphNode = graph::NodeIndex;
 /// [`GraphNode`]: type.GraphNode.html
 pub type ProcessOrder = VecDeque<GraphNode>;
 
+/// A compiled [`ExecutionPlan`] along with the [`Graph`] it was compiled from.
+/// 
+/// [`ExecutionPlan`]: ../execution_plan/struct.ExecutionPlan.html
+/// [`Graph`]: type.Graph.html
+type Compiled = Box<(ExecutionPlan, Graph)>;
+
+/// Number of blocks worth of samples the nodes of a region thawed by a
+/// [`GraphEditor`] commit are caught up by in each processed block, on top of
+/// keeping pace with its playback.
+/// 
+/// [`GraphEditor`]: struct.GraphEditor.html
+const THAW_RATE: usize = 8;
+
+/// Exchange point between a [`ComplexSound`] and its [`GraphEditor`]s.
+/// 
+/// [`ComplexSound`]: struct.ComplexSound.html
+/// [`GraphEditor`]: struct.GraphEditor.html
+#[derive(Default)]
+struct Mailbox {
+    pending: Option<Compiled>,
+    retired: Option<Compiled>,
+    thawed: Vec<FrozenRegion>,
+}
+
+/// A node of the graph of a [`ComplexSound`] and every node leading into it,
+/// replaced by a render of the output of the node.
+/// 
+/// [`ComplexSound`]: struct.ComplexSound.html
+#[derive(Clone)]
+struct FrozenRegion {
+    root: usize,
+    nodes: Vec<usize>,
+    playback: FrozenPlayback,
+    sample_rate: MathT,
+    /// Index in `nodes` of the node being caught up while the region is
+    /// thawed over several blocks, `None` while it is frozen.
+    thawing: Option<usize>,
+    /// Position the node being caught up has been skipped to.
+    caught: usize,
+}
+
+impl FrozenRegion {
+    fn contains(&self, node: usize) -> bool {
+        self.nodes.binary_search(&node).is_ok()
+    }
+
+    /// Resets the blocks of the region and skips them to the position of the
+    /// playback, so that processing them continues where the render was.
+    fn resync(&self, blocks: &mut BlockArena) {
+        let pos = self.playback.position();
+
+        for &n in &self.nodes {
+            if let Some(b) = blocks.get_mut(n) {
+                b.reset();
+                if pos > 0 {
+                    b.skip(pos);
+                }
+            }
+        }
+    }
+
+    /// Starts thawing the region over the following blocks with
+    /// [`catch_up`], unless it is being thawed already.
+    /// 
+    /// [`catch_up`]: struct.FrozenRegion.html#method.catch_up
+    fn start_thaw(&mut self, blocks: &mut BlockArena) {
+        if self.thawing.is_none() {
+            self.thawing = Some(0);
+            self.caught = 0;
+            if let Some(b) = blocks.get_mut(self.nodes[0]) {
+                b.reset();
+            }
+        }
+    }
+
+    /// Does the work of [`resync`] for a region being thawed, a bit at a
+    /// time: after a block of `len` samples has been played, the nodes caught
+    /// up so far are skipped along with the playback, and the next ones are
+    /// reset and skipped to its position, for at most `budget` samples.
+    /// Returns true once every node has caught up.
+    /// 
+    /// [`resync`]: struct.FrozenRegion.html#method.resync
+    fn catch_up(&mut self, blocks: &mut BlockArena, len: usize, budget: &mut usize) -> bool {
+        let mut i = match self.thawing {
+            Some(i) => i,
+            None => return false,
+        };
+        let pos = self.playback.position();
+
+        for &n in &self.nodes[..i] {
+            if let Some(b) = blocks.get_mut(n) {
+                b.skip(len);
+            }
+        }
+
+        while i < self.nodes.len() {
+            let n = (pos - self.caught).min(*budget);
+            if n > 0 {
+                if let Some(b) = blocks.get_mut(self.nodes[i]) {
+                    b.skip(n);
+                }
+                self.caught += n;
+                *budget -= n;
+            }
+            if self.caught < pos {
+                break;
+            }
+
+            i += 1;
+            self.caught = 0;
+            if let Some(b) = self.nodes.get(i).and_then(|&n| blocks.get_mut(n)) {
+                b.reset();
+            }
+        }
+
+        self.thawing = Some(i);
+        i == self.nodes.len()
+    }
+}
+
 /// Type implementing the ability to run multiple [`Generator`]s and
 /// [`Modifier`]s within a single object, granting the ability to create complex
 /// systems like those found in digital synthesizers.
 /// 
+/// The graph is compiled into an [`ExecutionPlan`] whenever it changes, and
+/// processing only ever follows the plan. The graph can also be edited while
+/// the sound is rendering on another thread through a [`GraphEditor`].
+/// 
+/// Blocks are kept in a [`BlockArena`], indexed by their node. Blocks added
+/// with [`add_standard_block`] are stored in place there.
+/// 
+/// Feedback loops within the graph are processed one sample at a time, so
+/// the signal going around a loop is delayed by one sample whatever the size
+/// of the blocks the sound is processed in. Connections into the input node
+/// or out of the output node are delayed by one block instead.
+/// 
+/// Deterministic parts of the graph that don't depend on the input of the
+/// sound can be rendered once and played back instead of being processed,
+/// with [`freeze`].
+/// 
 /// [`Generator`]: ../../generators/trait.Generator.html
 /// [`Modifier`]: ../../modifiers/trait.Modifier.html
-#[derive(Clone)]
+/// [`ExecutionPlan`]: ../execution_plan/struct.ExecutionPlan.html
+/// [`GraphEditor`]: struct.GraphEditor.html
+/// [`BlockArena`]: ../block_arena/struct.BlockArena.html
+/// [`add_standard_block`]: struct.ComplexSound.html#method.add_standard_block
+/// [`freeze`]: struct.ComplexSound.html#method.freeze
 pub struct ComplexSound {
-    graph: Graph,
-    process_order: ProcessOrder,
+    blocks: BlockArena,
+    compiled: Compiled,
+    buffers: Vec<SampleTrackT>,
+    carry: Vec<SampleT>,
+    mailbox: Arc<Mutex<Mailbox>>,
+    frozen: Vec<FrozenRegion>,
+    frozen_nodes: Vec<bool>,
+    thawed: Vec<FrozenRegion>,
     input_gain: GraphNode,
     output_gain: GraphNode,
-    id: Option<usize>,
+    tails: Vec<Option<usize>>,
+    tail: Option<usize>,
+    id: Option<SoundHandle>,
     is_muted: bool,
     is_paused: bool
 }
@@ -51,26 +205,30 @@ impl ComplexSound {
     /// [`ComplexSound`]: struct.ComplexSound.html
     pub fn new(input_gain: MathT, output_gain: MathT) -> Self {
         let mut graph = Graph::new();
-        let input_gain = graph.add_node(
-            Arc::new(
-                StandardBlock::from_modifier(
-                    modifiers::Gain::new(input_gain as SampleT)
-                )
-            )
-        );
-        let output_gain = graph.add_node(
-            Arc::new(
-                StandardBlock::from_modifier(
-                    modifiers::Gain::new(output_gain as SampleT)
-                )
-            )
-        );
+        let input = graph.add_node(());
+        let output = graph.add_node(());
+
+        let mut blocks = BlockArena::new();
+        blocks.push(StandardBlock::from_modifier(
+            modifiers::Gain::new(input_gain as SampleT)
+        ));
+        blocks.push(StandardBlock::from_modifier(
+            modifiers::Gain::new(output_gain as SampleT)
+        ));
 
         ComplexSound {
-            graph,
-            process_order: ProcessOrder::new(),
-            input_gain,
-            output_gain,
+            blocks,
+            compiled: Box::new((ExecutionPlan::compile(&graph, input, output), graph)),
+            buffers: Vec::new(),
+            carry: Vec::new(),
+            mailbox: Arc::new(Mutex::new(Mailbox::default())),
+            frozen: Vec::new(),
+            frozen_nodes: Vec::new(),
+            thawed: Vec::new(),
+            input_gain: input,
+            output_gain: output,
+            tails: Vec::new(),
+            tail: None,
             id: None,
             is_muted: false,
             is_paused: false
@@ -79,7 +237,7 @@ impl ComplexSound {
 
     /// Returns the ['GraphNode'] containing the input gain [`Modifier`].
     /// 
-    /// [`Graph`]: type.Graph.html
+    /// [`GraphNode`]: type.GraphNode.html
     /// [`Modifier`]: ../../modifiers/trait.Modifier.html
     pub fn get_input_gain(&self) -> GraphNode {
         self.input_gain
@@ -99,82 +257,635 @@ impl ComplexSound {
     /// 
     /// [`Graph`]: type.Graph.html
     /// [`Block`]: ../trait.Block.html
-    /// [`add_connection]: struct.ComplexSound.html#method.add_connection
-    /// [`remove_connection]: struct.ComplexSound.html#method.remove_connection
+    /// [`GraphNode`]: type.GraphNode.html
+    /// [`add_connection`]: struct.ComplexSound.html#method.add_connection
+    /// [`remove_connection`]: struct.ComplexSound.html#method.remove_connection
     pub fn add_block(&mut self, block: BlockSP) -> GraphNode {
-        self.graph.add_node(block)
+        self.blocks.push_shared(block);
+        self.add_node()
     }
 
-    /// Adds a new connection (edge) between the two given [`GraphNode`]s.
+    /// Adds a new node to the [`Graph`] like [`add_block`], storing the given
+    /// [`StandardBlock`] in place rather than behind a smart pointer.
+    /// 
+    /// [`Graph`]: type.Graph.html
+    /// [`add_block`]: struct.ComplexSound.html#method.add_block
+    /// [`StandardBlock`]: ../standard_block/struct.StandardBlock.html
+    pub fn add_standard_block(&mut self, block: StandardBlock) -> GraphNode {
+        self.blocks.push(block);
+        self.add_node()
+    }
+
+    /// Returns the [`Block`] of the given [`GraphNode`].
+    /// 
+    /// [`Block`]: ../trait.Block.html
+    /// [`GraphNode`]: type.GraphNode.html
+    pub fn get_block(&self, node: GraphNode) -> Option<&dyn Block> {
+        self.blocks.get(node.index())
+    }
+
+    /// Returns the [`Block`] of the given [`GraphNode`], or `None` if it is
+    /// shared with another owner. This thaws the node if it is frozen, since
+    /// the block may be changed through the returned reference.
+    /// 
+    /// [`Block`]: ../trait.Block.html
+    /// [`GraphNode`]: type.GraphNode.html
+    pub fn get_block_mut(&mut self, node: GraphNode) -> Option<&mut dyn Block> {
+        self.thaw(node);
+        self.tail = None;
+        self.blocks.get_mut(node.index())
+    }
+
+    /// Returns the render time statistics of the [`Block`] of the given
+    /// [`GraphNode`].
+    /// 
+    /// [`Block`]: ../trait.Block.html
+    /// [`GraphNode`]: type.GraphNode.html
+    #[cfg(feature = "instrumentation")]
+    pub fn node_stats(&self, node: GraphNode) -> Option<&Arc<crate::instrumentation::RenderStats>> {
+        self.blocks.stats(node.index())
+    }
+
+    /// Adds the node of the block just added to the arena.
+    fn add_node(&mut self) -> GraphNode {
+        let node = self.compiled.1.add_node(());
+
+        self.compile();
+
+        node
+    }
+
+    /// Adds a new connection (edge) between the two given [`GraphNode`]s,
+    /// thawing any frozen region it leads into or out of.
     /// 
     /// [`GraphNode`]: type.GraphNode.html
     pub fn add_connection(&mut self, from: GraphNode, to: GraphNode) {
-        self.graph.update_edge(from, to, ());
+        self.thaw_connection(from, to);
+        self.compiled.1.update_edge(from, to, ());
 
-        self.process_order();
+        self.compile();
     }
 
-    /// Removes a connection between the two given [`GraphNode`]s.
+    /// Removes a connection between the two given [`GraphNode`]s, thawing
+    /// any frozen region it leads into or out of.
     /// 
     /// [`GraphNode`]: type.GraphNode.html
     pub fn remove_connection(&mut self, from: GraphNode, to: GraphNode) {
-        if let Some(e) = self.graph.find_edge(from, to) {
-            self.graph.remove_edge(e);
+        self.thaw_connection(from, to);
+        if let Some(e) = self.compiled.1.find_edge(from, to) {
+            self.compiled.1.remove_edge(e);
         }
 
-        self.process_order();
+        self.compile();
     }
 
     /// Returns a copy of the list of all nodes of the graph in the order in
     /// which they will be processed.
     pub fn get_nodes(&self) -> ProcessOrder {
-        self.process_order.clone()
+        self.compiled.0.ops().iter().map(|op| GraphNode::new(op.node)).collect()
     }
 
-    /// Processes the graph and constructs the order to process the
-    /// [`GraphNode`]s.
+    /// Returns the [`ExecutionPlan`] the graph is currently processed with.
     /// 
-    /// [`GraphNode`]: type.GraphNode.html
-    fn process_order(&mut self) {
-        self.process_order.clear();
+    /// [`ExecutionPlan`]: ../execution_plan/struct.ExecutionPlan.html
+    pub fn get_plan(&self) -> &ExecutionPlan {
+        &self.compiled.0
+    }
 
-        self.process_order.extend(self.graph.externals(petgraph::Direction::Incoming));
-        let mut i = 0;
-        while i < self.process_order.len() {
-            let neighbors = self.graph.neighbors(self.process_order[i]);
-            self.process_order.extend(neighbors);
+    /// Creates a [`GraphEditor`] holding a copy of the current connections of
+    /// the graph, which can be used to change them from another thread while
+    /// the sound is processing.
+    /// 
+    /// Committed edits are only picked up if the graph still has the same
+    /// nodes, so editors should be created after all [`Block`]s are added.
+    /// 
+    /// [`GraphEditor`]: struct.GraphEditor.html
+    /// [`Block`]: ../trait.Block.html
+    pub fn editor(&self) -> GraphEditor {
+        GraphEditor {
+            graph: self.compiled.1.clone(),
+            input_gain: self.input_gain,
+            output_gain: self.output_gain,
+            mailbox: self.mailbox.clone(),
+        }
+    }
+
+    /// Freezes the given node along with every node leading into it, its
+    /// region: the output of the node is rendered once at the given
+    /// [`Context`], for at most `max_len` samples or until the region falls
+    /// silent, and played back in place of processing the region. Returns
+    /// false, changing nothing, if the region can't be frozen.
+    /// 
+    /// A region can be frozen if it doesn't depend on the input of the sound,
+    /// has no feedback, holds no shared [`Block`]s, and only its frozen node
+    /// is connected to nodes outside of it. Its blocks are expected to be
+    /// deterministic. Freezing restarts the region from its beginning, so
+    /// regions should be frozen before the sound is played. Frozen regions
+    /// overlapping the new one are thawed first.
+    /// 
+    /// A region is thawed again, and processed from where its playback was,
+    /// when a connection into or out of one of its nodes other than the
+    /// frozen one changes, when one of its blocks is borrowed through
+    /// [`get_block_mut`], when a [`GraphEditor`] commit is picked up, or when
+    /// a [`Context`] of another sample rate is applied. Regions thawed by a
+    /// commit keep playing their render for the few blocks it takes their
+    /// blocks to catch up, so that picking it up stays cheap.
+    /// 
+    /// # Example
+    /// 
+    /// ```
+    /// use std::time::Duration;
+    /// use bae_rs::{*, generators::*, modifiers::*, sounds::*};
+    /// 
+    /// let ms = Duration::from_millis;
+    /// let mut cs = ComplexSound::new(1.0, 1.0);
+    /// let sine = cs.add_standard_block(StandardBlock::from_generator(Sine::new(880.0)));
+    /// let env = cs.add_standard_block(StandardBlock::from_modifier(ADSR::new(ms(2), ms(20), 0.5, ms(30))));
+    /// cs.add_connection(sine, env);
+    /// cs.add_connection(env, cs.get_output_gain());
+    /// 
+    /// assert!(cs.freeze(env, &Context::default(), SAMPLE_RATE as usize));
+    /// assert!(cs.is_frozen(sine) && cs.is_frozen(env));
+    /// 
+    /// // Connecting the input of the sound into the region thaws it.
+    /// cs.add_connection(cs.get_input_gain(), sine);
+    /// assert!(!cs.is_frozen(env));
+    /// ```
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    /// [`Block`]: ../trait.Block.html
+    /// [`get_block_mut`]: struct.ComplexSound.html#method.get_block_mut
+    /// [`GraphEditor`]: struct.GraphEditor.html
+    pub fn freeze(&mut self, node: GraphNode, ctx: &Context, max_len: usize) -> bool {
+        self.freeze_with(node, ctx, |s, order| s.render_region(order, ctx, max_len))
+    }
 
-            let mut j = 0;
-            while j < i {
-                Self::remove_dups(&mut self.process_order, j);
-                j += 1;
+    /// Freezes the given node and its region like [`freeze`], with the
+    /// render cached under `key`, rendering and caching it if it isn't
+    /// cached.
+    /// 
+    /// The key has to identify the blocks of the region, their parameters,
+    /// and their connections, as a cached render is used as is.
+    /// 
+    /// [`freeze`]: struct.ComplexSound.html#method.freeze
+    pub fn freeze_cached(&mut self, node: GraphNode, ctx: &Context, max_len: usize, key: AssetKey, cache: &mut AssetCache) -> bool {
+        self.freeze_with(node, ctx, |s, order| match cache.get(&key) {
+            Some(b) => b,
+            None => cache.insert(key, s.render_region(order, ctx, max_len)),
+        })
+    }
+
+    /// Thaws the frozen region holding the given node, if there is one.
+    pub fn thaw(&mut self, node: GraphNode) {
+        if let Some(i) = self.frozen.iter().position(|f| f.contains(node.index())) {
+            self.thaw_region(i);
+        }
+    }
+
+    /// Returns true if the given node is part of a frozen region.
+    pub fn is_frozen(&self, node: GraphNode) -> bool {
+        Self::is_masked(&self.frozen_nodes, node.index())
+    }
+
+    /// Returns the render played in place of the given frozen node, or `None`
+    /// if it isn't the node a region was frozen at.
+    pub fn frozen_buffer(&self, node: GraphNode) -> Option<&SampleBuffer> {
+        self.frozen.iter()
+            .find(|f| f.root == node.index())
+            .map(|f| f.playback.buffer())
+    }
+
+    /// Finds the region of the given node, checks it can be frozen, and
+    /// freezes it with the render returned by `render`, which is given the
+    /// nodes of the region in processing order.
+    fn freeze_with<F>(&mut self, node: GraphNode, ctx: &Context, render: F) -> bool
+        where F: FnOnce(&mut Self, &[usize]) -> SampleBuffer
+    {
+        let order = match self.region(node.index()) {
+            Some(o) => o,
+            None => return false,
+        };
+
+        if order.iter().any(|&n| self.blocks.get_mut(n).is_none()) {
+            return false;
+        }
+
+        while let Some(i) = self.frozen.iter().position(|f| order.iter().any(|&n| f.contains(n))) {
+            self.thaw_region(i);
+        }
+
+        for &n in &order {
+            if let Some(b) = self.blocks.get_mut(n) {
+                b.set_context(ctx);
+                b.reset();
             }
+        }
 
-            i += 1;
+        let buffer = render(self, &order);
+
+        let mut nodes = order;
+        nodes.sort_unstable();
+        self.frozen.push(FrozenRegion {
+            root: node.index(),
+            nodes,
+            playback: FrozenPlayback::new(&buffer),
+            sample_rate: ctx.sample_rate(),
+            thawing: None,
+            caught: 0,
+        });
+        self.thawed.reserve(self.frozen.len());
+
+        self.update_frozen_nodes();
+        self.tail = None;
+
+        true
+    }
+
+    /// Returns the given node and every node leading into it, in processing
+    /// order ending with the node, or `None` if the region depends on the
+    /// input or output of the sound, has feedback, or has a node other than
+    /// the given one connected to a node outside of it.
+    fn region(&self, root: usize) -> Option<Vec<usize>> {
+        let graph = &self.compiled.1;
+        let (input, output) = (self.input_gain.index(), self.output_gain.index());
+
+        if root == input || root == output {
+            return None;
+        }
+
+        let mut in_region = vec![false; graph.node_count()];
+        let mut stack = vec![root];
+        in_region[root] = true;
+
+        while let Some(n) = stack.pop() {
+            for m in graph.neighbors_directed(GraphNode::new(n), Direction::Incoming) {
+                let m = m.index();
+                if m == input || m == output {
+                    return None;
+                }
+                if !in_region[m] {
+                    in_region[m] = true;
+                    stack.push(m);
+                }
+            }
         }
 
-        let ig = self.input_gain;
-        let og = self.output_gain;
+        let mut edges = Vec::new();
+        for n in (0..in_region.len()).filter(|&n| in_region[n]) {
+            for t in graph.neighbors(GraphNode::new(n)).map(|t| t.index()) {
+                if t == n || (n == root) == in_region[t] {
+                    return None;
+                }
+                if in_region[t] {
+                    edges.push((n, t));
+                }
+            }
+        }
 
-        self.process_order.retain(|e| *e != ig && *e != og);
+        // Cycles are broken by the sort, so are found as edges pointing back.
+        let order: Vec<usize> = topological_levels(in_region.len(), &edges)
+            .into_iter()
+            .flatten()
+            .filter(|&n| in_region[n])
+            .collect();
 
-        self.process_order.push_front(self.input_gain);
-        self.process_order.push_back(self.output_gain);
+        let mut rank = vec![0; in_region.len()];
+        for (i, &n) in order.iter().enumerate() {
+            rank[n] = i;
+        }
+        if edges.iter().any(|&(from, to)| rank[from] >= rank[to]) {
+            return None;
+        }
+
+        Some(order)
     }
 
-    /// Removes duplicate [`GraphNode`]s from the process order to prevent parsing cycles
+    /// Renders the output of the last of the given nodes, processing them in
+    /// the given order, in blocks of up to the [`max_block`] of the given
+    /// [`Context`], until the output falls silent or `max_len` samples have
+    /// been rendered. The blocks are reset afterwards.
     /// 
-    /// [`GraphNode`]: type.GraphNode.html
-    fn remove_dups(v: &mut ProcessOrder, whitelist: usize) {
-        let mut i = whitelist + 1;
+    /// [`max_block`]: ../../context/struct.Context.html#method.max_block
+    /// [`Context`]: ../../context/struct.Context.html
+    fn render_region(&mut self, order: &[usize], ctx: &Context, max_len: usize) -> SampleBuffer {
+        let graph = &self.compiled.1;
+        let root = order[order.len() - 1];
+
+        let fan_out: Vec<Vec<usize>> = order.iter()
+            .map(|&n| graph.neighbors(GraphNode::new(n))
+                .map(|t| t.index())
+                .filter(|&t| n != root && order.contains(&t))
+                .collect())
+            .collect();
+
+        let mut buffers = vec![SampleTrackT::new(); self.blocks.len()];
+        let mut tails: Vec<Option<usize>> = vec![None; self.blocks.len()];
+        let mut out = Vec::new();
+
+        while out.len() < max_len && tails[root] != Some(0) {
+            let len = ctx.max_block().min(max_len - out.len()).min(tails[root].unwrap_or(usize::MAX));
+            for &n in order {
+                buffers[n].resize(len, SampleT::default());
+            }
+
+            for (&n, targets) in order.iter().zip(&fan_out) {
+                let mut buf = std::mem::take(&mut buffers[n]);
+                self.blocks.process_block(n, &mut buf);
+
+                if n == root {
+                    out.extend_from_slice(&buf);
+                }
+                for &t in targets {
+                    for (d, s) in buffers[t].iter_mut().zip(&buf) {
+                        *d += *s;
+                    }
+                }
+                for x in &mut buf {
+                    *x = SampleT::default();
+                }
+
+                buffers[n] = buf;
+            }
+
+            // Tails are worked out as in update_tail.
+            for &n in order {
+                tails[n] = Some(0);
+            }
+            for (&n, targets) in order.iter().zip(&fan_out) {
+                let t = match self.blocks.get(n) {
+                    Some(b) if b.is_silent() => Some(0),
+                    Some(b) => tails[n].and_then(|a| b.tail().map(|t| a.saturating_add(t))),
+                    None => None,
+                };
+                for &o in targets {
+                    tails[o] = tails[o].and_then(|a| t.map(|t| a.max(t)));
+                }
+                tails[n] = t;
+            }
+        }
+
+        for &n in order {
+            if let Some(b) = self.blocks.get_mut(n) {
+                b.reset();
+            }
+        }
+
+        SampleBuffer::new(out, ctx.sample_rate())
+    }
+
+    /// Thaws the frozen region at the given index, processing its blocks
+    /// again from where its playback was.
+    fn thaw_region(&mut self, i: usize) {
+        let f = self.frozen.swap_remove(i);
+        f.resync(&mut self.blocks);
+
+        self.update_frozen_nodes();
+        self.tail = None;
+    }
+
+    /// Thaws the frozen regions whose render a change to the connection
+    /// between the two given nodes would affect.
+    fn thaw_connection(&mut self, from: GraphNode, to: GraphNode) {
+        let (from, to) = (from.index(), to.index());
+
+        while let Some(i) = self.frozen.iter().position(|f| f.contains(to) || (from != f.root && f.contains(from))) {
+            self.thaw_region(i);
+        }
+    }
 
-        while i < v.len() {
-            if v[i] == v[whitelist] {
-                v.remove(i);
+    /// Takes a step of thawing the regions picked up by [`receive`] after a
+    /// block of `len` samples, with a budget of [`THAW_RATE`] blocks worth of
+    /// skipped samples shared between them. The regions done thawing are kept
+    /// for the mailbox.
+    /// 
+    /// [`receive`]: struct.ComplexSound.html#method.receive
+    /// [`THAW_RATE`]: constant.THAW_RATE.html
+    fn thaw_step(&mut self, len: usize) {
+        let mut budget = len.saturating_mul(THAW_RATE);
+        let mut thawed = false;
+        let mut i = 0;
+
+        while i < self.frozen.len() {
+            if self.frozen[i].catch_up(&mut self.blocks, len, &mut budget) {
+                self.thawed.push(self.frozen.swap_remove(i));
+                thawed = true;
             } else {
                 i += 1;
             }
         }
+
+        if thawed {
+            self.update_frozen_nodes();
+            self.tail = None;
+        }
+    }
+
+    /// Marks the nodes of the frozen regions for processing.
+    fn update_frozen_nodes(&mut self) {
+        self.frozen_nodes.clear();
+        self.frozen_nodes.resize(self.blocks.len(), false);
+
+        for f in &self.frozen {
+            for &n in &f.nodes {
+                self.frozen_nodes[n] = true;
+            }
+        }
+    }
+
+    /// Returns true if the given node is marked as part of a frozen region.
+    #[inline]
+    fn is_masked(frozen_nodes: &[bool], node: usize) -> bool {
+        frozen_nodes.get(node).copied().unwrap_or(false)
+    }
+
+    /// Processes the given node, or plays its render in its place if it is
+    /// the frozen node of a region. Returns false if the node is part of a
+    /// frozen region but isn't its frozen node, in which case it has no
+    /// output.
+    #[inline]
+    fn process_node(blocks: &mut BlockArena, frozen: &mut [FrozenRegion], frozen_nodes: &[bool], buffers: &mut [SampleTrackT], node: usize) -> bool {
+        if !Self::is_masked(frozen_nodes, node) {
+            blocks.process_block(node, &mut buffers[node]);
+            return true;
+        }
+
+        match frozen.iter_mut().find(|f| f.root == node) {
+            Some(f) => {
+                f.playback.process_block(&mut buffers[node]);
+                true
+            },
+            None => false,
+        }
+    }
+
+    /// Recompiles the [`ExecutionPlan`] after a change to the graph.
+    /// 
+    /// [`ExecutionPlan`]: ../execution_plan/struct.ExecutionPlan.html
+    fn compile(&mut self) {
+        self.compiled.0 = ExecutionPlan::compile(&self.compiled.1, self.input_gain, self.output_gain);
+        self.tail = None;
+    }
+
+    /// Works out the tail of the graph from the tails of its blocks, in plan
+    /// order. Each node falls silent once its last input has and its block
+    /// has rung out. The tail of a graph with feedback is unknown.
+    fn update_tail(&mut self) {
+        let plan = &self.compiled.0;
+
+        self.tails.clear();
+        self.tails.resize(self.blocks.len(), Some(0));
+
+        for op in plan.ops() {
+            let level = plan.level_of(op.node);
+            if op.self_loop || op.fan_out.iter().any(|&t| plan.level_of(t) <= level) {
+                self.tail = None;
+                return;
+            }
+
+            let out = if Self::is_masked(&self.frozen_nodes, op.node) {
+                self.frozen.iter()
+                    .find(|f| f.root == op.node)
+                    .map_or(Some(0), |f| f.playback.tail())
+            } else {
+                match self.blocks.get(op.node) {
+                    Some(b) if b.is_silent() => Some(0),
+                    Some(b) => self.tails[op.node].and_then(|a| b.tail().map(|t| a.saturating_add(t))),
+                    None => None,
+                }
+            };
+
+            for &t in &op.fan_out {
+                self.tails[t] = self.tails[t].and_then(|a| out.map(|o| a.max(o)));
+            }
+            self.tails[op.node] = out;
+        }
+
+        self.tail = self.tails[plan.output()];
+    }
+
+    /// Adds the block rendered by the node of the given op to the buffers of
+    /// the nodes it is connected to, copying it to `inout` if it is the output
+    /// node, then clears it unless the node is connected to itself.
+    /// 
+    /// Running this in plan order after each level has been rendered produces
+    /// the same sums, in the same order, as running it right after each node.
+    fn fan_out(buffers: &mut [SampleTrackT], op: &NodeOp, output: usize, inout: &mut [SampleT]) {
+        let mut buf = std::mem::take(&mut buffers[op.node]);
+
+        for &t in &op.fan_out {
+            for (d, s) in buffers[t].iter_mut().zip(&buf) {
+                *d += *s;
+            }
+        }
+
+        if op.node == output {
+            inout.copy_from_slice(&buf);
+        }
+
+        if !op.self_loop {
+            for x in &mut buf {
+                *x = SampleT::default();
+            }
+        }
+
+        buffers[op.node] = buf;
+    }
+
+    /// Processes the nodes of a feedback loop one sample at a time, in the
+    /// order of the given ops. Each sample a node renders is added to the
+    /// input of the nodes it is connected to at the same sample, except for
+    /// those of the loop it leads back to, itself included, which receive it
+    /// at the next sample, carried over to the next block at the end of this
+    /// one. The buffers of the loop are cleared afterwards.
+    fn process_loop(blocks: &mut BlockArena, buffers: &mut [SampleTrackT], carry: &mut [SampleT], ops: &[NodeOp]) {
+        let len = buffers[ops[0].node].len();
+        if len == 0 {
+            return;
+        }
+
+        for op in ops {
+            buffers[op.node][0] += std::mem::take(&mut carry[op.node]);
+        }
+
+        for i in 0..len {
+            for op in ops {
+                let n = op.node;
+                blocks.process_block(n, &mut buffers[n][i..i + 1]);
+                let y = buffers[n][i];
+
+                let targets = op.fan_out.iter().map(|&t| (t, op.delayed.contains(&t)));
+                for (t, delayed) in targets.chain(Some((n, true)).filter(|_| op.self_loop)) {
+                    match (delayed, i + 1 < len) {
+                        (false, _) => buffers[t][i] += y,
+                        (true, true) => buffers[t][i + 1] += y,
+                        (true, false) => carry[t] += y,
+                    }
+                }
+            }
+        }
+
+        for op in ops {
+            for x in buffers[op.node].iter_mut() {
+                *x = SampleT::default();
+            }
+        }
+    }
+
+    /// Swaps in a plan committed by a [`GraphEditor`], if there is one. Never
+    /// blocks: if an editor is committing at the same time, the plan is picked
+    /// up on the next block instead. The replaced plan is handed back to the
+    /// mailbox so it isn't dropped on the processing thread, along with the
+    /// regions done thawing.
+    /// 
+    /// Frozen regions start thawing when a plan is swapped in. Catching their
+    /// blocks up to the position of the playback has no bound, so it is
+    /// spread over the following blocks by [`thaw_step`], the render being
+    /// played until every block of the region has caught up.
+    /// 
+    /// [`GraphEditor`]: struct.GraphEditor.html
+    /// [`thaw_step`]: struct.ComplexSound.html#method.thaw_step
+    fn receive(&mut self) {
+        if let Ok(mut mailbox) = self.mailbox.try_lock() {
+            if let Some(mut c) = mailbox.pending.take() {
+                if c.0.node_count() == self.blocks.len() {
+                    std::mem::swap(&mut self.compiled, &mut c);
+                    self.tail = None;
+
+                    for f in &mut self.frozen {
+                        f.start_thaw(&mut self.blocks);
+                    }
+                }
+                mailbox.retired = Some(c);
+            }
+
+            if mailbox.thawed.is_empty() {
+                std::mem::swap(&mut mailbox.thawed, &mut self.thawed);
+            } else {
+                mailbox.thawed.append(&mut self.thawed);
+            }
+        }
+    }
+}
+
+impl Clone for ComplexSound {
+    fn clone(&self) -> Self {
+        ComplexSound {
+            blocks: self.blocks.clone(),
+            compiled: self.compiled.clone(),
+            buffers: self.buffers.clone(),
+            carry: self.carry.clone(),
+            mailbox: Arc::new(Mutex::new(Mailbox::default())),
+            frozen: self.frozen.clone(),
+            frozen_nodes: self.frozen_nodes.clone(),
+            thawed: Vec::new(),
+            input_gain: self.input_gain,
+            output_gain: self.output_gain,
+            tails: self.tails.clone(),
+            tail: self.tail,
+            id: None,
+            is_muted: self.is_muted,
+            is_paused: self.is_paused
+        }
     }
 }
 
@@ -195,8 +906,8 @@ impl Sound for ComplexSound {
         self.is_muted
     }
 
-    fn register(&mut self, id: usize) {
-        self.id = Some(id);
+    fn register(&mut self, handle: SoundHandle) {
+        self.id = Some(handle);
     }
 
     fn unregister(&mut self) {
@@ -204,36 +915,240 @@ impl Sound for ComplexSound {
     }
 
     fn process(&mut self, input: SampleT) -> SampleT {
+        let mut x = [input];
+        self.process_block(&mut x);
+        x[0]
+    }
+
+    /// Processes the graph one block at a time by following its
+    /// [`ExecutionPlan`]. Each node receives the sum of the blocks rendered by
+    /// the nodes connected to it. Feedback loops are processed one sample at a
+    /// time, so connections leading back within them arrive one sample later,
+    /// while connections into the input or out of the output arrive one block
+    /// later.
+    /// 
+    /// With the `parallel` feature enabled, the nodes of each level of the
+    /// plan are rendered concurrently on the global [`rayon`] thread pool. The
+    /// output is identical to that of the serial path.
+    /// 
+    /// [`ExecutionPlan`]: ../execution_plan/struct.ExecutionPlan.html
+    /// [`rayon`]: https://docs.rs/rayon
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        self.receive();
+
         if self.is_paused {
-            return Default::default();
+            for x in inout {
+                *x = Default::default();
+            }
+            return;
         }
 
-        let mut out = Default::default();
+        let len = inout.len();
 
-        BlockSP::get_mut(
-            self.graph.node_weight_mut(self.input_gain).unwrap()
-        ).unwrap().prime_input(input);
+        self.buffers.resize_with(self.blocks.len(), SampleTrackT::new);
+        for b in &mut self.buffers {
+            b.resize(len, SampleT::default());
+        }
+        self.carry.resize(self.blocks.len(), SampleT::default());
 
-        for b in &self.process_order {
-            let block = BlockSP::get_mut(self.graph.node_weight_mut(*b).unwrap()).unwrap();
-            out = block.process();
+        for (b, x) in self.buffers[self.input_gain.index()].iter_mut().zip(inout.iter()) {
+            *b += *x;
+        }
+
+        let plan = &self.compiled.0;
+        let output = plan.output();
+
+        #[cfg(not(feature = "parallel"))]
+        for (l, range) in plan.levels().iter().enumerate() {
+            let ops = &plan.ops()[range.clone()];
+
+            if plan.is_loop(l) {
+                Self::process_loop(&mut self.blocks, &mut self.buffers, &mut self.carry, ops);
+                continue;
+            }
+
+            for op in ops {
+                if Self::process_node(&mut self.blocks, &mut self.frozen, &self.frozen_nodes, &mut self.buffers, op.node) {
+                    Self::fan_out(&mut self.buffers, op, output, inout);
+                }
+            }
+        }
+
+        #[cfg(feature = "parallel")]
+        for (l, range) in plan.levels().iter().enumerate() {
+            let ops = &plan.ops()[range.clone()];
+            let frozen_nodes = &self.frozen_nodes;
+
+            if plan.is_loop(l) {
+                Self::process_loop(&mut self.blocks, &mut self.buffers, &mut self.carry, ops);
+                continue;
+            }
+
+            if ops.len() > 1 {
+                self.blocks.par_process_blocks(&mut self.buffers, |n| {
+                    plan.level_of(n) == l && !Self::is_masked(frozen_nodes, n)
+                });
+            }
 
-            let mut neighbors = self.graph.neighbors(*b).detach();
+            for op in ops {
+                let active = if ops.len() > 1 && !Self::is_masked(frozen_nodes, op.node) {
+                    true
+                } else {
+                    Self::process_node(&mut self.blocks, &mut self.frozen, frozen_nodes, &mut self.buffers, op.node)
+                };
 
-            while let Some(t) = neighbors.next(&self.graph) {
-                BlockSP::get_mut(self.graph.node_weight_mut(t.1).unwrap()).unwrap().
-                prime_input(out);
+                if active {
+                    Self::fan_out(&mut self.buffers, op, output, inout);
+                }
             }
         }
 
+        self.thaw_step(len);
+        self.update_tail();
+
         if self.is_muted {
-            Default::default()
-        } else {
-            out
+            for x in inout {
+                *x = Default::default();
+            }
         }
     }
 
-    fn get_id(&self) -> Option<usize> {
+    fn get_id(&self) -> Option<SoundHandle> {
         self.id
     }
+
+    fn reset(&mut self) {
+        self.tail = None;
+        self.blocks.reset();
+        for f in &mut self.frozen {
+            f.playback.reset();
+            f.caught = 0;
+        }
+        for b in &mut self.buffers {
+            for x in b.iter_mut() {
+                *x = SampleT::default();
+            }
+        }
+        for x in &mut self.carry {
+            *x = SampleT::default();
+        }
+    }
+
+    /// Skips every node of the graph by `n` samples. Signals in flight along
+    /// feedback connections are dropped.
+    fn skip(&mut self, n: usize) {
+        self.receive();
+
+        if self.is_paused {
+            return;
+        }
+
+        self.tail = None;
+        self.blocks.skip(n);
+        for f in &mut self.frozen {
+            f.playback.skip(n);
+            f.caught = f.caught.saturating_add(n);
+        }
+        for b in &mut self.buffers {
+            for x in b.iter_mut() {
+                *x = SampleT::default();
+            }
+        }
+        for x in &mut self.carry {
+            *x = SampleT::default();
+        }
+    }
+
+    /// Applies the given [`Context`] to every block of the graph, and
+    /// reserves a buffer of its maximum block size for each of them. Frozen
+    /// regions rendered at another sample rate are thawed.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    fn set_context(&mut self, ctx: &Context) {
+        while let Some(i) = self.frozen.iter().position(|f| f.sample_rate != ctx.sample_rate()) {
+            self.thaw_region(i);
+        }
+
+        self.tail = None;
+        self.blocks.set_context(ctx);
+        self.tails.reserve(self.blocks.len().saturating_sub(self.tails.len()));
+
+        self.buffers.resize_with(self.blocks.len(), SampleTrackT::new);
+        for b in &mut self.buffers {
+            b.reserve(ctx.max_block().saturating_sub(b.len()));
+        }
+    }
+
+    /// Returns the tail of the graph as of the last processed block. Any
+    /// change to the graph or its blocks since then, including a plan
+    /// committed by a [`GraphEditor`] that hasn't been picked up yet, makes
+    /// the tail unknown until the next block.
+    /// 
+    /// [`GraphEditor`]: struct.GraphEditor.html
+    fn tail(&self) -> Option<usize> {
+        match self.mailbox.try_lock() {
+            Ok(m) if m.pending.is_none() => self.tail,
+            _ => None,
+        }
+    }
+}
+
+/// Editor for the connections of a [`ComplexSound`] that may be living on
+/// another thread, created with [`ComplexSound::editor`].
+/// 
+/// Edits are made to a private copy of the graph. [`commit`] compiles the
+/// copy into a new [`ExecutionPlan`] on the calling thread and hands it to the
+/// sound, which swaps it in at the start of its next block.
+/// 
+/// [`ComplexSound`]: struct.ComplexSound.html
+/// [`ComplexSound::editor`]: struct.ComplexSound.html#method.editor
+/// [`commit`]: struct.GraphEditor.html#method.commit
+/// [`ExecutionPlan`]: ../execution_plan/struct.ExecutionPlan.html
+pub struct GraphEditor {
+    graph: Graph,
+    input_gain: GraphNode,
+    output_gain: GraphNode,
+    mailbox: Arc<Mutex<Mailbox>>,
+}
+
+impl GraphEditor {
+    /// Adds a new connection (edge) between the two given [`GraphNode`]s.
+    /// 
+    /// [`GraphNode`]: type.GraphNode.html
+    pub fn add_connection(&mut self, from: GraphNode, to: GraphNode) {
+        self.graph.update_edge(from, to, ());
+    }
+
+    /// Removes a connection between the two given [`GraphNode`]s.
+    /// 
+    /// [`GraphNode`]: type.GraphNode.html
+    pub fn remove_connection(&mut self, from: GraphNode, to: GraphNode) {
+        if let Some(e) = self.graph.find_edge(from, to) {
+            self.graph.remove_edge(e);
+        }
+    }
+
+    /// Compiles the edited graph and sends it to the [`ComplexSound`],
+    /// replacing any earlier commit it hasn't picked up yet.
+    /// 
+    /// [`ComplexSound`]: struct.ComplexSound.html
+    pub fn commit(&self) {
+        let plan = ExecutionPlan::compile(&self.graph, self.input_gain, self.output_gain);
+        let compiled = Box::new((plan, self.graph.clone()));
+
+        let old = {
+            let mut mailbox = self.mailbox.lock().unwrap();
+            (mailbox.pending.replace(compiled), mailbox.retired.take(), std::mem::take(&mut mailbox.thawed))
+        };
+
+        drop(old);
+    }
+
+    /// Returns whether the last commit has been picked up by the
+    /// [`ComplexSound`].
+    /// 
+    /// [`ComplexSound`]: struct.ComplexSound.html
+    pub fn is_committed(&self) -> bool {
+        self.mailbox.lock().unwrap().pending.is_none()
+    }
 }
@@ -0,0 +1,200 @@
+//! # Execution Plan
+//! 
+//! A flat, precomputed schedule for processing the graph of a
+//! [`ComplexSound`].
+//! 
+//! [`ComplexSound`]: ../complex_sound/struct.ComplexSound.html
+
+use super::*;
+use std::ops::Range;
+use crate::utils::topo::{topological_levels, strongly_connected};
+
+/// A single step of an [`ExecutionPlan`]: process one node of the graph and
+/// add its output to the inputs of the nodes it is connected to.
+/// 
+/// [`ExecutionPlan`]: struct.ExecutionPlan.html
+#[derive(Clone,Debug)]
+pub struct NodeOp {
+    /// Index of the node to process.
+    pub node: usize,
+    /// Indices of the nodes receiving this node's output.
+    pub fan_out: Vec<usize>,
+    /// Whether the node is connected to itself, in which case its output is
+    /// kept as the start of its next input.
+    pub self_loop: bool,
+    /// Indices of the nodes of the same feedback loop, processed before this
+    /// one, that its output leads back to. They receive it one sample later.
+    pub delayed: Vec<usize>,
+}
+
+/// The order in which the nodes of a graph are processed, compiled once from
+/// the graph's connections so that processing never has to walk the graph.
+/// 
+/// Nodes are sorted topologically with Kahn's algorithm and grouped into
+/// dependency levels. The input node is always part of the first level and the
+/// output node makes up the last level on its own.
+/// 
+/// The nodes of each feedback loop, nodes that can all reach each other or a
+/// node connected to itself, make up a level of their own after every node
+/// feeding into them. They are processed one sample at a time, so connections
+/// leading back within the loop are delayed by one sample whatever the size
+/// of the blocks. Connections into the input or out of the output are delayed
+/// by one block.
+#[derive(Clone,Debug)]
+pub struct ExecutionPlan {
+    ops: Vec<NodeOp>,
+    levels: Vec<Range<usize>>,
+    loops: Vec<bool>,
+    node_levels: Vec<usize>,
+    node_count: usize,
+    output: usize,
+}
+
+impl ExecutionPlan {
+    /// Compiles a plan from the connections of the given graph. Compiling
+    /// never touches the [`Block`]s of the graph, so it can be done on any
+    /// thread.
+    /// 
+    /// # Parameters
+    /// 
+    /// * `graph` - The graph to compile.
+    /// * `input` - The node receiving the input of the graph.
+    /// * `output` - The node producing the output of the graph.
+    /// 
+    /// [`Block`]: ../trait.Block.html
+    pub fn compile(graph: &Graph, input: GraphNode, output: GraphNode) -> Self {
+        let node_count = graph.node_count();
+        let (input, output) = (input.index(), output.index());
+
+        let edges: Vec<(usize, usize)> = graph.raw_edges().iter()
+            .map(|e| (e.source().index(), e.target().index()))
+            .filter(|&(from, to)| to != input && from != output && to != output)
+            .collect();
+
+        // Feedback loops are sorted as a whole, then broken up into the order
+        // their nodes are processed in.
+        let comps = strongly_connected(node_count, &edges);
+        let comp_count = comps.iter().max().map_or(0, |c| c + 1);
+
+        let mut members = vec![Vec::new(); comp_count];
+        for (n, &c) in comps.iter().enumerate() {
+            members[c].push(n);
+        }
+
+        let mut looped: Vec<bool> = members.iter().map(|m| m.len() > 1).collect();
+        for &(from, to) in &edges {
+            if from == to {
+                looped[comps[from]] = true;
+            }
+        }
+
+        let comp_edges: Vec<(usize, usize)> = edges.iter()
+            .map(|&(from, to)| (comps[from], comps[to]))
+            .filter(|&(from, to)| from != to)
+            .collect();
+
+        let mut levels = Vec::new();
+        for l in topological_levels(comp_count, &comp_edges) {
+            let plain: Vec<usize> = l.iter()
+                .filter(|&&c| !looped[c])
+                .map(|&c| members[c][0])
+                .filter(|&n| n != output)
+                .collect();
+            if !plain.is_empty() {
+                levels.push((plain, false));
+            }
+
+            for &c in l.iter().filter(|&&c| looped[c]) {
+                let inner: Vec<(usize, usize)> = edges.iter()
+                    .copied()
+                    .filter(|&(from, to)| comps[from] == c && comps[to] == c)
+                    .collect();
+                let order = topological_levels(node_count, &inner)
+                    .into_iter()
+                    .flatten()
+                    .filter(|&n| comps[n] == c)
+                    .collect();
+                levels.push((order, true));
+            }
+        }
+        levels.push((vec![output], false));
+
+        let mut ops = Vec::with_capacity(node_count);
+        let mut ranges = Vec::with_capacity(levels.len());
+        let mut loops = Vec::with_capacity(levels.len());
+        let mut node_levels = vec![0; node_count];
+
+        for (i, (l, is_loop)) in levels.into_iter().enumerate() {
+            let start = ops.len();
+
+            for (j, &n) in l.iter().enumerate() {
+                node_levels[n] = i;
+                let node = GraphNode::new(n);
+                let fan_out: Vec<usize> = graph.neighbors(node)
+                    .map(|t| t.index())
+                    .filter(|&t| t != n)
+                    .collect();
+
+                ops.push(NodeOp {
+                    node: n,
+                    delayed: fan_out.iter()
+                        .copied()
+                        .filter(|t| is_loop && l[..j].contains(t))
+                        .collect(),
+                    fan_out,
+                    self_loop: graph.find_edge(node, node).is_some(),
+                });
+            }
+
+            ranges.push(start..ops.len());
+            loops.push(is_loop);
+        }
+
+        ExecutionPlan {
+            ops,
+            levels: ranges,
+            loops,
+            node_levels,
+            node_count,
+            output,
+        }
+    }
+
+    /// Returns the steps of the plan in the order they are executed.
+    pub fn ops(&self) -> &[NodeOp] {
+        &self.ops
+    }
+
+    /// Returns the dependency levels of the plan as ranges into [`ops`].
+    /// Nodes within one level don't depend on each other.
+    /// 
+    /// [`ops`]: struct.ExecutionPlan.html#method.ops
+    pub fn levels(&self) -> &[Range<usize>] {
+        &self.levels
+    }
+
+    /// Returns whether the given level holds the nodes of a feedback loop,
+    /// which depend on each other and are processed one sample at a time, in
+    /// order, rather than nodes that don't.
+    pub fn is_loop(&self, level: usize) -> bool {
+        self.loops[level]
+    }
+
+    /// Returns the index into [`levels`] of the level the given node belongs
+    /// to.
+    /// 
+    /// [`levels`]: struct.ExecutionPlan.html#method.levels
+    pub fn level_of(&self, node: usize) -> usize {
+        self.node_levels[node]
+    }
+
+    /// Returns the number of nodes the plan was compiled for.
+    pub fn node_count(&self) -> usize {
+        self.node_count
+    }
+
+    /// Returns the index of the node producing the output of the graph.
+    pub fn output(&self) -> usize {
+        self.output
+    }
+}
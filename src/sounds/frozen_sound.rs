@@ -0,0 +1,369 @@
+//! # Frozen Sound
+//! 
+//! Rendering deterministic [`Sound`]s once to a shared buffer, and playing the
+//! buffer in their place.
+//! 
+//! [`Sound`]: ../trait.Sound.html
+
+use super::*;
+use crate::channels::SoundHandle;
+use crate::generators::{Generator, FrozenPlayback};
+use crate::utils::asset_cache::{AssetCache, AssetKey, SampleBuffer};
+use std::thread::JoinHandle;
+
+/// Renders the given sound from its start with silent input, until it is
+/// finished or `max_len` samples have been rendered, in blocks of up to the
+/// [`max_block`] of the given [`Context`], cut short once the [`tail`] of the
+/// sound is known. The context is applied to the sound first, and the sound is
+/// reset again afterwards.
+/// 
+/// The sound should be neither paused nor muted, and should produce the same
+/// output every time it is played, or the render is only one of its
+/// possible outputs.
+/// 
+/// [`max_block`]: ../../context/struct.Context.html#method.max_block
+/// [`Context`]: ../../context/struct.Context.html
+/// [`tail`]: ../trait.Sound.html#method.tail
+pub fn render_sound<S: Sound + ?Sized>(sound: &mut S, ctx: &Context, max_len: usize) -> SampleBuffer {
+    sound.set_context(ctx);
+    sound.reset();
+
+    let mut out = Vec::new();
+    while out.len() < max_len && !sound.is_finished() {
+        let start = out.len();
+        let len = ctx.max_block().min(max_len - start).min(sound.tail().unwrap_or(usize::MAX));
+        out.resize(start + len, SampleT::default());
+        sound.process_block(&mut out[start..]);
+    }
+
+    sound.reset();
+
+    SampleBuffer::new(out, ctx.sample_rate())
+}
+
+/// Sound playing a render of another, deterministic [`Sound`], its source,
+/// instead of processing it.
+/// 
+/// The source is rendered once with [`render_sound`], and the render is then
+/// played back with a [`FrozenPlayback`], which costs no more than a copy per
+/// block however expensive the source is. Renders are [`SampleBuffer`]s, so
+/// they can be kept in an [`AssetCache`] and shared by every voice of the
+/// sound without rendering it again, and the render of a sound that takes
+/// long to compute can be made on another thread with [`spawn`].
+/// 
+/// The source has no live input: the input of a frozen sound is ignored, and
+/// renders are made with silent input. Renders end when the source finishes,
+/// or after the maximum length given when freezing, which cuts off sounds
+/// that never finish.
+/// 
+/// Borrowing the source mutably through [`source_mut`], to change one of its
+/// parameters, thaws the sound: the render no longer matches the source, so
+/// the source is processed again, starting from the current position, until
+/// it is frozen again with [`refreeze`]. Applying a [`Context`] of another
+/// sample rate also thaws the sound.
+/// 
+/// # Example
+/// 
+/// ```
+/// use std::time::Duration;
+/// use bae_rs::{*, generators::*, modifiers::*, sounds::*};
+/// 
+/// let ms = Duration::from_millis;
+/// let blip = Chain::new(Sine::new(880.0), (LowPass::new(4000.0, 0.7), ADSR::new(ms(2), ms(20), 0.5, ms(30))));
+/// 
+/// let mut frozen = FrozenSound::new(blip, &Context::default(), SAMPLE_RATE as usize);
+/// assert!(frozen.is_frozen());
+/// 
+/// // Every trigger plays the same render.
+/// let mut voice = frozen.voice();
+/// let mut t = vec![0.0; 480];
+/// voice.process_block(&mut t);
+/// assert_eq!(&t[..], &frozen.buffer().samples()[..480]);
+/// 
+/// // Changing the source thaws the sound until it is frozen again.
+/// frozen.source_mut().set_gain(0.5);
+/// assert!(!frozen.is_frozen());
+/// frozen.refreeze();
+/// assert!(frozen.is_frozen());
+/// ```
+/// 
+/// [`Sound`]: ../trait.Sound.html
+/// [`render_sound`]: fn.render_sound.html
+/// [`FrozenPlayback`]: ../../generators/frozen_playback/struct.FrozenPlayback.html
+/// [`SampleBuffer`]: ../../utils/asset_cache/struct.SampleBuffer.html
+/// [`AssetCache`]: ../../utils/asset_cache/struct.AssetCache.html
+/// [`spawn`]: struct.FrozenSound.html#method.spawn
+/// [`source_mut`]: struct.FrozenSound.html#method.source_mut
+/// [`refreeze`]: struct.FrozenSound.html#method.refreeze
+/// [`Context`]: ../../context/struct.Context.html
+pub struct FrozenSound<S> {
+    source: S,
+    ctx: Context,
+    max_len: usize,
+    playback: FrozenPlayback,
+    is_frozen: bool,
+    id: Option<SoundHandle>,
+    is_muted: bool,
+    is_paused: bool,
+}
+
+impl<S: Sound> FrozenSound<S> {
+    /// Renders the given source at the given [`Context`], for at most
+    /// `max_len` samples, and creates a sound playing the render.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn new(mut source: S, ctx: &Context, max_len: usize) -> Self {
+        let buffer = render_sound(&mut source, ctx, max_len);
+
+        Self::from_buffer(source, ctx, max_len, &buffer)
+    }
+
+    /// Creates a sound playing the render of the given source cached under
+    /// `key`, rendering and caching it as in [`new`] if it isn't cached.
+    /// 
+    /// The key has to identify the source and all of its parameters, such as
+    /// an [`AssetKey::Hash`] of them, as a cached render is used as is.
+    /// 
+    /// [`new`]: struct.FrozenSound.html#method.new
+    /// [`AssetKey::Hash`]: ../../utils/asset_cache/enum.AssetKey.html#variant.Hash
+    pub fn cached(mut source: S, ctx: &Context, max_len: usize, key: AssetKey, cache: &mut AssetCache) -> Self {
+        let buffer = match cache.get(&key) {
+            Some(b) => b,
+            None => cache.insert(key, render_sound(&mut source, ctx, max_len)),
+        };
+
+        source.set_context(ctx);
+        source.reset();
+
+        Self::from_buffer(source, ctx, max_len, &buffer)
+    }
+
+    /// Creates a sound playing the given render of the given source, which
+    /// must have been made at the given [`Context`], with the source reset.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn from_buffer(source: S, ctx: &Context, max_len: usize, buffer: &SampleBuffer) -> Self {
+        FrozenSound {
+            source,
+            ctx: *ctx,
+            max_len,
+            playback: FrozenPlayback::new(buffer),
+            is_frozen: true,
+            id: None,
+            is_muted: false,
+            is_paused: false,
+        }
+    }
+
+    /// Renders the given source as in [`new`] on a new thread, returning a
+    /// [`FreezeJob`] that yields the frozen sound once it is done.
+    /// 
+    /// [`new`]: struct.FrozenSound.html#method.new
+    /// [`FreezeJob`]: struct.FreezeJob.html
+    pub fn spawn(source: S, ctx: &Context, max_len: usize) -> FreezeJob<S>
+        where S: 'static
+    {
+        let ctx = *ctx;
+
+        FreezeJob {
+            handle: std::thread::spawn(move || FrozenSound::new(source, &ctx, max_len)),
+        }
+    }
+
+    /// Returns the source of the sound.
+    pub fn source(&self) -> &S {
+        &self.source
+    }
+
+    /// Returns the source of the sound, thawing it, since the source may be
+    /// changed through the returned reference.
+    pub fn source_mut(&mut self) -> &mut S {
+        self.thaw();
+        &mut self.source
+    }
+
+    /// Returns the source of the sound, dropping the render.
+    pub fn into_source(self) -> S {
+        self.source
+    }
+
+    /// Returns true if the sound is playing its render rather than processing
+    /// its source.
+    pub fn is_frozen(&self) -> bool {
+        self.is_frozen
+    }
+
+    /// Returns the latest render of the source, which is out of date if the
+    /// sound isn't frozen.
+    pub fn buffer(&self) -> &SampleBuffer {
+        self.playback.buffer()
+    }
+
+    /// Returns a new sound playing the latest render of the source from its
+    /// start, for triggering another voice of the sound without rendering or
+    /// copying anything.
+    pub fn voice(&self) -> Chain<FrozenPlayback, ()> {
+        Chain::from_generator(FrozenPlayback::new(self.playback.buffer()))
+    }
+
+    /// Stops playing the render, and has the source skip to the current
+    /// position so that processing continues from there.
+    pub fn thaw(&mut self) {
+        if !self.is_frozen {
+            return;
+        }
+
+        self.is_frozen = false;
+
+        let pos = self.playback.position();
+        if pos > 0 {
+            self.source.skip(pos);
+        }
+    }
+
+    /// Renders the source again and plays the new render from the current
+    /// position. This renders the whole source at once, so it shouldn't be
+    /// done on the thread rendering audio.
+    pub fn refreeze(&mut self) {
+        let pos = self.playback.position();
+        let buffer = render_sound(&mut self.source, &self.ctx, self.max_len);
+
+        self.playback = FrozenPlayback::new(&buffer);
+        self.playback.set_position(pos);
+        self.is_frozen = true;
+    }
+}
+
+impl<S: Sound> Sound for FrozenSound<S> {
+    fn toggle_pause(&mut self) {
+        self.is_paused = !self.is_paused;
+    }
+
+    fn is_paused(&self) -> bool {
+        self.is_paused
+    }
+
+    fn toggle_mute(&mut self) {
+        self.is_muted = !self.is_muted;
+    }
+
+    fn is_muted(&self) -> bool {
+        self.is_muted
+    }
+
+    fn register(&mut self, handle: SoundHandle) {
+        self.id = Some(handle);
+    }
+
+    fn unregister(&mut self) {
+        self.id = None;
+    }
+
+    /// Processes one sample. The input is ignored.
+    fn process(&mut self, input: SampleT) -> SampleT {
+        let mut x = [input];
+        self.process_block(&mut x);
+        x[0]
+    }
+
+    /// Processes a block by copying it from the render, or by processing the
+    /// source with silent input if the sound is thawed. The input is ignored.
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        if self.is_paused {
+            for x in inout {
+                *x = Default::default();
+            }
+            return;
+        }
+
+        if self.is_frozen {
+            self.playback.process_block(inout);
+        } else {
+            for x in inout.iter_mut() {
+                *x = Default::default();
+            }
+            self.source.process_block(inout);
+            self.playback.skip(inout.len());
+        }
+
+        if self.is_muted {
+            for x in inout {
+                *x = Default::default();
+            }
+        }
+    }
+
+    fn get_id(&self) -> Option<SoundHandle> {
+        self.id
+    }
+
+    fn reset(&mut self) {
+        self.playback.reset();
+        if !self.is_frozen {
+            self.source.reset();
+        }
+    }
+
+    fn skip(&mut self, n: usize) {
+        if self.is_paused {
+            return;
+        }
+
+        self.playback.skip(n);
+        if !self.is_frozen {
+            self.source.skip(n);
+        }
+    }
+
+    /// Applies the given [`Context`] to the source, thawing the sound if the
+    /// sample rate differs from that of the render.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    fn set_context(&mut self, ctx: &Context) {
+        if ctx.sample_rate() != self.ctx.sample_rate() {
+            self.thaw();
+        }
+
+        self.ctx = *ctx;
+        self.source.set_context(ctx);
+    }
+
+    fn tail(&self) -> Option<usize> {
+        if self.is_frozen {
+            self.playback.tail()
+        } else {
+            self.source.tail()
+        }
+    }
+}
+
+/// Render of a [`FrozenSound`] running on another thread, created with
+/// [`FrozenSound::spawn`].
+/// 
+/// [`FrozenSound`]: struct.FrozenSound.html
+/// [`FrozenSound::spawn`]: struct.FrozenSound.html#method.spawn
+pub struct FreezeJob<S> {
+    handle: JoinHandle<FrozenSound<S>>,
+}
+
+impl<S: Sound> FreezeJob<S> {
+    /// Returns true if the render is done, so that [`wait`] returns without
+    /// blocking.
+    /// 
+    /// [`wait`]: struct.FreezeJob.html#method.wait
+    pub fn is_finished(&self) -> bool {
+        self.handle.is_finished()
+    }
+
+    /// Waits for the render to finish and returns the frozen sound.
+    /// 
+    /// # Panics
+    /// 
+    /// Panics if rendering the source panicked.
+    pub fn wait(self) -> FrozenSound<S> {
+        match self.handle.join() {
+            Ok(s) => s,
+            Err(e) => std::panic::resume_unwind(e),
+        }
+    }
+}
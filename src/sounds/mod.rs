@@ -8,13 +8,22 @@
 
 use super::*;
 use std::sync::Arc;
+use crate::channels::SoundHandle;
 
 pub mod standard_block;
+pub mod block_arena;
+pub mod chain;
 pub mod complex_sound;
+pub mod execution_plan;
+pub mod frozen_sound;
 pub mod simple_sound;
 
 pub use standard_block::*;
+pub use block_arena::*;
+pub use chain::*;
 pub use complex_sound::*;
+pub use execution_plan::*;
+pub use frozen_sound::*;
 pub use simple_sound::*;
 
 /// Trait used for generalizing the interface that allows for the processing of
@@ -22,19 +31,91 @@ pub use simple_sound::*;
 /// 
 /// [`Generator`]: ../../generators/trait.Generator.html
 /// [`Modifier`]: ../../modifiers/trait.Modifier.html
-pub trait Block {
+pub trait Block: Send + Sync {
     /// Increments the internal input sample by the given sample.
     fn prime_input(&mut self, x: SampleT);
 
     /// Process the [`Block`]. Individually processes the stored [`Generator`]
-    /// and [`Modifier`] objects which are both combined using the [`Inter`] and
-    /// returned.
+    /// and [`Modifier`] objects which are both combined using the [`Interactor`]
+    /// and returned.
     /// 
     /// [`Block`]: trait.Block.html
     /// [`Generator`]: ../../generators/trait.Generator.html
     /// [`Modifier`]: ../../modifiers/trait.Modifier.html
-    /// [`Inter`]: type.Inter.html
+    /// [`Interactor`]: enum.Interactor.html
     fn process(&mut self) -> SampleT;
+
+    /// Processes a block of samples. On entry `inout` holds the input for each
+    /// sample, on return it holds each output sample. Any input primed through
+    /// [`prime_input`] beforehand is added to the first sample of the block.
+    /// 
+    /// The default implementation calls [`prime_input`] and [`process`] once
+    /// per sample.
+    /// 
+    /// [`prime_input`]: trait.Block.html#tymethod.prime_input
+    /// [`process`]: trait.Block.html#tymethod.process
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        for x in inout {
+            self.prime_input(*x);
+            *x = self.process();
+        }
+    }
+
+    /// Returns the block to the state it was created in, so it can be reused
+    /// for a new voice.
+    /// 
+    /// The default implementation does nothing.
+    fn reset(&mut self) {}
+
+    /// Advances the block by `n` samples without producing them, as for a
+    /// voice that is playing but inaudible.
+    /// 
+    /// The default implementation processes `n` samples of silence and
+    /// discards them.
+    fn skip(&mut self, n: usize) {
+        let mut scratch = [SampleT::default(); 64];
+        let mut n = n;
+
+        while n > 0 {
+            let k = n.min(scratch.len());
+            for x in &mut scratch[..k] {
+                *x = SampleT::default();
+            }
+            self.process_block(&mut scratch[..k]);
+            n -= k;
+        }
+    }
+
+    /// Applies the given [`Context`] to the block's [`Generator`] and
+    /// [`Modifier`].
+    /// 
+    /// The default implementation does nothing.
+    /// 
+    /// [`Context`]: ../context/struct.Context.html
+    /// [`Generator`]: ../generators/trait.Generator.html
+    /// [`Modifier`]: ../modifiers/trait.Modifier.html
+    fn set_context(&mut self, _ctx: &Context) {}
+
+    /// Returns the number of samples of output still to come if the input
+    /// stays silent from now on, or `None` if the block may never fall
+    /// silent, as for [`Modifier::tail`].
+    /// 
+    /// The default implementation returns `None`.
+    /// 
+    /// [`Modifier::tail`]: ../modifiers/trait.Modifier.html#method.tail
+    fn tail(&self) -> Option<usize> {
+        None
+    }
+
+    /// Returns true if the output of the block is silent whatever its input,
+    /// as for [`Modifier::is_silent`].
+    /// 
+    /// The default implementation returns false.
+    /// 
+    /// [`Modifier::is_silent`]: ../modifiers/trait.Modifier.html#method.is_silent
+    fn is_silent(&self) -> bool {
+        false
+    }
 }
 
 /// Alias for a [`Block`] object wrapped in a smart pointer.
@@ -45,8 +126,12 @@ pub type BlockSP = Arc<dyn Block>;
 /// This trait defines the interface that anything producing sound that will be
 /// output to a [`Channel`] must define.
 /// 
-/// [`Channel`]: ../../core/trait.Channel.html
-pub trait Sound {
+/// Sounds are required to be [`Send`] so that they can be constructed on one
+/// thread and handed to the thread rendering their [`Channel`].
+/// 
+/// [`Channel`]: ../channels/trait.Channel.html
+/// [`Send`]: https://doc.rust-lang.org/std/marker/trait.Send.html
+pub trait Sound: Send {
     /// Toggles the pause state of the sound. If the sound is paused, the
     /// internal structures aren't process during a call to [`process`], instead
     /// only [`Default::default()`] is returned.
@@ -81,33 +166,112 @@ pub trait Sound {
     /// [`Default::default()`]: https://doc.rust-lang.org/std/default/trait.Default.html#tymethod.default
     fn process(&mut self, input: SampleT) -> SampleT;
 
-    /// Sets itself as registered with the given ID.
+    /// Processes a block of samples in place. On entry `inout` holds the input
+    /// for each sample, on return it holds each output sample. Pausing and
+    /// muting behave as they do for [`process`].
+    /// 
+    /// The default implementation calls [`process`] once per sample.
+    /// 
+    /// [`process`]: trait.Sound.html#tymethod.process
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        for x in inout {
+            *x = self.process(*x);
+        }
+    }
+
+    /// Sets itself as registered with the given [`SoundHandle`].
     /// 
     /// Caution should be taken when registering and unregistering sounds to or
     /// from a [`Channel`], as [`Sound`]s don't control their own registration.
     /// As such you should be registering through [`Channel::add_sound`].
     /// 
-    /// [`Channel`]: ../../core/trait.Channel.html
-    /// [`Channel::add_sound`]: ../../core/trait.Channel.html#tymethod.add_sound
+    /// [`SoundHandle`]: ../channels/struct.SoundHandle.html
+    /// [`Channel`]: ../channels/trait.Channel.html
+    /// [`Channel::add_sound`]: ../channels/trait.Channel.html#tymethod.add_sound
     /// [`Sound`]: trait.Sound.html
     /// [`Sound::unregister`]: trait.Sound.html#tymethod.unregister
-    fn register(&mut self, id: usize);
+    fn register(&mut self, handle: SoundHandle);
 
-    /// Sets itself as unregistered and clears the saved ID.
+    /// Sets itself as unregistered and clears the saved [`SoundHandle`].
     /// 
     /// Caution should be taken when registering and unregistering sounds to or
     /// from a [`Channel`] as [`Sound`]s don't control their own registration.
     /// As such you should be registering through [`Channel::remove_sound`].
     /// 
-    /// [`Channel`]: ../../core/trait.Channel.html
-    /// [`Channel::remove_sound`]: ../../core/trait.Channel.html#tymethod.remove_sound
+    /// [`SoundHandle`]: ../channels/struct.SoundHandle.html
+    /// [`Channel`]: ../channels/trait.Channel.html
+    /// [`Channel::remove_sound`]: ../channels/trait.Channel.html#tymethod.remove_sound
     /// [`Sound`]: trait.Sound.html
     fn unregister(&mut self);
 
-    /// Returns the ID given to the [`Sound`] during registration with a
-    /// [`Channel`]. If the [`Sound`] is unregistered, it will return `None`.
+    /// Returns the [`SoundHandle`] given to the [`Sound`] during registration
+    /// with a [`Channel`]. If the [`Sound`] is unregistered, it will return
+    /// `None`.
     /// 
-    /// [`Channel`]: ../../core/trait.Channel.html
+    /// [`SoundHandle`]: ../channels/struct.SoundHandle.html
+    /// [`Channel`]: ../channels/trait.Channel.html
     /// [`Sound`]: trait.Sound.html
-    fn get_id(&self) -> Option<usize>;
+    fn get_id(&self) -> Option<SoundHandle>;
+
+    /// Restarts the sound from the beginning, keeping its parameters and its
+    /// pause and mute states, so it can be played again as a new voice
+    /// without being rebuilt.
+    /// 
+    /// The default implementation does nothing.
+    fn reset(&mut self) {}
+
+    /// Advances the sound by `n` samples without rendering them, as for a
+    /// voice that is playing but inaudible.
+    /// 
+    /// The default implementation processes `n` samples of silence and
+    /// discards them.
+    fn skip(&mut self, n: usize) {
+        let mut scratch = [SampleT::default(); 64];
+        let mut n = n;
+
+        while n > 0 {
+            let k = n.min(scratch.len());
+            for x in &mut scratch[..k] {
+                *x = SampleT::default();
+            }
+            self.process_block(&mut scratch[..k]);
+            n -= k;
+        }
+    }
+
+    /// Applies the given [`Context`] to every part of the sound, and reserves
+    /// whatever it needs to process blocks of up to [`max_block`] samples.
+    /// [`Channel`]s do this for every sound added to them.
+    /// 
+    /// The default implementation does nothing.
+    /// 
+    /// [`Context`]: ../context/struct.Context.html
+    /// [`max_block`]: ../context/struct.Context.html#method.max_block
+    /// [`Channel`]: ../channels/trait.Channel.html
+    fn set_context(&mut self, _ctx: &Context) {}
+
+    /// Returns the number of samples the sound will take to fall silent if
+    /// its input stays silent from now on, or `None` if it may never stop,
+    /// from the tails of its [`Generator`]s and [`Modifier`]s. A paused sound
+    /// keeps the tail it had when it was paused.
+    /// 
+    /// The default implementation returns `None`.
+    /// 
+    /// [`Generator`]: ../generators/trait.Generator.html
+    /// [`Modifier`]: ../modifiers/trait.Modifier.html
+    fn tail(&self) -> Option<usize> {
+        None
+    }
+
+    /// Returns true if the sound will only output silence until it is
+    /// changed, as for a one-shot whose envelope has stopped or whose file
+    /// has played to the end. Channels skip finished sounds, and can remove
+    /// them automatically.
+    /// 
+    /// The default implementation returns true if the [`tail`] is 0.
+    /// 
+    /// [`tail`]: trait.Sound.html#method.tail
+    fn is_finished(&self) -> bool {
+        self.tail() == Some(0)
+    }
 }
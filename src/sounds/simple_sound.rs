@@ -9,21 +9,26 @@
 //! [`Modifier`]: ../../generators/trait.Modifier.html
 
 use super::*;
+use crate::channels::SoundHandle;
 
 /// Struct implementing the ability to run a single [`Generator`] through a
 /// given list of [`Modifier`]s operated in series. This allows for simple and
 /// fast processing of the structure's elements while still allowing for a wide
 /// range of more complex sounds.
 /// 
+/// The blocks are kept in a [`BlockArena`], the generator first. Blocks given
+/// as a [`StandardBlock`] are stored in place there.
+/// 
 /// [`Generator`]: ../../generators/trait.Generator.html
 /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+/// [`BlockArena`]: ../block_arena/struct.BlockArena.html
+/// [`StandardBlock`]: ../standard_block/struct.StandardBlock.html
 #[derive(Clone)]
 pub struct SimpleSound {
-    generator: BlockSP,
-    modifier_list: Vec<BlockSP>,
+    blocks: BlockArena,
     input_gain: SampleT,
     output_gain: SampleT,
-    id: Option<usize>,
+    id: Option<SoundHandle>,
     is_muted: bool,
     is_paused: bool,
 }
@@ -39,9 +44,32 @@ impl SimpleSound {
     /// [`add_modifier`]: struct.SimpleSound.html#method.add_modifier
     /// [`extend_modifiers`]: struct.SimpleSound.html#method.extend_modifiers
     pub fn new(input_gain: MathT, output_gain: MathT, generator: BlockSP) -> Self {
+        let mut blocks = BlockArena::new();
+        blocks.push_shared(generator);
+
+        Self::with_blocks(input_gain, output_gain, blocks)
+    }
+
+    /// Constructs a new [`SimpleSound`] object like [`new`], storing the
+    /// given [`StandardBlock`] in place.
+    /// 
+    /// [`SimpleSound`]: struct.SimpleSound.html
+    /// [`new`]: struct.SimpleSound.html#method.new
+    /// [`StandardBlock`]: ../standard_block/struct.StandardBlock.html
+    pub fn from_block(input_gain: MathT, output_gain: MathT, generator: StandardBlock) -> Self {
+        let mut blocks = BlockArena::new();
+        blocks.push(generator);
+
+        Self::with_blocks(input_gain, output_gain, blocks)
+    }
+
+    /// Constructs a new [`SimpleSound`] object from the arena holding its
+    /// blocks, the generator first.
+    /// 
+    /// [`SimpleSound`]: struct.SimpleSound.html
+    fn with_blocks(input_gain: MathT, output_gain: MathT, blocks: BlockArena) -> Self {
         SimpleSound {
-            generator,
-            modifier_list: Vec::new(),
+            blocks,
             input_gain: input_gain as SampleT,
             output_gain: output_gain as SampleT,
             id: None,
@@ -54,10 +82,17 @@ impl SimpleSound {
     /// 
     /// [`Vec`]: https://doc.rust-lang.org/std/vec/struct.Vec.html
     /// [`Modifier`]: ../../modifiers/trait.Modifier.html
-    pub fn add_modifier<M>(&mut self, m: BlockSP)
-        where M: 'static + Clone
-    {
-        self.modifier_list.push(m);
+    pub fn add_modifier(&mut self, m: BlockSP) {
+        self.blocks.push_shared(m);
+    }
+
+    /// Adds a single modifier to the internal list of [`Modifier`]s, storing
+    /// the given [`StandardBlock`] in place.
+    /// 
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    /// [`StandardBlock`]: ../standard_block/struct.StandardBlock.html
+    pub fn add_standard_modifier(&mut self, m: StandardBlock) {
+        self.blocks.push(m);
     }
 
     /// Extends the internal [`Vec`] of [`Modifier`]s with the given [`Vec`].
@@ -65,7 +100,21 @@ impl SimpleSound {
     /// [`Vec`]: https://doc.rust-lang.org/std/vec/struct.Vec.html
     /// [`Modifier`]: ../../modifiers/trait.Modifier.html
     pub fn extend_modifiers(&mut self, m_list: Vec<BlockSP>) {
-        self.modifier_list.extend(m_list);
+        for m in m_list {
+            self.blocks.push_shared(m);
+        }
+    }
+
+    /// Returns the render time statistics of the given [`Block`], the
+    /// [`Generator`] being block 0 and the [`Modifier`]s following it in the
+    /// order they were added.
+    /// 
+    /// [`Block`]: ../trait.Block.html
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    #[cfg(feature = "instrumentation")]
+    pub fn block_stats(&self, block: usize) -> Option<&std::sync::Arc<crate::instrumentation::RenderStats>> {
+        self.blocks.stats(block)
     }
 
     /// Returns the linear gain applied to the input during processing.
@@ -106,8 +155,8 @@ impl Sound for SimpleSound {
         self.is_muted
     }
 
-    fn register(&mut self, id: usize) {
-        self.id = Some(id);
+    fn register(&mut self, handle: SoundHandle) {
+        self.id = Some(handle);
     }
 
     fn unregister(&mut self) {
@@ -119,15 +168,15 @@ impl Sound for SimpleSound {
             return Default::default();
         }
 
-        let mut out = if let Some(b) = BlockSP::get_mut(&mut self.generator) {
+        let mut out = if let Some(b) = self.blocks.get_mut(0) {
             b.prime_input(input * self.input_gain);
             b.process()
         } else {
             Default::default()
         };
 
-        for m in &mut self.modifier_list {
-            if let Some(m) = BlockSP::get_mut(m) {
+        for i in 1..self.blocks.len() {
+            if let Some(m) = self.blocks.get_mut(i) {
                 m.prime_input(out);
                 out = m.process();
             }
@@ -140,7 +189,63 @@ impl Sound for SimpleSound {
         }
     }
 
-    fn get_id(&self) -> Option<usize> {
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        if self.is_paused {
+            for x in inout {
+                *x = Default::default();
+            }
+            return;
+        }
+
+        let g = self.input_gain;
+        for x in inout.iter_mut() {
+            *x *= g;
+        }
+        if !self.blocks.try_process_block(0, inout) {
+            for x in inout.iter_mut() {
+                *x = Default::default();
+            }
+        }
+
+        for i in 1..self.blocks.len() {
+            self.blocks.try_process_block(i, inout);
+        }
+
+        if self.is_muted {
+            for x in inout {
+                *x = Default::default();
+            }
+        } else {
+            let g = self.output_gain;
+            for x in inout {
+                *x *= g;
+            }
+        }
+    }
+
+    fn get_id(&self) -> Option<SoundHandle> {
         self.id
     }
+
+    fn reset(&mut self) {
+        self.blocks.reset();
+    }
+
+    fn skip(&mut self, n: usize) {
+        if self.is_paused {
+            return;
+        }
+
+        self.blocks.skip(n);
+    }
+    fn set_context(&mut self, ctx: &Context) {
+        self.blocks.set_context(ctx);
+    }
+
+    fn tail(&self) -> Option<usize> {
+        modifiers::series_tail((0..self.blocks.len()).map(|i| match self.blocks.get(i) {
+            Some(b) => (b.is_silent(), b.tail()),
+            None => (false, None),
+        }))
+    }
 }
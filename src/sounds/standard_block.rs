@@ -23,53 +23,138 @@ type ModifierSP = Arc<dyn Modifier>;
 /// [`Generator`]: ../../generators/trait.Generator.html
 /// [`Modifier`]: ../../modifiers/trait.Modifier.html
 /// [`StandardBlock`]: struct.StandardBlock.html
-pub type InterBase = dyn FnMut(SampleT, SampleT) -> SampleT;
+pub type InterBase = dyn FnMut(SampleT, SampleT) -> SampleT + Send + Sync;
 
 /// Reference-counted wrapper for the closure [`InterBase`]
 /// 
 /// [`InterBase`]: type.InterBase.html
 pub type Inter = Arc<InterBase>;
 
+/// How a [`StandardBlock`] combines the outputs of its [`Generator`] and
+/// [`Modifier`].
+/// 
+/// The built-in combinations are dispatched with a single match per block,
+/// and compile to plain loops. Any other combination can be given as a
+/// closure with [`Custom`].
+/// 
+/// [`StandardBlock`]: struct.StandardBlock.html
+/// [`Generator`]: ../../generators/trait.Generator.html
+/// [`Modifier`]: ../../modifiers/trait.Modifier.html
+/// [`Custom`]: enum.Interactor.html#variant.Custom
+#[derive(Clone)]
+pub enum Interactor {
+    /// Multiplies the two samples together.
+    Multiply,
+    /// Adds the two samples together.
+    Add,
+    /// Passes the [`Generator`] sample through.
+    /// 
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    Generator,
+    /// Passes the [`Modifier`] sample through.
+    /// 
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    Modifier,
+    /// Combines the [`Generator`] and [`Modifier`] samples, in that order,
+    /// with the given closure.
+    /// 
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    Custom(Inter),
+}
+
+impl Interactor {
+    /// Creates a [`Custom`] interactor from the given closure.
+    /// 
+    /// [`Custom`]: enum.Interactor.html#variant.Custom
+    pub fn custom<F>(f: F) -> Self
+        where F: 'static + FnMut(SampleT, SampleT) -> SampleT + Send + Sync
+    {
+        Interactor::Custom(Arc::new(f))
+    }
+
+    /// Combines the [`Generator`] samples in `g` with the [`Modifier`] samples
+    /// in `inout`, storing the results in `inout`.
+    /// 
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    fn apply(&mut self, g: &[SampleT], inout: &mut [SampleT]) {
+        match self {
+            Interactor::Multiply => {
+                for (y, g) in inout.iter_mut().zip(g) {
+                    *y *= *g;
+                }
+            },
+            Interactor::Add => {
+                for (y, g) in inout.iter_mut().zip(g) {
+                    *y += *g;
+                }
+            },
+            Interactor::Generator => inout.copy_from_slice(&g[..inout.len()]),
+            Interactor::Modifier => (),
+            Interactor::Custom(i) => {
+                let i = Inter::get_mut(i).unwrap();
+                for (y, g) in inout.iter_mut().zip(g) {
+                    *y = i(*g, *y);
+                }
+            },
+        }
+    }
+}
+
+impl Default for Interactor {
+    fn default() -> Self {
+        Interactor::Multiply
+    }
+}
+
+impl From<Inter> for Interactor {
+    fn from(i: Inter) -> Self {
+        Interactor::Custom(i)
+    }
+}
+
 /// Struct used for generalizing the structure of and abstracting the [`Sound`]
 /// struct. This allows us to create complex sounds as a graph of [`StandardBlock`]s,
 /// where each block can be a [`Modifier`], [`Generator`], or both, and there output
 /// of the [`StandardBlock`] is defined as some user-definable combination of the
 /// [`Generator`] and [`Modifier`] output. See [`Sound`] documentation for more info.
 /// 
-/// Internally, the [`Generator`], [`Modifier`], and [`Inter`] are stored wrapped
-/// within an [`Arc`]. This means that when you clone a [`StandardBlock`], the
-/// internal objects are *not* cloned. Rather, their reference count is incremented,
-/// and the wrapped objects stay where they are.
+/// Internally, the [`Generator`] and [`Modifier`] are stored wrapped within an
+/// [`Arc`]. This means that when you clone a [`StandardBlock`], the internal
+/// objects are *not* cloned. Rather, their reference count is incremented,
+/// and the wrapped objects stay where they are. A block can only be processed
+/// while it is the only owner of them.
 /// 
 /// [`Generator`]: ../../generators/trait.Generator.html
 /// [`Modifier`]: ../../modifiers/trait.Modifier.html
 /// [`StandardBlock`]: struct.StandardBlock.html
 /// [`Sound`]: struct.Sound.html
-/// [`Inter`]: type.Inter.html
 /// [`Arc`]: https://doc.rust-lang.org/std/sync/struct.Arc.html
 pub struct StandardBlock {
     g: GeneratorSP,
     m: ModifierSP,
-    i: Inter,
+    i: Interactor,
     input: SampleT,
+    scratch: SampleTrackT,
 }
 
 impl StandardBlock {
     /// Creates a new StandardBlock from the given [`Generator`], [`Modifier`], and
-    /// [`Inter`].
+    /// [`Interactor`].
     /// 
     /// # Parameters
     /// 
     /// * `g` - The [`Generator`] for the [`StandardBlock`].
     /// * `m` - The [`Modifier`] for the [`StandardBlock`].
-    /// * `i` - The interactor (typically a closure) that defines the combination
-    /// of `g`s and `m`s samples when `StandardBlock::process()` is called.
+    /// * `i` - The interactor that defines the combination of `g`s and `m`s
+    /// samples when `StandardBlock::process()` is called.
     /// 
     /// [`Generator`]: ../../generators/trait.Generator.html
     /// [`Modifier`]: ../../modifiers/trait.Modifier.html
     /// [`StandardBlock`]: struct.StandardBlock.html
-    /// [`Inter`]: type.Inter.html
-    pub fn new<T, U>(g: T, m: U, i: Inter) -> Self
+    /// [`Interactor`]: enum.Interactor.html
+    pub fn new<T, U>(g: T, m: U, i: Interactor) -> Self
         where T: 'static + generators::Generator,
               U: 'static + modifiers::Modifier
     {
@@ -78,6 +163,7 @@ impl StandardBlock {
             m: Arc::new(m),
             i,
             input: SampleT::default(),
+            scratch: SampleTrackT::new(),
         }
     }
 
@@ -91,7 +177,6 @@ impl StandardBlock {
     /// [`Generator`]: ../../generators/trait.Generator.html
     /// [`StandardBlock`]: struct.StandardBlock.html
     /// [`StandardBlock::generator_passthrough`]: struct.StandardBlock.html#method.generator_passthrough
-    /// [`Inter`]: type.Inter.html
     /// [`Empty`]: ../../generators/empty/struct.Empty.html
     pub fn from_generator<T>(g: T) -> Self
         where T: 'static + generators::Generator
@@ -102,7 +187,8 @@ impl StandardBlock {
                 modifiers::Passthrough::new()
             ),
             i: Self::generator_passthrough(),
-            input: SampleT::default()
+            input: SampleT::default(),
+            scratch: SampleTrackT::new(),
         }
     }
 
@@ -116,7 +202,6 @@ impl StandardBlock {
     /// [`Modifier`]: ../../modifiers/trait.Modifier.html
     /// [`StandardBlock`]: struct.StandardBlock.html
     /// [`StandardBlock::modifier_passthrough`]: struct.StandardBlock.html#method.modifier_passthrough
-    /// [`Inter`]: type.Inter.html
     /// [`Empty`]: ../../modifiers/empty/struct.Empty.html
     pub fn from_modifier<U>(m: U) -> Self
         where U: 'static + modifiers::Modifier
@@ -127,30 +212,31 @@ impl StandardBlock {
             ),
             m: Arc::new(m),
             i: Self::modifier_passthrough(),
-            input: SampleT::default()
+            input: SampleT::default(),
+            scratch: SampleTrackT::new(),
         }
     }
 
     /// Creates the default interactor which simply multiplies the two passed
     /// samples together.
-    pub fn default_interactor() -> Inter {
-        Arc::new(|ge, mo| ge * mo)
+    pub fn default_interactor() -> Interactor {
+        Interactor::Multiply
     }
 
     /// Creates a passthrough interactor which passes the [`Generator`] sample
     /// through.
     /// 
     /// [`Generator`]: ../../generators/trait.Generator.html
-    pub fn generator_passthrough() -> Inter {
-        Arc::new(|ge, _| ge)
+    pub fn generator_passthrough() -> Interactor {
+        Interactor::Generator
     }
 
     /// Creates a passthrough interactor which passes the [`Modifier`] sample
     /// through.
     /// 
     /// [`Modifier`]: ../../modifiers/trait.Modifier.html
-    pub fn modifier_passthrough() -> Inter {
-        Arc::new(|_, mo| mo)
+    pub fn modifier_passthrough() -> Interactor {
+        Interactor::Modifier
     }
 
     /// Returns a reference to the [`Generator`] wrapped in a smart pointer.
@@ -180,6 +266,37 @@ impl StandardBlock {
     pub fn get_m_mut(&mut self) -> &mut ModifierSP {
         &mut self.m
     }
+
+    /// Returns a reference to the [`Interactor`].
+    /// 
+    /// [`Interactor`]: enum.Interactor.html
+    pub fn get_i(&self) -> &Interactor {
+        &self.i
+    }
+
+    /// Sets the [`Interactor`].
+    /// 
+    /// [`Interactor`]: enum.Interactor.html
+    pub fn set_i(&mut self, i: Interactor) {
+        self.i = i;
+    }
+}
+
+impl Clone for StandardBlock {
+    /// Creates a block sharing the same [`Generator`] and [`Modifier`], with
+    /// no primed input.
+    /// 
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    fn clone(&self) -> Self {
+        StandardBlock {
+            g: self.g.clone(),
+            m: self.m.clone(),
+            i: self.i.clone(),
+            input: SampleT::default(),
+            scratch: SampleTrackT::new(),
+        }
+    }
 }
 
 impl Block for StandardBlock {
@@ -188,14 +305,108 @@ impl Block for StandardBlock {
     }
 
     fn process(&mut self) -> SampleT {
-        let y = Inter::get_mut(&mut self.i).unwrap()(
-            GeneratorSP::get_mut(&mut self.g).unwrap().process(),
-            ModifierSP::get_mut(&mut self.m).unwrap().process(self.input)
-        );
+        let g = GeneratorSP::get_mut(&mut self.g).unwrap().process();
+        let mut y = [ModifierSP::get_mut(&mut self.m).unwrap().process(self.input)];
+
+        self.input = SampleT::default();
+        self.i.apply(&[g], &mut y);
+
+        y[0]
+    }
+
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        if let Some(x) = inout.first_mut() {
+            *x += self.input;
+        }
+        self.input = SampleT::default();
+
+        self.scratch.resize(inout.len(), SampleT::default());
+
+        GeneratorSP::get_mut(&mut self.g).unwrap().process_block(&mut self.scratch);
+        ModifierSP::get_mut(&mut self.m).unwrap().process_block(inout);
+
+        self.i.apply(&self.scratch, inout);
+    }
+
+    fn reset(&mut self) {
+        self.input = SampleT::default();
+
+        if let Some(g) = GeneratorSP::get_mut(&mut self.g) {
+            g.reset();
+        }
+        if let Some(m) = ModifierSP::get_mut(&mut self.m) {
+            m.reset();
+        }
+    }
 
+    fn skip(&mut self, n: usize) {
         self.input = SampleT::default();
 
-        y
+        if let Some(g) = GeneratorSP::get_mut(&mut self.g) {
+            g.skip(n);
+        }
+        if let Some(m) = ModifierSP::get_mut(&mut self.m) {
+            m.skip(n);
+        }
+    }
+    /// Applies the given [`Context`] to the [`Generator`] and [`Modifier`],
+    /// skipping any shared with another block, and reserves the scratch
+    /// buffer for blocks of its maximum size.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    fn set_context(&mut self, ctx: &Context) {
+        if let Some(g) = GeneratorSP::get_mut(&mut self.g) {
+            g.set_context(ctx);
+        }
+        if let Some(m) = ModifierSP::get_mut(&mut self.m) {
+            m.set_context(ctx);
+        }
+
+        self.scratch.reserve(ctx.max_block().saturating_sub(self.scratch.len()));
+    }
+
+    /// Combines the tails of the [`Generator`] and [`Modifier`] as the
+    /// [`Interactor`] combines their outputs. The tail of a [`Custom`]
+    /// combination is unknown.
+    /// 
+    /// [`Generator`]: ../../generators/trait.Generator.html
+    /// [`Modifier`]: ../../modifiers/trait.Modifier.html
+    /// [`Interactor`]: enum.Interactor.html
+    /// [`Custom`]: enum.Interactor.html#variant.Custom
+    fn tail(&self) -> Option<usize> {
+        let (g, m) = (self.g.tail(), self.m.tail());
+
+        match self.i {
+            Interactor::Multiply => {
+                if self.is_silent() {
+                    Some(0)
+                } else {
+                    match (g, m) {
+                        (Some(g), Some(m)) => Some(g.min(m)),
+                        (Some(t), None) | (None, Some(t)) => Some(t),
+                        (None, None) => None,
+                    }
+                }
+            },
+            Interactor::Add => g.and_then(|g| m.map(|m| g.max(m))),
+            Interactor::Generator => g,
+            Interactor::Modifier => m,
+            Interactor::Custom(_) => None,
+        }
+    }
+
+    fn is_silent(&self) -> bool {
+        let g = self.g.tail() == Some(0);
+
+        match self.i {
+            Interactor::Multiply => g || self.m.is_silent(),
+            Interactor::Add => g && self.m.is_silent(),
+            Interactor::Generator => g,
+            Interactor::Modifier => self.m.is_silent(),
+            Interactor::Custom(_) => false,
+        }
     }
 }
 
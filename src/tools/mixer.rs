@@ -1,30 +1,696 @@
 //! # Mixer
+//! 
+//! A graph of submix buses summing [`Channel`]s through effect chains, with
+//! aux sends and metering.
+//! 
+//! [`Channel`]: ../../channels/trait.Channel.html
 
 use super::*;
 
-use std::collections::VecDeque;
-use crate::channels::{Channel, ChannelSP};
-use crate::sounds::BlockSP;
+use crate::channels::ChannelSP;
+use crate::modifiers::Modifier;
+use crate::utils::{denormal::DenormalGuard, simd, topo};
+use std::ops::Range;
+use std::time::Duration;
+#[cfg(feature = "parallel")]
+use rayon::prelude::*;
 
-pub struct Mixer {
-    modifier_list: Vec<BlockSP>,
-    channel_list: VecDeque<ChannelSP>,
+/// Handle referring to a bus of a [`Mixer`].
+/// 
+/// [`Mixer`]: struct.Mixer.html
+#[derive(Copy,Clone,Debug,PartialEq,Eq,Hash)]
+pub struct BusId(usize);
+
+/// Point in a bus that a send or meter reads the signal from.
+#[derive(Copy,Clone,Debug,PartialEq,Eq)]
+pub enum TapPoint {
+    /// After the effect chain, before the fader.
+    PreFader,
+    /// After the fader.
+    PostFader,
+}
+
+/// Level of one channel of a bus over the last processed block.
+#[derive(Copy,Clone,Debug,Default,PartialEq)]
+pub struct Level {
+    /// Largest absolute sample value.
+    pub peak: SampleT,
+    /// Root mean square of the samples.
+    pub rms: SampleT,
+}
+
+/// Send of the signal of a bus to another bus.
+#[derive(Copy,Clone,Debug)]
+struct AuxSend {
+    to: BusId,
+    gain: SampleT,
+    tap: TapPoint,
+}
+
+/// Signal of a bus from a bus rendered before it, either through its output
+/// or one of its sends.
+#[derive(Copy,Clone,Debug)]
+struct Input {
+    from: usize,
+    send: Option<usize>,
 }
 
-impl Mixer {
-    pub fn modifier_list(&self) -> &Vec<BlockSP> {
-        &self.modifier_list
+/// Processing state of a bus, which is only touched by the bus itself.
+struct Strip<SF>
+    where SF: SampleFormat
+{
+    id: BusId,
+    channels: Vec<ChannelSP<SF>>,
+    effects: Vec<Box<dyn Modifier>>,
+    inputs: Vec<Input>,
+}
+
+/// Output of a bus, which is read by the buses rendered after it.
+struct Output {
+    buffer: PlanarBuffer,
+    gain: SampleT,
+    route: Option<BusId>,
+    sends: Vec<AuxSend>,
+    levels: Vec<Level>,
+}
+
+/// Mixer summing [`Channel`]s through a graph of submix buses into a master
+/// bus.
+/// 
+/// Every bus sums the channels it owns and the signals routed into it, runs
+/// the sum through its chain of effects, and passes it through its fader to
+/// the bus it outputs to, [`master`] by default. Buses can also send their
+/// signal, before or after their fader, to any number of other buses, such as
+/// an aux bus holding a reverb whose output returns to the master bus. Routes
+/// that would create a feedback loop are rejected.
+/// 
+/// Buses are kept sorted by their dependency levels, and render a whole block
+/// at a time. Each bus owns a [`PlanarBuffer`] which its channels mix into
+/// directly and which the buses it feeds read in place, and the buffers of
+/// removed buses are kept in a pool for new buses to reuse, so [`process`]
+/// never allocates however large the graph is. With the `parallel` feature
+/// enabled, the buses of each level render concurrently on the global
+/// [`rayon`] thread pool.
+/// 
+/// The peak and RMS level of every bus is measured after its effect chain
+/// each block. As the fader is a plain gain, post-fader levels are derived
+/// from these without measuring twice.
+/// 
+/// # Example
+/// 
+/// ```
+/// use std::sync::Arc;
+/// use bae_rs::{*, channels::*, generators::*, modifiers::*, sounds::*, tools::*};
+/// 
+/// let mut mixer = Mixer::<Stereo>::new();
+/// let music = mixer.add_bus();
+/// let reverb = mixer.add_bus();
+/// mixer.add_effect(reverb, Echo::new(std::time::Duration::from_millis(120), 0.4));
+/// mixer.add_send(music, reverb, 0.3, TapPoint::PostFader);
+/// 
+/// let mut channel = StandardChannel::<Stereo>::new(1.0);
+/// channel.add_sound(Box::new(SimpleSound::new(1.0, 1.0,
+///     Arc::new(StandardBlock::from_generator(Sine::new(440.0)))
+/// )));
+/// mixer.add_channel(music, Box::new(channel));
+/// 
+/// mixer.process();
+/// let peak = mixer.get_level(mixer.master(), 0, TapPoint::PostFader).unwrap().peak;
+/// ```
+/// 
+/// [`Channel`]: ../../channels/trait.Channel.html
+/// [`master`]: struct.Mixer.html#method.master
+/// [`PlanarBuffer`]: ../../sample_format/planar/struct.PlanarBuffer.html
+/// [`process`]: struct.Mixer.html#method.process
+/// [`rayon`]: https://docs.rs/rayon
+pub struct Mixer<SF>
+    where SF: SampleFormat
+{
+    strips: Vec<Strip<SF>>,
+    outputs: Vec<Output>,
+    ranks: Vec<Option<usize>>,
+    levels: Vec<Range<usize>>,
+    pool: Vec<PlanarBuffer>,
+    mix: PlanarBuffer,
+    output: Vec<SF>,
+    time: Duration,
+    context: Context,
+}
+
+impl<SF> Mixer<SF>
+    where SF: SampleFormat
+{
+    /// Creates a new mixer with only a master bus.
+    /// 
+    /// The internal track is initialized for 10ms' worth of samples. Call
+    /// [`set_process_time`] to change this.
+    /// 
+    /// [`set_process_time`]: struct.Mixer.html#method.set_process_time
+    pub fn new() -> Self {
+        Self::with_context(Context::default())
+    }
+
+    /// Creates a new mixer with only a master bus, running in the given
+    /// [`Context`]. The internal track is initialized for blocks of its
+    /// maximum size, and the context is applied to every channel and effect
+    /// added to the mixer.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn with_context(context: Context) -> Self {
+        let time = context.block_time();
+        let len = context.max_block();
+
+        let mut output = Vec::with_capacity(len);
+        output.resize_with(len, SF::default);
+
+        let mut mixer = Mixer {
+            strips: Vec::new(),
+            outputs: Vec::new(),
+            ranks: Vec::new(),
+            levels: Vec::new(),
+            pool: Vec::new(),
+            mix: PlanarBuffer::new(SF::num_samples(), len),
+            output,
+            time,
+            context,
+        };
+        mixer.push_bus(None);
+
+        mixer
+    }
+
+    /// Returns the master bus, which every other bus feeds into.
+    pub fn master(&self) -> BusId {
+        BusId(0)
+    }
+
+    /// Returns the number of buses, including the master bus.
+    pub fn bus_count(&self) -> usize {
+        self.strips.len()
+    }
+
+    /// Adds a new bus with no channels or effects and unity gain, routed to
+    /// the master bus.
+    pub fn add_bus(&mut self) -> BusId {
+        let id = self.push_bus(Some(self.master()));
+        self.sort();
+
+        id
+    }
+
+    /// Removes the given bus with its channels and effects. Buses routed to it
+    /// are routed to the master bus instead, and sends to it are removed.
+    /// Returns false if the bus doesn't exist or is the master bus.
+    pub fn remove_bus(&mut self, bus: BusId) -> bool {
+        let r = match self.rank(bus) {
+            Some(r) if bus != self.master() => r,
+            _ => return false,
+        };
+
+        self.strips.remove(r);
+        let output = self.outputs.remove(r);
+        self.pool.push(output.buffer);
+        self.ranks[bus.0] = None;
+        for k in self.ranks.iter_mut().flatten() {
+            if *k > r {
+                *k -= 1;
+            }
+        }
+
+        let master = self.master();
+        for o in &mut self.outputs {
+            if o.route == Some(bus) {
+                o.route = Some(master);
+            }
+            o.sends.retain(|s| s.to != bus);
+        }
+
+        self.sort();
+
+        true
+    }
+
+    /// Routes the output of a bus to another bus. Returns false, leaving the
+    /// routing unchanged, if either bus doesn't exist, `from` is the master
+    /// bus, or the route would create a feedback loop.
+    pub fn set_output(&mut self, from: BusId, to: BusId) -> bool {
+        let r = match (self.rank(from), self.rank(to)) {
+            (Some(r), Some(_)) if from != self.master() => r,
+            _ => return false,
+        };
+
+        let old = self.outputs[r].route.replace(to);
+        if self.sort() {
+            true
+        } else {
+            self.outputs[r].route = old;
+            false
+        }
+    }
+
+    /// Returns the bus the given bus outputs to, or `None` for the master bus
+    /// and buses that don't exist.
+    pub fn get_output_bus(&self, bus: BusId) -> Option<BusId> {
+        self.outputs[self.rank(bus)?].route
+    }
+
+    /// Sends the signal of `from` at the given tap to `to` with the given gain,
+    /// replacing any previous send between them. Returns false, leaving the
+    /// routing unchanged, if either bus doesn't exist, `from` is the master
+    /// bus, or the send would create a feedback loop.
+    pub fn add_send(&mut self, from: BusId, to: BusId, gain: MathT, tap: TapPoint) -> bool {
+        let r = match (self.rank(from), self.rank(to)) {
+            (Some(r), Some(_)) if from != self.master() => r,
+            _ => return false,
+        };
+
+        let send = AuxSend {
+            to,
+            gain: gain as SampleT,
+            tap,
+        };
+
+        let sends = &mut self.outputs[r].sends;
+        let old = match sends.iter().position(|s| s.to == to) {
+            Some(k) => Some(std::mem::replace(&mut sends[k], send)),
+            None => {
+                sends.push(send);
+                None
+            },
+        };
+
+        if self.sort() {
+            return true;
+        }
+
+        let sends = &mut self.outputs[r].sends;
+        match old {
+            Some(old) => *sends.iter_mut().find(|s| s.to == to).unwrap() = old,
+            None => { sends.pop(); },
+        }
+
+        false
+    }
+
+    /// Sets the gain of the send from `from` to `to`. Returns false if there
+    /// is no such send.
+    pub fn set_send_gain(&mut self, from: BusId, to: BusId, gain: MathT) -> bool {
+        let r = match self.rank(from) {
+            Some(r) => r,
+            None => return false,
+        };
+
+        match self.outputs[r].sends.iter_mut().find(|s| s.to == to) {
+            Some(s) => {
+                s.gain = gain as SampleT;
+                true
+            },
+            None => false,
+        }
+    }
+
+    /// Removes the send from `from` to `to`. Returns false if there is no such
+    /// send.
+    pub fn remove_send(&mut self, from: BusId, to: BusId) -> bool {
+        let r = match self.rank(from) {
+            Some(r) => r,
+            None => return false,
+        };
+
+        let sends = &mut self.outputs[r].sends;
+        let len = sends.len();
+        sends.retain(|s| s.to != to);
+
+        if sends.len() != len {
+            self.sort();
+            true
+        } else {
+            false
+        }
+    }
+
+    /// Sets the gain of the fader of the given bus. Returns false if the bus
+    /// doesn't exist.
+    pub fn set_bus_gain(&mut self, bus: BusId, gain: MathT) -> bool {
+        match self.rank(bus) {
+            Some(r) => {
+                self.outputs[r].gain = gain as SampleT;
+                true
+            },
+            None => false,
+        }
+    }
+
+    /// Returns the gain of the fader of the given bus, or `None` if the bus
+    /// doesn't exist.
+    pub fn get_bus_gain(&self, bus: BusId) -> Option<MathT> {
+        Some(self.outputs[self.rank(bus)?].gain as MathT)
+    }
+
+    /// Appends an effect to the chain of the given bus. Each channel of the
+    /// [`SampleFormat`] is filtered by its own clone of `effect`. Returns false
+    /// if the bus doesn't exist.
+    /// 
+    /// [`SampleFormat`]: ../../sample_format/trait.SampleFormat.html
+    pub fn add_effect<M>(&mut self, bus: BusId, mut effect: M) -> bool
+        where M: Modifier + Clone + 'static
+    {
+        let r = match self.rank(bus) {
+            Some(r) => r,
+            None => return false,
+        };
+
+        effect.set_context(&self.context);
+
+        let effects = &mut self.strips[r].effects;
+        for _ in 1..SF::num_samples() {
+            effects.push(Box::new(effect.clone()));
+        }
+        effects.push(Box::new(effect));
+
+        true
+    }
+
+    /// Returns the number of effects in the chain of the given bus, or `None`
+    /// if the bus doesn't exist.
+    pub fn effect_count(&self, bus: BusId) -> Option<usize> {
+        Some(self.strips[self.rank(bus)?].effects.len() / SF::num_samples())
+    }
+
+    /// Removes every effect from the chain of the given bus. Returns false if
+    /// the bus doesn't exist.
+    pub fn clear_effects(&mut self, bus: BusId) -> bool {
+        match self.rank(bus) {
+            Some(r) => {
+                self.strips[r].effects.clear();
+                true
+            },
+            None => false,
+        }
+    }
+
+    /// Adds a channel to the given bus, setting its context and process time
+    /// to those of the mixer, and returns its index within the bus or `None`
+    /// if the bus doesn't exist.
+    pub fn add_channel(&mut self, bus: BusId, mut channel: ChannelSP<SF>) -> Option<usize> {
+        let r = self.rank(bus)?;
+
+        channel.set_context(&self.context);
+        channel.set_process_time(self.time);
+
+        let channels = &mut self.strips[r].channels;
+        channels.push(channel);
+
+        Some(channels.len() - 1)
+    }
+
+    /// Removes the channel at the given index of the given bus, shifting the
+    /// channels after it down, and returns it.
+    pub fn remove_channel(&mut self, bus: BusId, index: usize) -> Option<ChannelSP<SF>> {
+        let r = self.rank(bus)?;
+        let channels = &mut self.strips[r].channels;
+
+        if index < channels.len() {
+            Some(channels.remove(index))
+        } else {
+            None
+        }
+    }
+
+    /// Returns the channels of the given bus, or `None` if the bus doesn't
+    /// exist.
+    pub fn get_channels(&self, bus: BusId) -> Option<&[ChannelSP<SF>]> {
+        Some(&self.strips[self.rank(bus)?].channels)
+    }
+
+    /// Returns a mutable reference to the channel at the given index of the
+    /// given bus.
+    pub fn get_channel_mut(&mut self, bus: BusId, index: usize) -> Option<&mut ChannelSP<SF>> {
+        let r = self.rank(bus)?;
+        self.strips[r].channels.get_mut(index)
+    }
+
+    /// Returns the level of the given channel of the given bus over the last
+    /// block, at the given tap, or `None` if there is no such bus or channel.
+    pub fn get_level(&self, bus: BusId, channel: usize, tap: TapPoint) -> Option<Level> {
+        let o = &self.outputs[self.rank(bus)?];
+        let l = *o.levels.get(channel)?;
+
+        Some(match tap {
+            TapPoint::PreFader => l,
+            TapPoint::PostFader => Level {
+                peak: l.peak * o.gain.abs(),
+                rms: l.rms * o.gain.abs(),
+            },
+        })
+    }
+
+    /// Sets the amount of time [`process`] should calculate samples for, for
+    /// the mixer and all of its channels. The given duration is truncated to
+    /// an integer sample value.
+    /// 
+    /// [`process`]: struct.Mixer.html#method.process
+    pub fn set_process_time(&mut self, d: Duration) {
+        self.time = d;
+        self.set_length((d.as_secs_f64() * self.context.sample_rate()) as usize);
+
+        for s in &mut self.strips {
+            for c in &mut s.channels {
+                c.set_process_time(d);
+            }
+        }
+    }
+
+    /// Returns the [`Context`] the mixer runs in.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn get_context(&self) -> &Context {
+        &self.context
+    }
+
+    /// Applies the given [`Context`] to the mixer and all of its channels and
+    /// effects, and sets the process time to its maximum block size.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn set_context(&mut self, ctx: &Context) {
+        self.context = *ctx;
+        self.time = ctx.block_time();
+        self.set_length(ctx.max_block());
+
+        for s in &mut self.strips {
+            for c in &mut s.channels {
+                c.set_context(ctx);
+            }
+            for e in &mut s.effects {
+                e.set_context(ctx);
+            }
+        }
+    }
+
+    /// Returns the output of the master bus from the last call to
+    /// [`process`], after its fader.
+    /// 
+    /// [`process`]: struct.Mixer.html#method.process
+    pub fn get_output(&self) -> &Vec<SF> {
+        &self.output
+    }
+
+    /// Returns the output of the master bus from the last call to
+    /// [`process`], after its fader, in planar layout.
+    /// 
+    /// [`process`]: struct.Mixer.html#method.process
+    pub fn get_planar_output(&self) -> &PlanarBuffer {
+        &self.mix
     }
 
-    pub fn modifier_list_mut(&mut self) -> &mut Vec<BlockSP> {
-        &mut self.modifier_list
+    /// Processes a block of every bus, storing the output of the master bus
+    /// in the internal track of samples.
+    pub fn process(&mut self) {
+        for level in &self.levels {
+            let (done, cur) = self.outputs.split_at_mut(level.start);
+            let outputs = &mut cur[..level.len()];
+            let strips = &mut self.strips[level.clone()];
+            let done = &*done;
+
+            #[cfg(not(feature = "parallel"))]
+            for (s, o) in strips.iter_mut().zip(outputs.iter_mut()) {
+                s.render(o, done);
+            }
+
+            #[cfg(feature = "parallel")]
+            strips.par_iter_mut()
+                .zip(outputs.par_iter_mut())
+                .for_each(|(s, o)| s.render(o, done));
+        }
+
+        let master = &self.outputs[self.ranks[0].unwrap()];
+        self.mix.clear();
+        for (d, s) in self.mix.iter_mut().zip(master.buffer.iter()) {
+            simd::mix(d, s, master.gain);
+        }
+
+        SF::from_planar(&self.mix, &mut self.output);
+    }
+
+    /// Resizes the internal track and every bus buffer to `len` samples.
+    fn set_length(&mut self, len: usize) {
+        self.output.clear();
+        self.output.resize_with(len, SF::default);
+        self.mix.resize(SF::num_samples(), len);
+
+        for o in &mut self.outputs {
+            o.buffer.resize(SF::num_samples(), len);
+        }
+        for b in &mut self.pool {
+            b.resize(SF::num_samples(), len);
+        }
+    }
+
+    fn rank(&self, bus: BusId) -> Option<usize> {
+        *self.ranks.get(bus.0)?
+    }
+
+    fn push_bus(&mut self, route: Option<BusId>) -> BusId {
+        let id = BusId(self.ranks.len());
+
+        let mut buffer = self.pool.pop().unwrap_or_default();
+        buffer.resize(SF::num_samples(), self.output.len());
+
+        self.ranks.push(Some(self.strips.len()));
+        self.strips.push(Strip {
+            id,
+            channels: Vec::new(),
+            effects: Vec::new(),
+            inputs: Vec::new(),
+        });
+        self.outputs.push(Output {
+            buffer,
+            gain: 1.0,
+            route,
+            sends: Vec::new(),
+            levels: vec![Level::default(); SF::num_samples()],
+        });
+
+        id
+    }
+
+    /// Reorders the buses by dependency level and rebuilds their inputs.
+    /// Returns false, leaving the order unchanged, if the routing contains a
+    /// feedback loop.
+    fn sort(&mut self) -> bool {
+        let mut edges = Vec::new();
+        for (s, o) in self.strips.iter().zip(&self.outputs) {
+            for to in o.route.iter().chain(o.sends.iter().map(|s| &s.to)) {
+                edges.push((s.id.0, to.0));
+            }
+        }
+
+        let levels: Vec<Vec<usize>> = topo::topological_levels(self.ranks.len(), &edges)
+            .into_iter()
+            .map(|l| l.into_iter().filter(|b| self.ranks[*b].is_some()).collect::<Vec<_>>())
+            .filter(|l| !l.is_empty())
+            .collect();
+
+        let mut depth = vec![0; self.ranks.len()];
+        for (d, l) in levels.iter().enumerate() {
+            for &b in l {
+                depth[b] = d;
+            }
+        }
+        if edges.iter().any(|&(from, to)| from == to || depth[from] >= depth[to]) {
+            return false;
+        }
+
+        let mut strips: Vec<Option<Strip<SF>>> = self.strips.drain(..).map(Some).collect();
+        let mut outputs: Vec<Option<Output>> = self.outputs.drain(..).map(Some).collect();
+        let mut ranks = vec![None; self.ranks.len()];
+        self.levels.clear();
+
+        for l in &levels {
+            let start = self.strips.len();
+            for &b in l {
+                let r = self.ranks[b].unwrap();
+                ranks[b] = Some(self.strips.len());
+                self.strips.push(strips[r].take().unwrap());
+                self.outputs.push(outputs[r].take().unwrap());
+            }
+            self.levels.push(start..self.strips.len());
+        }
+        self.ranks = ranks;
+
+        for s in &mut self.strips {
+            s.inputs.clear();
+        }
+        for (from, o) in self.outputs.iter().enumerate() {
+            if let Some(to) = o.route {
+                let r = self.ranks[to.0].unwrap();
+                self.strips[r].inputs.push(Input { from, send: None });
+            }
+            for (k, s) in o.sends.iter().enumerate() {
+                let r = self.ranks[s.to.0].unwrap();
+                self.strips[r].inputs.push(Input { from, send: Some(k) });
+            }
+        }
+
+        true
     }
+}
 
-    pub fn channel_list(&self) -> &VecDeque<ChannelSP> {
-        &self.channel_list
+impl<SF> Default for Mixer<SF>
+    where SF: SampleFormat
+{
+    fn default() -> Self {
+        Mixer::new()
     }
+}
+
+impl<SF> Strip<SF>
+    where SF: SampleFormat
+{
+    /// Renders a block of the bus into its output, reading its inputs from the
+    /// outputs of the buses rendered before it.
+    fn render(&mut self, out: &mut Output, done: &[Output]) {
+        let _guard = DenormalGuard::new();
+        let buffer = &mut out.buffer;
+        buffer.clear();
+
+        for c in &mut self.channels {
+            c.process();
+            c.mix_output(buffer);
+        }
+
+        for i in &self.inputs {
+            let src = &done[i.from];
+            let g = match i.send {
+                None => src.gain,
+                Some(k) => {
+                    let s = &src.sends[k];
+                    match s.tap {
+                        TapPoint::PreFader => s.gain,
+                        TapPoint::PostFader => s.gain * src.gain,
+                    }
+                },
+            };
+
+            for (d, s) in buffer.iter_mut().zip(src.buffer.iter()) {
+                simd::mix(d, s, g);
+            }
+        }
+
+        let n = buffer.channels().max(1);
+        for (k, e) in self.effects.iter_mut().enumerate() {
+            e.process_block(buffer.channel_mut(k % n));
+        }
+
+        for (l, ch) in out.levels.iter_mut().zip(buffer.iter()) {
+            let (mut peak, mut sum) = (0.0 as SampleT, 0.0 as SampleT);
+            for x in ch {
+                peak = peak.max(x.abs());
+                sum += x * x;
+            }
 
-    pub fn channel_list_mut(&mut self) -> &mut VecDeque<ChannelSP> {
-        &mut self.channel_list
+            l.peak = peak;
+            l.rms = (sum / ch.len().max(1) as SampleT).sqrt();
+        }
     }
 }
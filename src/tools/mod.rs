@@ -1,7 +1,14 @@
 //! # Tools
+//! 
+//! Module including the higher level systems built from channels, such as
+//! the [`Mixer`].
+//! 
+//! [`Mixer`]: mixer/struct.Mixer.html
 
 use super::*;
 
 pub mod mixer;
+pub mod offline;
 
 pub use mixer::*;
+pub use offline::*;
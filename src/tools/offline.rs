@@ -0,0 +1,273 @@
+//! # Offline
+//! 
+//! Rendering of channels and mixers straight to WAV files, faster than real
+//! time.
+
+use super::*;
+
+use crate::channels::{Channel, StandardChannel, VoicePool};
+use crate::sample_format::{Dither, PlanarBuffer};
+use crate::utils::wav_writer::WavWriter;
+use std::io::Write;
+use std::sync::mpsc;
+
+/// Default number of frames in each chunk handed from the render thread to
+/// the writer thread of an [`OfflineRenderer`].
+/// 
+/// [`OfflineRenderer`]: struct.OfflineRenderer.html
+pub const OFFLINE_CHUNK_FRAMES: usize = 16_384;
+
+/// Default number of chunks an [`OfflineRenderer`] lets the render thread get
+/// ahead of the writer thread.
+/// 
+/// [`OfflineRenderer`]: struct.OfflineRenderer.html
+pub const OFFLINE_QUEUE_DEPTH: usize = 4;
+
+/// Source of the audio rendered by an [`OfflineRenderer`].
+/// 
+/// [`OfflineRenderer`]: struct.OfflineRenderer.html
+pub trait OfflineSource {
+    /// Returns the [`Context`] the source renders in.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    fn context(&self) -> Context;
+
+    /// Returns the number of channels of the rendered blocks.
+    fn channels(&self) -> usize;
+
+    /// Renders the next block, returning it in planar layout.
+    fn render_block(&mut self) -> &PlanarBuffer;
+}
+
+impl<SF> OfflineSource for Mixer<SF>
+    where SF: SampleFormat
+{
+    fn context(&self) -> Context {
+        *self.get_context()
+    }
+
+    fn channels(&self) -> usize {
+        SF::num_samples()
+    }
+
+    fn render_block(&mut self) -> &PlanarBuffer {
+        self.process();
+        self.get_planar_output()
+    }
+}
+
+impl<SF> OfflineSource for StandardChannel<SF>
+    where SF: SampleFormat
+{
+    fn context(&self) -> Context {
+        *self.get_context()
+    }
+
+    fn channels(&self) -> usize {
+        SF::num_samples()
+    }
+
+    fn render_block(&mut self) -> &PlanarBuffer {
+        self.process();
+        self.get_planar_output()
+    }
+}
+
+impl<SF> OfflineSource for VoicePool<SF>
+    where SF: SampleFormat
+{
+    fn context(&self) -> Context {
+        *self.get_channel().get_context()
+    }
+
+    fn channels(&self) -> usize {
+        SF::num_samples()
+    }
+
+    fn render_block(&mut self) -> &PlanarBuffer {
+        self.process();
+        self.get_channel().get_planar_output()
+    }
+}
+
+/// Renderer of an [`OfflineSource`], such as a [`Mixer`] or a
+/// [`StandardChannel`], to a WAV file.
+/// 
+/// Rendering and writing are pipelined: the calling thread renders blocks
+/// as fast as it can and copies them into chunks of [`OFFLINE_CHUNK_FRAMES`]
+/// frames, which are converted and written by a [`WavWriter`] on a second
+/// thread. The threads exchange chunks through a bounded queue, so at most
+/// [`OFFLINE_QUEUE_DEPTH`] chunks are ever waiting to be written, and the
+/// written chunks are sent back to be filled again. Memory use is set by the
+/// chunk size and queue depth alone, not by the length of the file, and the
+/// chunks are kept by the renderer between calls, so baking many files in a
+/// row allocates only the writer thread's conversion buffers.
+/// 
+/// # Example
+/// 
+/// ```
+/// use std::io::Cursor;
+/// use std::sync::Arc;
+/// use bae_rs::{*, channels::*, generators::*, sounds::*, tools::*};
+/// 
+/// let mut channel = StandardChannel::<Stereo>::new(1.0);
+/// channel.add_sound(Box::new(SimpleSound::new(1.0, 1.0,
+///     Arc::new(StandardBlock::from_generator(Sine::new(440.0)))
+/// )));
+/// 
+/// let mut renderer = OfflineRenderer::new(16, true);
+/// let file = renderer.render(&mut channel, SAMPLE_RATE, Cursor::new(Vec::new())).unwrap();
+/// assert_eq!(file.into_inner().len(), 44 + 48_000 * 4);
+/// ```
+/// 
+/// [`OfflineSource`]: trait.OfflineSource.html
+/// [`Mixer`]: ../mixer/struct.Mixer.html
+/// [`StandardChannel`]: ../../channels/standard_channel/struct.StandardChannel.html
+/// [`OFFLINE_CHUNK_FRAMES`]: constant.OFFLINE_CHUNK_FRAMES.html
+/// [`WavWriter`]: ../../utils/wav_writer/struct.WavWriter.html
+/// [`OFFLINE_QUEUE_DEPTH`]: constant.OFFLINE_QUEUE_DEPTH.html
+pub struct OfflineRenderer {
+    bps: u16,
+    clip: bool,
+    dither: Option<Dither>,
+    chunk_frames: usize,
+    queue_depth: usize,
+    pool: Vec<PlanarBuffer>,
+    pending: PlanarBuffer,
+}
+
+impl OfflineRenderer {
+    /// Creates a new renderer writing files of the given bits per sample,
+    /// which should be 8, 16, or 24, optionally clipping the samples to
+    /// [-1,1].
+    pub fn new(bps: u16, clip: bool) -> Self {
+        OfflineRenderer {
+            bps,
+            clip,
+            dither: None,
+            chunk_frames: OFFLINE_CHUNK_FRAMES,
+            queue_depth: OFFLINE_QUEUE_DEPTH,
+            pool: Vec::new(),
+            pending: PlanarBuffer::new(0, 0),
+        }
+    }
+
+    /// Sets the number of frames in each chunk handed to the writer thread.
+    pub fn set_chunk_frames(&mut self, frames: usize) {
+        self.chunk_frames = frames.max(1);
+    }
+
+    /// Sets the number of chunks the render thread can get ahead of the
+    /// writer thread.
+    pub fn set_queue_depth(&mut self, depth: usize) {
+        self.queue_depth = depth.max(1);
+    }
+
+    /// Sets the dither added to samples written to 16-bit files, or disables
+    /// dither if `None`, the default.
+    pub fn set_dither(&mut self, dither: Option<Dither>) {
+        self.dither = dither;
+    }
+
+    /// Renders `frames` frames of the given source into a WAV file written to
+    /// `dest`, at the sample rate of the source's [`Context`], and returns the
+    /// destination.
+    /// 
+    /// The source is rendered a whole block at a time, so it is left having
+    /// rendered up to the end of the block containing the last frame. Sources
+    /// are usually set up to render blocks of their context's maximum size,
+    /// as larger blocks render faster.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails under the conditions of [`WavWriter::with_frames`]
+    /// and [`WavWriter::write`], in which case rendering stops early.
+    /// 
+    /// # Panics
+    /// 
+    /// Panics if the source renders an empty block or a block of a different
+    /// number of channels than it declares.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    /// [`WavWriter::with_frames`]: ../../utils/wav_writer/struct.WavWriter.html#method.with_frames
+    /// [`WavWriter::write`]: ../../utils/wav_writer/struct.WavWriter.html#method.write
+    pub fn render<S, W>(&mut self, source: &mut S, frames: u64, dest: W) -> std::io::Result<W>
+        where S: OfflineSource + ?Sized,
+              W: Write + Send
+    {
+        let channels = source.channels();
+        let rate = source.context().sample_rate().round() as u32;
+        let (bps, clip, dither, chunk_frames) = (self.bps, self.clip, self.dither, self.chunk_frames);
+
+        let (full_tx, full_rx) = mpsc::sync_channel::<PlanarBuffer>(self.queue_depth);
+        let (free_tx, free_rx) = mpsc::channel();
+
+        self.pool.resize_with(self.queue_depth + 1, || PlanarBuffer::new(0, 0));
+        for mut b in self.pool.drain(..) {
+            b.resize(channels, chunk_frames);
+            let _ = free_tx.send(b);
+        }
+        self.pending.resize(channels, 0);
+        let mut pos = 0;
+
+        let result = std::thread::scope(|scope| {
+            let writer = scope.spawn(move || {
+                let mut w = WavWriter::with_frames(dest, channels as u16, rate, bps, frames)?;
+                w.set_dither(dither);
+
+                for chunk in full_rx {
+                    w.write_planar(&chunk, clip)?;
+                    let _ = free_tx.send(chunk);
+                }
+
+                w.finish()
+            });
+
+            let mut left = frames;
+            while left > 0 {
+                let mut chunk = match free_rx.recv() {
+                    Ok(c) => c,
+                    Err(_) => break,
+                };
+                let n = left.min(chunk_frames as u64) as usize;
+                chunk.resize(channels, n);
+
+                let mut filled = 0;
+                while filled < n {
+                    if pos == self.pending.frames() {
+                        let block = source.render_block();
+                        assert!(block.frames() > 0 && block.channels() == channels, "Source rendered an invalid block");
+
+                        self.pending.resize(channels, block.frames());
+                        for c in 0..channels {
+                            self.pending.channel_mut(c).copy_from_slice(block.channel(c));
+                        }
+                        pos = 0;
+                    }
+
+                    let k = (n - filled).min(self.pending.frames() - pos);
+                    for c in 0..channels {
+                        chunk.channel_mut(c)[filled..filled + k].copy_from_slice(&self.pending.channel(c)[pos..pos + k]);
+                    }
+                    filled += k;
+                    pos += k;
+                }
+
+                if full_tx.send(chunk).is_err() {
+                    break;
+                }
+                left -= n as u64;
+            }
+            drop(full_tx);
+
+            match writer.join() {
+                Ok(r) => r,
+                Err(e) => std::panic::resume_unwind(e),
+            }
+        });
+
+        self.pool.extend(free_rx.try_iter());
+
+        result
+    }
+}
@@ -0,0 +1,304 @@
+//! # Asset Cache
+//! 
+//! Shared, immutable sample buffers, and a cache of them with a memory budget.
+//! Voices playing the same sound hold handles to one buffer instead of each
+//! owning a copy, so spawning a voice never copies or allocates sample data.
+
+use super::*;
+use std::collections::HashMap;
+use std::path::{Path, PathBuf};
+use std::sync::Arc;
+
+/// Immutable buffer of monophonic samples along with the sample rate they were
+/// recorded at.
+/// 
+/// Cloning a buffer only increments a reference count.
+#[derive(Clone)]
+pub struct SampleBuffer {
+    samples: Arc<[SampleT]>,
+    sampling_rate: MathT,
+}
+
+impl SampleBuffer {
+    /// Creates a new buffer from the given samples.
+    pub fn new<S: Into<Arc<[SampleT]>>>(samples: S, sampling_rate: MathT) -> Self {
+        SampleBuffer {
+            samples: samples.into(),
+            sampling_rate,
+        }
+    }
+
+    /// Decodes the first channel of the WAV data read from `s` into a new
+    /// buffer.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if:
+    /// * Anything that [`read_wav`] specifies.
+    /// * The file contains no audio data.
+    /// 
+    /// [`read_wav`]: ../fn.read_wav.html
+    pub fn from_wav(s: &mut dyn std::io::Read) -> std::io::Result<Self> {
+        use std::io::{Error, ErrorKind};
+
+        let (h, t) = read_wav(s)?;
+        let t = t.into_iter().next()
+            .ok_or_else(|| Error::new(ErrorKind::Other, "No audio data read, aborting."))?;
+
+        Ok(SampleBuffer::new(t, h.sampling_rate as MathT))
+    }
+
+    /// Returns the samples of the buffer.
+    pub fn samples(&self) -> &Arc<[SampleT]> {
+        &self.samples
+    }
+
+    /// Returns the sample rate the buffer was recorded at.
+    pub fn sampling_rate(&self) -> MathT {
+        self.sampling_rate
+    }
+
+    /// Returns the number of samples in the buffer.
+    pub fn len(&self) -> usize {
+        self.samples.len()
+    }
+
+    /// Returns true if the buffer holds no samples.
+    pub fn is_empty(&self) -> bool {
+        self.samples.is_empty()
+    }
+
+    /// Returns the size of the sample data in bytes.
+    pub fn bytes(&self) -> usize {
+        self.samples.len() * std::mem::size_of::<SampleT>()
+    }
+
+    /// Returns true if both buffers share the same sample data.
+    pub fn ptr_eq(&self, other: &SampleBuffer) -> bool {
+        Arc::ptr_eq(&self.samples, &other.samples)
+    }
+}
+
+/// Key identifying an asset in an [`AssetCache`].
+/// 
+/// [`AssetCache`]: struct.AssetCache.html
+#[derive(Clone,Debug,PartialEq,Eq,Hash)]
+pub enum AssetKey {
+    /// An asset loaded from the file at the given path.
+    Path(PathBuf),
+    /// An asset identified by a hash of its contents, or any other
+    /// user-chosen id.
+    Hash(u64),
+}
+
+impl AssetKey {
+    /// Creates a key from a hash of the given bytes, such as the contents of
+    /// an embedded file.
+    pub fn of_bytes(b: &[u8]) -> Self {
+        use std::hash::{Hash, Hasher};
+
+        let mut h = std::collections::hash_map::DefaultHasher::new();
+        b.hash(&mut h);
+
+        AssetKey::Hash(h.finish())
+    }
+}
+
+impl From<&Path> for AssetKey {
+    fn from(p: &Path) -> Self {
+        AssetKey::Path(p.to_path_buf())
+    }
+}
+
+impl From<PathBuf> for AssetKey {
+    fn from(p: PathBuf) -> Self {
+        AssetKey::Path(p)
+    }
+}
+
+impl From<u64> for AssetKey {
+    fn from(h: u64) -> Self {
+        AssetKey::Hash(h)
+    }
+}
+
+/// Counters describing the use of an [`AssetCache`].
+/// 
+/// [`AssetCache`]: struct.AssetCache.html
+#[derive(Copy,Clone,Debug,Default,PartialEq,Eq)]
+pub struct CacheStats {
+    /// Number of lookups that found their asset.
+    pub hits: usize,
+    /// Number of lookups that didn't find their asset.
+    pub misses: usize,
+    /// Number of assets evicted to stay within the budget.
+    pub evictions: usize,
+    /// Total size of the evicted assets in bytes.
+    pub evicted_bytes: usize,
+    /// Number of assets currently cached.
+    pub entries: usize,
+    /// Total size of the cached assets in bytes.
+    pub resident_bytes: usize,
+}
+
+struct Entry {
+    buffer: SampleBuffer,
+    last_used: u64,
+}
+
+/// Cache of [`SampleBuffer`]s with a least recently used eviction policy.
+/// 
+/// The cache holds at most `budget` bytes of sample data. Evicting an asset
+/// only drops the cache's handle to it, so voices still playing it are
+/// unaffected, and its memory is freed once the last of them is dropped.
+/// 
+/// [`SampleBuffer`]: struct.SampleBuffer.html
+pub struct AssetCache {
+    entries: HashMap<AssetKey, Entry>,
+    budget: usize,
+    tick: u64,
+    stats: CacheStats,
+}
+
+impl AssetCache {
+    /// Creates a new, empty cache holding at most `budget` bytes of samples.
+    pub fn new(budget: usize) -> Self {
+        AssetCache {
+            entries: HashMap::new(),
+            budget,
+            tick: 0,
+            stats: CacheStats::default(),
+        }
+    }
+
+    /// Returns the maximum number of bytes of samples the cache holds.
+    pub fn budget(&self) -> usize {
+        self.budget
+    }
+
+    /// Sets the maximum number of bytes of samples the cache holds, evicting
+    /// assets as needed.
+    pub fn set_budget(&mut self, budget: usize) {
+        self.budget = budget;
+        self.evict_to(budget);
+    }
+
+    /// Returns the usage counters of the cache.
+    pub fn stats(&self) -> CacheStats {
+        self.stats
+    }
+
+    /// Returns the asset with the given key, marking it as recently used.
+    pub fn get(&mut self, key: &AssetKey) -> Option<SampleBuffer> {
+        self.tick += 1;
+
+        match self.entries.get_mut(key) {
+            Some(e) => {
+                e.last_used = self.tick;
+                self.stats.hits += 1;
+                Some(e.buffer.clone())
+            },
+            None => {
+                self.stats.misses += 1;
+                None
+            },
+        }
+    }
+
+    /// Returns true if the asset with the given key is cached. Doesn't count
+    /// as a use of the asset.
+    pub fn contains(&self, key: &AssetKey) -> bool {
+        self.entries.contains_key(key)
+    }
+
+    /// Caches the given asset, evicting the least recently used assets until
+    /// it fits, and returns it. An asset larger than the whole budget is
+    /// returned without being cached.
+    pub fn insert(&mut self, key: AssetKey, buffer: SampleBuffer) -> SampleBuffer {
+        self.remove(&key);
+
+        let bytes = buffer.bytes();
+        if bytes > self.budget {
+            return buffer;
+        }
+
+        self.evict_to(self.budget - bytes);
+
+        self.tick += 1;
+        self.stats.entries += 1;
+        self.stats.resident_bytes += bytes;
+        self.entries.insert(key, Entry {
+            buffer: buffer.clone(),
+            last_used: self.tick,
+        });
+
+        buffer
+    }
+
+    /// Returns the asset with the given key, creating and caching it with `f`
+    /// if it isn't cached.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if `f` fails.
+    pub fn get_or_insert_with<F>(&mut self, key: AssetKey, f: F) -> std::io::Result<SampleBuffer>
+        where F: FnOnce() -> std::io::Result<SampleBuffer>
+    {
+        if let Some(b) = self.get(&key) {
+            return Ok(b);
+        }
+
+        Ok(self.insert(key, f()?))
+    }
+
+    /// Returns the first channel of the WAV file at the given path, reading
+    /// and caching it if it isn't cached.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if the file can't be opened, or under any of the
+    /// conditions of [`SampleBuffer::from_wav`].
+    /// 
+    /// [`SampleBuffer::from_wav`]: struct.SampleBuffer.html#method.from_wav
+    pub fn load_wav<P: AsRef<Path>>(&mut self, path: P) -> std::io::Result<SampleBuffer> {
+        let path = path.as_ref();
+
+        self.get_or_insert_with(path.into(), || {
+            SampleBuffer::from_wav(&mut std::io::BufReader::new(std::fs::File::open(path)?))
+        })
+    }
+
+    /// Removes the asset with the given key from the cache, returning it. This
+    /// isn't counted as an eviction.
+    pub fn remove(&mut self, key: &AssetKey) -> Option<SampleBuffer> {
+        let e = self.entries.remove(key)?;
+
+        self.stats.entries -= 1;
+        self.stats.resident_bytes -= e.buffer.bytes();
+
+        Some(e.buffer)
+    }
+
+    /// Removes all assets from the cache.
+    pub fn clear(&mut self) {
+        self.entries.clear();
+        self.stats.entries = 0;
+        self.stats.resident_bytes = 0;
+    }
+
+    /// Evicts the least recently used assets until at most `bytes` bytes are
+    /// cached.
+    fn evict_to(&mut self, bytes: usize) {
+        while self.stats.resident_bytes > bytes {
+            let key = match self.entries.iter().min_by_key(|(_, e)| e.last_used) {
+                Some((k, _)) => k.clone(),
+                None => break,
+            };
+
+            if let Some(b) = self.remove(&key) {
+                self.stats.evictions += 1;
+                self.stats.evicted_bytes += b.bytes();
+            }
+        }
+    }
+}
@@ -0,0 +1,379 @@
+//! # Automation
+//! 
+//! Sample-accurate parameter ramps, and a wrapper applying them to generators
+//! and modifiers at control rate.
+
+use super::*;
+use crate::generators::{FreqMod, Generator};
+use crate::modifiers::Modifier;
+use std::time::Duration;
+
+/// Default number of samples between parameter updates made by an
+/// [`Automated`] object.
+/// 
+/// [`Automated`]: struct.Automated.html
+pub const CONTROL_INTERVAL: usize = 32;
+
+/// Shape of a [`Ramp`] between its start and target values.
+/// 
+/// [`Ramp`]: struct.Ramp.html
+#[derive(Copy,Clone,Debug,PartialEq,Eq)]
+pub enum Curve {
+    /// Changes the value by the same amount every sample.
+    Linear,
+    /// Changes the value by the same ratio every sample, which sounds even
+    /// for frequencies and gains. Ramps that start or end at 0, or cross it,
+    /// fall back to [`Linear`].
+    /// 
+    /// [`Linear`]: enum.Curve.html#variant.Linear
+    Exponential,
+}
+
+impl Default for Curve {
+    fn default() -> Self {
+        Curve::Linear
+    }
+}
+
+/// Value moving towards a target over a set number of samples.
+#[derive(Copy,Clone,Debug)]
+pub struct Ramp {
+    value: MathT,
+    target: MathT,
+    step: MathT,
+    remaining: usize,
+    curve: Curve,
+}
+
+impl Ramp {
+    /// Creates a new ramp resting at the given value.
+    pub fn new(value: MathT) -> Self {
+        Ramp {
+            value,
+            target: value,
+            step: 0.0,
+            remaining: 0,
+            curve: Curve::Linear,
+        }
+    }
+
+    /// Returns the current value.
+    pub fn value(&self) -> MathT {
+        self.value
+    }
+
+    /// Returns the value the ramp ends at.
+    pub fn target(&self) -> MathT {
+        self.target
+    }
+
+    /// Returns the number of samples until the target is reached.
+    pub fn remaining(&self) -> usize {
+        self.remaining
+    }
+
+    /// Returns true while the ramp hasn't reached its target.
+    pub fn is_active(&self) -> bool {
+        self.remaining > 0
+    }
+
+    /// Jumps to the given value, stopping any ramp in progress.
+    pub fn set(&mut self, value: MathT) {
+        *self = Ramp::new(value);
+    }
+
+    /// Starts a ramp from the current value to `target` over the given
+    /// duration, rounded to the nearest sample.
+    pub fn ramp_to(&mut self, target: MathT, d: Duration, curve: Curve) {
+        self.ramp_over(target, seconds_to_samples(d), curve);
+    }
+
+    /// Starts a ramp from the current value to `target` over the given number
+    /// of samples. A ramp over 0 samples jumps straight to the target.
+    pub fn ramp_over(&mut self, target: MathT, samples: usize, curve: Curve) {
+        if samples == 0 {
+            self.set(target);
+            return;
+        }
+
+        let curve = if curve == Curve::Exponential && self.value * target > 0.0 {
+            Curve::Exponential
+        } else {
+            Curve::Linear
+        };
+
+        self.step = match curve {
+            Curve::Linear => (target - self.value) / samples as MathT,
+            Curve::Exponential => (target / self.value).powf(1.0 / samples as MathT),
+        };
+        self.target = target;
+        self.remaining = samples;
+        self.curve = curve;
+    }
+
+    /// Advances the ramp by one sample, returning the new value.
+    #[inline]
+    pub fn next(&mut self) -> MathT {
+        if self.remaining > 1 {
+            self.remaining -= 1;
+            match self.curve {
+                Curve::Linear => self.value += self.step,
+                Curve::Exponential => self.value *= self.step,
+            }
+        } else {
+            self.remaining = 0;
+            self.value = self.target;
+        }
+
+        self.value
+    }
+
+    /// Advances the ramp by `n` samples at once, returning the new value.
+    pub fn advance(&mut self, n: usize) -> MathT {
+        if n >= self.remaining {
+            self.remaining = 0;
+            self.value = self.target;
+        } else {
+            self.remaining -= n;
+            match self.curve {
+                Curve::Linear => self.value += self.step * n as MathT,
+                Curve::Exponential => self.value *= self.step.powi(n as i32),
+            }
+        }
+
+        self.value
+    }
+
+    /// Writes the values of the next `out.len()` samples of the ramp to `out`.
+    /// Samples past the end of the ramp hold the target.
+    pub fn fill(&mut self, out: &mut [SampleT]) {
+        let n = self.remaining.min(out.len());
+
+        for y in &mut out[..n] {
+            *y = self.next() as SampleT;
+        }
+        for y in &mut out[n..] {
+            *y = self.value as SampleT;
+        }
+    }
+
+    /// Multiplies `inout` by the values of the next `inout.len()` samples of
+    /// the ramp, using it as a gain.
+    pub fn apply(&mut self, inout: &mut [SampleT]) {
+        let n = self.remaining.min(inout.len());
+
+        for x in &mut inout[..n] {
+            *x *= self.next() as SampleT;
+        }
+
+        let g = self.value as SampleT;
+        for x in &mut inout[n..] {
+            *x *= g;
+        }
+    }
+}
+
+/// Wrapper automating one parameter of a [`Generator`] or [`Modifier`] with a
+/// [`Ramp`].
+/// 
+/// Rather than setting the parameter every sample, which for filters means
+/// redesigning them every sample, the parameter is updated once every
+/// [`CONTROL_INTERVAL`] samples (or as set by [`set_interval`]) with the value
+/// the ramp reaches at the end of the interval, and the wrapped object is
+/// processed in between. Setters that interpolate over the next processed
+/// block, such as [`LowPass::glide_central_frequency`], then move smoothly
+/// between updates.
+/// 
+/// # Example
+/// 
+/// ```
+/// use std::time::Duration;
+/// use bae_rs::{*, generators::*, modifiers::*, utils::*};
+/// 
+/// let mut sweep = Automated::new(LowPass::new(200.0, 0.5), 200.0, LowPass::glide_central_frequency);
+/// sweep.ramp_to(4000.0, Duration::from_secs(1), Curve::Exponential);
+/// 
+/// let mut glide = Automated::frequency(Sine::new(220.0));
+/// glide.ramp_to(440.0, Duration::from_millis(50), Curve::Exponential);
+/// 
+/// let mut t = vec![0.0; 4800];
+/// glide.process_block(&mut t);
+/// sweep.process_block(&mut t);
+/// ```
+/// 
+/// [`Generator`]: ../../generators/trait.Generator.html
+/// [`Modifier`]: ../../modifiers/trait.Modifier.html
+/// [`Ramp`]: struct.Ramp.html
+/// [`CONTROL_INTERVAL`]: constant.CONTROL_INTERVAL.html
+/// [`set_interval`]: struct.Automated.html#method.set_interval
+/// [`LowPass::glide_central_frequency`]: ../../modifiers/lowpass/struct.LowPass.html#method.glide_central_frequency
+#[derive(Clone)]
+pub struct Automated<T> {
+    inner: T,
+    ramp: Ramp,
+    apply: fn(&mut T, MathT),
+    interval: usize,
+    phase: usize,
+}
+
+impl<T> Automated<T> {
+    /// Wraps the given object, whose parameter currently has the value
+    /// `value` and is set by `apply`.
+    pub fn new(inner: T, value: MathT, apply: fn(&mut T, MathT)) -> Self {
+        Automated {
+            inner,
+            ramp: Ramp::new(value),
+            apply,
+            interval: CONTROL_INTERVAL,
+            phase: 0,
+        }
+    }
+
+    /// Borrows the wrapped object.
+    pub fn get(&self) -> &T {
+        &self.inner
+    }
+
+    /// Mutably borrows the wrapped object.
+    pub fn get_mut(&mut self) -> &mut T {
+        &mut self.inner
+    }
+
+    /// Returns the ramp driving the parameter.
+    pub fn get_ramp(&self) -> &Ramp {
+        &self.ramp
+    }
+
+    /// Sets the number of samples between parameter updates, at least 1.
+    pub fn set_interval(&mut self, interval: usize) {
+        self.interval = interval.max(1);
+        self.phase = 0;
+    }
+
+    /// Returns the number of samples between parameter updates.
+    pub fn get_interval(&self) -> usize {
+        self.interval
+    }
+
+    /// Sets the parameter immediately, stopping any ramp in progress.
+    pub fn set(&mut self, value: MathT) {
+        self.ramp.set(value);
+        self.phase = 0;
+        (self.apply)(&mut self.inner, value);
+    }
+
+    /// Starts a ramp of the parameter from its current value to `target` over
+    /// the given duration.
+    pub fn ramp_to(&mut self, target: MathT, d: Duration, curve: Curve) {
+        self.ramp.ramp_to(target, d, curve);
+        self.phase = 0;
+    }
+
+    /// Runs `f` over consecutive ranges covering `0..len`, updating the
+    /// parameter at every control point in between.
+    fn run<F>(&mut self, len: usize, mut f: F)
+        where F: FnMut(&mut T, std::ops::Range<usize>)
+    {
+        let mut i = 0;
+
+        while i < len {
+            if !self.ramp.is_active() && self.phase == 0 {
+                f(&mut self.inner, i..len);
+                return;
+            }
+
+            if self.phase == 0 {
+                let v = self.ramp.advance(self.interval);
+                (self.apply)(&mut self.inner, v);
+            }
+
+            let n = (self.interval - self.phase).min(len - i);
+            f(&mut self.inner, i..i + n);
+
+            self.phase = (self.phase + n) % self.interval;
+            i += n;
+        }
+    }
+
+    /// Moves the ramp on by `n` samples and applies its value at once.
+    fn jump(&mut self, n: usize) {
+        if self.ramp.is_active() || self.phase != 0 {
+            let v = self.ramp.advance(n);
+            (self.apply)(&mut self.inner, v);
+            self.phase = 0;
+        }
+    }
+}
+
+impl<T> Automated<T>
+    where T: FreqMod
+{
+    /// Wraps the given object, automating its frequency through
+    /// [`FreqMod::set_frequency`].
+    /// 
+    /// [`FreqMod::set_frequency`]: ../../generators/trait.FreqMod.html#tymethod.set_frequency
+    pub fn frequency(inner: T) -> Self {
+        let f = inner.get_frequency();
+        Automated::new(inner, f, T::set_frequency)
+    }
+}
+
+impl<T> Generator for Automated<T>
+    where T: Generator
+{
+    fn process(&mut self) -> SampleT {
+        let mut y = 0.0;
+        self.process_block(std::slice::from_mut(&mut y));
+        y
+    }
+
+    fn process_block(&mut self, out: &mut [SampleT]) {
+        self.run(out.len(), |g, r| g.process_block(&mut out[r]));
+    }
+
+    fn reset(&mut self) {
+        self.inner.reset();
+    }
+
+    fn skip(&mut self, n: usize) {
+        self.jump(n);
+        self.inner.skip(n);
+    }
+
+    fn tail(&self) -> Option<usize> {
+        self.inner.tail()
+    }
+}
+
+impl<T> Modifier for Automated<T>
+    where T: Modifier
+{
+    fn process(&mut self, x: SampleT) -> SampleT {
+        let mut y = x;
+        self.process_block(std::slice::from_mut(&mut y));
+        y
+    }
+
+    fn process_block(&mut self, inout: &mut [SampleT]) {
+        self.run(inout.len(), |m, r| m.process_block(&mut inout[r]));
+    }
+
+    fn reset(&mut self) {
+        self.inner.reset();
+    }
+
+    fn skip(&mut self, n: usize) {
+        self.jump(n);
+        self.inner.skip(n);
+    }
+
+    fn tail(&self) -> Option<usize> {
+        self.inner.tail()
+    }
+
+    /// Returns true if the wrapped modifier is silent and no ramp is in
+    /// progress, since the ramp may bring it back.
+    fn is_silent(&self) -> bool {
+        !self.ramp.is_active() && self.phase == 0 && self.inner.is_silent()
+    }
+}
@@ -0,0 +1,154 @@
+//! # DelayLine
+//! 
+//! Ring buffer of past samples, with integer, interpolated, and block reads at
+//! any delay up to its length.
+
+use super::*;
+
+/// Number of samples past the maximum delay kept for interpolated reads.
+const TAP_MARGIN: usize = 3;
+
+/// Ring buffer holding the most recently written samples of a signal.
+/// 
+/// The length of the buffer is a power of two so positions wrap with a mask.
+/// All reads are relative to the most recently written sample, which is at a
+/// delay of 0. Reads past [`max_delay`] wrap around and return newer samples.
+/// 
+/// Any number of reads at different delays can be made from the same buffer,
+/// so several taps share one memory footprint.
+/// 
+/// [`max_delay`]: struct.DelayLine.html#method.max_delay
+pub struct DelayLine {
+    buffer: Vec<SampleT>,
+    mask: usize,
+    write: usize,
+}
+
+impl DelayLine {
+    /// Creates a new delay line of silence able to read at integer delays of
+    /// at least `max_delay` samples. All memory is allocated here.
+    pub fn new(max_delay: usize) -> Self {
+        let len = (max_delay + 1 + TAP_MARGIN).next_power_of_two();
+
+        DelayLine {
+            buffer: vec![SampleT::default(); len],
+            mask: len - 1,
+            write: 0,
+        }
+    }
+
+    /// Returns the largest delay that can be read with [`tap_cubic`], in
+    /// samples. Integer and linear reads can go up to two samples further.
+    /// 
+    /// [`tap_cubic`]: struct.DelayLine.html#method.tap_cubic
+    pub fn max_delay(&self) -> usize {
+        self.buffer.len() - 1 - TAP_MARGIN
+    }
+
+    /// Returns the number of samples held by the buffer.
+    pub fn len(&self) -> usize {
+        self.buffer.len()
+    }
+
+    /// Silences the buffer.
+    pub fn clear(&mut self) {
+        for x in &mut self.buffer {
+            *x = SampleT::default();
+        }
+    }
+
+    /// Writes the next sample.
+    pub fn write(&mut self, x: SampleT) {
+        self.write = (self.write + 1) & self.mask;
+        self.buffer[self.write] = x;
+    }
+
+    /// Writes the next samples, in order.
+    pub fn write_block(&mut self, x: &[SampleT]) {
+        // Only the last `len` samples can be kept.
+        let skip = x.len().saturating_sub(self.buffer.len());
+        let x = &x[skip..];
+        self.write = (self.write + skip) & self.mask;
+
+        let start = (self.write + 1) & self.mask;
+        let n = x.len().min(self.buffer.len() - start);
+
+        self.buffer[start..start + n].copy_from_slice(&x[..n]);
+        self.buffer[..x.len() - n].copy_from_slice(&x[n..]);
+        self.write = (self.write + x.len()) & self.mask;
+    }
+
+    /// Returns the sample written `d` samples before the most recent one.
+    #[inline]
+    pub fn tap(&self, d: usize) -> SampleT {
+        self.buffer[self.write.wrapping_sub(d) & self.mask]
+    }
+
+    /// Returns the signal at a fractional delay of `d` samples, linearly
+    /// interpolated between the neighbouring samples.
+    #[inline]
+    pub fn tap_linear(&self, d: SampleT) -> SampleT {
+        let d = d.max(0.0);
+        let i = d as usize;
+        let t = d - i as SampleT;
+
+        let x0 = self.tap(i);
+        let x1 = self.tap(i + 1);
+
+        x0 + t * (x1 - x0)
+    }
+
+    /// Returns the signal at a fractional delay of `d` samples, interpolated
+    /// with a cubic Hermite (Catmull-Rom) spline through the four neighbouring
+    /// samples.
+    /// 
+    /// At delays under one sample the newest sample is held in place of the
+    /// one that hasn't been written yet.
+    #[inline]
+    pub fn tap_cubic(&self, d: SampleT) -> SampleT {
+        let d = d.max(0.0);
+        let i = d as usize;
+        let t = d - i as SampleT;
+
+        let xm1 = self.tap(i.saturating_sub(1));
+        let x0 = self.tap(i);
+        let x1 = self.tap(i + 1);
+        let x2 = self.tap(i + 2);
+
+        let c1 = 0.5 * (x1 - xm1);
+        let c2 = xm1 - 2.5 * x0 + 2.0 * x1 - 0.5 * x2;
+        let c3 = 0.5 * (x2 - xm1) + 1.5 * (x0 - x1);
+
+        ((c3 * t + c2) * t + c1) * t + x0
+    }
+
+    /// Reads the samples `d` samples before each of the last `out.len()`
+    /// written samples, oldest first, so `out[i]` is the sample at a delay of
+    /// `d + out.len() - 1 - i`.
+    /// 
+    /// Reading right after [`write_block`] with the same length delays the
+    /// block by `d` samples. Reading a block of `n` samples with `d` set to
+    /// `delay - n` before writing returns the delayed samples for the next `n`
+    /// writes, for recursive uses like feedback.
+    /// 
+    /// [`write_block`]: struct.DelayLine.html#method.write_block
+    pub fn read_block(&self, d: usize, out: &mut [SampleT]) {
+        let start = self.write.wrapping_sub(d + out.len()).wrapping_add(1) & self.mask;
+        let n = out.len().min(self.buffer.len() - start);
+
+        out[..n].copy_from_slice(&self.buffer[start..start + n]);
+        let rest = out.len() - n;
+        out[n..].copy_from_slice(&self.buffer[..rest]);
+    }
+}
+
+impl Clone for DelayLine {
+    /// Creates a silent delay line of the same length.
+    fn clone(&self) -> Self {
+        DelayLine {
+            buffer: vec![SampleT::default(); self.buffer.len()],
+            mask: self.mask,
+            write: 0,
+        }
+    }
+}
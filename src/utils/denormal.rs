@@ -0,0 +1,157 @@
+//! # Denormal
+//! 
+//! Protection against subnormal floating point values, which recursive
+//! filters decay into once their input goes quiet, and which many CPUs
+//! process tens of times slower than normal values.
+//! 
+//! Two complementary strategies are used. Rendering entry points such as
+//! [`StandardChannel::process`] hold a [`DenormalGuard`], which has the CPU
+//! flush subnormal results and operands to zero in hardware where that is
+//! supported. Independently of the CPU, the feedback state of the built-in
+//! filters is passed through [`flush`], which zeroes values far below
+//! audibility long before they become subnormal.
+//! 
+//! [`StandardChannel::process`]: ../../channels/trait.Channel.html#tymethod.process
+//! [`DenormalGuard`]: struct.DenormalGuard.html
+//! [`flush`]: fn.flush.html
+
+use super::*;
+
+/// Magnitude below which [`flush`] sets values to zero, about -400dBFS. This
+/// is many orders of magnitude above the subnormal range, so that a state
+/// flushed once per block can't decay into it within the block unless it
+/// also decays out of it within a few hundred samples.
+/// 
+/// [`flush`]: fn.flush.html
+pub const FLUSH_THRESHOLD: SampleT = 1e-20;
+
+/// Returns 0 if the magnitude of `x` is below [`FLUSH_THRESHOLD`], and `x`
+/// otherwise.
+/// 
+/// [`FLUSH_THRESHOLD`]: constant.FLUSH_THRESHOLD.html
+#[inline(always)]
+pub fn flush(x: SampleT) -> SampleT {
+    if x.abs() < FLUSH_THRESHOLD {
+        0.0
+    } else {
+        x
+    }
+}
+
+/// Applies [`flush`] to every element of the given slice.
+/// 
+/// [`flush`]: fn.flush.html
+pub fn flush_slice(xs: &mut [SampleT]) {
+    for x in xs {
+        *x = flush(*x);
+    }
+}
+
+/// Scoped hardware flush-to-zero for the calling thread.
+/// 
+/// While a guard is alive, the floating point unit of the thread that
+/// created it treats subnormal operands as zero and flushes subnormal results
+/// to zero: FTZ and DAZ in MXCSR on x86 with SSE, and FZ in FPCR on AArch64.
+/// The previous mode is restored when the guard is dropped, so guards can be
+/// nested and never leak the mode into code outside the render call. On other
+/// targets a guard does nothing, and [`flush`] is all that protects filters.
+/// 
+/// A guard only affects the thread it was created on, so work handed to
+/// other threads needs a guard of its own.
+/// 
+/// # Example
+/// 
+/// ```
+/// use bae_rs::utils::denormal::DenormalGuard;
+/// 
+/// let tiny = std::hint::black_box(1e-30f32);
+/// {
+///     let _guard = DenormalGuard::new();
+///     let x = std::hint::black_box(tiny * 1e-10);
+///     assert!(!DenormalGuard::is_supported() || x == 0.0);
+/// }
+/// assert!(std::hint::black_box(tiny * 1e-10) > 0.0);
+/// ```
+/// 
+/// [`flush`]: fn.flush.html
+pub struct DenormalGuard {
+    saved: u64,
+}
+
+impl DenormalGuard {
+    /// Enables flush-to-zero on the calling thread until the returned guard
+    /// is dropped.
+    pub fn new() -> Self {
+        let saved = unsafe { mode::get() };
+        unsafe { mode::set(saved | mode::FLUSH_BITS) };
+
+        DenormalGuard {
+            saved,
+        }
+    }
+
+    /// Returns true if the guard has an effect on the target compiled for.
+    pub fn is_supported() -> bool {
+        mode::FLUSH_BITS != 0
+    }
+}
+
+impl Default for DenormalGuard {
+    fn default() -> Self {
+        DenormalGuard::new()
+    }
+}
+
+impl Drop for DenormalGuard {
+    fn drop(&mut self) {
+        unsafe { mode::set(self.saved) };
+    }
+}
+
+#[cfg(any(target_arch = "x86_64", all(target_arch = "x86", target_feature = "sse")))]
+mod mode {
+    use std::arch::asm;
+
+    /// FTZ (bit 15) and DAZ (bit 6) of MXCSR.
+    pub const FLUSH_BITS: u64 = (1 << 15) | (1 << 6);
+
+    pub unsafe fn get() -> u64 {
+        let mut csr: u32 = 0;
+        asm!("stmxcsr [{}]", in(reg) &mut csr, options(nostack, preserves_flags));
+        csr as u64
+    }
+
+    pub unsafe fn set(csr: u64) {
+        let csr = csr as u32;
+        asm!("ldmxcsr [{}]", in(reg) &csr, options(nostack, readonly, preserves_flags));
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+mod mode {
+    use std::arch::asm;
+
+    /// FZ (bit 24) of FPCR.
+    pub const FLUSH_BITS: u64 = 1 << 24;
+
+    pub unsafe fn get() -> u64 {
+        let fpcr: u64;
+        asm!("mrs {}, fpcr", out(reg) fpcr, options(nomem, nostack, preserves_flags));
+        fpcr
+    }
+
+    pub unsafe fn set(fpcr: u64) {
+        asm!("msr fpcr, {}", in(reg) fpcr, options(nomem, nostack, preserves_flags));
+    }
+}
+
+#[cfg(not(any(target_arch = "x86_64", all(target_arch = "x86", target_feature = "sse"), target_arch = "aarch64")))]
+mod mode {
+    pub const FLUSH_BITS: u64 = 0;
+
+    pub unsafe fn get() -> u64 {
+        0
+    }
+
+    pub unsafe fn set(_: u64) {}
+}
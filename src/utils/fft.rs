@@ -0,0 +1,136 @@
+//! # FFT
+//! 
+//! Radix-2 fast Fourier transform of power-of-two sizes on split real and
+//! imaginary arrays.
+
+use super::*;
+
+/// Precomputed tables for forward and inverse transforms of one size.
+/// 
+/// Transforms work in place on separate real and imaginary slices, which
+/// keeps the butterflies free of shuffles so they vectorize well. The tables
+/// are computed once, and an `Fft` can be shared between any number of
+/// threads, as transforms never modify it.
+/// 
+/// # Example
+/// 
+/// ```
+/// use bae_rs::utils::fft::Fft;
+/// 
+/// let fft = Fft::new(8);
+/// let mut re = [1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0];
+/// let mut im = [0.0; 8];
+/// 
+/// fft.forward(&mut re, &mut im);
+/// assert!(re.iter().all(|x| (x - 1.0).abs() < 1e-6));
+/// 
+/// fft.inverse(&mut re, &mut im);
+/// assert!((re[0] - 1.0).abs() < 1e-6 && re[1..].iter().all(|x| x.abs() < 1e-6));
+/// ```
+#[derive(Clone)]
+pub struct Fft {
+    size: usize,
+    bitrev: Vec<u32>,
+    cos: Vec<SampleT>,
+    sin: Vec<SampleT>,
+}
+
+impl Fft {
+    /// Creates the tables for transforms of `size` points.
+    /// 
+    /// # Panics
+    /// 
+    /// Panics if `size` is not a power of two.
+    pub fn new(size: usize) -> Self {
+        assert!(size.is_power_of_two(), "FFT size must be a power of two");
+
+        let bits = size.trailing_zeros();
+        let bitrev = (0..size as u32)
+            .map(|i| if bits == 0 { 0 } else { i.reverse_bits() >> (32 - bits) })
+            .collect();
+
+        let half = size / 2;
+        let w = -2.0 * std::f64::consts::PI / size as f64;
+        let cos = (0..half).map(|i| (w * i as f64).cos() as SampleT).collect();
+        let sin = (0..half).map(|i| (w * i as f64).sin() as SampleT).collect();
+
+        Fft {
+            size,
+            bitrev,
+            cos,
+            sin,
+        }
+    }
+
+    /// Returns the number of points of the transform.
+    pub fn size(&self) -> usize {
+        self.size
+    }
+
+    /// Replaces the given signal with its spectrum. The transform is not
+    /// scaled.
+    /// 
+    /// # Panics
+    /// 
+    /// Panics if either slice is not of the transform's size.
+    pub fn forward(&self, re: &mut [SampleT], im: &mut [SampleT]) {
+        self.transform(re, im, 1.0);
+    }
+
+    /// Replaces the given spectrum with its signal, scaled by `1 / size` so
+    /// that it undoes [`forward`].
+    /// 
+    /// # Panics
+    /// 
+    /// Panics if either slice is not of the transform's size.
+    /// 
+    /// [`forward`]: struct.Fft.html#method.forward
+    pub fn inverse(&self, re: &mut [SampleT], im: &mut [SampleT]) {
+        self.transform(re, im, -1.0);
+
+        let g = 1.0 / self.size as SampleT;
+        for (r, i) in re.iter_mut().zip(im.iter_mut()) {
+            *r *= g;
+            *i *= g;
+        }
+    }
+
+    fn transform(&self, re: &mut [SampleT], im: &mut [SampleT], dir: SampleT) {
+        let n = self.size;
+        assert!(re.len() == n && im.len() == n, "Slices don't match the FFT size");
+
+        for (i, &j) in self.bitrev.iter().enumerate() {
+            let j = j as usize;
+            if i < j {
+                re.swap(i, j);
+                im.swap(i, j);
+            }
+        }
+
+        let mut len = 2;
+        while len <= n {
+            let half = len / 2;
+            let step = n / len;
+
+            for start in (0..n).step_by(len) {
+                let (lo_re, hi_re) = re[start..start + len].split_at_mut(half);
+                let (lo_im, hi_im) = im[start..start + len].split_at_mut(half);
+
+                for k in 0..half {
+                    let wr = self.cos[k * step];
+                    let wi = dir * self.sin[k * step];
+
+                    let tr = hi_re[k] * wr - hi_im[k] * wi;
+                    let ti = hi_re[k] * wi + hi_im[k] * wr;
+
+                    hi_re[k] = lo_re[k] - tr;
+                    hi_im[k] = lo_im[k] - ti;
+                    lo_re[k] += tr;
+                    lo_im[k] += ti;
+                }
+            }
+
+            len *= 2;
+        }
+    }
+}
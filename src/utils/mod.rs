@@ -6,7 +6,18 @@ use super::*;
 use std::vec::Vec;
 use std::ops::{Add, Sub, Mul, Div};
 
+pub mod asset_cache;
+pub mod automation;
+pub mod delay_line;
+pub mod denormal;
+pub mod fft;
 pub mod mono_resampler;
+pub mod simd;
+pub mod spsc;
+pub mod topo;
+pub mod wav_stream;
+pub mod wav_writer;
+pub use automation::*;
 pub use mono_resampler::*;
 
 /// Linear interpolation (y-y1 = m * (x-x1)) of a given value.
@@ -43,7 +54,7 @@ pub fn clerp<T>(x:T, x1:T, x2:T, y1:T, y2:T) -> T
 
 /// Converts a given sample count to seconds.
 pub fn samples_to_seconds(s: usize) -> std::time::Duration {
-    std::time::Duration::from_secs_f64(s as f64 * SAMPLE_RATE as f64)
+    std::time::Duration::from_secs_f64(s as f64 * INV_SAMPLE_RATE)
 }
 
 /// Converts the given duration to samples, rounded to the nearest sample.
@@ -61,6 +72,45 @@ pub fn db_to_linear(db: MathT) -> MathT {
     10.0_f64.powf(db/20.0)
 }
 
+/// Approximates `10^(db/20)`, converting from decibels (dBFS) to a linear
+/// gain like [`db_to_linear`] with a relative error under 1e-6, at a fraction
+/// of the cost of `powf`. Returns 0 below about -6000dB.
+/// 
+/// [`db_to_linear`]: fn.db_to_linear.html
+pub fn fast_db_to_linear(db: MathT) -> MathT {
+    // 2^y split into 2^i, built directly in the exponent bits, and 2^f for
+    // f in [-0.5,0.5] from a polynomial.
+    let y = db * (std::f64::consts::LOG2_10 / 20.0);
+    if y < -1022.0 {
+        return 0.0;
+    }
+
+    let i = y.round().min(1023.0);
+    let f = (y - i) * std::f64::consts::LN_2;
+    let p = 1.0 + f * (1.0 + f * (0.5 + f * (1.0 / 6.0 + f * (1.0 / 24.0 + f * (1.0 / 120.0 + f * (1.0 / 720.0))))));
+
+    p * MathT::from_bits(((i as i64 + 1023) as u64) << 52)
+}
+
+/// Approximates `tan(x)` with a relative error under 1e-7 for any `x` not
+/// within 1e-7 of a pole, with a rational approximation instead of `tan`. This
+/// is the fast path used when filters are redesigned at control rate.
+pub fn fast_tan(x: MathT) -> MathT {
+    use std::f64::consts::{FRAC_PI_2, FRAC_PI_4, PI};
+
+    // Reduce to [-pi/2,pi/2], then to [0,pi/4] with tan(pi/2 - x) = 1/tan(x).
+    let x = x - PI * (x / PI).round();
+    let (x, sign) = if x < 0.0 { (-x, -1.0) } else { (x, 1.0) };
+    let (x, flip) = if x > FRAC_PI_4 { (FRAC_PI_2 - x, true) } else { (x, false) };
+
+    // Pade approximant of order (7,6).
+    let x2 = x * x;
+    let n = x * (135135.0 + x2 * (-17325.0 + x2 * (378.0 - x2)));
+    let d = 135135.0 + x2 * (-62370.0 + x2 * (3150.0 - 28.0 * x2));
+
+    sign * if flip { d / n } else { n / d }
+}
+
 /// Normalizes the given audio track to have a peak value at the given dBFS
 /// value.
 pub fn normalize(db: MathT, t: &mut SampleTrackT) {
@@ -107,29 +157,24 @@ pub fn normalize(db: MathT, t: &mut SampleTrackT) {
 /// [`TrackT`]: ../../type.TrackT.html
 /// [`wav::read_wav`]: https://docs.rs/wav/0.1.1/wav/fn.read_wav.html
 pub fn read_wav(s: &mut dyn std::io::Read) -> std::io::Result<(wav::Header, Vec<SampleTrackT>)> {
+    use crate::sample_format::*;
+
     let (h, bd) = wav::read_wav(s)?;
 
-    let mut tracks = Vec::new();
-    for _ in 0..h.channel_count {
-        tracks.push(SampleTrackT::new());
-    }
+    let channels = h.channel_count as usize;
+    let frames = match &bd {
+        wav::BitDepth::Eight(d) => d.len(),
+        wav::BitDepth::Sixteen(d) => d.len(),
+        wav::BitDepth::TwentyFour(d) => d.len(),
+        _ => 0,
+    } / channels.max(1);
+
+    let mut tracks = vec![vec![SampleT::default(); frames]; channels];
 
     match bd {
-        wav::BitDepth::Eight(d) => {
-            for i in 0..d.len() {
-                tracks[i % h.channel_count as usize].push(sample_from_u8(d[i]));
-            }
-        },
-        wav::BitDepth::Sixteen(d) => {
-            for i in 0..d.len() {
-                tracks[i % h.channel_count as usize].push(sample_from_i16(d[i]));
-            }
-        },
-        wav::BitDepth::TwentyFour(d) => {
-            for i in 0..d.len() {
-                tracks[i % h.channel_count as usize].push(sample_from_i24(d[i]));
-            }
-        },
+        wav::BitDepth::Eight(d) => deinterleave_u8(&d, &mut tracks),
+        wav::BitDepth::Sixteen(d) => deinterleave_i16(&d, &mut tracks),
+        wav::BitDepth::TwentyFour(d) => deinterleave_i24(&d, &mut tracks),
 
         _ => (),
     }
@@ -140,6 +185,10 @@ pub fn read_wav(s: &mut dyn std::io::Read) -> std::io::Result<(wav::Header, Vec<
 /// Takes the given track and filename and writes the track data to the WAV file
 /// at the given location with a given bit-depth.
 /// 
+/// The tracks are converted and written a few thousand frames at a time. To
+/// write a file as it is rendered, without holding all of it in memory, use a
+/// [`WavWriter`].
+/// 
 /// # Parameters
 /// 
 /// * `track` - A vector of tracks to write. Each track is considered a channel.
@@ -152,7 +201,7 @@ pub fn read_wav(s: &mut dyn std::io::Read) -> std::io::Result<(wav::Header, Vec<
 /// # Errors
 /// 
 /// This function fails if:
-/// * Anything that [`wav::write_wav`] specifies.
+/// * The data can't be written to the destination.
 /// * The channels don't have equal lengths.
 /// * The given vector contains no data.
 /// 
@@ -171,10 +220,9 @@ pub fn read_wav(s: &mut dyn std::io::Read) -> std::io::Result<(wav::Header, Vec<
 /// write_wav(vec![t], 16, &mut File::create(".junk/some/path/noise.wav").unwrap(), false);
 /// ```
 /// 
-/// [`wav::write_wav`]: https://docs.rs/wav/0.1.1/wav/fn.write_wav.html
-pub fn write_wav(mut tracks: Vec<SampleTrackT>, bps: u16, d: &mut dyn std::io::Write, clip: bool) -> std::io::Result<()> {
+/// [`WavWriter`]: wav_writer/struct.WavWriter.html
+pub fn write_wav(tracks: Vec<SampleTrackT>, bps: u16, d: &mut dyn std::io::Write, clip: bool) -> std::io::Result<()> {
     use std::io::{Error, ErrorKind};
-    use crate::sample_format::*;
 
     if tracks.len() == 0 {
         return Err(Error::new(ErrorKind::Other, "No channels given, aborting."));
@@ -182,69 +230,64 @@ pub fn write_wav(mut tracks: Vec<SampleTrackT>, bps: u16, d: &mut dyn std::io::W
 
     let len = tracks[0].len();
 
-    for t in &mut tracks {
+    for t in &tracks {
         if t.len() != len {
             return Err(Error::new(ErrorKind::Other, "Channels have mismatching lengths, aborting."));
         }
-        if clip {
-            for s in t {
-                if *s > 1.0 {
-                    *s = 1.0;
-                } else if *s < -1.0 {
-                    *s = -1.0;
-                }
-            }
-        }
     }
 
-    match bps {
-        8 => {
-            let mut v = Vec::new();
-
-            for i in 0..len {
-                for t in &tracks {
-                    v.push(sample_to_u8(t[i]));
-                }
-            }
-
-            wav::write_wav(
-                wav::Header::new(1, tracks.len() as u16, SAMPLE_RATE as u32, bps),
-                wav::BitDepth::Eight(v),
-                d
-            )?;
-        },
-        16 => {
-            let mut v = Vec::new();
-
-            for i in 0..len {
-                for t in &tracks {
-                    v.push(sample_to_i16(t[i]));
-                }
-            }
-
-            wav::write_wav(
-                wav::Header::new(1, tracks.len() as u16, SAMPLE_RATE as u32, bps),
-                wav::BitDepth::Sixteen(v),
-                d
-            )?;
-        },
-        24 => {
-            let mut v = Vec::new();
-
-            for i in 0..len {
-                for t in &tracks {
-                    v.push(sample_to_i24(t[i]));
-                }
-            }
-
-            wav::write_wav(
-                wav::Header::new(1, tracks.len() as u16, SAMPLE_RATE as u32, bps),
-                wav::BitDepth::TwentyFour(v),
-                d
-            )?;
-        },
-        _ => return Err(Error::new(ErrorKind::Other, "Unsupported bit depth, aborting.")),
+    let channels: Vec<&[SampleT]> = tracks.iter().map(|t| &t[..]).collect();
+
+    write_channels(&channels, bps, d, clip)
+}
+
+/// Writes the given planar buffer to the WAV file at the given location with a
+/// given bit-depth. Each channel of the buffer is written as a channel of the
+/// file.
+/// 
+/// # Parameters
+/// 
+/// * `buffer` - The buffer to write.
+/// * `bps` - The number of bits per sample. Should be 8, 16, or 24.
+/// * `d` - The destination to write to.
+/// * `clip` - Controls whether or not the function will clamp values outside
+///            the range of [-1,1] to that range.
+/// 
+/// # Errors
+/// 
+/// This function fails if:
+/// * The data can't be written to the destination.
+/// * The given buffer has no channels.
+pub fn write_wav_planar(buffer: &crate::sample_format::PlanarBuffer, bps: u16, d: &mut dyn std::io::Write, clip: bool) -> std::io::Result<()> {
+    use std::io::{Error, ErrorKind};
+
+    if buffer.channels() == 0 {
+        return Err(Error::new(ErrorKind::Other, "No channels given, aborting."));
+    }
+
+    let channels: Vec<&[SampleT]> = buffer.iter().collect();
+
+    write_channels(&channels, bps, d, clip)
+}
+
+/// Converts the given channels to the given bit depth, interleaving them, and
+/// writes them to a WAV file one block at a time.
+fn write_channels(channels: &[&[SampleT]], bps: u16, d: &mut dyn std::io::Write, clip: bool) -> std::io::Result<()> {
+    const FRAMES: usize = 4096;
+
+    let len = channels[0].len();
+    let mut w = wav_writer::WavWriter::with_frames(d, channels.len() as u16, SAMPLE_RATE as u32, bps, len as u64)?;
+    let mut block = Vec::with_capacity(channels.len());
+
+    for start in (0..len).step_by(FRAMES) {
+        let end = (start + FRAMES).min(len);
+
+        block.clear();
+        block.extend(channels.iter().map(|c| &c[start..end]));
+        w.write(&block, clip)?;
     }
 
+    w.finish()?;
+
     Ok(())
 }
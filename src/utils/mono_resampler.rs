@@ -4,20 +4,81 @@
 //! sampling rate BAE runs at.
 
 use super::*;
+use super::asset_cache::SampleBuffer;
 use sample_format::{SampleFormat, MonoTrackT};
+use std::sync::Arc;
 
-/// Type used for fractional indexing.
-type IndexT = SampleT;
+/// Number of fractional bits in the fixed-point playback position.
+const FRAC_BITS: u32 = 32;
+/// Mask selecting the fractional part of the playback position.
+const FRAC_MASK: u64 = (1 << FRAC_BITS) - 1;
+
+/// Number of taps of the windowed-sinc interpolation kernel.
+pub const SINC_TAPS: usize = 16;
+/// Number of bits of the fractional position used to select a phase of the
+/// windowed-sinc kernel.
+const SINC_PHASE_BITS: u32 = 8;
+/// Number of precomputed phases of the windowed-sinc kernel.
+const SINC_PHASES: usize = 1 << SINC_PHASE_BITS;
+// Polyphase table of the Blackman-Harris windowed-sinc kernel generated by the
+// build script, `SINC_TABLE`, with a cutoff of 0.9 times the source Nyquist
+// rate. Row `p` holds the taps for a fractional position of
+// `p / SINC_PHASES`, with one extra row so adjacent rows can always be
+// interpolated between.
+include!(concat!(env!("OUT_DIR"), "/sinc_table.rs"));
+
+/// Interpolation method used by a [`MonoResampler`], trading processing time
+/// for quality.
+/// 
+/// [`MonoResampler`]: struct.MonoResampler.html
+#[derive(Copy,Clone,Debug,PartialEq,Eq)]
+pub enum Interpolation {
+    /// 2-point linear interpolation. The cheapest, but it attenuates high
+    /// frequencies and aliases.
+    Linear,
+    /// 4-point cubic Hermite (Catmull-Rom) interpolation.
+    Cubic,
+    /// 16-point windowed-sinc interpolation from a precomputed polyphase
+    /// table. The most expensive, with the least aliasing and imaging.
+    Sinc,
+}
+
+impl Interpolation {
+    /// Returns the range of taps around the current sample read by the
+    /// interpolation, with both ends inclusive.
+    fn taps(self) -> (i64, i64) {
+        match self {
+            Interpolation::Linear => (0, 1),
+            Interpolation::Cubic => (-1, 2),
+            Interpolation::Sinc => (1 - (SINC_TAPS / 2) as i64, (SINC_TAPS / 2) as i64),
+        }
+    }
+}
+
+impl Default for Interpolation {
+    fn default() -> Self {
+        Interpolation::Linear
+    }
+}
 
 /// Struct tracking all of the data required for resampling, with some extra
 /// features like playback speed and looping.
+/// 
+/// The audio data is shared between clones, and only the playback state is
+/// per object, so cloning never copies the data.
+/// 
+/// The playback position is kept in 32.32 fixed-point, so it is exact for
+/// files of any practical length and never drifts.
 pub struct MonoResampler {
-    data: MonoTrackT,
-    ind: IndexT,
-    inc: SampleT,
+    data: Arc<[SampleT]>,
+    pos: u64,
+    inc: u64,
+    source_rate: MathT,
+    ratio: MathT,
     speed: MathT,
     loop_start: usize,
     loop_end: usize,
+    interpolation: Interpolation,
 }
 
 impl MonoResampler {
@@ -31,24 +92,54 @@ impl MonoResampler {
     /// * `loop_end` - The end point of looping. If this value is 0, no looping is assumed.
     /// 
     /// If `loop_end` is less than `loop_start`, they are swapped.
-    pub fn new(data:MonoTrackT, source_sample_rate: MathT, mut loop_start: usize, mut loop_end: usize) -> Self {
+    pub fn new(data:MonoTrackT, source_sample_rate: MathT, loop_start: usize, loop_end: usize) -> Self {
+        let data: Vec<SampleT> = data.iter().map(|s| s.into_sample()).collect();
+
+        MonoResampler::from_shared(data.into(), source_sample_rate, loop_start, loop_end)
+    }
+
+    /// Creates a new MonoResampler object playing the given shared buffer,
+    /// without copying its data.
+    /// 
+    /// # Parameters
+    /// 
+    /// * `buffer` - The buffer containing the original audio data and its
+    /// sample rate.
+    /// * `loop_start` - The start point of looping.
+    /// * `loop_end` - The end point of looping. If this value is 0, no looping is assumed.
+    /// 
+    /// If `loop_end` is less than `loop_start`, they are swapped.
+    pub fn from_buffer(buffer: &SampleBuffer, loop_start: usize, loop_end: usize) -> Self {
+        MonoResampler::from_shared(buffer.samples().clone(), buffer.sampling_rate(), loop_start, loop_end)
+    }
+
+    /// Creates a new MonoResampler object playing the given shared samples.
+    fn from_shared(data: Arc<[SampleT]>, source_sample_rate: MathT, mut loop_start: usize, mut loop_end: usize) -> Self {
         if loop_end < loop_start {
             std::mem::swap(&mut loop_start, &mut loop_end);
         }
 
-        MonoResampler {
+        let mut r = MonoResampler {
             data,
-            ind: 0.0,
-            inc: (source_sample_rate as MathT * INV_SAMPLE_RATE) as SampleT,
+            pos: 0,
+            inc: 0,
+            source_rate: source_sample_rate,
+            ratio: source_sample_rate * INV_SAMPLE_RATE,
             speed: 1.0,
             loop_start,
             loop_end,
-        }
+            interpolation: Interpolation::default(),
+        };
+
+        r.update_inc();
+
+        r
     }
 
     /// Sets the playback speed.
     pub fn set_playback_speed(&mut self, speed: MathT) {
         self.speed = speed;
+        self.update_inc();
     }
 
     /// Returns the playback speed.
@@ -56,44 +147,245 @@ impl MonoResampler {
         self.speed
     }
 
-    /// Calculates and returns the next sample.
-    pub fn process(&mut self) -> SampleT {
-        if self.ind as usize >= self.data.len() && self.loop_end == 0 {
-            return SampleT::default();
+    /// Sets the interpolation method.
+    pub fn set_interpolation(&mut self, i: Interpolation) {
+        self.interpolation = i;
+    }
+
+    /// Returns the interpolation method.
+    pub fn get_interpolation(&self) -> Interpolation {
+        self.interpolation
+    }
+
+    /// Sets the playback position, in samples of the original audio data.
+    pub fn set_position(&mut self, p: MathT) {
+        self.pos = (p.max(0.0) * (1u64 << FRAC_BITS) as MathT) as u64;
+    }
+
+    /// Returns the playback position, in samples of the original audio data.
+    pub fn get_position(&self) -> MathT {
+        self.pos as MathT / (1u64 << FRAC_BITS) as MathT
+    }
+
+    /// Sets the sample rate of the output to that of the given [`Context`],
+    /// keeping the playback speed. When it matches the rate of the source
+    /// data, the data is played without being resampled.
+    /// 
+    /// [`Context`]: ../../context/struct.Context.html
+    pub fn set_context(&mut self, ctx: &Context) {
+        self.ratio = self.source_rate * ctx.inv_sample_rate();
+        self.update_inc();
+    }
+
+    /// Returns the shared audio data being played.
+    pub fn get_data(&self) -> &Arc<[SampleT]> {
+        &self.data
+    }
+
+    fn update_inc(&mut self) {
+        self.inc = (self.ratio * self.speed.max(0.0) * (1u64 << FRAC_BITS) as MathT).round() as u64;
+    }
+
+    fn is_looping(&self) -> bool {
+        self.loop_end != 0
+    }
+
+    /// Index one past the last sample that is read before wrapping or
+    /// stopping.
+    fn limit(&self) -> usize {
+        if self.is_looping() {
+            self.loop_end.min(self.data.len())
+        } else {
+            self.data.len()
+        }
+    }
+
+    /// Returns the sample at the given index, wrapping indices past the loop
+    /// end back into the loop and holding the first and last samples beyond
+    /// either end of the data.
+    fn at(&self, mut i: i64) -> SampleT {
+        let limit = self.limit() as i64;
+
+        if self.is_looping() && i >= limit && limit > self.loop_start as i64 {
+            i = self.loop_start as i64 + (i - self.loop_start as i64) % (limit - self.loop_start as i64);
         }
 
-        let p1: SampleT = if self.ind.trunc() as usize + 1 >= self.data.len() && self.loop_end != 0 {
-            self.data[(self.ind - (self.loop_end - self.loop_start) as IndexT) as usize].into_sample()
-        } else if self.ind.trunc() as usize + 1 >= self.data.len() {
-            self.data[self.ind.trunc() as usize].into_sample()
+        self.data[i.max(0).min(self.data.len() as i64 - 1) as usize]
+    }
+
+    /// Interpolates between the samples in `x`, which holds the taps of the
+    /// current interpolation method, at the given fractional position.
+    #[inline(always)]
+    fn interpolate(interpolation: Interpolation, x: &[SampleT], frac: u64) -> SampleT {
+        let t = frac as SampleT * (1.0 / (1u64 << FRAC_BITS) as SampleT);
+
+        match interpolation {
+            Interpolation::Linear => x[0] + t * (x[1] - x[0]),
+            Interpolation::Cubic => {
+                let (xm1, x0, x1, x2) = (x[0], x[1], x[2], x[3]);
+                let c1 = 0.5 * (x1 - xm1);
+                let c2 = xm1 - 2.5 * x0 + 2.0 * x1 - 0.5 * x2;
+                let c3 = 0.5 * (x2 - xm1) + 1.5 * (x0 - x1);
+
+                ((c3 * t + c2) * t + c1) * t + x0
+            },
+            Interpolation::Sinc => {
+                let shift = FRAC_BITS - SINC_PHASE_BITS;
+                let p = (frac >> shift) as usize;
+                let f = (frac & ((1 << shift) - 1)) as SampleT * (1.0 / (1u64 << shift) as SampleT);
+                let (r0, r1) = (&SINC_TABLE[p], &SINC_TABLE[p + 1]);
+
+                let mut y = 0.0;
+                for k in 0..SINC_TAPS {
+                    y += x[k] * (r0[k] + f * (r1[k] - r0[k]));
+                }
+                y
+            },
+        }
+    }
+
+    /// Steps the position forward one output sample, wrapping it back into
+    /// the loop if needed.
+    fn advance(&mut self) {
+        self.pos += self.inc;
+        self.wrap();
+    }
+
+    /// Moves a position past the loop end back into the loop.
+    fn wrap(&mut self) {
+        if self.is_looping() && (self.pos >> FRAC_BITS) as usize >= self.loop_end {
+            let len = ((self.loop_end - self.loop_start) as u64) << FRAC_BITS;
+
+            if len == 0 {
+                self.pos = (self.loop_start as u64) << FRAC_BITS;
+            } else {
+                let start = (self.loop_start as u64) << FRAC_BITS;
+                self.pos = start + (self.pos - start) % len;
+            }
+        }
+    }
+
+    /// Returns true if playback has passed the end of non-looping data.
+    pub fn is_finished(&self) -> bool {
+        !self.is_looping() && (self.pos >> FRAC_BITS) as usize >= self.data.len()
+    }
+
+    /// Returns the number of samples left to play before the end of
+    /// non-looping data, or `None` if the data loops or playback is stopped
+    /// at a speed of 0.
+    pub fn remaining(&self) -> Option<usize> {
+        if self.is_looping() {
+            None
+        } else if self.is_finished() {
+            Some(0)
+        } else if self.inc == 0 {
+            None
         } else {
-            self.data[(self.ind + 1.0).trunc() as usize].into_sample()
-        };
+            let left = ((self.data.len() as u64) << FRAC_BITS) - self.pos;
+            Some(((left + self.inc - 1) / self.inc) as usize)
+        }
+    }
+
+    /// Advances the position by `n` output samples without calculating them.
+    pub fn skip(&mut self, n: usize) {
+        if self.is_finished() {
+            return;
+        }
 
-        let x1: SampleT = self.data[self.ind.trunc() as usize].into_sample();
-        let x2: SampleT = p1;
+        self.pos = self.pos.saturating_add(self.inc.saturating_mul(n as u64));
+        self.wrap();
+    }
 
-        let y = x1 + self.ind.fract() as SampleT * (x2 - x1);
+    /// Calculates and returns the next sample.
+    pub fn process(&mut self) -> SampleT {
+        if self.is_finished() || self.data.is_empty() {
+            return SampleT::default();
+        }
 
-        self.ind += self.inc * self.speed as SampleT;
+        let (lo, hi) = self.interpolation.taps();
+        let i = (self.pos >> FRAC_BITS) as i64;
 
-        if self.ind >= self.loop_end as IndexT && self.loop_end != 0 {
-            self.ind -= (self.loop_end - self.loop_start) as IndexT;
+        let mut x = [0.0; SINC_TAPS];
+        for (k, x) in x.iter_mut().enumerate().take((hi - lo + 1) as usize) {
+            *x = self.at(i + lo + k as i64);
         }
 
+        let y = Self::interpolate(self.interpolation, &x, self.pos & FRAC_MASK);
+
+        self.advance();
+
         y
     }
+
+    /// Calculates the next block of samples, overwriting the contents of
+    /// `out`.
+    /// 
+    /// Runs of samples whose taps all lie inside the data, before any loop
+    /// end, are interpolated straight from the data without any bounds or loop
+    /// checks. Only the few samples around a wrap or the ends of the data go
+    /// through [`process`].
+    /// 
+    /// [`process`]: struct.MonoResampler.html#method.process
+    pub fn process_block(&mut self, out: &mut [SampleT]) {
+        let (lo, hi) = self.interpolation.taps();
+        let limit = self.limit() as i64;
+        let mut o = 0;
+
+        while o < out.len() {
+            if self.is_finished() || self.data.is_empty() {
+                for y in &mut out[o..] {
+                    *y = SampleT::default();
+                }
+                return;
+            }
+
+            let i = (self.pos >> FRAC_BITS) as i64;
+
+            if i + lo < 0 || i + hi >= limit {
+                out[o] = self.process();
+                o += 1;
+                continue;
+            }
+
+            // Number of samples before the last tap reaches the limit.
+            let end = ((limit - hi) as u64) << FRAC_BITS;
+            let n = if self.inc == 0 {
+                out.len() - o
+            } else {
+                (((end - 1 - self.pos) / self.inc + 1) as usize).min(out.len() - o)
+            };
+
+            let data = &self.data[..];
+            let interpolation = self.interpolation;
+            let width = (hi - lo + 1) as usize;
+            let mut pos = self.pos;
+
+            for y in &mut out[o..o + n] {
+                let s = ((pos >> FRAC_BITS) as i64 + lo) as usize;
+                *y = Self::interpolate(interpolation, &data[s..s + width], pos & FRAC_MASK);
+                pos += self.inc;
+            }
+
+            self.pos = pos;
+            self.wrap();
+            o += n;
+        }
+    }
 }
 
 impl Clone for MonoResampler {
     fn clone(&self) -> Self {
+        // Only the reference count of the data is touched.
         MonoResampler {
             data: self.data.clone(),
-            ind: 0.0,
+            pos: 0,
             inc: self.inc,
+            source_rate: self.source_rate,
+            ratio: self.ratio,
             speed: self.speed,
             loop_start: self.loop_start,
             loop_end: self.loop_end,
+            interpolation: self.interpolation,
         }
     }
 }
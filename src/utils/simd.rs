@@ -0,0 +1,1063 @@
+//! # SIMD
+//! 
+//! Vectorized kernels for common operations on blocks of samples. The fastest
+//! instruction set supported by the running CPU (AVX2 or SSE2 on x86, NEON on
+//! AArch64) is detected once and used for every call, with a scalar fallback
+//! for everything else.
+//! 
+//! Every kernel performs exactly the same floating point operations in the
+//! same order as its counterpart in [`scalar`], so results are identical no
+//! matter which instruction set is picked.
+//! 
+//! [`scalar`]: scalar/index.html
+
+use super::*;
+use std::sync::atomic::{AtomicU8, Ordering};
+
+/// Divisor converting between 16-bit integer and floating point samples.
+const I16_SCALE: SampleT = (1 << 15) as SampleT - 1.0;
+/// Divisor converting between 24-bit integer and floating point samples.
+const I24_SCALE: SampleT = (1 << 23) as SampleT - 1.0;
+
+/// Instruction sets the kernels can be run with.
+#[derive(Copy,Clone,Debug,PartialEq,Eq)]
+pub enum Isa {
+    /// Plain Rust, one sample at a time.
+    Scalar,
+    /// 128-bit x86 vectors.
+    Sse2,
+    /// 256-bit x86 vectors.
+    Avx2,
+    /// 128-bit ARM vectors.
+    Neon,
+}
+
+/// Detected instruction set, stored as one more than its index in [`Isa`] so
+/// that 0 means it hasn't been detected yet. Detecting it again when threads
+/// race is harmless, as they all find the same one.
+/// 
+/// [`Isa`]: enum.Isa.html
+static ISA: AtomicU8 = AtomicU8::new(0);
+
+#[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+fn detect() -> Isa {
+    if is_x86_feature_detected!("avx2") {
+        Isa::Avx2
+    } else if is_x86_feature_detected!("sse2") {
+        Isa::Sse2
+    } else {
+        Isa::Scalar
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+fn detect() -> Isa {
+    if std::arch::is_aarch64_feature_detected!("neon") {
+        Isa::Neon
+    } else {
+        Isa::Scalar
+    }
+}
+
+#[cfg(not(any(target_arch = "x86", target_arch = "x86_64", target_arch = "aarch64")))]
+fn detect() -> Isa {
+    Isa::Scalar
+}
+
+/// Returns the instruction set the kernels in this module run with.
+pub fn isa() -> Isa {
+    match ISA.load(Ordering::Relaxed) {
+        0 => {
+            let isa = detect();
+            ISA.store(isa as u8 + 1, Ordering::Relaxed);
+            isa
+        },
+        1 => Isa::Scalar,
+        2 => Isa::Sse2,
+        3 => Isa::Avx2,
+        _ => Isa::Neon,
+    }
+}
+
+/// Dispatches a kernel call to the implementation for the detected
+/// instruction set.
+macro_rules! dispatch {
+    ($f:ident($($a:expr),*)) => {
+        match isa() {
+            #[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+            Isa::Avx2 => unsafe { avx2::$f($($a),*) },
+            #[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+            Isa::Sse2 => unsafe { sse2::$f($($a),*) },
+            #[cfg(target_arch = "aarch64")]
+            Isa::Neon => unsafe { neon::$f($($a),*) },
+            _ => scalar::$f($($a),*),
+        }
+    };
+}
+
+/// Adds `src` to `dst`, element by element.
+pub fn add(dst: &mut [SampleT], src: &[SampleT]) {
+    dispatch!(add(dst, src))
+}
+
+/// Adds `src` multiplied by `g` to `dst`, element by element.
+pub fn mix(dst: &mut [SampleT], src: &[SampleT], g: SampleT) {
+    dispatch!(mix(dst, src, g))
+}
+
+/// Adds `src` multiplied by a gain ramping linearly from `g` by `dg` per
+/// element to `dst`, so element `i` is scaled by `g + dg * i`. This moves a
+/// mix gain to a new value over a block without zipper noise.
+pub fn mix_ramp(dst: &mut [SampleT], src: &[SampleT], g: SampleT, dg: SampleT) {
+    dispatch!(mix_ramp(dst, src, g, dg))
+}
+
+/// Multiplies every element of `dst` by `g`.
+pub fn mul(dst: &mut [SampleT], g: SampleT) {
+    dispatch!(mul(dst, g))
+}
+
+/// Writes `src` multiplied by `gl` to `left` and by `gr` to `right`, panning a
+/// monophonic block into two channels. The pan gains for a position can be
+/// taken from [`Panner::to_sample_format`] called with a sample of 1.
+/// 
+/// [`Panner::to_sample_format`]: ../../sample_format/trait.Panner.html#tymethod.to_sample_format
+pub fn pan(src: &[SampleT], left: &mut [SampleT], right: &mut [SampleT], gl: SampleT, gr: SampleT) {
+    dispatch!(pan(src, left, right, gl, gr))
+}
+
+/// Clamps every element of `dst` to the range [`lo`,`hi`].
+pub fn clip(dst: &mut [SampleT], lo: SampleT, hi: SampleT) {
+    dispatch!(clip(dst, lo, hi))
+}
+
+/// Interleaves the two channels `left` and `right` into `out`, which must be
+/// twice as long.
+pub fn interleave2(left: &[SampleT], right: &[SampleT], out: &mut [SampleT]) {
+    dispatch!(interleave2(left, right, out))
+}
+
+/// Splits the interleaved stereo block `src` into `left` and `right`, which
+/// must each be half as long.
+pub fn deinterleave2(src: &[SampleT], left: &mut [SampleT], right: &mut [SampleT]) {
+    dispatch!(deinterleave2(src, left, right))
+}
+
+/// Converts 16-bit integer samples to [`SampleT`]s, as [`sample_from_i16`]
+/// does.
+/// 
+/// [`SampleT`]: ../../type.SampleT.html
+/// [`sample_from_i16`]: ../../sample_format/fn.sample_from_i16.html
+pub fn from_i16(src: &[i16], dst: &mut [SampleT]) {
+    dispatch!(from_i16(src, dst))
+}
+
+/// Converts 24-bit integer samples stored in `i32`s to [`SampleT`]s, as
+/// [`sample_from_i24`] does.
+/// 
+/// [`SampleT`]: ../../type.SampleT.html
+/// [`sample_from_i24`]: ../../sample_format/fn.sample_from_i24.html
+pub fn from_i24(src: &[i32], dst: &mut [SampleT]) {
+    dispatch!(from_i24(src, dst))
+}
+
+/// Converts [`SampleT`]s to 16-bit integer samples, as [`sample_to_i16`]
+/// does: values are rounded half away from zero and saturated to the range of
+/// `i16`, and NaN becomes 0.
+/// 
+/// [`SampleT`]: ../../type.SampleT.html
+/// [`sample_to_i16`]: ../../sample_format/fn.sample_to_i16.html
+pub fn to_i16(src: &[SampleT], dst: &mut [i16]) {
+    dispatch!(to_i16(src, dst))
+}
+
+/// Number of voices processed together by [`biquad_lanes`].
+/// 
+/// [`biquad_lanes`]: fn.biquad_lanes.html
+pub const LANES: usize = 8;
+
+/// One value for each of [`LANES`] voices.
+/// 
+/// [`LANES`]: constant.LANES.html
+pub type Lanes = [SampleT; LANES];
+
+/// Runs an independent biquad section for each of [`LANES`] voices over the
+/// frames of `x`, in place. Frame `n` holds the `n`th sample of every voice.
+/// 
+/// `c` holds the b0, b1, b2, a1, and a2 coefficients of each lane, and `s`
+/// the two values of its transposed direct form II state, with the same
+/// operations as a [`Biquad`]. If `dc` is given it is added to `c` after each
+/// frame, ramping the coefficients over the block.
+/// 
+/// [`LANES`]: constant.LANES.html
+/// [`Biquad`]: ../../modifiers/iir/type.Biquad.html
+pub fn biquad_lanes(x: &mut [Lanes], c: &mut [Lanes; 5], dc: Option<&[Lanes; 5]>, s: &mut [Lanes; 2]) {
+    dispatch!(biquad_lanes(x, c, dc, s))
+}
+
+/// Reference implementations of the kernels, processing one sample at a time.
+pub mod scalar {
+    use super::*;
+
+    /// See [`simd::add`](../fn.add.html).
+    pub fn add(dst: &mut [SampleT], src: &[SampleT]) {
+        for (d, s) in dst.iter_mut().zip(src) {
+            *d += *s;
+        }
+    }
+
+    /// See [`simd::mix`](../fn.mix.html).
+    pub fn mix(dst: &mut [SampleT], src: &[SampleT], g: SampleT) {
+        for (d, s) in dst.iter_mut().zip(src) {
+            *d += *s * g;
+        }
+    }
+
+    /// See [`simd::mix_ramp`](../fn.mix_ramp.html). The gain of each element
+    /// is computed from its index rather than accumulated, so every kernel
+    /// rounds it the same way.
+    pub fn mix_ramp(dst: &mut [SampleT], src: &[SampleT], g: SampleT, dg: SampleT) {
+        for (i, (d, s)) in dst.iter_mut().zip(src).enumerate() {
+            *d += *s * (g + dg * i as SampleT);
+        }
+    }
+
+    /// See [`simd::mul`](../fn.mul.html).
+    pub fn mul(dst: &mut [SampleT], g: SampleT) {
+        for d in dst {
+            *d *= g;
+        }
+    }
+
+    /// See [`simd::pan`](../fn.pan.html).
+    pub fn pan(src: &[SampleT], left: &mut [SampleT], right: &mut [SampleT], gl: SampleT, gr: SampleT) {
+        for ((s, l), r) in src.iter().zip(left.iter_mut()).zip(right.iter_mut()) {
+            *l = *s * gl;
+            *r = *s * gr;
+        }
+    }
+
+    /// See [`simd::clip`](../fn.clip.html). Comparisons are ordered like the
+    /// vector min/max instructions, so NaN is clamped to `hi`.
+    pub fn clip(dst: &mut [SampleT], lo: SampleT, hi: SampleT) {
+        for d in dst {
+            let x = if *d < hi { *d } else { hi };
+            *d = if x > lo { x } else { lo };
+        }
+    }
+
+    /// See [`simd::interleave2`](../fn.interleave2.html).
+    pub fn interleave2(left: &[SampleT], right: &[SampleT], out: &mut [SampleT]) {
+        for ((l, r), o) in left.iter().zip(right).zip(out.chunks_exact_mut(2)) {
+            o[0] = *l;
+            o[1] = *r;
+        }
+    }
+
+    /// See [`simd::deinterleave2`](../fn.deinterleave2.html).
+    pub fn deinterleave2(src: &[SampleT], left: &mut [SampleT], right: &mut [SampleT]) {
+        for ((s, l), r) in src.chunks_exact(2).zip(left.iter_mut()).zip(right.iter_mut()) {
+            *l = s[0];
+            *r = s[1];
+        }
+    }
+
+    /// See [`simd::from_i16`](../fn.from_i16.html).
+    pub fn from_i16(src: &[i16], dst: &mut [SampleT]) {
+        for (d, s) in dst.iter_mut().zip(src) {
+            *d = *s as SampleT / I16_SCALE;
+        }
+    }
+
+    /// See [`simd::from_i24`](../fn.from_i24.html).
+    pub fn from_i24(src: &[i32], dst: &mut [SampleT]) {
+        for (d, s) in dst.iter_mut().zip(src) {
+            *d = *s as SampleT / I24_SCALE;
+        }
+    }
+
+    /// See [`simd::to_i16`](../fn.to_i16.html).
+    pub fn to_i16(src: &[SampleT], dst: &mut [i16]) {
+        for (d, s) in dst.iter_mut().zip(src) {
+            *d = (*s * I16_SCALE).round() as i16;
+        }
+    }
+
+    /// See [`simd::biquad_lanes`](../fn.biquad_lanes.html).
+    pub fn biquad_lanes(x: &mut [Lanes], c: &mut [Lanes; 5], dc: Option<&[Lanes; 5]>, s: &mut [Lanes; 2]) {
+        for f in x {
+            for l in 0..LANES {
+                let y = c[0][l] * f[l] + s[0][l];
+                s[0][l] = c[1][l] * f[l] - c[3][l] * y + s[1][l];
+                s[1][l] = c[2][l] * f[l] - c[4][l] * y;
+                f[l] = y;
+            }
+
+            if let Some(dc) = dc {
+                for (c, dc) in c.iter_mut().zip(dc) {
+                    for (c, dc) in c.iter_mut().zip(dc) {
+                        *c += *dc;
+                    }
+                }
+            }
+        }
+    }
+}
+
+#[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+mod sse2 {
+    use super::*;
+    #[cfg(target_arch = "x86")]
+    use std::arch::x86::*;
+    #[cfg(target_arch = "x86_64")]
+    use std::arch::x86_64::*;
+
+    const W: usize = 4;
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn add(dst: &mut [SampleT], src: &[SampleT]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+
+        let mut i = 0;
+        while i < v {
+            _mm_storeu_ps(d.add(i), _mm_add_ps(_mm_loadu_ps(d.add(i)), _mm_loadu_ps(s.add(i))));
+            i += W;
+        }
+
+        scalar::add(&mut dst[v..n], &src[v..n]);
+    }
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn mix(dst: &mut [SampleT], src: &[SampleT], g: SampleT) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let gv = _mm_set1_ps(g);
+
+        let mut i = 0;
+        while i < v {
+            let x = _mm_mul_ps(_mm_loadu_ps(s.add(i)), gv);
+            _mm_storeu_ps(d.add(i), _mm_add_ps(_mm_loadu_ps(d.add(i)), x));
+            i += W;
+        }
+
+        scalar::mix(&mut dst[v..n], &src[v..n], g);
+    }
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn mix_ramp(dst: &mut [SampleT], src: &[SampleT], g: SampleT, dg: SampleT) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let (gv, dgv) = (_mm_set1_ps(g), _mm_set1_ps(dg));
+        let mut iv = _mm_setr_ps(0.0, 1.0, 2.0, 3.0);
+
+        let mut i = 0;
+        while i < v {
+            let x = _mm_mul_ps(_mm_loadu_ps(s.add(i)), _mm_add_ps(gv, _mm_mul_ps(dgv, iv)));
+            _mm_storeu_ps(d.add(i), _mm_add_ps(_mm_loadu_ps(d.add(i)), x));
+            iv = _mm_add_ps(iv, _mm_set1_ps(W as SampleT));
+            i += W;
+        }
+
+        for j in v..n {
+            dst[j] += src[j] * (g + dg * j as SampleT);
+        }
+    }
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn mul(dst: &mut [SampleT], g: SampleT) {
+        let n = dst.len();
+        let v = n - n % W;
+        let d = dst.as_mut_ptr();
+        let gv = _mm_set1_ps(g);
+
+        let mut i = 0;
+        while i < v {
+            _mm_storeu_ps(d.add(i), _mm_mul_ps(_mm_loadu_ps(d.add(i)), gv));
+            i += W;
+        }
+
+        scalar::mul(&mut dst[v..n], g);
+    }
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn pan(src: &[SampleT], left: &mut [SampleT], right: &mut [SampleT], gl: SampleT, gr: SampleT) {
+        let n = src.len().min(left.len()).min(right.len());
+        let v = n - n % W;
+        let (s, l, r) = (src.as_ptr(), left.as_mut_ptr(), right.as_mut_ptr());
+        let (glv, grv) = (_mm_set1_ps(gl), _mm_set1_ps(gr));
+
+        let mut i = 0;
+        while i < v {
+            let x = _mm_loadu_ps(s.add(i));
+            _mm_storeu_ps(l.add(i), _mm_mul_ps(x, glv));
+            _mm_storeu_ps(r.add(i), _mm_mul_ps(x, grv));
+            i += W;
+        }
+
+        scalar::pan(&src[v..n], &mut left[v..n], &mut right[v..n], gl, gr);
+    }
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn clip(dst: &mut [SampleT], lo: SampleT, hi: SampleT) {
+        let n = dst.len();
+        let v = n - n % W;
+        let d = dst.as_mut_ptr();
+        let (lov, hiv) = (_mm_set1_ps(lo), _mm_set1_ps(hi));
+
+        let mut i = 0;
+        while i < v {
+            _mm_storeu_ps(d.add(i), _mm_max_ps(_mm_min_ps(_mm_loadu_ps(d.add(i)), hiv), lov));
+            i += W;
+        }
+
+        scalar::clip(&mut dst[v..n], lo, hi);
+    }
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn interleave2(left: &[SampleT], right: &[SampleT], out: &mut [SampleT]) {
+        let n = left.len().min(right.len()).min(out.len() / 2);
+        let v = n - n % W;
+        let (l, r, o) = (left.as_ptr(), right.as_ptr(), out.as_mut_ptr());
+
+        let mut i = 0;
+        while i < v {
+            let (a, b) = (_mm_loadu_ps(l.add(i)), _mm_loadu_ps(r.add(i)));
+            _mm_storeu_ps(o.add(2 * i), _mm_unpacklo_ps(a, b));
+            _mm_storeu_ps(o.add(2 * i + W), _mm_unpackhi_ps(a, b));
+            i += W;
+        }
+
+        scalar::interleave2(&left[v..n], &right[v..n], &mut out[2 * v..2 * n]);
+    }
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn deinterleave2(src: &[SampleT], left: &mut [SampleT], right: &mut [SampleT]) {
+        let n = left.len().min(right.len()).min(src.len() / 2);
+        let v = n - n % W;
+        let (s, l, r) = (src.as_ptr(), left.as_mut_ptr(), right.as_mut_ptr());
+
+        let mut i = 0;
+        while i < v {
+            let (a, b) = (_mm_loadu_ps(s.add(2 * i)), _mm_loadu_ps(s.add(2 * i + W)));
+            _mm_storeu_ps(l.add(i), _mm_shuffle_ps(a, b, 0b10_00_10_00));
+            _mm_storeu_ps(r.add(i), _mm_shuffle_ps(a, b, 0b11_01_11_01));
+            i += W;
+        }
+
+        scalar::deinterleave2(&src[2 * v..2 * n], &mut left[v..n], &mut right[v..n]);
+    }
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn from_i16(src: &[i16], dst: &mut [SampleT]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % (2 * W);
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let scale = _mm_set1_ps(I16_SCALE);
+
+        let mut i = 0;
+        while i < v {
+            let x = _mm_loadu_si128(s.add(i) as *const __m128i);
+            let lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+            let hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+            _mm_storeu_ps(d.add(i), _mm_div_ps(_mm_cvtepi32_ps(lo), scale));
+            _mm_storeu_ps(d.add(i + W), _mm_div_ps(_mm_cvtepi32_ps(hi), scale));
+            i += 2 * W;
+        }
+
+        scalar::from_i16(&src[v..n], &mut dst[v..n]);
+    }
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn from_i24(src: &[i32], dst: &mut [SampleT]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let scale = _mm_set1_ps(I24_SCALE);
+
+        let mut i = 0;
+        while i < v {
+            let x = _mm_loadu_si128(s.add(i) as *const __m128i);
+            _mm_storeu_ps(d.add(i), _mm_div_ps(_mm_cvtepi32_ps(x), scale));
+            i += W;
+        }
+
+        scalar::from_i24(&src[v..n], &mut dst[v..n]);
+    }
+
+    /// Scales, saturates and rounds four samples half away from zero. SSE2
+    /// has no rounding instruction, so the value is truncated and then
+    /// adjusted by the (exact) fractional part.
+    #[target_feature(enable = "sse2")]
+    unsafe fn round_i16(x: __m128) -> __m128i {
+        let t = _mm_mul_ps(x, _mm_set1_ps(I16_SCALE));
+        let t = _mm_and_ps(t, _mm_cmpord_ps(t, t));
+        let t = _mm_min_ps(_mm_max_ps(t, _mm_set1_ps(-32768.0)), _mm_set1_ps(32767.0));
+        let i = _mm_cvttps_epi32(t);
+        let f = _mm_sub_ps(t, _mm_cvtepi32_ps(i));
+        let up = _mm_castps_si128(_mm_cmpge_ps(f, _mm_set1_ps(0.5)));
+        let down = _mm_castps_si128(_mm_cmple_ps(f, _mm_set1_ps(-0.5)));
+        _mm_add_epi32(_mm_sub_epi32(i, up), down)
+    }
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn to_i16(src: &[SampleT], dst: &mut [i16]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % (2 * W);
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+
+        let mut i = 0;
+        while i < v {
+            let lo = round_i16(_mm_loadu_ps(s.add(i)));
+            let hi = round_i16(_mm_loadu_ps(s.add(i + W)));
+            _mm_storeu_si128(d.add(i) as *mut __m128i, _mm_packs_epi32(lo, hi));
+            i += 2 * W;
+        }
+
+        scalar::to_i16(&src[v..n], &mut dst[v..n]);
+    }
+
+    /// Each group of `W` lanes runs over the whole block while its state and
+    /// coefficients are in registers.
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn biquad_lanes(x: &mut [Lanes], c: &mut [Lanes; 5], dc: Option<&[Lanes; 5]>, s: &mut [Lanes; 2]) {
+        let mut h = 0;
+        while h < LANES {
+            let mut k: [__m128; 5] = [_mm_setzero_ps(); 5];
+            let mut d: [__m128; 5] = [_mm_setzero_ps(); 5];
+            for i in 0..5 {
+                k[i] = _mm_loadu_ps(c[i].as_ptr().add(h));
+                if let Some(dc) = dc {
+                    d[i] = _mm_loadu_ps(dc[i].as_ptr().add(h));
+                }
+            }
+            let mut s0 = _mm_loadu_ps(s[0].as_ptr().add(h));
+            let mut s1 = _mm_loadu_ps(s[1].as_ptr().add(h));
+
+            for f in x.iter_mut() {
+                let p = f.as_mut_ptr().add(h);
+                let xv = _mm_loadu_ps(p);
+                let y = _mm_add_ps(_mm_mul_ps(k[0], xv), s0);
+                s0 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(k[1], xv), _mm_mul_ps(k[3], y)), s1);
+                s1 = _mm_sub_ps(_mm_mul_ps(k[2], xv), _mm_mul_ps(k[4], y));
+                _mm_storeu_ps(p, y);
+
+                if dc.is_some() {
+                    for i in 0..5 {
+                        k[i] = _mm_add_ps(k[i], d[i]);
+                    }
+                }
+            }
+
+            for i in 0..5 {
+                _mm_storeu_ps(c[i].as_mut_ptr().add(h), k[i]);
+            }
+            _mm_storeu_ps(s[0].as_mut_ptr().add(h), s0);
+            _mm_storeu_ps(s[1].as_mut_ptr().add(h), s1);
+
+            h += W;
+        }
+    }
+}
+
+#[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+mod avx2 {
+    use super::*;
+    #[cfg(target_arch = "x86")]
+    use std::arch::x86::*;
+    #[cfg(target_arch = "x86_64")]
+    use std::arch::x86_64::*;
+
+    const W: usize = 8;
+
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn add(dst: &mut [SampleT], src: &[SampleT]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+
+        let mut i = 0;
+        while i < v {
+            _mm256_storeu_ps(d.add(i), _mm256_add_ps(_mm256_loadu_ps(d.add(i)), _mm256_loadu_ps(s.add(i))));
+            i += W;
+        }
+
+        scalar::add(&mut dst[v..n], &src[v..n]);
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn mix(dst: &mut [SampleT], src: &[SampleT], g: SampleT) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let gv = _mm256_set1_ps(g);
+
+        let mut i = 0;
+        while i < v {
+            let x = _mm256_mul_ps(_mm256_loadu_ps(s.add(i)), gv);
+            _mm256_storeu_ps(d.add(i), _mm256_add_ps(_mm256_loadu_ps(d.add(i)), x));
+            i += W;
+        }
+
+        scalar::mix(&mut dst[v..n], &src[v..n], g);
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn mix_ramp(dst: &mut [SampleT], src: &[SampleT], g: SampleT, dg: SampleT) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let (gv, dgv) = (_mm256_set1_ps(g), _mm256_set1_ps(dg));
+        let mut iv = _mm256_setr_ps(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0);
+
+        let mut i = 0;
+        while i < v {
+            let x = _mm256_mul_ps(_mm256_loadu_ps(s.add(i)), _mm256_add_ps(gv, _mm256_mul_ps(dgv, iv)));
+            _mm256_storeu_ps(d.add(i), _mm256_add_ps(_mm256_loadu_ps(d.add(i)), x));
+            iv = _mm256_add_ps(iv, _mm256_set1_ps(W as SampleT));
+            i += W;
+        }
+
+        for j in v..n {
+            dst[j] += src[j] * (g + dg * j as SampleT);
+        }
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn mul(dst: &mut [SampleT], g: SampleT) {
+        let n = dst.len();
+        let v = n - n % W;
+        let d = dst.as_mut_ptr();
+        let gv = _mm256_set1_ps(g);
+
+        let mut i = 0;
+        while i < v {
+            _mm256_storeu_ps(d.add(i), _mm256_mul_ps(_mm256_loadu_ps(d.add(i)), gv));
+            i += W;
+        }
+
+        scalar::mul(&mut dst[v..n], g);
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn pan(src: &[SampleT], left: &mut [SampleT], right: &mut [SampleT], gl: SampleT, gr: SampleT) {
+        let n = src.len().min(left.len()).min(right.len());
+        let v = n - n % W;
+        let (s, l, r) = (src.as_ptr(), left.as_mut_ptr(), right.as_mut_ptr());
+        let (glv, grv) = (_mm256_set1_ps(gl), _mm256_set1_ps(gr));
+
+        let mut i = 0;
+        while i < v {
+            let x = _mm256_loadu_ps(s.add(i));
+            _mm256_storeu_ps(l.add(i), _mm256_mul_ps(x, glv));
+            _mm256_storeu_ps(r.add(i), _mm256_mul_ps(x, grv));
+            i += W;
+        }
+
+        scalar::pan(&src[v..n], &mut left[v..n], &mut right[v..n], gl, gr);
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn clip(dst: &mut [SampleT], lo: SampleT, hi: SampleT) {
+        let n = dst.len();
+        let v = n - n % W;
+        let d = dst.as_mut_ptr();
+        let (lov, hiv) = (_mm256_set1_ps(lo), _mm256_set1_ps(hi));
+
+        let mut i = 0;
+        while i < v {
+            _mm256_storeu_ps(d.add(i), _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(d.add(i)), hiv), lov));
+            i += W;
+        }
+
+        scalar::clip(&mut dst[v..n], lo, hi);
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn interleave2(left: &[SampleT], right: &[SampleT], out: &mut [SampleT]) {
+        let n = left.len().min(right.len()).min(out.len() / 2);
+        let v = n - n % W;
+        let (l, r, o) = (left.as_ptr(), right.as_ptr(), out.as_mut_ptr());
+
+        let mut i = 0;
+        while i < v {
+            let (a, b) = (_mm256_loadu_ps(l.add(i)), _mm256_loadu_ps(r.add(i)));
+            let (lo, hi) = (_mm256_unpacklo_ps(a, b), _mm256_unpackhi_ps(a, b));
+            _mm256_storeu_ps(o.add(2 * i), _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps(o.add(2 * i + W), _mm256_permute2f128_ps(lo, hi, 0x31));
+            i += W;
+        }
+
+        scalar::interleave2(&left[v..n], &right[v..n], &mut out[2 * v..2 * n]);
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn deinterleave2(src: &[SampleT], left: &mut [SampleT], right: &mut [SampleT]) {
+        let n = left.len().min(right.len()).min(src.len() / 2);
+        let v = n - n % W;
+        let (s, l, r) = (src.as_ptr(), left.as_mut_ptr(), right.as_mut_ptr());
+
+        let mut i = 0;
+        while i < v {
+            let (a, b) = (_mm256_loadu_ps(s.add(2 * i)), _mm256_loadu_ps(s.add(2 * i + W)));
+            let (lo, hi) = (_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31));
+            _mm256_storeu_ps(l.add(i), _mm256_shuffle_ps(lo, hi, 0b10_00_10_00));
+            _mm256_storeu_ps(r.add(i), _mm256_shuffle_ps(lo, hi, 0b11_01_11_01));
+            i += W;
+        }
+
+        scalar::deinterleave2(&src[2 * v..2 * n], &mut left[v..n], &mut right[v..n]);
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn from_i16(src: &[i16], dst: &mut [SampleT]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let scale = _mm256_set1_ps(I16_SCALE);
+
+        let mut i = 0;
+        while i < v {
+            let x = _mm256_cvtepi16_epi32(_mm_loadu_si128(s.add(i) as *const __m128i));
+            _mm256_storeu_ps(d.add(i), _mm256_div_ps(_mm256_cvtepi32_ps(x), scale));
+            i += W;
+        }
+
+        scalar::from_i16(&src[v..n], &mut dst[v..n]);
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn from_i24(src: &[i32], dst: &mut [SampleT]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let scale = _mm256_set1_ps(I24_SCALE);
+
+        let mut i = 0;
+        while i < v {
+            let x = _mm256_loadu_si256(s.add(i) as *const __m256i);
+            _mm256_storeu_ps(d.add(i), _mm256_div_ps(_mm256_cvtepi32_ps(x), scale));
+            i += W;
+        }
+
+        scalar::from_i24(&src[v..n], &mut dst[v..n]);
+    }
+
+    /// See `sse2::round_i16`.
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn to_i16(src: &[SampleT], dst: &mut [i16]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let scale = _mm256_set1_ps(I16_SCALE);
+        let (lo, hi) = (_mm256_set1_ps(-32768.0), _mm256_set1_ps(32767.0));
+        let (half, neg_half) = (_mm256_set1_ps(0.5), _mm256_set1_ps(-0.5));
+
+        let mut i = 0;
+        while i < v {
+            let t = _mm256_mul_ps(_mm256_loadu_ps(s.add(i)), scale);
+            let t = _mm256_and_ps(t, _mm256_cmp_ps(t, t, _CMP_ORD_Q));
+            let t = _mm256_min_ps(_mm256_max_ps(t, lo), hi);
+            let x = _mm256_cvttps_epi32(t);
+            let f = _mm256_sub_ps(t, _mm256_cvtepi32_ps(x));
+            let up = _mm256_castps_si256(_mm256_cmp_ps(f, half, _CMP_GE_OQ));
+            let down = _mm256_castps_si256(_mm256_cmp_ps(f, neg_half, _CMP_LE_OQ));
+            let x = _mm256_add_epi32(_mm256_sub_epi32(x, up), down);
+            let packed = _mm_packs_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+            _mm_storeu_si128(d.add(i) as *mut __m128i, packed);
+            i += W;
+        }
+
+        scalar::to_i16(&src[v..n], &mut dst[v..n]);
+    }
+
+    /// Each group of `W` lanes runs over the whole block while its state and
+    /// coefficients are in registers.
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn biquad_lanes(x: &mut [Lanes], c: &mut [Lanes; 5], dc: Option<&[Lanes; 5]>, s: &mut [Lanes; 2]) {
+        let mut h = 0;
+        while h < LANES {
+            let mut k: [__m256; 5] = [_mm256_setzero_ps(); 5];
+            let mut d: [__m256; 5] = [_mm256_setzero_ps(); 5];
+            for i in 0..5 {
+                k[i] = _mm256_loadu_ps(c[i].as_ptr().add(h));
+                if let Some(dc) = dc {
+                    d[i] = _mm256_loadu_ps(dc[i].as_ptr().add(h));
+                }
+            }
+            let mut s0 = _mm256_loadu_ps(s[0].as_ptr().add(h));
+            let mut s1 = _mm256_loadu_ps(s[1].as_ptr().add(h));
+
+            for f in x.iter_mut() {
+                let p = f.as_mut_ptr().add(h);
+                let xv = _mm256_loadu_ps(p);
+                let y = _mm256_add_ps(_mm256_mul_ps(k[0], xv), s0);
+                s0 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(k[1], xv), _mm256_mul_ps(k[3], y)), s1);
+                s1 = _mm256_sub_ps(_mm256_mul_ps(k[2], xv), _mm256_mul_ps(k[4], y));
+                _mm256_storeu_ps(p, y);
+
+                if dc.is_some() {
+                    for i in 0..5 {
+                        k[i] = _mm256_add_ps(k[i], d[i]);
+                    }
+                }
+            }
+
+            for i in 0..5 {
+                _mm256_storeu_ps(c[i].as_mut_ptr().add(h), k[i]);
+            }
+            _mm256_storeu_ps(s[0].as_mut_ptr().add(h), s0);
+            _mm256_storeu_ps(s[1].as_mut_ptr().add(h), s1);
+
+            h += W;
+        }
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+mod neon {
+    use super::*;
+    use std::arch::aarch64::*;
+
+    const W: usize = 4;
+
+    #[target_feature(enable = "neon")]
+    pub unsafe fn add(dst: &mut [SampleT], src: &[SampleT]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+
+        let mut i = 0;
+        while i < v {
+            vst1q_f32(d.add(i), vaddq_f32(vld1q_f32(d.add(i)), vld1q_f32(s.add(i))));
+            i += W;
+        }
+
+        scalar::add(&mut dst[v..n], &src[v..n]);
+    }
+
+    #[target_feature(enable = "neon")]
+    pub unsafe fn mix(dst: &mut [SampleT], src: &[SampleT], g: SampleT) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let gv = vdupq_n_f32(g);
+
+        let mut i = 0;
+        while i < v {
+            let x = vmulq_f32(vld1q_f32(s.add(i)), gv);
+            vst1q_f32(d.add(i), vaddq_f32(vld1q_f32(d.add(i)), x));
+            i += W;
+        }
+
+        scalar::mix(&mut dst[v..n], &src[v..n], g);
+    }
+
+    #[target_feature(enable = "neon")]
+    pub unsafe fn mix_ramp(dst: &mut [SampleT], src: &[SampleT], g: SampleT, dg: SampleT) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let (gv, dgv) = (vdupq_n_f32(g), vdupq_n_f32(dg));
+        let mut iv = vld1q_f32([0.0, 1.0, 2.0, 3.0].as_ptr());
+
+        let mut i = 0;
+        while i < v {
+            let x = vmulq_f32(vld1q_f32(s.add(i)), vaddq_f32(gv, vmulq_f32(dgv, iv)));
+            vst1q_f32(d.add(i), vaddq_f32(vld1q_f32(d.add(i)), x));
+            iv = vaddq_f32(iv, vdupq_n_f32(W as SampleT));
+            i += W;
+        }
+
+        for j in v..n {
+            dst[j] += src[j] * (g + dg * j as SampleT);
+        }
+    }
+
+    #[target_feature(enable = "neon")]
+    pub unsafe fn mul(dst: &mut [SampleT], g: SampleT) {
+        let n = dst.len();
+        let v = n - n % W;
+        let d = dst.as_mut_ptr();
+        let gv = vdupq_n_f32(g);
+
+        let mut i = 0;
+        while i < v {
+            vst1q_f32(d.add(i), vmulq_f32(vld1q_f32(d.add(i)), gv));
+            i += W;
+        }
+
+        scalar::mul(&mut dst[v..n], g);
+    }
+
+    #[target_feature(enable = "neon")]
+    pub unsafe fn pan(src: &[SampleT], left: &mut [SampleT], right: &mut [SampleT], gl: SampleT, gr: SampleT) {
+        let n = src.len().min(left.len()).min(right.len());
+        let v = n - n % W;
+        let (s, l, r) = (src.as_ptr(), left.as_mut_ptr(), right.as_mut_ptr());
+        let (glv, grv) = (vdupq_n_f32(gl), vdupq_n_f32(gr));
+
+        let mut i = 0;
+        while i < v {
+            let x = vld1q_f32(s.add(i));
+            vst1q_f32(l.add(i), vmulq_f32(x, glv));
+            vst1q_f32(r.add(i), vmulq_f32(x, grv));
+            i += W;
+        }
+
+        scalar::pan(&src[v..n], &mut left[v..n], &mut right[v..n], gl, gr);
+    }
+
+    /// Uses compare-and-select rather than `vminq`/`vmaxq`, which propagate
+    /// NaN, to match the ordering of the scalar kernel.
+    #[target_feature(enable = "neon")]
+    pub unsafe fn clip(dst: &mut [SampleT], lo: SampleT, hi: SampleT) {
+        let n = dst.len();
+        let v = n - n % W;
+        let d = dst.as_mut_ptr();
+        let (lov, hiv) = (vdupq_n_f32(lo), vdupq_n_f32(hi));
+
+        let mut i = 0;
+        while i < v {
+            let x = vld1q_f32(d.add(i));
+            let x = vbslq_f32(vcltq_f32(x, hiv), x, hiv);
+            vst1q_f32(d.add(i), vbslq_f32(vcgtq_f32(x, lov), x, lov));
+            i += W;
+        }
+
+        scalar::clip(&mut dst[v..n], lo, hi);
+    }
+
+    #[target_feature(enable = "neon")]
+    pub unsafe fn interleave2(left: &[SampleT], right: &[SampleT], out: &mut [SampleT]) {
+        let n = left.len().min(right.len()).min(out.len() / 2);
+        let v = n - n % W;
+        let (l, r, o) = (left.as_ptr(), right.as_ptr(), out.as_mut_ptr());
+
+        let mut i = 0;
+        while i < v {
+            vst2q_f32(o.add(2 * i), float32x4x2_t(vld1q_f32(l.add(i)), vld1q_f32(r.add(i))));
+            i += W;
+        }
+
+        scalar::interleave2(&left[v..n], &right[v..n], &mut out[2 * v..2 * n]);
+    }
+
+    #[target_feature(enable = "neon")]
+    pub unsafe fn deinterleave2(src: &[SampleT], left: &mut [SampleT], right: &mut [SampleT]) {
+        let n = left.len().min(right.len()).min(src.len() / 2);
+        let v = n - n % W;
+        let (s, l, r) = (src.as_ptr(), left.as_mut_ptr(), right.as_mut_ptr());
+
+        let mut i = 0;
+        while i < v {
+            let x = vld2q_f32(s.add(2 * i));
+            vst1q_f32(l.add(i), x.0);
+            vst1q_f32(r.add(i), x.1);
+            i += W;
+        }
+
+        scalar::deinterleave2(&src[2 * v..2 * n], &mut left[v..n], &mut right[v..n]);
+    }
+
+    #[target_feature(enable = "neon")]
+    pub unsafe fn from_i16(src: &[i16], dst: &mut [SampleT]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % (2 * W);
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let scale = vdupq_n_f32(I16_SCALE);
+
+        let mut i = 0;
+        while i < v {
+            let x = vld1q_s16(s.add(i));
+            let lo = vmovl_s16(vget_low_s16(x));
+            let hi = vmovl_high_s16(x);
+            vst1q_f32(d.add(i), vdivq_f32(vcvtq_f32_s32(lo), scale));
+            vst1q_f32(d.add(i + W), vdivq_f32(vcvtq_f32_s32(hi), scale));
+            i += 2 * W;
+        }
+
+        scalar::from_i16(&src[v..n], &mut dst[v..n]);
+    }
+
+    #[target_feature(enable = "neon")]
+    pub unsafe fn from_i24(src: &[i32], dst: &mut [SampleT]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % W;
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let scale = vdupq_n_f32(I24_SCALE);
+
+        let mut i = 0;
+        while i < v {
+            vst1q_f32(d.add(i), vdivq_f32(vcvtq_f32_s32(vld1q_s32(s.add(i))), scale));
+            i += W;
+        }
+
+        scalar::from_i24(&src[v..n], &mut dst[v..n]);
+    }
+
+    /// `vcvtaq` rounds half away from zero and saturates, and the narrowing
+    /// saturates again, matching a rounded `as i16` cast exactly.
+    #[target_feature(enable = "neon")]
+    pub unsafe fn to_i16(src: &[SampleT], dst: &mut [i16]) {
+        let n = dst.len().min(src.len());
+        let v = n - n % (2 * W);
+        let (d, s) = (dst.as_mut_ptr(), src.as_ptr());
+        let scale = vdupq_n_f32(I16_SCALE);
+
+        let mut i = 0;
+        while i < v {
+            let lo = vcvtaq_s32_f32(vmulq_f32(vld1q_f32(s.add(i)), scale));
+            let hi = vcvtaq_s32_f32(vmulq_f32(vld1q_f32(s.add(i + W)), scale));
+            vst1q_s16(d.add(i), vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+            i += 2 * W;
+        }
+
+        scalar::to_i16(&src[v..n], &mut dst[v..n]);
+    }
+
+    /// Each group of `W` lanes runs over the whole block while its state and
+    /// coefficients are in registers.
+    #[target_feature(enable = "neon")]
+    pub unsafe fn biquad_lanes(x: &mut [Lanes], c: &mut [Lanes; 5], dc: Option<&[Lanes; 5]>, s: &mut [Lanes; 2]) {
+        let mut h = 0;
+        while h < LANES {
+            let mut k: [float32x4_t; 5] = [vdupq_n_f32(0.0); 5];
+            let mut d: [float32x4_t; 5] = [vdupq_n_f32(0.0); 5];
+            for i in 0..5 {
+                k[i] = vld1q_f32(c[i].as_ptr().add(h));
+                if let Some(dc) = dc {
+                    d[i] = vld1q_f32(dc[i].as_ptr().add(h));
+                }
+            }
+            let mut s0 = vld1q_f32(s[0].as_ptr().add(h));
+            let mut s1 = vld1q_f32(s[1].as_ptr().add(h));
+
+            for f in x.iter_mut() {
+                let p = f.as_mut_ptr().add(h);
+                let xv = vld1q_f32(p);
+                let y = vaddq_f32(vmulq_f32(k[0], xv), s0);
+                s0 = vaddq_f32(vsubq_f32(vmulq_f32(k[1], xv), vmulq_f32(k[3], y)), s1);
+                s1 = vsubq_f32(vmulq_f32(k[2], xv), vmulq_f32(k[4], y));
+                vst1q_f32(p, y);
+
+                if dc.is_some() {
+                    for i in 0..5 {
+                        k[i] = vaddq_f32(k[i], d[i]);
+                    }
+                }
+            }
+
+            for i in 0..5 {
+                vst1q_f32(c[i].as_mut_ptr().add(h), k[i]);
+            }
+            vst1q_f32(s[0].as_mut_ptr().add(h), s0);
+            vst1q_f32(s[1].as_mut_ptr().add(h), s1);
+
+            h += W;
+        }
+    }
+}
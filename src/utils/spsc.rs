@@ -0,0 +1,162 @@
+//! # SPSC
+//!
+//! Wait-free, bounded, single-producer single-consumer queue used to hand
+//! objects between a control thread and the render thread without locking.
+
+use std::cell::UnsafeCell;
+use std::mem::MaybeUninit;
+use std::sync::Arc;
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+/// Storage shared between a [`Producer`] and its [`Consumer`].
+///
+/// `head` is only written by the consumer and `tail` only by the producer.
+/// Both increase monotonically (wrapping), and the number of queued elements
+/// is always `tail - head`.
+///
+/// [`Producer`]: struct.Producer.html
+/// [`Consumer`]: struct.Consumer.html
+struct Ring<T> {
+    buffer: Box<[UnsafeCell<MaybeUninit<T>>]>,
+    mask: usize,
+    head: AtomicUsize,
+    tail: AtomicUsize,
+}
+
+unsafe impl<T: Send> Send for Ring<T> {}
+unsafe impl<T: Send> Sync for Ring<T> {}
+
+impl<T> Drop for Ring<T> {
+    fn drop(&mut self) {
+        let head = *self.head.get_mut();
+        let tail = *self.tail.get_mut();
+
+        let mut i = head;
+        while i != tail {
+            unsafe {
+                std::ptr::drop_in_place((*self.buffer[i & self.mask].get()).as_mut_ptr());
+            }
+            i = i.wrapping_add(1);
+        }
+    }
+}
+
+/// The sending half of a queue created with [`spsc`].
+///
+/// [`spsc`]: fn.spsc.html
+pub struct Producer<T> {
+    ring: Arc<Ring<T>>,
+}
+
+/// The receiving half of a queue created with [`spsc`].
+///
+/// [`spsc`]: fn.spsc.html
+pub struct Consumer<T> {
+    ring: Arc<Ring<T>>,
+}
+
+/// Creates a new queue able to hold at least `capacity` elements, returning
+/// its sending and receiving halves. The capacity is rounded up to the next
+/// power of two.
+///
+/// All memory is allocated here; pushing and popping never allocate, lock, or
+/// wait on the other half.
+pub fn spsc<T>(capacity: usize) -> (Producer<T>, Consumer<T>) {
+    let capacity = capacity.max(1).next_power_of_two();
+
+    let mut buffer = Vec::with_capacity(capacity);
+    buffer.resize_with(capacity, || UnsafeCell::new(MaybeUninit::uninit()));
+
+    let ring = Arc::new(Ring {
+        buffer: buffer.into_boxed_slice(),
+        mask: capacity - 1,
+        head: AtomicUsize::new(0),
+        tail: AtomicUsize::new(0),
+    });
+
+    (
+        Producer {
+            ring: ring.clone(),
+        },
+        Consumer {
+            ring,
+        }
+    )
+}
+
+impl<T> Producer<T> {
+    /// Pushes a value onto the queue. If the queue is full, the value is
+    /// handed back in the `Err` variant.
+    pub fn push(&mut self, v: T) -> Result<(), T> {
+        let ring = &*self.ring;
+
+        let tail = ring.tail.load(Ordering::Relaxed);
+        let head = ring.head.load(Ordering::Acquire);
+
+        if tail.wrapping_sub(head) > ring.mask {
+            return Err(v);
+        }
+
+        unsafe {
+            (*ring.buffer[tail & ring.mask].get()).as_mut_ptr().write(v);
+        }
+
+        ring.tail.store(tail.wrapping_add(1), Ordering::Release);
+
+        Ok(())
+    }
+
+    /// Returns the number of values that can be pushed before the queue is
+    /// full.
+    pub fn free_space(&self) -> usize {
+        let ring = &*self.ring;
+
+        ring.mask + 1 - ring.tail.load(Ordering::Relaxed)
+            .wrapping_sub(ring.head.load(Ordering::Acquire))
+    }
+
+    /// Returns the total number of values the queue can hold.
+    pub fn capacity(&self) -> usize {
+        self.ring.mask + 1
+    }
+}
+
+impl<T> Consumer<T> {
+    /// Pops the oldest value from the queue, or returns `None` if it is empty.
+    pub fn pop(&mut self) -> Option<T> {
+        let ring = &*self.ring;
+
+        let head = ring.head.load(Ordering::Relaxed);
+        let tail = ring.tail.load(Ordering::Acquire);
+
+        if head == tail {
+            return None;
+        }
+
+        let v = unsafe {
+            (*ring.buffer[head & ring.mask].get()).as_ptr().read()
+        };
+
+        ring.head.store(head.wrapping_add(1), Ordering::Release);
+
+        Some(v)
+    }
+
+    /// Returns the number of values currently in the queue.
+    pub fn len(&self) -> usize {
+        let ring = &*self.ring;
+
+        ring.tail.load(Ordering::Acquire)
+            .wrapping_sub(ring.head.load(Ordering::Relaxed))
+    }
+
+    /// Returns whether the queue is currently empty.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Returns the total number of values the queue can hold.
+    pub fn capacity(&self) -> usize {
+        self.ring.mask + 1
+    }
+}
@@ -0,0 +1,601 @@
+//! # WAV Stream
+//! 
+//! Streaming access to the audio data of WAV files. The header of a file is
+//! parsed once into a shared [`WavAsset`], and each [`WavStream`] opened from
+//! it decodes the file in small chunks on a background thread, handing them to
+//! the render thread through a bounded, wait-free ring. Only the chunks
+//! currently queued are ever held in memory, no matter how long the file is.
+//! 
+//! [`WavAsset`]: struct.WavAsset.html
+//! [`WavStream`]: struct.WavStream.html
+
+use super::*;
+use super::spsc::*;
+use std::io::{Read, Seek, SeekFrom, Error, ErrorKind};
+use std::path::{Path, PathBuf};
+use std::sync::Arc;
+use std::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::thread::Thread;
+
+/// Number of frames decoded into each chunk of a [`WavStream`].
+/// 
+/// [`WavStream`]: struct.WavStream.html
+pub const STREAM_CHUNK_FRAMES: usize = 4096;
+
+/// Default number of chunks a [`WavStream`] keeps decoded ahead of playback.
+/// 
+/// [`WavStream`]: struct.WavStream.html
+pub const STREAM_CHUNKS: usize = 4;
+
+/// Encoding of the samples in the data chunk of a WAV file.
+#[derive(Copy,Clone,Debug,PartialEq,Eq)]
+pub enum WavEncoding {
+    /// Unsigned 8-bit integer PCM.
+    U8,
+    /// Signed 16-bit integer PCM.
+    I16,
+    /// Signed 24-bit integer PCM, packed in three bytes.
+    I24,
+    /// 32-bit IEEE floating point.
+    F32,
+}
+
+/// The parts of a WAV header needed to stream its data.
+#[derive(Copy,Clone,Debug,PartialEq,Eq)]
+pub struct WavInfo {
+    /// Encoding of each sample.
+    pub encoding: WavEncoding,
+    /// Number of interleaved channels.
+    pub channels: u16,
+    /// Sample rate the file was recorded at.
+    pub sampling_rate: u32,
+    /// Size of one frame (a sample for every channel) in bytes.
+    pub block_align: u16,
+    /// Byte offset of the first frame in the file.
+    pub data_offset: u64,
+    /// Number of frames in the file.
+    pub frames: u64,
+}
+
+impl WavInfo {
+    /// Parses the RIFF header of a WAV file, leaving `s` at an unspecified
+    /// position.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if:
+    /// * The source can't be read.
+    /// * The source isn't a RIFF WAVE file.
+    /// * The file has no `fmt ` or `data` chunk.
+    /// * The samples aren't 8, 16, or 24-bit integer PCM or 32-bit float.
+    pub fn parse<R: Read + Seek>(s: &mut R) -> std::io::Result<WavInfo> {
+        let invalid = |m: &str| Error::new(ErrorKind::InvalidData, m.to_string());
+
+        let mut riff = [0u8; 12];
+        s.read_exact(&mut riff)?;
+        if &riff[0..4] != b"RIFF" || &riff[8..12] != b"WAVE" {
+            return Err(invalid("Not a RIFF WAVE file, aborting."));
+        }
+
+        let mut fmt = None;
+        let mut pos = 12u64;
+
+        loop {
+            let mut ch = [0u8; 8];
+            s.read_exact(&mut ch)?;
+            let size = u32::from_le_bytes([ch[4], ch[5], ch[6], ch[7]]) as u64;
+            pos += 8;
+
+            match &ch[0..4] {
+                b"fmt " => {
+                    let mut f = [0u8; 40];
+                    let n = (size as usize).min(f.len());
+                    s.read_exact(&mut f[..n])?;
+                    if n < 16 {
+                        return Err(invalid("Truncated fmt chunk, aborting."));
+                    }
+
+                    let u16_at = |i: usize| u16::from_le_bytes([f[i], f[i + 1]]);
+                    let mut tag = u16_at(0);
+                    if tag == 0xFFFE && n >= 26 {
+                        // WAVE_FORMAT_EXTENSIBLE stores the real tag at the
+                        // start of the sub-format GUID.
+                        tag = u16_at(24);
+                    }
+
+                    let bits = u16_at(14);
+                    let encoding = match (tag, bits) {
+                        (1, 8) => WavEncoding::U8,
+                        (1, 16) => WavEncoding::I16,
+                        (1, 24) => WavEncoding::I24,
+                        (3, 32) => WavEncoding::F32,
+                        _ => return Err(invalid("Unsupported sample encoding, aborting.")),
+                    };
+
+                    fmt = Some((encoding, u16_at(2), u32::from_le_bytes([f[4], f[5], f[6], f[7]]), u16_at(12)));
+                },
+                b"data" => {
+                    let (encoding, channels, sampling_rate, block_align) = fmt
+                        .ok_or_else(|| invalid("Data chunk before fmt chunk, aborting."))?;
+                    if channels == 0 || block_align == 0 {
+                        return Err(invalid("File has no channels, aborting."));
+                    }
+
+                    // Clamp the size to the real file length, as streaming
+                    // writers often leave it unset.
+                    let end = s.seek(SeekFrom::End(0))?;
+                    let size = size.min(end.saturating_sub(pos));
+
+                    return Ok(WavInfo {
+                        encoding,
+                        channels,
+                        sampling_rate,
+                        block_align,
+                        data_offset: pos,
+                        frames: size / block_align as u64,
+                    });
+                },
+                _ => (),
+            }
+
+            // Chunks are padded to an even number of bytes.
+            pos += size + (size & 1);
+            s.seek(SeekFrom::Start(pos))?;
+        }
+    }
+
+    /// Decodes the first channel of each whole frame in `bytes` into `out`,
+    /// returning the number of frames decoded.
+    pub fn decode_first_channel(&self, bytes: &[u8], out: &mut [SampleT]) -> usize {
+        use crate::sample_format::*;
+
+        let frames = bytes.chunks_exact(self.block_align as usize);
+        let n = frames.len().min(out.len());
+
+        for (o, f) in out.iter_mut().zip(frames) {
+            *o = match self.encoding {
+                WavEncoding::U8 => sample_from_u8(f[0]),
+                WavEncoding::I16 => sample_from_i16_bytes([f[0], f[1]]),
+                WavEncoding::I24 => sample_from_i24_bytes([f[0], f[1], f[2]]),
+                WavEncoding::F32 => SampleT::from_le_bytes([f[0], f[1], f[2], f[3]]),
+            };
+        }
+
+        n
+    }
+}
+
+/// Where a [`WavAsset`] reads its bytes from.
+/// 
+/// [`WavAsset`]: struct.WavAsset.html
+enum Source {
+    File(PathBuf),
+    Memory(Arc<[u8]>),
+}
+
+/// Object safe reader used by the prefetch thread.
+trait ReadSeek: Read + Seek + Send {}
+impl<T: Read + Seek + Send> ReadSeek for T {}
+
+/// A WAV file whose header has been parsed, shared between any number of
+/// [`WavStream`]s. Each stream opens its own handle to the file, so the data
+/// itself is shared through the operating system's page cache rather than
+/// being copied into every voice.
+/// 
+/// [`WavStream`]: struct.WavStream.html
+pub struct WavAsset {
+    source: Source,
+    info: WavInfo,
+}
+
+impl WavAsset {
+    /// Parses the header of the WAV file at the given path.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if the file can't be opened, or under any of the
+    /// conditions of [`WavInfo::parse`].
+    /// 
+    /// [`WavInfo::parse`]: struct.WavInfo.html#method.parse
+    pub fn open<P: AsRef<Path>>(path: P) -> std::io::Result<Arc<WavAsset>> {
+        let path = path.as_ref().to_path_buf();
+        let info = WavInfo::parse(&mut std::fs::File::open(&path)?)?;
+
+        Ok(Arc::new(WavAsset {
+            source: Source::File(path),
+            info,
+        }))
+    }
+
+    /// Parses the header of a WAV file already held in memory, such as one
+    /// embedded with [`include_bytes`].
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails under any of the conditions of [`WavInfo::parse`].
+    /// 
+    /// [`include_bytes`]: https://doc.rust-lang.org/std/macro.include_bytes.html
+    /// [`WavInfo::parse`]: struct.WavInfo.html#method.parse
+    pub fn from_bytes(bytes: Arc<[u8]>) -> std::io::Result<Arc<WavAsset>> {
+        let info = WavInfo::parse(&mut std::io::Cursor::new(&bytes[..]))?;
+
+        Ok(Arc::new(WavAsset {
+            source: Source::Memory(bytes),
+            info,
+        }))
+    }
+
+    /// Returns the parsed header.
+    pub fn info(&self) -> &WavInfo {
+        &self.info
+    }
+
+    fn reader(&self) -> std::io::Result<Box<dyn ReadSeek>> {
+        Ok(match &self.source {
+            Source::File(p) => Box::new(std::io::BufReader::new(std::fs::File::open(p)?)),
+            Source::Memory(b) => Box::new(std::io::Cursor::new(b.clone())),
+        })
+    }
+}
+
+/// A chunk of decoded frames handed from the prefetch thread to the render
+/// thread.
+struct Chunk {
+    /// The seek generation the chunk was decoded for.
+    epoch: u64,
+    len: usize,
+    data: Box<[SampleT]>,
+}
+
+/// State shared between a [`WavStream`] and its prefetch thread.
+/// 
+/// [`WavStream`]: struct.WavStream.html
+struct Shared {
+    /// Incremented by the stream for every seek.
+    epoch: AtomicU64,
+    /// Frame to restart decoding from, valid once `epoch` changes.
+    seek_to: AtomicU64,
+    loop_start: AtomicU64,
+    loop_end: AtomicU64,
+    /// Set to `epoch + 1` once the prefetch thread has decoded every frame
+    /// of that generation.
+    ended: AtomicU64,
+    /// Set once the prefetch thread has stopped on an IO error.
+    failed: AtomicBool,
+    shutdown: AtomicBool,
+    underruns: AtomicUsize,
+}
+
+/// Render side of a streamed WAV file. Reads frames of the first channel in
+/// order, wrapping between the loop points if they are set.
+/// 
+/// Reading, seeking, and changing loop points never block or allocate. If the
+/// prefetch thread falls behind, the missing frames are read as silence and
+/// counted in [`underruns`].
+/// 
+/// The prefetch thread sleeps while the ring is full or the stream has ended,
+/// and is only woken when a chunk is handed back to it, on a seek, on a change
+/// of the loop points, or when the stream is dropped, so idle streams cost no
+/// CPU time.
+/// 
+/// [`underruns`]: struct.WavStream.html#method.underruns
+pub struct WavStream {
+    asset: Arc<WavAsset>,
+    shared: Arc<Shared>,
+    chunks: Consumer<Chunk>,
+    recycle: Producer<Box<[SampleT]>>,
+    current: Option<Chunk>,
+    pos: usize,
+    epoch: u64,
+    depth: usize,
+    prefetch: Thread,
+}
+
+impl WavStream {
+    /// Opens a new stream of the given asset with the default prefetch depth
+    /// of [`STREAM_CHUNKS`] chunks.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if the asset's file can't be opened.
+    /// 
+    /// [`STREAM_CHUNKS`]: constant.STREAM_CHUNKS.html
+    pub fn new(asset: Arc<WavAsset>) -> std::io::Result<Self> {
+        WavStream::with_depth(asset, STREAM_CHUNKS)
+    }
+
+    /// Opens a new stream of the given asset which keeps up to `chunks` chunks
+    /// of [`STREAM_CHUNK_FRAMES`] frames decoded ahead of playback. All chunk
+    /// memory is allocated here.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if the asset's file can't be opened.
+    /// 
+    /// [`STREAM_CHUNK_FRAMES`]: constant.STREAM_CHUNK_FRAMES.html
+    pub fn with_depth(asset: Arc<WavAsset>, chunks: usize) -> std::io::Result<Self> {
+        let reader = asset.reader()?;
+        let chunks = chunks.max(2);
+
+        let shared = Arc::new(Shared {
+            epoch: AtomicU64::new(0),
+            seek_to: AtomicU64::new(0),
+            loop_start: AtomicU64::new(0),
+            loop_end: AtomicU64::new(0),
+            ended: AtomicU64::new(0),
+            failed: AtomicBool::new(false),
+            shutdown: AtomicBool::new(false),
+            underruns: AtomicUsize::new(0),
+        });
+
+        let (chunk_tx, chunk_rx) = spsc(chunks);
+        let (mut recycle_tx, recycle_rx) = spsc(chunks);
+
+        for _ in 0..chunks {
+            let _ = recycle_tx.push(vec![SampleT::default(); STREAM_CHUNK_FRAMES].into_boxed_slice());
+        }
+
+        let prefetch = Prefetch {
+            info: asset.info,
+            shared: shared.clone(),
+            reader,
+            chunks: chunk_tx,
+            recycle: recycle_rx,
+            bytes: vec![0; STREAM_CHUNK_FRAMES * asset.info.block_align as usize],
+        };
+
+        let prefetch = std::thread::Builder::new()
+            .name("bae wav prefetch".to_string())
+            .spawn(move || prefetch.run())?
+            .thread()
+            .clone();
+
+        Ok(WavStream {
+            asset,
+            shared,
+            chunks: chunk_rx,
+            recycle: recycle_tx,
+            current: None,
+            pos: 0,
+            epoch: 0,
+            depth: chunks,
+            prefetch,
+        })
+    }
+
+    /// Returns the asset being streamed.
+    pub fn asset(&self) -> &Arc<WavAsset> {
+        &self.asset
+    }
+
+    /// Reads the next frames into `out`, filling any that haven't been decoded
+    /// yet with silence.
+    pub fn read(&mut self, out: &mut [SampleT]) {
+        let mut i = 0;
+
+        while i < out.len() {
+            if let Some(c) = &self.current {
+                let n = (c.len - self.pos).min(out.len() - i);
+                out[i..i + n].copy_from_slice(&c.data[self.pos..self.pos + n]);
+                self.pos += n;
+                i += n;
+
+                if self.pos < c.len {
+                    continue;
+                }
+
+                self.release();
+            }
+
+            if !self.next_chunk() {
+                if !self.is_finished() {
+                    self.shared.underruns.fetch_add(1, Ordering::Relaxed);
+                }
+
+                for x in &mut out[i..] {
+                    *x = SampleT::default();
+                }
+                return;
+            }
+        }
+    }
+
+    /// Restarts playback from the given frame. Frames queued from before the
+    /// seek are discarded, and their chunks handed back to the prefetch
+    /// thread to be filled from the new position.
+    pub fn seek(&mut self, frame: u64) {
+        self.release();
+        while let Some(c) = self.chunks.pop() {
+            self.recycle(c.data);
+        }
+        self.epoch += 1;
+
+        self.shared.seek_to.store(frame, Ordering::Relaxed);
+        self.shared.epoch.store(self.epoch, Ordering::Release);
+        self.prefetch.unpark();
+    }
+
+    /// Sets the loop points, in frames of the source file. Once decoding
+    /// reaches `loop_end` it continues from `loop_start`. If `loop_end` is 0,
+    /// no looping is done. If `loop_end` is less than `loop_start`, they are
+    /// swapped.
+    /// 
+    /// Frames already decoded are unaffected, so the change is heard after at
+    /// most the prefetch depth.
+    pub fn set_loop_points(&mut self, mut loop_start: u64, mut loop_end: u64) {
+        if loop_end < loop_start {
+            std::mem::swap(&mut loop_start, &mut loop_end);
+        }
+
+        // The end is stored first so the prefetch thread never sees a start
+        // past the end.
+        self.shared.loop_end.store(0, Ordering::Relaxed);
+        self.shared.loop_start.store(loop_start, Ordering::Relaxed);
+        self.shared.loop_end.store(loop_end, Ordering::Release);
+        self.prefetch.unpark();
+    }
+
+    /// Returns the loop points, in frames of the source file.
+    pub fn get_loop_points(&self) -> (u64, u64) {
+        (
+            self.shared.loop_start.load(Ordering::Relaxed),
+            self.shared.loop_end.load(Ordering::Relaxed),
+        )
+    }
+
+    /// Returns true once every frame up to the end of the file has been read,
+    /// or every frame decoded before reading the file failed. A looping
+    /// stream never finishes unless it fails.
+    pub fn is_finished(&self) -> bool {
+        self.current.is_none()
+            && self.chunks.is_empty()
+            && (self.shared.ended.load(Ordering::Acquire) == self.epoch + 1 || self.has_failed())
+    }
+
+    /// Returns true if the prefetch thread stopped because reading the file
+    /// failed, as when it was truncated or removed while being streamed. No
+    /// more frames are decoded after a failure, even after a seek.
+    pub fn has_failed(&self) -> bool {
+        self.shared.failed.load(Ordering::Acquire)
+    }
+
+    /// Returns true once the prefetch thread can't decode any further ahead:
+    /// either every frame up to the end of the file has been decoded since
+    /// the last seek, reading the file failed, or every chunk is holding
+    /// decoded frames. A chunk still
+    /// being decoded when the stream was sought counts until it is read.
+    pub fn is_prefetched(&self) -> bool {
+        self.shared.ended.load(Ordering::Acquire) == self.epoch + 1
+            || self.has_failed()
+            || self.chunks.len() + self.current.is_some() as usize >= self.depth
+    }
+
+    /// Returns the number of reads that ran out of decoded frames before the
+    /// end of the file, not counting those after a failure.
+    pub fn underruns(&self) -> usize {
+        self.shared.underruns.load(Ordering::Relaxed)
+    }
+
+    /// Pops chunks until one of the current seek generation is found.
+    fn next_chunk(&mut self) -> bool {
+        while let Some(c) = self.chunks.pop() {
+            if c.epoch == self.epoch {
+                self.current = Some(c);
+                self.pos = 0;
+                return true;
+            }
+
+            self.recycle(c.data);
+        }
+
+        false
+    }
+
+    /// Hands the current chunk's memory back to the prefetch thread.
+    fn release(&mut self) {
+        if let Some(c) = self.current.take() {
+            self.recycle(c.data);
+        }
+        self.pos = 0;
+    }
+
+    /// Hands a chunk buffer back to the prefetch thread, waking it to fill it.
+    fn recycle(&mut self, data: Box<[SampleT]>) {
+        let _ = self.recycle.push(data);
+        self.prefetch.unpark();
+    }
+}
+
+impl Drop for WavStream {
+    fn drop(&mut self) {
+        // The prefetch thread is not joined, so dropping a stream on the
+        // render thread never waits on it. It exits once woken.
+        self.shared.shutdown.store(true, Ordering::Release);
+        self.prefetch.unpark();
+    }
+}
+
+/// Background half of a [`WavStream`], decoding chunks of the file into the
+/// buffers handed back by the render thread.
+/// 
+/// [`WavStream`]: struct.WavStream.html
+struct Prefetch {
+    info: WavInfo,
+    shared: Arc<Shared>,
+    reader: Box<dyn ReadSeek>,
+    chunks: Producer<Chunk>,
+    recycle: Consumer<Box<[SampleT]>>,
+    bytes: Vec<u8>,
+}
+
+impl Prefetch {
+    fn run(mut self) {
+        // An IO error ends the stream for good, which the stream reports as
+        // finished so that its players can be retired.
+        if self.decode().is_err() {
+            self.shared.failed.store(true, Ordering::Release);
+        }
+    }
+
+    /// Decodes chunks until the stream is dropped or reading the file fails.
+    fn decode(&mut self) -> std::io::Result<()> {
+        let mut epoch = 0;
+        let mut frame = 0;
+        let mut spare: Option<Box<[SampleT]>> = None;
+
+        self.seek(0)?;
+
+        while !self.shared.shutdown.load(Ordering::Acquire) {
+            let e = self.shared.epoch.load(Ordering::Acquire);
+            if e != epoch {
+                epoch = e;
+                frame = self.shared.seek_to.load(Ordering::Relaxed).min(self.info.frames);
+                self.seek(frame)?;
+            }
+
+            let loop_end = self.shared.loop_end.load(Ordering::Acquire).min(self.info.frames);
+            let loop_start = self.shared.loop_start.load(Ordering::Relaxed);
+            let looping = loop_end > loop_start;
+            let end = if looping { loop_end } else { self.info.frames };
+
+            if frame >= end {
+                if looping {
+                    frame = loop_start;
+                    self.seek(frame)?;
+                    continue;
+                }
+
+                self.shared.ended.store(epoch + 1, Ordering::Release);
+                std::thread::park();
+                continue;
+            }
+
+            let mut data = match spare.take().or_else(|| self.recycle.pop()) {
+                Some(d) => d,
+                None => {
+                    std::thread::park();
+                    continue;
+                },
+            };
+
+            let n = ((end - frame) as usize).min(data.len());
+            let bytes = &mut self.bytes[..n * self.info.block_align as usize];
+            self.reader.read_exact(bytes)?;
+
+            let len = self.info.decode_first_channel(bytes, &mut data);
+            frame += len as u64;
+
+            // The ring holds as many chunks as there are buffers, so this
+            // push can't fail.
+            if let Err(c) = self.chunks.push(Chunk { epoch, len, data }) {
+                spare = Some(c.data);
+            }
+        }
+
+        Ok(())
+    }
+
+    fn seek(&mut self, frame: u64) -> std::io::Result<u64> {
+        self.reader.seek(SeekFrom::Start(self.info.data_offset + frame * self.info.block_align as u64))
+    }
+}
@@ -0,0 +1,332 @@
+//! # WAV Writer
+//! 
+//! Incremental writing of PCM WAV files, one block of samples at a time. Only
+//! the block being converted is ever held in memory, no matter how long the
+//! file is.
+
+use super::*;
+use crate::sample_format::*;
+use std::io::{Write, Seek, SeekFrom, Error, ErrorKind};
+
+/// Size in bytes of the header written before the samples.
+pub const WAV_HEADER_SIZE: u64 = 44;
+
+/// Writer appending interleaved PCM samples to a WAV file as they are
+/// rendered.
+/// 
+/// The header is written when the writer is created. A writer created with
+/// [`new`] doesn't know how long the file will be, so it writes placeholder
+/// sizes and patches them in [`finish`], which requires the destination to be
+/// seekable. A writer created with [`with_frames`] writes the final sizes
+/// upfront, so any destination will do, but exactly that many frames must be
+/// written.
+/// 
+/// Blocks are given in planar layout, one slice per channel, and converted
+/// to the bit depth of the file through a buffer which is reused between
+/// calls, so writing does not allocate once the largest block has been
+/// written. Dropping a writer without calling [`finish`] finishes the file,
+/// ignoring any error.
+/// 
+/// # Example
+/// 
+/// ```
+/// use std::io::Cursor;
+/// use bae_rs::{*, generators::*, utils::wav_writer::*};
+/// 
+/// let mut w = WavWriter::new(Cursor::new(Vec::new()), 1, SAMPLE_RATE as u32, 16).unwrap();
+/// let mut n = Noise::new();
+/// let mut block = vec![0.0; 480];
+/// for _ in 0..100 {
+///     n.process_block(&mut block);
+///     w.write(&[&block], true).unwrap();
+/// }
+/// 
+/// let file = w.finish().unwrap().into_inner();
+/// assert_eq!(file.len(), 44 + 48_000 * 2);
+/// ```
+/// 
+/// [`new`]: struct.WavWriter.html#method.new
+/// [`with_frames`]: struct.WavWriter.html#method.with_frames
+/// [`finish`]: struct.WavWriter.html#method.finish
+pub struct WavWriter<W>
+    where W: Write
+{
+    dest: Option<W>,
+    start: u64,
+    patch: Option<fn(&mut W, u64, u32, u32) -> std::io::Result<()>>,
+    channels: usize,
+    bps: u16,
+    frames: u64,
+    expected: Option<u64>,
+    dither: Option<Dither>,
+    bytes: Vec<u8>,
+    pcm16: Vec<i16>,
+    pcm24: Vec<i32>,
+}
+
+impl<W> WavWriter<W>
+    where W: Write + Seek
+{
+    /// Creates a new writer of a file of the given number of channels, sample
+    /// rate, and bits per sample, which should be 8, 16, or 24, starting at
+    /// the current position of `dest`. The sizes in the header are patched
+    /// when the writer is finished.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if:
+    /// * The bit depth is unsupported or there are no channels.
+    /// * The header can't be written.
+    pub fn new(mut dest: W, channels: u16, sampling_rate: u32, bps: u16) -> std::io::Result<Self> {
+        let start = dest.seek(SeekFrom::Current(0))?;
+
+        let mut w = WavWriter::create(dest, channels, sampling_rate, bps, 0)?;
+        w.start = start;
+        w.patch = Some(patch::<W>);
+
+        Ok(w)
+    }
+}
+
+impl<W> WavWriter<W>
+    where W: Write
+{
+    /// Creates a new writer of a file of exactly `frames` frames of the given
+    /// number of channels, sample rate, and bits per sample, which should be
+    /// 8, 16, or 24. The destination doesn't need to be seekable.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if:
+    /// * The bit depth is unsupported or there are no channels.
+    /// * The file would be too large for the sizes in its header.
+    /// * The header can't be written.
+    pub fn with_frames(dest: W, channels: u16, sampling_rate: u32, bps: u16, frames: u64) -> std::io::Result<Self> {
+        let mut w = WavWriter::create(dest, channels, sampling_rate, bps, frames)?;
+        w.expected = Some(frames);
+
+        Ok(w)
+    }
+
+    fn create(mut dest: W, channels: u16, sampling_rate: u32, bps: u16, frames: u64) -> std::io::Result<Self> {
+        if channels == 0 {
+            return Err(Error::new(ErrorKind::Other, "No channels given, aborting."));
+        }
+        if bps != 8 && bps != 16 && bps != 24 {
+            return Err(Error::new(ErrorKind::Other, "Unsupported bit depth, aborting."));
+        }
+
+        let align = channels as u64 * (bps / 8) as u64;
+        let data = data_size(frames * align)?;
+        let block_align = (align as u16).to_le_bytes();
+
+        let mut h = [0u8; WAV_HEADER_SIZE as usize];
+        h[0..4].copy_from_slice(b"RIFF");
+        h[4..8].copy_from_slice(&riff_size(data).to_le_bytes());
+        h[8..16].copy_from_slice(b"WAVEfmt ");
+        h[16..20].copy_from_slice(&16u32.to_le_bytes());
+        h[20..22].copy_from_slice(&1u16.to_le_bytes());
+        h[22..24].copy_from_slice(&channels.to_le_bytes());
+        h[24..28].copy_from_slice(&sampling_rate.to_le_bytes());
+        h[28..32].copy_from_slice(&(sampling_rate * align as u32).to_le_bytes());
+        h[32..34].copy_from_slice(&block_align);
+        h[34..36].copy_from_slice(&bps.to_le_bytes());
+        h[36..40].copy_from_slice(b"data");
+        h[40..44].copy_from_slice(&data.to_le_bytes());
+        dest.write_all(&h)?;
+
+        Ok(WavWriter {
+            dest: Some(dest),
+            start: 0,
+            patch: None,
+            channels: channels as usize,
+            bps,
+            frames: 0,
+            expected: None,
+            dither: None,
+            bytes: Vec::new(),
+            pcm16: Vec::new(),
+            pcm24: Vec::new(),
+        })
+    }
+
+    /// Returns the number of channels of the file.
+    pub fn channels(&self) -> usize {
+        self.channels
+    }
+
+    /// Returns the number of bits per sample of the file.
+    pub fn bits_per_sample(&self) -> u16 {
+        self.bps
+    }
+
+    /// Returns the number of frames written so far.
+    pub fn frames(&self) -> u64 {
+        self.frames
+    }
+
+    /// Sets the dither added to samples written to 16-bit files, or disables
+    /// dither if `None`, the default.
+    pub fn set_dither(&mut self, dither: Option<Dither>) {
+        self.dither = dither;
+    }
+
+    /// Appends the given block, one slice per channel, to the file, optionally
+    /// clipping it to [-1,1] first.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if:
+    /// * The number of slices doesn't match the channels of the file, or
+    ///   their lengths don't match.
+    /// * The file would grow past its declared length, or too large for the
+    ///   sizes in its header.
+    /// * The samples can't be written.
+    pub fn write(&mut self, channels: &[&[SampleT]], clip: bool) -> std::io::Result<()> {
+        if channels.len() != self.channels {
+            return Err(Error::new(ErrorKind::Other, "Channel count doesn't match the file, aborting."));
+        }
+
+        let frames = channels[0].len();
+        if channels.iter().any(|c| c.len() != frames) {
+            return Err(Error::new(ErrorKind::Other, "Channels have mismatching lengths, aborting."));
+        }
+
+        let total = self.frames + frames as u64;
+        if self.expected.map_or(false, |e| total > e) {
+            return Err(Error::new(ErrorKind::Other, "More frames written than declared, aborting."));
+        }
+        data_size(total * self.block_align())?;
+
+        let len = frames * self.channels;
+        self.bytes.clear();
+
+        match self.bps {
+            8 => {
+                self.bytes.resize(len, 0);
+                interleave_u8(channels, &mut self.bytes, clip);
+            },
+            16 => {
+                self.pcm16.resize(len, 0);
+                interleave_i16(channels, &mut self.pcm16, clip, self.dither.as_mut());
+                self.bytes.extend(self.pcm16.iter().flat_map(|s| s.to_le_bytes()));
+            },
+            _ => {
+                self.pcm24.resize(len, 0);
+                interleave_i24(channels, &mut self.pcm24, clip);
+                self.bytes.extend(self.pcm24.iter().flat_map(|s| {
+                    let b = s.to_le_bytes();
+                    [b[0], b[1], b[2]]
+                }));
+            },
+        }
+
+        self.dest.as_mut().unwrap().write_all(&self.bytes)?;
+        self.frames = total;
+
+        Ok(())
+    }
+
+    /// Appends the channels of the given [`PlanarBuffer`] to the file,
+    /// optionally clipping them to [-1,1] first.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails under the conditions of [`write`].
+    /// 
+    /// [`PlanarBuffer`]: ../../sample_format/planar/struct.PlanarBuffer.html
+    /// [`write`]: struct.WavWriter.html#method.write
+    pub fn write_planar(&mut self, buffer: &PlanarBuffer, clip: bool) -> std::io::Result<()> {
+        let mut channels = [&[][..]; 8];
+
+        if buffer.channels() <= channels.len() {
+            for (c, ch) in channels.iter_mut().zip(buffer.iter()) {
+                *c = ch;
+            }
+            self.write(&channels[..buffer.channels()], clip)
+        } else {
+            let channels: Vec<&[SampleT]> = buffer.iter().collect();
+            self.write(&channels, clip)
+        }
+    }
+
+    /// Finishes the file, padding the data to an even size and patching its
+    /// sizes in the header if they weren't known upfront, and returns the
+    /// destination positioned at the end of the file.
+    /// 
+    /// # Errors
+    /// 
+    /// This function fails if:
+    /// * Fewer frames were written than declared in [`with_frames`].
+    /// * The file can't be written or flushed.
+    /// 
+    /// [`with_frames`]: struct.WavWriter.html#method.with_frames
+    pub fn finish(mut self) -> std::io::Result<W> {
+        self.finalize()
+    }
+
+    fn block_align(&self) -> u64 {
+        self.channels as u64 * (self.bps / 8) as u64
+    }
+
+    fn finalize(&mut self) -> std::io::Result<W> {
+        let data = data_size(self.frames * self.block_align())?;
+        let mut dest = self.dest.take().unwrap();
+
+        if let Some(e) = self.expected {
+            if e != self.frames {
+                return Err(Error::new(ErrorKind::Other, "Fewer frames written than declared, aborting."));
+            }
+        }
+
+        if data % 2 == 1 {
+            dest.write_all(&[0])?;
+        }
+
+        if let Some(patch) = self.patch {
+            patch(&mut dest, self.start, riff_size(data), data)?;
+        }
+
+        dest.flush()?;
+
+        Ok(dest)
+    }
+}
+
+impl<W> Drop for WavWriter<W>
+    where W: Write
+{
+    fn drop(&mut self) {
+        if self.dest.is_some() {
+            let _ = self.finalize();
+        }
+    }
+}
+
+/// Returns the given size of the data chunk if it fits in its header field.
+fn data_size(bytes: u64) -> std::io::Result<u32> {
+    if bytes + (bytes & 1) + WAV_HEADER_SIZE - 8 > u32::MAX as u64 {
+        Err(Error::new(ErrorKind::Other, "File too large for a WAV header, aborting."))
+    } else {
+        Ok(bytes as u32)
+    }
+}
+
+/// Returns the size of the RIFF chunk holding a data chunk of the given size.
+fn riff_size(data: u32) -> u32 {
+    (WAV_HEADER_SIZE - 8) as u32 + data + (data & 1)
+}
+
+/// Writes the given sizes into the header starting at `start`, returning to
+/// the end of the file.
+fn patch<W: Write + Seek>(dest: &mut W, start: u64, riff: u32, data: u32) -> std::io::Result<()> {
+    let end = dest.seek(SeekFrom::Current(0))?;
+
+    dest.seek(SeekFrom::Start(start + 4))?;
+    dest.write_all(&riff.to_le_bytes())?;
+    dest.seek(SeekFrom::Start(start + 40))?;
+    dest.write_all(&data.to_le_bytes())?;
+    dest.seek(SeekFrom::Start(end))?;
+
+    Ok(())
+}
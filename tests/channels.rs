@@ -0,0 +1,578 @@
+extern crate bae_rs;
+
+#[cfg(test)]
+mod tests {
+    use std::sync::Arc;
+    use std::time::Duration;
+    use bae_rs::{*, channels::*, generators::*, modifiers::*, sounds::*};
+
+    fn sine_sound(f: MathT) -> SoundSP {
+        Box::new(SimpleSound::new(1.0, 1.0,
+            Arc::new(StandardBlock::from_generator(Sine::new(f)))
+        ))
+    }
+
+    #[test]
+    fn test_handles() {
+        let mut c = StandardChannel::<Mono>::new(1.0);
+
+        let a = c.add_sound(sine_sound(440.0));
+        let b = c.add_sound(sine_sound(220.0));
+        assert_eq!(c.sound_count(), 2);
+        assert_eq!(c.get_sound(a).unwrap().get_id(), Some(a));
+
+        let removed = c.remove_sound(a).unwrap();
+        assert_eq!(removed.get_id(), None);
+        assert!(c.remove_sound(a).is_none());
+        assert!(c.get_sound(a).is_none());
+        assert_eq!(c.get_sound(b).unwrap().get_id(), Some(b));
+
+        let d = c.add_sound(sine_sound(110.0));
+        assert_eq!(d.index(), a.index());
+        assert_ne!(d, a);
+        assert!(c.get_sound(a).is_none());
+        assert_eq!(c.sound_count(), 2);
+    }
+
+    #[test]
+    fn test_controller() {
+        let mut c = StandardChannel::<Mono>::new(1.0);
+        let mut ctl = c.connect(2, 8);
+
+        let a = ctl.add_sound(sine_sound(440.0)).ok().unwrap();
+        let b = ctl.add_sound(sine_sound(440.0)).ok().unwrap();
+        assert!(ctl.add_sound(sine_sound(440.0)).is_err());
+        assert_eq!(c.sound_count(), 0);
+
+        let handle = std::thread::spawn(move || {
+            c.process();
+            c
+        });
+        let mut c = handle.join().unwrap();
+        assert_eq!(c.sound_count(), 2);
+
+        let mut s = Sine::new(440.0);
+        let render = c.get_output().iter().map(|x| x.mono).collect::<Vec<_>>();
+        for y in render {
+            assert!((y - 2.0 * s.process()).abs() < 1e-6);
+        }
+
+        ctl.set_sound_gain(b, 0.0).ok().unwrap();
+        ctl.toggle_mute(a).ok().unwrap();
+        ctl.modify(a, |s| s.toggle_mute()).ok().unwrap();
+        ctl.remove_sound(b).ok().unwrap();
+        c.process();
+        assert_eq!(c.sound_count(), 1);
+        assert!(!c.get_sound(a).unwrap().is_muted());
+        for y in c.get_output() {
+            assert!((y.mono - s.process()).abs() < 1e-6);
+        }
+
+        assert_eq!(ctl.free_sounds(), 0);
+        assert_eq!(ctl.collect(), 2);
+        assert_eq!(ctl.free_sounds(), 1);
+
+        let d = ctl.add_sound(sine_sound(110.0)).ok().unwrap();
+        assert_eq!(d.index(), b.index());
+        assert_ne!(d, b);
+    }
+
+    #[test]
+    fn test_process() {
+        let mut c = StandardChannel::<Mono>::new(0.5);
+        c.set_process_time(Duration::from_secs_f64(0.01));
+        assert_eq!(c.get_output().len(), 480);
+
+        c.add_sound(sine_sound(440.0));
+        c.add_sound(sine_sound(440.0));
+
+        let mut s = Sine::new(440.0);
+
+        for _ in 0..4 {
+            c.process();
+
+            for y in c.get_output() {
+                let x = s.process();
+                assert!((y.mono - x).abs() < 1e-6);
+            }
+        }
+    }
+
+    #[test]
+    fn test_deterministic_mix() {
+        let voices = |i: usize| -> SoundSP {
+            let mut cs = ComplexSound::new(1.0, 1.0);
+            let a = cs.add_block(Arc::new(StandardBlock::from_generator(Sine::new(110.0 * (i + 1) as MathT))));
+            let b = cs.add_block(Arc::new(StandardBlock::from_generator(Sawtooth::new(55.0 * (i + 1) as MathT))));
+            cs.add_connection(a, cs.get_output_gain());
+            cs.add_connection(b, cs.get_output_gain());
+            Box::new(cs)
+        };
+
+        let mut c = StandardChannel::<Mono>::new(1.0);
+        let mut reference = Vec::new();
+
+        for i in 0..16 {
+            c.add_sound(voices(i));
+            reference.push(voices(i));
+        }
+
+        let len = c.get_output().len();
+        let mut scratch = vec![0.0; len];
+
+        for _ in 0..4 {
+            c.process();
+
+            let mut expected = vec![0.0; len];
+            for v in &mut reference {
+                for x in &mut scratch {
+                    *x = 0.0;
+                }
+                v.process_block(&mut scratch);
+                for (e, x) in expected.iter_mut().zip(&scratch) {
+                    *e += *x;
+                }
+            }
+
+            for (y, e) in c.get_output().iter().zip(&expected) {
+                assert_eq!(y.mono.to_bits(), e.to_bits());
+            }
+        }
+    }
+    #[test]
+    fn test_inserts() {
+        let mut c = StandardChannel::<Mono>::new(1.0);
+        let mut reference = Vec::new();
+        let mut filters = Vec::new();
+        let mut handles = Vec::new();
+
+        for i in 0..10 {
+            handles.push(c.add_sound(sine_sound(110.0 * (i + 1) as MathT)));
+            reference.push(sine_sound(110.0 * (i + 1) as MathT));
+
+            let lp = Biquad::lowpass(400.0 + 100.0 * i as MathT, 0.7);
+            let hp = Biquad::highpass(50.0, 0.7);
+            if i % 3 != 0 {
+                assert!(c.set_insert(handles[i], 0, &lp));
+                assert!(c.set_insert(handles[i], 1, &hp));
+                filters.push(Some((lp, hp)));
+            } else {
+                filters.push(None);
+            }
+        }
+        assert!(!c.set_insert(handles[0], INSERT_STAGES, &Biquad::notch(100.0, 1.0)));
+
+        // Removing a sound keeps the inserts of the one moved into its slot.
+        c.remove_sound(handles[1]);
+        reference.remove(1);
+        filters.remove(1);
+        let moved = reference.pop().unwrap();
+        reference.insert(1, moved);
+        let moved = filters.pop().unwrap();
+        filters.insert(1, moved);
+
+        let len = c.get_output().len();
+        let mut scratch = vec![0.0; len];
+
+        for _ in 0..4 {
+            c.process();
+
+            let mut expected = vec![0.0; len];
+            for (v, f) in reference.iter_mut().zip(&mut filters) {
+                for x in &mut scratch {
+                    *x = 0.0;
+                }
+                v.process_block(&mut scratch);
+                if let Some((lp, hp)) = f {
+                    lp.process_block(&mut scratch);
+                    hp.process_block(&mut scratch);
+                }
+                for (e, x) in expected.iter_mut().zip(&scratch) {
+                    *e += *x;
+                }
+            }
+
+            for (y, e) in c.get_output().iter().zip(&expected) {
+                assert_eq!(y.mono.to_bits(), e.to_bits());
+            }
+        }
+    }
+
+    #[test]
+    fn test_voice_pool_stealing() {
+        let mut pool = VoicePool::<Mono>::new(1.0, 8);
+        let oldest = pool.add_template(2, StealPolicy::Oldest, None, || sine_sound(440.0));
+        let quietest = pool.add_template(2, StealPolicy::Quietest, None, || sine_sound(440.0));
+        let lowest = pool.add_template(2, StealPolicy::LowestPriority, None, || sine_sound(440.0));
+        let none = pool.add_template(1, StealPolicy::None, None, || sine_sound(440.0));
+        assert_eq!(pool.voice_count(), 7);
+
+        let a = pool.play(oldest, 0, 1.0).unwrap();
+        pool.process();
+        let b = pool.play(oldest, 0, 1.0).unwrap();
+        pool.process();
+        let c = pool.play(oldest, 0, 1.0).unwrap();
+        assert!(!pool.is_playing(a));
+        assert!(pool.is_playing(b));
+        assert!(pool.is_playing(c));
+        assert!(!pool.stop(a));
+
+        let a = pool.play(quietest, 0, 0.2).unwrap();
+        let b = pool.play(quietest, 0, 0.8).unwrap();
+        let c = pool.play(quietest, 0, 0.5).unwrap();
+        assert!(!pool.is_playing(a));
+        assert!(pool.is_playing(b));
+        assert!(pool.is_playing(c));
+
+        let a = pool.play(lowest, 5, 1.0).unwrap();
+        let b = pool.play(lowest, 3, 1.0).unwrap();
+        assert!(pool.play(lowest, 1, 1.0).is_none());
+        let c = pool.play(lowest, 4, 1.0).unwrap();
+        assert!(pool.is_playing(a));
+        assert!(!pool.is_playing(b));
+        assert_eq!(pool.get_priority(c), Some(4));
+
+        let a = pool.play(none, 0, 1.0).unwrap();
+        assert!(pool.play(none, 10, 1.0).is_none());
+        assert!(pool.stop(a));
+        assert!(pool.play(none, 0, 1.0).is_some());
+        assert_eq!(pool.playing_count(), 7);
+    }
+
+    #[test]
+    fn test_voice_pool_virtual() {
+        let mut pool = VoicePool::<Mono>::new(1.0, 1);
+        let t = pool.add_template(3, StealPolicy::Oldest, None, || sine_sound(440.0));
+
+        let a = pool.play(t, 0, 1.0).unwrap();
+        let b = pool.play(t, 0, 0.5).unwrap();
+        let q = pool.play(t, 0, 1e-4).unwrap();
+
+        let mut s = Sine::new(440.0);
+        pool.process();
+        assert_eq!(pool.real_count(), 1);
+        assert!(!pool.is_virtual(a));
+        assert!(pool.is_virtual(b));
+        assert!(pool.is_virtual(q));
+        for y in pool.get_output() {
+            assert!((y.mono - s.process()).abs() < 1e-6);
+        }
+
+        // The quieter voice takes over, continuing from where it would have
+        // been had it been rendered all along.
+        assert!(pool.set_volume(b, 2.0));
+        pool.process();
+        assert_eq!(pool.real_count(), 1);
+        assert!(pool.is_virtual(a));
+        assert!(!pool.is_virtual(b));
+        for y in pool.get_output() {
+            assert!((y.mono - 2.0 * s.process()).abs() < 1e-5);
+        }
+
+        // Voices below the threshold stay virtual even with room to render.
+        pool.set_max_real(3);
+        pool.process();
+        assert_eq!(pool.real_count(), 2);
+        assert!(pool.is_virtual(q));
+        for y in pool.get_output() {
+            assert!((y.mono - 3.0 * s.process()).abs() < 1e-5);
+        }
+
+        // Sounds owned by voices can't be removed through the channel.
+        let h = pool.get_sound_mut(a).unwrap().get_id().unwrap();
+        assert!(pool.remove_sound(h).is_none());
+        assert!(pool.stop(a));
+        assert!(pool.stop(b));
+        pool.process();
+        assert_eq!(pool.real_count(), 0);
+        for y in pool.get_output() {
+            assert_eq!(y.mono, 0.0);
+        }
+    }
+
+    #[test]
+    fn test_voice_pool_length() {
+        let mut pool = VoicePool::<Mono>::new(1.0, 4);
+        let t = pool.add_template(1, StealPolicy::Oldest, Some(Duration::from_millis(15)), || sine_sound(440.0));
+
+        let a = pool.play(t, 0, 1.0).unwrap();
+        pool.process();
+        pool.process();
+        assert!(pool.is_playing(a));
+        pool.process();
+        assert!(!pool.is_playing(a));
+        assert_eq!(pool.playing_count(), 0);
+
+        // A recycled voice restarts from the beginning of its sound.
+        let mut s = Sine::new(440.0);
+        pool.play(t, 0, 1.0).unwrap();
+        pool.process();
+        for y in pool.get_output() {
+            assert!((y.mono - s.process()).abs() < 1e-6);
+        }
+    }
+
+    #[test]
+    fn test_finished_sounds() {
+        let clip = || MonoWav::from_track(SAMPLE_RATE as MathT, vec![Mono::from_sample(0.5); 100]);
+        let one_shot = || -> SoundSP {
+            Box::new(SimpleSound::new(1.0, 1.0, Arc::new(StandardBlock::from_generator(clip()))))
+        };
+
+        // Finished sounds stay registered but are no longer processed, and
+        // modifiers ring out before their sound is finished.
+        let mut c = StandardChannel::<Mono>::new(1.0);
+        let a = c.add_sound(one_shot());
+        let b = c.add_sound(Box::new(Chain::new(clip(), Delay::new(Duration::from_millis(20)))));
+        c.add_sound(sine_sound(440.0));
+
+        let mut s = Sine::new(440.0);
+        for block in 0..3 {
+            c.process();
+            assert!(c.get_sound(a).unwrap().is_finished());
+            assert_eq!(c.get_sound(b).unwrap().is_finished(), block == 2);
+
+            for (i, y) in c.get_output().iter().enumerate() {
+                let t = block * 480 + i;
+                let mut x = s.process();
+                if t < 100 {
+                    x += 0.5;
+                }
+                if t >= 960 && t < 1060 {
+                    x += 0.5;
+                }
+                assert!((y.mono - x).abs() < 1e-6);
+            }
+        }
+        assert_eq!(c.sound_count(), 3);
+
+        // Retiring removes them instead, handing those added through a
+        // controller back to it.
+        c.set_auto_retire(true);
+        c.process();
+        assert_eq!(c.sound_count(), 1);
+
+        // Only once their inserts have rung out.
+        let r = c.add_sound(one_shot());
+        assert!(c.set_insert(r, 0, &Biquad::lowpass(1000.0, 20.0)));
+        c.process();
+        c.process();
+        assert!(c.get_sound(r).unwrap().is_finished());
+        let mut blocks = 2;
+        while c.get_sound(r).is_some() {
+            c.process();
+            blocks += 1;
+            assert!(blocks < 100);
+        }
+        assert!(blocks > 4);
+        assert_eq!(c.sound_count(), 1);
+
+        let mut ctl = c.connect(1, 4);
+        ctl.add_sound(one_shot()).ok().unwrap();
+        assert_eq!(ctl.free_sounds(), 0);
+        c.process();
+        assert_eq!(c.sound_count(), 1);
+
+        let mut retired = 0;
+        ctl.collect_with(|r| if let Retired::Sound(_, _) = r { retired += 1 });
+        assert_eq!(retired, 1);
+        assert_eq!(ctl.free_sounds(), 1);
+
+        // Voice pools stop finished voices by themselves.
+        let mut pool = VoicePool::<Mono>::new(1.0, 4);
+        let t = pool.add_template(1, StealPolicy::Oldest, None, one_shot);
+        let v = pool.play(t, 0, 1.0).unwrap();
+        pool.process();
+        pool.process();
+        assert!(!pool.is_playing(v));
+
+        // Virtual voices too, once they have lagged behind for their tail.
+        let v = pool.play(t, 0, 1e-4).unwrap();
+        pool.process();
+        assert!(pool.is_virtual(v));
+        pool.process();
+        assert!(!pool.is_playing(v));
+        assert_eq!(pool.playing_count(), 0);
+
+        // Voices retired by the channel itself are stopped, and never played
+        // again since their sound is gone.
+        pool.get_channel_mut().set_auto_retire(true);
+        let v = pool.play(t, 0, 1.0).unwrap();
+        pool.process();
+        pool.process();
+        assert!(!pool.is_playing(v));
+        pool.process();
+        assert!(pool.play(t, 0, 1.0).is_none());
+        assert_eq!(pool.playing_count(), 0);
+    }
+
+    #[test]
+    fn test_sound_pan() {
+        let dc = || -> SoundSP {
+            let clip = MonoWav::from_track(SAMPLE_RATE as MathT, vec![Mono::from_sample(0.5); 4800]);
+            Box::new(SimpleSound::new(1.0, 1.0, Arc::new(StandardBlock::from_generator(clip))))
+        };
+
+        let mut c = StandardChannel::<Surround51>::new(1.0);
+        let a = c.add_sound(dc());
+        let b = c.add_sound(dc());
+        c.set_sound_gain(b, 0.0);
+
+        // Unpanned sounds play from the center, and panning ramps the gains
+        // to the new speakers over the next block.
+        c.process();
+        assert!(c.get_output().iter().all(|s| s.center == 0.5 && s.right == 0.0));
+
+        assert!(c.set_sound_pan(a, 30.0));
+        assert_eq!(c.get_sound_pan_gains(a).unwrap(), &[0.0, 1.0, 0.0, 0.0, 0.0, 0.0]);
+        c.process();
+        for (i, s) in c.get_output().iter().enumerate() {
+            let t = i as SampleT / 480.0;
+            assert!((s.center - 0.5 * (1.0 - t)).abs() < 1e-6);
+            assert!((s.right - 0.5 * t).abs() < 1e-6);
+        }
+
+        c.process();
+        assert!(c.get_output().iter().all(|s| s.center == 0.0 && s.right == 0.5));
+
+        let mut ctl = c.connect(0, 4);
+        ctl.set_sound_pan(b, -110.0).ok().unwrap();
+        c.process();
+        assert_eq!(c.get_sound_pan_gains(b).unwrap()[4], 1.0);
+
+        c.remove_sound(a);
+        assert_eq!(c.get_sound_pan_gains(b).unwrap(), &[0.0, 0.0, 0.0, 0.0, 1.0, 0.0]);
+        assert!(c.get_sound_pan_gains(a).is_none());
+        assert!(!c.set_sound_pan(a, 0.0));
+    }
+
+    #[test]
+    fn test_channel_context() {
+        let ctx = Context::new(24_000.0, 240);
+        let expected = |i: usize| (2.0 * std::f64::consts::PI * 1000.0 * i as f64 / 24_000.0).sin() as SampleT;
+
+        // Sounds added to a channel run at its sample rate, in blocks of its
+        // maximum size.
+        let mut c = StandardChannel::<Mono>::with_context(1.0, 1, ctx);
+        assert_eq!(c.get_output().len(), 240);
+        c.add_sound(sine_sound(1000.0));
+        c.process();
+        for (i, y) in c.get_output().iter().enumerate() {
+            assert!((y.mono - expected(i)).abs() < 1e-4);
+        }
+
+        // Sounds already registered are given a context applied afterwards.
+        let mut c = StandardChannel::<Mono>::new(1.0);
+        c.add_sound(sine_sound(1000.0));
+        c.set_context(&ctx);
+        assert_eq!(c.get_output().len(), 240);
+        c.process();
+        for (i, y) in c.get_output().iter().enumerate() {
+            assert!((y.mono - expected(i)).abs() < 1e-4);
+        }
+        c.set_process_time(ctx.block_time());
+        assert_eq!(c.get_output().len(), 240);
+
+        // Durations are converted at the rate of the context.
+        let ms = Duration::from_millis;
+        let mut d = Delay::new(ms(5));
+        d.set_context(&ctx);
+        assert_eq!(d.get_delay(), ms(5));
+        let mut x = vec![0.0; 240];
+        x[0] = 1.0;
+        d.process_block(&mut x);
+        assert_eq!(x[120], 1.0);
+        assert_eq!(x.iter().sum::<SampleT>(), 1.0);
+
+        let mut a = ADSR::new(ms(10), ms(0), 0.0, ms(0));
+        a.set_context(&ctx);
+        let mut x = vec![1.0; 240];
+        a.process_block(&mut x);
+        assert!((x[119] - 0.5).abs() < 1e-6);
+        assert!((x[239] - 1.0).abs() < 1e-6);
+
+        // The voice pool gives its own sounds the context, and counts the
+        // length of its templates at its rate.
+        let mut pool = VoicePool::<Mono>::with_context(1.0, 1, ctx);
+        let t = pool.add_template(1, StealPolicy::Oldest, Some(ms(20)), || sine_sound(1000.0));
+        let v = pool.play(t, 0, 1.0).unwrap();
+        pool.process();
+        for (i, y) in pool.get_output().iter().enumerate() {
+            assert!((y.mono - expected(i)).abs() < 1e-4);
+        }
+        pool.process();
+        assert!(pool.is_playing(v));
+        pool.process();
+        assert!(!pool.is_playing(v));
+    }
+
+    #[cfg(feature = "instrumentation")]
+    #[test]
+    fn test_instrumentation() {
+        use bae_rs::instrumentation::*;
+
+        // Blocks of the default context have a deadline of 10ms.
+        let stats = RenderStats::new();
+        let ms = Duration::from_millis;
+        for _ in 0..98 {
+            stats.record(ms(5), 480);
+        }
+        stats.record(ms(20), 480);
+        stats.record(ms(30), 480);
+
+        let s = stats.snapshot();
+        assert_eq!(s.blocks, 100);
+        assert_eq!(s.samples, 48_000);
+        assert_eq!(s.overruns, 2);
+        assert_eq!(s.peak_block_time, ms(30));
+        assert!((s.peak_load - 3.0).abs() < 1e-6);
+        assert!((s.load() - 0.54).abs() < 1e-9);
+        assert_eq!(s.mean_block_time(), Duration::from_micros(5_400));
+        assert!((s.ns_per_sample() - 11_250.0).abs() < 1e-6);
+        let p50 = s.load_percentile(0.5);
+        assert!(p50 >= 0.5 && p50 <= 0.5 * 1.25);
+        let p99 = s.load_percentile(0.99);
+        assert!(p99 >= 2.0 && p99 <= 2.5);
+        assert_eq!(s.load_percentile(1.0), s.peak_load);
+        assert_eq!(s.histogram().iter().sum::<u64>(), 100);
+
+        stats.reset();
+        assert_eq!(stats.snapshot().blocks, 0);
+
+        // Channels record themselves and each of their sounds.
+        let mut c = StandardChannel::<Mono>::new(1.0);
+        let a = c.add_sound(sine_sound(440.0));
+        let b = c.add_sound(sine_sound(220.0));
+        let monitor = c.stats().clone();
+        for _ in 0..3 {
+            c.process();
+        }
+
+        let s = monitor.snapshot();
+        assert_eq!((s.blocks, s.samples), (3, 3 * 480));
+        assert_eq!((s.voices, s.peak_voices), (2, 2));
+        assert_eq!(c.sound_stats(a).unwrap().snapshot().blocks, 3);
+
+        c.remove_sound(a);
+        c.process();
+        assert!(c.sound_stats(a).is_none());
+        assert_eq!(monitor.snapshot().voices, 1);
+        assert_eq!(monitor.snapshot().peak_voices, 2);
+        assert_eq!(c.sound_stats(b).unwrap().snapshot().blocks, 4);
+
+        // A new sound taking the slot starts from nothing.
+        let d = c.add_sound(sine_sound(110.0));
+        assert_eq!(d.index(), a.index());
+        assert_eq!(c.sound_stats(d).unwrap().snapshot().blocks, 0);
+
+        // Graph nodes are recorded separately.
+        let mut cs = ComplexSound::new(1.0, 1.0);
+        let n = cs.add_standard_block(StandardBlock::from_generator(Sine::new(440.0)));
+        cs.add_connection(n, cs.get_output_gain());
+        let mut x = vec![0.0; 480];
+        cs.process_block(&mut x);
+        cs.process_block(&mut x);
+        assert_eq!(cs.node_stats(n).unwrap().snapshot().blocks, 2);
+        assert_eq!(cs.clone().node_stats(n).unwrap().snapshot().blocks, 0);
+    }
+}
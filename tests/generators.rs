@@ -16,15 +16,49 @@ mod tests {
 
     #[test]
     fn test_noise() {
-        // use fftw::array::AlignedVec;
-        // use fftw::plan::*;
-        // use fftw::types::*;
-        // use std::f32::consts::PI;
+        // Seeded noise is reproducible, whether generated by block or by sample.
+        let mut a = Noise::with_seed(42);
+        let mut b = Noise::with_seed(42);
+        let mut x = vec![0.0; 4800];
+        a.process_block(&mut x);
+        let y: Vec<f32> = (0..4800).map(|_| b.process()).collect();
+        assert_eq!(x, y);
+        assert_eq!(a.get_position(), 4800);
 
-        // let n = 128;
-        // let mut plan: R2CPlan32 = R2CPlan32::aligned(&[n], Flag::Measure).unwrap();
+        assert!(x.iter().all(|x| *x >= -1.0 && *x < 1.0));
+        let mean = x.iter().map(|x| *x as f64).sum::<f64>() / 4800.0;
+        let var = x.iter().map(|x| (*x as f64 - mean).powi(2)).sum::<f64>() / 4800.0;
+        assert!(mean.abs() < 0.05);
+        assert!((var - 1.0 / 3.0).abs() < 0.03);
 
-        // todo!();
+        // Other seeds and streams are different, seeking lands on the same
+        // samples, and clones restart.
+        let mut c = Noise::with_seed(43);
+        assert!((0..4800).map(|_| c.process()).ne(x.iter().copied()));
+        c.set_seed(42);
+        c.set_stream(1);
+        assert!((0..4800).map(|_| c.process()).ne(x.iter().copied()));
+        c.set_stream(0);
+        c.seek(1000);
+        assert_eq!(c.process(), x[1000]);
+        assert_eq!(a.clone().process(), x[0]);
+
+        // Pink and brown noise lose power at high frequencies.
+        fn hf_ratio(t: &[f32]) -> f64 {
+            let d: f64 = t.windows(2).map(|w| ((w[1] - w[0]) as f64).powi(2)).sum();
+            let e: f64 = t.iter().map(|x| (*x as f64).powi(2)).sum();
+            d / e
+        }
+
+        let mut t = vec![0.0; 48_000];
+        let mut ratios = Vec::new();
+        for color in [NoiseColor::White, NoiseColor::Pink, NoiseColor::Brown].iter() {
+            let mut n = Noise::with_color(*color, 7);
+            n.process_block(&mut t);
+            assert!(t.iter().all(|x| x.abs() < 2.0));
+            ratios.push(hf_ratio(&t));
+        }
+        assert!(ratios[0] > ratios[1] * 2.0 && ratios[1] > ratios[2] * 2.0);
     }
 
     #[test]
@@ -71,6 +105,27 @@ mod tests {
         }
     }
 
+    #[test]
+    fn test_sine_wrap() {
+        // 7Hz doesn't divide the table, so the phase lands everywhere in the
+        // last interval of the table over a few seconds, where the guard
+        // sample is read instead of wrapping around.
+        let f = 7.0;
+        let n = 4 * bae_rs::SAMPLE_RATE as usize;
+        let expected = |i: usize| (2.0 * std::f64::consts::PI * f * i as f64 * bae_rs::INV_SAMPLE_RATE).sin();
+
+        let mut s = Sine::new(f);
+        let mut y = vec![0.0; n];
+        s.process_block(&mut y);
+        for (i, y) in y.iter().enumerate() {
+            assert!((*y as f64 - expected(i)).abs() < 1e-6);
+        }
+
+        let mut s = Sine::new(3.0);
+        s.skip(usize::MAX / 2);
+        assert!(s.process().abs() <= 1.0);
+    }
+
     #[test]
     fn test_square() {
         let mut s = Square::new(440.0);
@@ -118,8 +173,307 @@ mod tests {
         println!("Test ran in {} seconds", duration.as_secs_f64());
     }
 
+    #[test]
+    fn test_process_block() {
+        fn compare<G: Generator>(mut a: G, mut b: G) {
+            let mut t = vec![0.0; 1000];
+            for c in t.chunks_mut(64) {
+                b.process_block(c);
+            }
+            for s in t {
+                assert!(float_equal(a.process(), s, std::f32::EPSILON, |x| x.abs()));
+            }
+        }
+
+        compare(Zero::new(), Zero::new());
+        compare(Sawtooth::new(440.0), Sawtooth::new(440.0));
+        compare(Sine::new(440.0), Sine::new(440.0));
+        compare(Square::new(440.0), Square::new(440.0));
+        compare(Triangle::new(440.0), Triangle::new(440.0));
+    }
+
+    #[test]
+    fn test_reset_skip() {
+        fn compare<G: Generator>(mut a: G, mut b: G, eps: f32) {
+            let mut t = vec![0.0; 1000];
+            a.process_block(&mut t);
+            b.process_block(&mut t);
+
+            // Skipping lands where processing does.
+            a.skip(777);
+            b.process_block(&mut t[..777]);
+            for _ in 0..100 {
+                assert!((a.process() - b.process()).abs() <= eps);
+            }
+
+            // Resetting restarts the output.
+            a.reset();
+            b.reset();
+            a.process_block(&mut t);
+            let mut u = vec![0.0; 1000];
+            b.process_block(&mut u);
+            assert_eq!(t, u);
+        }
+
+        compare(Zero::new(), Zero::new(), 0.0);
+        compare(Sawtooth::new(440.0), Sawtooth::new(440.0), 1e-5);
+        compare(Sine::new(440.0), Sine::new(440.0), 1e-5);
+        compare(Square::new(440.0), Square::new(440.0), 0.0);
+        compare(Triangle::new(440.0), Triangle::new(440.0), 1e-5);
+        compare(Oscillator::with_waveform(Waveform::Sawtooth, 440.0),
+            Oscillator::with_waveform(Waveform::Sawtooth, 440.0), 1e-3);
+        compare(OscillatorBank::unison(Waveform::Sine, 440.0, 5, 20.0),
+            OscillatorBank::unison(Waveform::Sine, 440.0, 5, 20.0), 1e-3);
+        compare(Noise::with_seed(7), Noise::with_seed(7), 0.0);
+
+        let mut a = Noise::with_seed(7);
+        a.reset();
+        assert_eq!(a.get_position(), 0);
+        a.skip(1 << 33);
+        assert_eq!(a.get_position(), 1 << 33);
+    }
+
     #[test]
     fn test_monowav() {
         // todo!();
     }
+
+    #[test]
+    fn test_streaming_wav() {
+        use bae_rs::utils::*;
+        use bae_rs::utils::wav_stream::*;
+        use std::fs::File;
+        use std::time::{Duration, Instant};
+
+        // Waits for the prefetch thread without relying on its timing.
+        fn wait_for<F: Fn() -> bool>(ready: F) {
+            let deadline = Instant::now() + Duration::from_secs(10);
+            while !ready() {
+                assert!(Instant::now() < deadline, "Timed out waiting for the prefetch thread");
+                std::thread::sleep(Duration::from_millis(1));
+            }
+        }
+
+        let l: Vec<f32> = (0..20_000).map(|i| (i as f32 * 0.01).sin() * 0.8).collect();
+        let r: Vec<f32> = l.iter().map(|x| -x).collect();
+
+        std::fs::create_dir_all(".junk/generators").unwrap();
+        let path = ".junk/generators/streaming.wav";
+        write_wav(vec![l, r], 16, &mut File::create(path).unwrap(), false).unwrap();
+
+        let (_, t) = read_wav(&mut File::open(path).unwrap()).unwrap();
+        let expected = &t[0];
+
+        let asset = WavAsset::open(path).unwrap();
+        assert_eq!(asset.info().channels, 2);
+        assert_eq!(asset.info().frames, 20_000);
+
+        // Whole file, in order.
+        let mut s = WavStream::with_depth(asset.clone(), 8).unwrap();
+        let mut out = vec![0.0; expected.len()];
+        wait_for(|| s.is_prefetched());
+        s.read(&mut out);
+        assert_eq!(s.underruns(), 0);
+        for (x, y) in expected.iter().zip(&out) {
+            assert_eq!(x.to_bits(), y.to_bits());
+        }
+        wait_for(|| s.is_finished());
+
+        // Seeking into a loop.
+        s.set_loop_points(1000, 3000);
+        s.seek(2000);
+        let mut out = vec![0.0; 4000];
+        wait_for(|| s.is_prefetched());
+        s.read(&mut out);
+        let looped: Vec<f32> = (2000..3000).chain(1000..3000).chain(1000..2000).map(|i| expected[i]).collect();
+        assert_eq!(looped, out);
+        assert!(!s.is_finished());
+
+        // Players sharing the asset.
+        let mut a = StreamingWav::new(asset.clone()).unwrap();
+        let mut b = a.try_clone().unwrap();
+        let mut ya = vec![0.0; 1000];
+        let mut yb = vec![0.0; 1000];
+        wait_for(|| a.get().is_prefetched() && b.get().is_prefetched());
+        a.process_block(&mut ya);
+        b.process_block(&mut yb);
+        assert_eq!(&expected[..1000], &ya[..]);
+        assert_eq!(ya, yb);
+
+        // Players opened for a context play at its rate from the start.
+        let mut c = StreamingWav::with_context(asset.clone(), &bae_rs::Context::new(24_000.0, 240)).unwrap();
+        let mut yc = vec![0.0; 100];
+        wait_for(|| c.get().is_prefetched());
+        c.process_block(&mut yc);
+        for (i, y) in yc.iter().enumerate() {
+            assert_eq!(*y, expected[2 * i]);
+        }
+
+        // Stopping and restarting leaves the speed exact.
+        a.set_speed(0.0);
+        a.set_speed(0.5);
+        assert_eq!(a.get_speed(), 0.5);
+        assert_eq!(a.tail(), None);
+        let mut ya = vec![0.0; 1000];
+        a.process_block(&mut ya);
+        assert!(ya.iter().all(|y| y.is_finite()));
+        assert!((ya[1] - 0.5 * (expected[1000] + expected[1001])).abs() < 1e-6);
+
+        // Streams of a file that can no longer be read finish with an error.
+        let path = ".junk/generators/truncated.wav";
+        std::fs::copy(".junk/generators/streaming.wav", path).unwrap();
+        let asset = WavAsset::open(path).unwrap();
+        File::create(path).unwrap();
+        let mut s = WavStream::new(asset).unwrap();
+        wait_for(|| s.is_finished());
+        assert!(s.has_failed());
+        let underruns = s.underruns();
+        s.read(&mut out);
+        assert_eq!(s.underruns(), underruns);
+    }
+
+    #[test]
+    fn test_oscillator() {
+        use bae_rs::SampleT;
+
+        // Fraction of the energy of a block of 4800 samples outside of the
+        // harmonics of its 1010Hz fundamental. The DFT bins are 10Hz apart, so
+        // harmonics fall on bins and aliases mostly don't.
+        fn alias_ratio(t: &[SampleT]) -> f64 {
+            let n = t.len();
+            let (mut total, mut alias) = (0.0, 0.0);
+
+            for k in 1..n / 2 {
+                let (mut re, mut im) = (0.0f64, 0.0f64);
+                for (i, x) in t.iter().enumerate() {
+                    let w = 2.0 * std::f64::consts::PI * (k * i % n) as f64 / n as f64;
+                    re += *x as f64 * w.cos();
+                    im -= *x as f64 * w.sin();
+                }
+
+                let e = re * re + im * im;
+                total += e;
+                if (k * 10) % 1010 != 0 {
+                    alias += e;
+                }
+            }
+
+            alias / total
+        }
+
+        let naive = |f: &dyn Fn(f64) -> f64| -> Vec<SampleT> {
+            (0..4800).map(|i| f((i as f64 * 1010.0 / 48_000.0).fract()) as SampleT).collect()
+        };
+
+        let cases: [(Waveform, Vec<SampleT>); 3] = [
+            (Waveform::Sawtooth, naive(&|p| 2.0 * p - 1.0)),
+            (Waveform::Square, naive(&|p| if p < 0.5 { 1.0 } else { -1.0 })),
+            (Waveform::Triangle, naive(&|p| 1.0 - 4.0 * (p - 0.5).abs())),
+        ];
+
+        for (w, n) in cases.iter() {
+            let mut o = Oscillator::with_waveform(*w, 1010.0);
+            let mut t = vec![0.0; 4800];
+            o.process_block(&mut t);
+
+            assert!(t.iter().all(|x| x.abs() <= 1.05));
+            assert!(alias_ratio(&t) * 10.0 < alias_ratio(n), "{:?}", w);
+        }
+
+        let mut s = Oscillator::new(440.0);
+        for i in 0..4800 {
+            let e = (2.0 * std::f64::consts::PI * 440.0 * i as f64 / 48_000.0).sin();
+            // The single precision phase drifts slowly from the exact one.
+            assert!((s.process() as f64 - e).abs() < 5e-4);
+        }
+    }
+
+    #[test]
+    fn test_oscillator_bank() {
+        // A voice of a bank matches an oscillator exactly.
+        for w in [Waveform::Sine, Waveform::Sawtooth, Waveform::Pulse(0.3), Waveform::Triangle].iter() {
+            let mut o = Oscillator::with_waveform(*w, 330.0);
+            let mut b = OscillatorBank::new(*w);
+            b.add_voice(330.0, 1.0);
+
+            let (mut x, mut y) = (vec![0.0; 1000], vec![0.0; 1000]);
+            o.process_block(&mut x);
+            for c in y.chunks_mut(100) {
+                b.process_block(c);
+            }
+            assert_eq!(x, y);
+        }
+
+        // Many voices sum like separate oscillators.
+        let amps: Vec<f32> = (1..=20).map(|k| 1.0 / k as f32).collect();
+        let mut b = OscillatorBank::additive(220.0, &amps);
+        assert_eq!(b.voices(), 20);
+        let mut os: Vec<Oscillator> = (1..=20).map(|k| Oscillator::new(220.0 * k as f64)).collect();
+
+        let mut y = vec![0.0; 2000];
+        b.process_block(&mut y);
+        for y in &y {
+            let mut e = 0.0;
+            for (o, a) in os.iter_mut().zip(&amps) {
+                e += o.process() * a;
+            }
+            assert!((y - e).abs() < 1e-5);
+        }
+
+        // Unison voices are detuned around the center and start spread out.
+        let mut u = OscillatorBank::unison(Waveform::Sawtooth, 110.0, 7, 50.0);
+        assert!((u.get_frequency(0) - 110.0 * (-25.0f64 / 1200.0).exp2()).abs() < 1e-3);
+        assert!((u.get_frequency(3) - 110.0).abs() < 1e-3);
+        assert!(u.get_phase(1) != u.get_phase(2));
+
+        u.swap_remove(0);
+        assert_eq!(u.voices(), 6);
+        assert!((u.get_frequency(0) - 110.0 * (25.0f64 / 1200.0).exp2()).abs() < 1e-3);
+
+        let mut y = vec![0.0; 480];
+        u.process_block(&mut y);
+        let mut c = u.clone();
+        let mut z = vec![0.0; 480];
+        c.process_block(&mut z);
+        assert_eq!(y, z);
+        assert!(y.iter().all(|x| x.abs() <= 6.0f32.sqrt() * 1.1));
+    }
+
+    #[test]
+    fn test_context() {
+        let ctx = bae_rs::Context::new(24_000.0, 240);
+        let expected = |i: usize| (2.0 * std::f64::consts::PI * 1000.0 * i as f64 / 24_000.0).sin() as f32;
+
+        // Frequencies are kept across a change of sample rate.
+        let mut s = Sine::new(1000.0);
+        s.set_context(&ctx);
+        assert!((s.get_frequency() - 1000.0).abs() < 1e-9);
+
+        let mut o = Oscillator::new(1000.0);
+        o.set_context(&ctx);
+        assert_eq!(o.get_frequency(), 1000.0);
+
+        let mut y = vec![0.0; 240];
+        let mut z = vec![0.0; 240];
+        s.process_block(&mut y);
+        o.process_block(&mut z);
+        for (i, (y, z)) in y.iter().zip(&z).enumerate() {
+            assert!((y - expected(i)).abs() < 1e-4);
+            assert!((z - expected(i)).abs() < 1e-4);
+        }
+
+        // A period of 1kHz is 24 samples at 24kHz.
+        let mut q = Square::new(1000.0);
+        q.set_context(&ctx);
+        q.process_block(&mut y[..48]);
+        assert!(y[..12].iter().all(|x| *x == 1.0));
+        assert!(y[12..24].iter().all(|x| *x == -1.0));
+        assert!(y[24..36].iter().all(|x| *x == 1.0));
+
+        let mut t = Sawtooth::new(1000.0);
+        t.set_context(&ctx);
+        assert!((t.get_frequency() - 1000.0).abs() < 1e-9);
+        t.process_block(&mut y[..7]);
+        assert!((y[6] - 0.5).abs() < 1e-6);
+    }
 }
@@ -53,6 +53,256 @@ mod tests {
         run_modifier(&mut d, "delay.wav");
     }
 
+    #[test]
+    fn test_delay_line() {
+        use bae_rs::utils::delay_line::*;
+
+        let mut l = DelayLine::new(100);
+        assert!(l.max_delay() >= 100);
+        assert!(l.len().is_power_of_two());
+
+        let input: Vec<f32> = (0..1000).map(|i| i as f32).collect();
+        for x in &input[..500] {
+            l.write(*x);
+        }
+        l.write_block(&input[500..]);
+
+        assert_eq!(l.tap(0), 999.0);
+        assert_eq!(l.tap(100), 899.0);
+        assert_eq!(l.tap_linear(10.25), 988.75);
+        assert!((l.tap_cubic(10.25) - 988.75).abs() < 1e-3);
+
+        let mut out = vec![0.0; 50];
+        l.read_block(20, &mut out);
+        assert_eq!(&out[..], &input[930..980]);
+
+        // Clones are silent and the same length as the original.
+        let e = Echo::new(Duration::from_secs_f64(1.0), 0.5);
+        let mut c = e.clone();
+        assert_eq!(c.process(1.0), 1.0);
+
+        // Fractional delays interpolate between samples, and can change
+        // without reallocating.
+        let mut d = Delay::with_max_delay(Duration::from_secs_f64(0.0), Duration::from_secs_f64(0.01));
+        d.set_delay(Duration::from_secs_f64(2.5 / bae_rs::SAMPLE_RATE as f64));
+        let mut y: Vec<f32> = input[..10].iter().map(|x| d.process(*x)).collect();
+        for (y, e) in y[3..].iter().zip(&[0.5, 1.5, 2.5, 3.5, 4.5, 5.5, 6.5]) {
+            assert!((y - e).abs() < 1e-4);
+        }
+
+        d.set_delay(Duration::from_secs_f64(1.0));
+        assert_eq!(d.get_delay(), Duration::from_secs_f64(480.0 / bae_rs::SAMPLE_RATE as f64));
+
+        // Several taps of one buffer give the sum of separate delays.
+        let mut m = MultiTap::new(Duration::from_secs_f64(0.01));
+        m.add_tap(Tap { delay: 7.0, gain: 0.5 });
+        m.add_tap(Tap { delay: 130.0, gain: 0.25 });
+        let mut d1 = Delay::new(Duration::from_secs_f64(7.0 / bae_rs::SAMPLE_RATE as f64));
+        let mut d2 = Delay::new(Duration::from_secs_f64(130.0 / bae_rs::SAMPLE_RATE as f64));
+
+        y = input.clone();
+        for (x, y) in input.iter().zip(&mut y) {
+            let expected = d1.process(*x) * 0.5 + d2.process(*x) * 0.25;
+            *y = m.process(*x);
+            assert_eq!(*y, expected);
+        }
+    }
+
+    #[test]
+    fn test_iir() {
+        // Transposed direct form II matches the direct form difference
+        // equation.
+        let (b, a) = ([0.2, 0.3, -0.1, 0.05], [-0.5, 0.25]);
+        let mut f = Iir::new(b, a);
+        let (mut x, mut y) = ([0.0f32; 4], [0.0f32; 2]);
+
+        let mut n = Noise::new();
+        for _ in 0..1000 {
+            let input = n.process();
+            x = [input, x[0], x[1], x[2]];
+
+            let mut expected = 0.0;
+            for k in 0..4 {
+                expected += b[k] * x[k];
+            }
+            for k in 0..2 {
+                expected -= a[k] * y[k];
+            }
+            y = [expected, y[0]];
+
+            assert!((f.process(input) - expected).abs() < 1e-5);
+        }
+
+        // A high order Butterworth cascade passes DC, stops high frequencies,
+        // and stays stable.
+        let mut lp = BiquadCascade::<4>::butterworth_lowpass(1000.0);
+        let mut t = vec![1.0; 48_000];
+        lp.process_block(&mut t);
+        assert!((t[47_999] - 1.0).abs() < 1e-3);
+
+        let mut s = Sine::new(8000.0);
+        let mut t = vec![0.0; 48_000];
+        s.process_block(&mut t);
+        lp.process_block(&mut t);
+        assert!(t[24_000..].iter().all(|x| x.abs() < 1e-4));
+
+        let mut imp = vec![0.0; 48_000];
+        imp[0] = 1.0;
+        BiquadCascade::<8>::butterworth_highpass(20.0).process_block(&mut imp);
+        assert!(imp[40_000..].iter().all(|x| x.abs() < 1e-6));
+    }
+
+    #[test]
+    fn test_biquad_context() {
+        let ctx = bae_rs::Context::new(96_000.0, 960);
+        let at_rate = Biquad::with_context(BiquadShape::LowPass, 1000.0, 0.7, &ctx);
+        assert_ne!(Biquad::lowpass(1000.0, 0.7).get_a(), at_rate.get_a());
+
+        // Designed filters are designed again at the new rate.
+        let mut f = Biquad::lowpass(1000.0, 0.7);
+        f.set_context(&ctx);
+        assert_eq!(f.get_b(), at_rate.get_b());
+        assert_eq!(f.get_a(), at_rate.get_a());
+
+        let mut lp = BiquadCascade::<2>::butterworth_lowpass(1000.0);
+        lp.set_context(&ctx);
+        let mut t = vec![1.0; 96_000];
+        lp.process_block(&mut t);
+        assert!((t[95_999] - 1.0).abs() < 1e-3);
+        // The cutoff stays at -3dB.
+        let mut s = Sine::new(1000.0);
+        s.set_context(&ctx);
+        let mut t = vec![0.0; 96_000];
+        s.process_block(&mut t);
+        lp.process_block(&mut t);
+        let peak = t[48_000..].iter().fold(0.0f32, |m, x| m.max(x.abs()));
+        assert!((peak - 0.5f32.sqrt()).abs() < 1e-2);
+
+        let mut bank = BiquadBank::new(2);
+        bank.set_voice(0, &Biquad::lowpass(1000.0, 0.7));
+        bank.set_voice(1, &Biquad::new([0.5, 0.0, 0.0], [0.0, 0.0]));
+        bank.set_context(&ctx);
+        assert_eq!(bank.get_voice(0).get_a(), at_rate.get_a());
+        bank.set_voice(0, &Biquad::lowpass(1000.0, 0.7));
+        assert_eq!(bank.get_voice(0).get_a(), at_rate.get_a());
+
+        // Filters made from coefficients are bound to their rate.
+        assert_eq!(bank.get_voice(1).get_b(), &[0.5, 0.0, 0.0]);
+        let mut f = Biquad::new(*at_rate.get_b(), *at_rate.get_a());
+        f.set_context(&bae_rs::Context::default());
+        assert_eq!(f.get_a(), at_rate.get_a());
+    }
+
+    #[test]
+    fn test_biquad_bank() {
+        // Every voice matches a Biquad with the same coefficients, on every
+        // voice of a partly filled lane group.
+        let filters: Vec<Biquad> = (0..11)
+            .map(|i| Biquad::lowpass(200.0 * (i + 1) as bae_rs::MathT, 0.7 + 0.1 * i as bae_rs::MathT))
+            .collect();
+
+        let mut bank = BiquadBank::new(filters.len());
+        for (v, f) in filters.iter().enumerate() {
+            bank.set_voice(v, f);
+        }
+
+        let mut n = Noise::new();
+        let mut reference = filters.clone();
+        for _ in 0..3 {
+            let mut blocks: Vec<bae_rs::SampleTrackT> = (0..filters.len())
+                .map(|_| (0..96).map(|_| n.process()).collect())
+                .collect();
+            let expected: Vec<bae_rs::SampleTrackT> = blocks.iter().zip(&mut reference)
+                .map(|(b, f)| {
+                    let mut b = b.clone();
+                    f.process_block(&mut b);
+                    b
+                })
+                .collect();
+
+            bank.process(&mut blocks);
+
+            for (b, e) in blocks.iter().zip(&expected) {
+                for (y, e) in b.iter().zip(e) {
+                    assert_eq!(y.to_bits(), e.to_bits());
+                }
+            }
+        }
+
+        // Ramping steps the coefficients linearly once per sample, and lands
+        // on the target at the end of the block.
+        let (from, to) = (Biquad::lowpass(500.0, 0.7), Biquad::lowpass(2000.0, 0.7));
+        let mut bank = BiquadBank::new(1);
+        bank.set_voice(0, &from);
+        bank.ramp_voice(0, &to);
+
+        let block: bae_rs::SampleTrackT = (0..64).map(|_| n.process()).collect();
+        let mut expected = block.clone();
+        let mut f = from.clone();
+        let (mut b, mut a) = (*from.get_b(), *from.get_a());
+        let db = [0, 1, 2].map(|k| (to.get_b()[k] - b[k]) / 64.0);
+        let da = [0, 1].map(|k| (to.get_a()[k] - a[k]) / 64.0);
+        for x in &mut expected {
+            *x = f.process(*x);
+            for k in 0..3 {
+                b[k] += db[k];
+            }
+            for k in 0..2 {
+                a[k] += da[k];
+            }
+            f.set_coefficients(b, a);
+        }
+
+        let mut blocks = vec![block];
+        bank.process(&mut blocks);
+        for (y, e) in blocks[0].iter().zip(&expected) {
+            assert_eq!(y.to_bits(), e.to_bits());
+        }
+        assert_eq!(bank.get_voice(0).get_b(), to.get_b());
+
+        // Removing a voice moves the last one into its place.
+        let mut bank = BiquadBank::new(9);
+        bank.set_voice(8, &to);
+        bank.swap_remove(2);
+        assert_eq!(bank.voices(), 8);
+        assert_eq!(bank.get_voice(2).get_a(), to.get_a());
+        assert_eq!(bank.get_voice(7).get_b(), &[1.0, 0.0, 0.0]);
+    }
+
+    #[test]
+    fn test_convolution() {
+        use std::sync::Arc;
+
+        let mut n = Noise::new();
+        let taps: Vec<f32> = (0..3000).map(|i| n.process() * (-(i as f32) / 600.0).exp()).collect();
+        let input: Vec<f32> = (0..6000).map(|_| n.process()).collect();
+
+        let expected: Vec<f32> = (0..input.len())
+            .map(|t| taps.iter().take(t + 1).enumerate().map(|(k, h)| h * input[t - k]).sum())
+            .collect();
+
+        let uniform = Arc::new(ImpulseResponse::new(&taps, bae_rs::SAMPLE_RATE as f64, 100));
+        assert_eq!(uniform.partition(), 128);
+        assert_eq!(uniform.partitions(), vec![(128, 23)]);
+
+        let nonuniform = Arc::new(ImpulseResponse::with_partitions(&taps, bae_rs::SAMPLE_RATE as f64, 16, 512));
+        assert_eq!(nonuniform.partitions(), vec![(16, 1), (32, 1), (64, 1), (128, 1), (256, 1), (512, 5)]);
+
+        for ir in [uniform, nonuniform] {
+            let mut c = Convolution::new(ir.clone());
+            for (x, y) in input.iter().zip(&expected) {
+                assert!((c.process(*x) - y).abs() < 1e-4);
+            }
+
+            c.reset();
+            let mut shared = c.clone();
+            assert!(Arc::ptr_eq(shared.get_impulse_response(), &ir));
+            for (x, y) in input.iter().zip(&expected) {
+                assert!((shared.process(*x) - y).abs() < 1e-4);
+            }
+        }
+    }
+
     #[test]
     fn test_echo() {
         let mut e = Echo::new(std::time::Duration::from_secs_f64(0.25), 0.5);
@@ -68,6 +318,119 @@ mod tests {
         write_wav(vec![t], 24, &mut File::create(f).unwrap(), false).unwrap();
     }
 
+    #[test]
+    fn test_denormals() {
+        fn ring_out<M: Modifier>(mut m: M, blocks: usize) {
+            let mut block = vec![0.0; 480];
+            block[0] = 1.0;
+
+            let mut last = 1.0;
+            for i in 0..blocks {
+                if i % 2 == 0 {
+                    m.process_block(&mut block);
+                } else {
+                    for x in block.iter_mut() {
+                        *x = m.process(*x);
+                    }
+                }
+
+                assert!(block.iter().all(|x| *x == 0.0 || x.abs() >= std::f32::MIN_POSITIVE));
+                last = block[479];
+                block.iter_mut().for_each(|x| *x = 0.0);
+            }
+            assert_eq!(last, 0.0);
+        }
+
+        // Without a hardware guard the state decays until it is flushed,
+        // never reaching subnormal values.
+        ring_out(LowPass::new(500.0, 0.5), 1000);
+        ring_out(Biquad::lowpass(20.0, 0.7), 1000);
+        ring_out(Envelope::new(20.0, 2000.0), 1000);
+        ring_out(Echo::new(Duration::from_millis(1), 0.9), 1000);
+        ring_out(Generic::new(
+            vec![(0, 1.0)].into_iter().collect(),
+            vec![(0, 0.99)].into_iter().collect(),
+        ), 1000);
+
+        let mut bank = BiquadBank::new(2);
+        bank.set_voice(0, &Biquad::lowpass(20.0, 0.7));
+        let mut voices = vec![vec![0.0; 480], vec![0.0; 480]];
+        voices[0][0] = 1.0;
+        for _ in 0..1000 {
+            bank.process(&mut voices);
+            assert!(voices[0].iter().all(|x| *x == 0.0 || x.abs() >= std::f32::MIN_POSITIVE));
+            voices[0].iter_mut().for_each(|x| *x = 0.0);
+        }
+        bank.process(&mut voices);
+        assert_eq!(voices[0][479], 0.0);
+
+        let tiny = std::hint::black_box(1e-30f32);
+        {
+            let _guard = denormal::DenormalGuard::new();
+            let _inner = denormal::DenormalGuard::new();
+            assert!(!denormal::DenormalGuard::is_supported() || std::hint::black_box(tiny * 1e-10) == 0.0);
+        }
+        assert!(std::hint::black_box(tiny * 1e-10) > 0.0);
+    }
+
+    #[test]
+    fn test_tail() {
+        let ms = Duration::from_millis;
+        let mut impulse = vec![0.0; 480];
+        impulse[0] = 1.0;
+        let mut late = vec![0.0; 480];
+        late[479] = 1.0;
+        let silence = vec![0.0; 480];
+
+        // Fixed tails count down from the last sample of input.
+        let mut d = Delay::new(ms(5));
+        assert_eq!(d.tail(), Some(0));
+        d.process_block(&mut late.clone());
+        assert_eq!(d.tail(), Some(241));
+        d.process_block(&mut silence.clone());
+        assert_eq!(d.tail(), Some(0));
+        d.process_block(&mut late.clone());
+        d.reset();
+        assert_eq!(d.tail(), Some(0));
+
+        let mut e = Echo::new(ms(5), 0.5);
+        e.process_block(&mut late.clone());
+        let left = e.tail().unwrap();
+        assert!(left > 240 * 19 && left < 240 * 22);
+        e.set_gain(1.0);
+        assert_eq!(e.tail(), None);
+
+        // Filters with feedback ring until their state decays.
+        let mut lp = LowPass::new(440.0, 0.5);
+        assert_eq!(lp.tail(), Some(0));
+        lp.process_block(&mut impulse.clone());
+        assert_eq!(lp.tail(), None);
+        for _ in 0..100 {
+            lp.process_block(&mut silence.clone());
+        }
+        assert_eq!(lp.tail(), Some(0));
+
+        // A stopped envelope silences whatever comes after it in a series,
+        // once the rest of the series has rung out.
+        let mut a = ADSR::new(ms(1), ms(1), 0.5, ms(1));
+        assert!(!a.is_silent());
+        a.release();
+        a.process_block(&mut impulse.clone());
+        assert!(a.is_silent());
+
+        let mut series = (a, Delay::new(ms(20)));
+        series.0.trigger();
+        series.process_block(&mut impulse.clone());
+        series.0.release();
+        series.process_block(&mut impulse.clone());
+        assert!(!series.is_silent());
+        assert_eq!(series.tail(), Some(961 - 479));
+        series.process_block(&mut silence.clone());
+        series.process_block(&mut silence.clone());
+        assert!(series.is_silent());
+        assert_eq!(series.tail(), Some(0));
+    }
+
     #[test]
     fn test_envelope() {
         let mut e = Envelope::new(20.0, 20_000.0);
@@ -158,6 +521,75 @@ mod tests {
         write_wav(vec![t], 24, &mut File::create(f).unwrap(), false).unwrap();
     }
 
+    #[test]
+    fn test_filter_response() {
+        // Gain of the filter at a frequency once it has settled.
+        fn gain<M: Modifier>(mut m: M, f: bae_rs::MathT) -> bae_rs::MathT {
+            let mut x = vec![0.0; bae_rs::SAMPLE_RATE as usize / 2];
+            Oscillator::new(f).process_block(&mut x);
+            let mut y = x.clone();
+            m.process_block(&mut y);
+
+            let rms = |t: &[bae_rs::SampleT]| {
+                (t.iter().map(|s| (s * s) as bae_rs::MathT).sum::<bae_rs::MathT>() / t.len() as bae_rs::MathT).sqrt()
+            };
+            let half = x.len() / 2;
+            rms(&y[half..]) / rms(&x[half..])
+        }
+
+        assert!((gain(LowPass::new(440.0, 0.0), 50.0) - 1.0).abs() < 0.05);
+        assert!(gain(LowPass::new(440.0, 0.0), 8000.0) < 0.01);
+        assert!(gain(HighPass::new(440.0, 0.0), 8000.0) > 0.9);
+        assert!(gain(HighPass::new(440.0, 0.0), 50.0) < 0.01);
+        assert!(gain(BandPass::new(1000.0, 1.0), 1000.0) > 0.5);
+        assert!(gain(BandPass::new(1000.0, 1.0), 20.0) < 0.1);
+        assert!(gain(BandPass::from_corners((500.0, 2000.0)), 1000.0) > 0.5);
+    }
+
+    #[test]
+    fn test_process_block() {
+        fn compare<M: Modifier>(mut a: M, mut b: M) {
+            let mut g = Sine::new(440.0);
+            let mut input = vec![0.0; bae_rs::SAMPLE_RATE as usize / 4];
+            g.process_block(&mut input);
+
+            let mut t = input.clone();
+            for c in t.chunks_mut(100) {
+                b.process_block(c);
+            }
+            for (x, y) in input.iter().zip(t) {
+                assert!((a.process(*x) - y).abs() < std::f32::EPSILON);
+            }
+        }
+
+        let adsr = || ADSR::new(
+            Duration::from_secs_f64(0.03125),
+            Duration::from_secs_f64(0.125),
+            linear_to_db(0.5),
+            Duration::from_secs_f64(0.5)
+        );
+
+        compare(adsr(), adsr());
+        compare(BandPass::new(440.0, 2.0), BandPass::new(440.0, 2.0));
+        compare(Delay::new(Duration::from_secs_f64(0.001)), Delay::new(Duration::from_secs_f64(0.001)));
+        compare(Echo::new(Duration::from_secs_f64(0.001), 0.5), Echo::new(Duration::from_secs_f64(0.001), 0.5));
+        compare(Envelope::new(20.0, 20_000.0), Envelope::new(20.0, 20_000.0));
+        compare(Gain::new(0.5), Gain::new(0.5));
+        compare(HighPass::new(440.0, 1.0), HighPass::new(440.0, 1.0));
+        compare(LowPass::new(440.0, 1.0), LowPass::new(440.0, 1.0));
+        compare(Passthrough::new(), Passthrough::new());
+        compare(Biquad::lowpass(440.0, 0.7), Biquad::lowpass(440.0, 0.7));
+        compare(BiquadCascade::<3>::butterworth_highpass(440.0), BiquadCascade::<3>::butterworth_highpass(440.0));
+        compare(
+            Delay::with_max_delay(Duration::from_secs_f64(0.0011), Duration::from_secs_f64(0.01)),
+            Delay::with_max_delay(Duration::from_secs_f64(0.0011), Duration::from_secs_f64(0.01))
+        );
+        compare(
+            Echo::with_max_delay(Duration::from_secs_f64(0.0011), Duration::from_secs_f64(0.01), 0.5),
+            Echo::with_max_delay(Duration::from_secs_f64(0.0011), Duration::from_secs_f64(0.01), 0.5)
+        );
+    }
+
     fn run_modifier(m: &mut dyn bae_rs::modifiers::Modifier, file:&str)
     {
         let mut g = Noise::new();
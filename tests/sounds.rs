@@ -5,7 +5,8 @@ mod tests {
     use std::sync::Arc;
     use std::fs::File;
     use std::time::Duration;
-    use bae_rs::{generators::*, modifiers::*, sounds::*, utils::*};
+    use bae_rs::{generators::*, modifiers::*, sample_format::*, sounds::*, utils::*};
+    use bae_rs::utils::asset_cache::{AssetCache, AssetKey};
 
     #[test]
     fn test_blocks() {
@@ -29,6 +30,165 @@ mod tests {
         normalize_write(-1.5, t, &mut File::create(".junk/sounds/block_NoiseLP.wav").unwrap())
 }
 
+    #[test]
+    fn test_interactors() {
+        let mut t = vec![0.0; 256];
+        let mut g = vec![0.0; 256];
+        Sine::new(440.0).process_block(&mut g);
+
+        let cases = vec![
+            (Interactor::Multiply, g.iter().map(|g| g * 0.5).collect::<Vec<_>>()),
+            (Interactor::Add, g.iter().map(|g| g + 0.5).collect()),
+            (Interactor::Generator, g.clone()),
+            (Interactor::Modifier, vec![0.5; 256]),
+            (Interactor::custom(|g, m| g - m), g.iter().map(|g| g - 0.5).collect()),
+            (Interactor::from(Arc::new(|g, m| g * g + m) as Inter), g.iter().map(|g| g * g + 0.5).collect()),
+        ];
+
+        for (i, expected) in cases {
+            let mut b = StandardBlock::new(Sine::new(440.0), Passthrough::new(), i);
+            for x in &mut t {
+                *x = 0.5;
+            }
+            b.process_block(&mut t);
+            assert_eq!(t, expected);
+
+            // Custom interactors are shared by clones, so only one block may
+            // hold each at a time.
+            let i = b.get_i().clone();
+            drop(b);
+            let mut b = StandardBlock::new(Sine::new(440.0), Passthrough::new(), i);
+            for e in &expected {
+                b.prime_input(0.5);
+                assert_eq!(b.process(), *e);
+            }
+        }
+    }
+
+    #[test]
+    fn test_block_arena() {
+        let shared: BlockSP = Arc::new(StandardBlock::from_generator(Sine::new(220.0)));
+        let mut arena = BlockArena::with_capacity(2);
+        let a = arena.push(StandardBlock::from_generator(Sine::new(440.0)));
+        let b = arena.push_shared(shared.clone());
+        assert_eq!(arena.len(), 2);
+        assert!(arena.get_standard(a).is_some());
+        assert!(arena.get_standard(b).is_none());
+
+        // Shared blocks are left alone while another owner holds them.
+        let mut t = vec![0.0; 64];
+        assert!(arena.get_mut(b).is_none());
+        assert!(!arena.try_process_block(b, &mut t));
+        drop(shared);
+        assert!(arena.try_process_block(b, &mut t));
+
+        let mut s = Sine::new(440.0);
+        arena.process_block(a, &mut t);
+        for x in &t {
+            assert!((x - s.process()).abs() < 1e-6);
+        }
+
+        // Sounds built from blocks stored in place match the shared ones.
+        let mut x = SimpleSound::new(1.0, 0.5, Arc::new(StandardBlock::from_generator(Sine::new(440.0))));
+        x.add_modifier(Arc::new(StandardBlock::from_modifier(LowPass::new(440.0, 1.0))));
+        let mut y = SimpleSound::from_block(1.0, 0.5, StandardBlock::from_generator(Sine::new(440.0)));
+        y.add_standard_modifier(StandardBlock::from_modifier(LowPass::new(440.0, 1.0)));
+
+        let mut u = vec![0.0; 512];
+        x.process_block(&mut t);
+        y.process_block(&mut u[..64]);
+        assert_eq!(t, &u[..64]);
+
+        let mut cx = ComplexSound::new(1.0, 1.0);
+        let n = cx.add_block(Arc::new(StandardBlock::from_generator(Sawtooth::new(110.0))));
+        cx.add_connection(n, cx.get_output_gain());
+        let mut cy = ComplexSound::new(1.0, 1.0);
+        let n = cy.add_standard_block(StandardBlock::from_generator(Sawtooth::new(110.0)));
+        cy.add_connection(n, cy.get_output_gain());
+        assert!(cy.get_block_mut(n).is_some());
+
+        let mut v = vec![0.0; 512];
+        for x in &mut u {
+            *x = 0.0;
+        }
+        cx.process_block(&mut u);
+        cy.process_block(&mut v);
+        assert_eq!(u, v);
+    }
+
+    #[test]
+    fn test_chain() {
+        let mut ss = SimpleSound::new(1.0, 0.5,
+            Arc::new(StandardBlock::from_generator(Sawtooth::new(220.0)))
+        );
+        ss.add_modifier(Arc::new(StandardBlock::from_modifier(LowPass::new(880.0, 0.7))));
+        ss.add_modifier(Arc::new(StandardBlock::from_modifier(HighPass::new(110.0, 0.7))));
+
+        let mut chain = Chain::new(Sawtooth::new(220.0), (LowPass::new(880.0, 0.7),))
+            .then(HighPass::new(110.0, 0.7));
+        chain.set_gain(0.5);
+        let mut fresh = chain.clone();
+
+        let mut t = vec![0.0; 480];
+        let mut u = vec![0.0; 480];
+        for _ in 0..4 {
+            ss.process_block(&mut t);
+            chain.process_block(&mut u);
+            assert_eq!(t, u);
+        }
+        assert_eq!(ss.process(0.0), chain.process(0.0));
+
+        // Clones and resets start over from the beginning.
+        fresh.process_block(&mut t);
+        chain.reset();
+        chain.process_block(&mut u);
+        assert_eq!(t, u);
+
+        chain.toggle_mute();
+        chain.process_block(&mut u);
+        assert!(u.iter().all(|x| *x == 0.0));
+
+        let mut silent = Chain::from_generator(Zero::new());
+        silent.process_block(&mut u);
+        assert!(u.iter().all(|x| *x == 0.0));
+    }
+
+    #[test]
+    fn test_finished() {
+        let ms = Duration::from_millis;
+        let mut t = vec![0.0; 480];
+
+        // A chain is finished once its envelope stops, until it is triggered
+        // again.
+        let mut chain = Chain::new(Sine::new(440.0), ADSR::new(ms(1), ms(1), 0.5, ms(1)));
+        chain.process_block(&mut t);
+        assert_eq!(chain.tail(), None);
+        chain.get_modifiers_mut().release();
+        chain.process_block(&mut t);
+        assert!(chain.is_finished());
+        chain.get_modifiers_mut().trigger();
+        assert!(!chain.is_finished());
+
+        // Graphs are finished once every path to the output has rung out, and
+        // graphs with feedback never are.
+        let clip = MonoWav::from_track(bae_rs::SAMPLE_RATE as bae_rs::MathT, vec![Mono::from_sample(0.5); 100]);
+        let mut cs = ComplexSound::new(1.0, 1.0);
+        let g = cs.add_block(Arc::new(StandardBlock::from_generator(clip)));
+        let d = cs.add_block(Arc::new(StandardBlock::from_modifier(Delay::new(ms(5)))));
+        cs.add_connection(g, d);
+        cs.add_connection(d, cs.get_output_gain());
+        assert_eq!(cs.tail(), None);
+
+        cs.process_block(&mut t);
+        assert!(t[240..340].iter().all(|x| *x == 0.5));
+        assert!(cs.is_finished());
+
+        cs.reset();
+        cs.add_connection(d, d);
+        cs.process_block(&mut t);
+        assert_eq!(cs.tail(), None);
+    }
+
     #[test]
     fn test_simple_sounds() {
         let mut ss = SimpleSound::new(1.0, 0.5,
@@ -92,9 +252,249 @@ mod tests {
         normalize_write(-1.5, t, &mut File::create(".junk/sounds/complex_sounds.wav").unwrap())
     }
 
+    #[test]
+    fn test_block_sounds() {
+        let simple = || {
+            let mut ss = SimpleSound::new(1.0, 0.5,
+                Arc::new(StandardBlock::from_generator(Sine::new(440.0)))
+            );
+            ss.extend_modifiers(
+                vec![
+                    Arc::new(StandardBlock::from_modifier(LowPass::new(880.0, 1.0))),
+                    Arc::new(StandardBlock::from_modifier(HighPass::new(220.0, 1.0)))
+                ]
+            );
+            ss
+        };
+        let complex = || {
+            let mut cs = ComplexSound::new(1.0, 0.5);
+            let s = cs.add_block(Arc::new(StandardBlock::from_generator(Sine::new(440.0))));
+            let lp = cs.add_block(Arc::new(StandardBlock::from_modifier(LowPass::new(880.0, 1.0))));
+            cs.add_connection(cs.get_input_gain(), s);
+            cs.add_connection(s, lp);
+            cs.add_connection(lp, cs.get_output_gain());
+            cs
+        };
+
+        fn compare(a: &mut dyn Sound, b: &mut dyn Sound) {
+            let mut t = vec![0.0; 2000];
+            for c in t.chunks_mut(128) {
+                b.process_block(c);
+            }
+            for s in t {
+                assert!((a.process(0.0) - s).abs() < 1e-6);
+            }
+        }
+
+        compare(&mut simple(), &mut simple());
+        compare(&mut complex(), &mut complex());
+    }
+
+    #[test]
+    fn test_execution_plan() {
+        let mut cs = ComplexSound::new(1.0, 1.0);
+        let s = cs.add_block(Arc::new(StandardBlock::from_generator(Sine::new(440.0))));
+        let lp = cs.add_block(Arc::new(StandardBlock::from_modifier(LowPass::new(880.0, 1.0))));
+        let hp = cs.add_block(Arc::new(StandardBlock::from_modifier(HighPass::new(220.0, 1.0))));
+        let ig = cs.get_input_gain();
+        let og = cs.get_output_gain();
+
+        cs.add_connection(ig, s);
+        cs.add_connection(s, lp);
+        cs.add_connection(s, hp);
+        cs.add_connection(lp, og);
+        cs.add_connection(hp, og);
+        cs.add_connection(og, ig);
+
+        let plan = cs.get_plan();
+        let levels: Vec<Vec<usize>> = plan.levels().iter()
+            .map(|r| plan.ops()[r.clone()].iter().map(|op| op.node).collect())
+            .collect();
+
+        assert_eq!(levels, vec![
+            vec![ig.index()],
+            vec![s.index()],
+            vec![lp.index(), hp.index()],
+            vec![og.index()],
+        ]);
+        assert_eq!(cs.get_nodes().len(), 5);
+
+        let mut editor = cs.editor();
+        editor.remove_connection(lp, og);
+        editor.remove_connection(hp, og);
+        editor.commit();
+        assert!(!editor.is_committed());
+
+        let mut t = vec![0.0; 128];
+        cs.process_block(&mut t);
+
+        assert!(editor.is_committed());
+        assert!(t.iter().all(|x| *x == 0.0));
+        assert!(cs.get_plan().ops().last().unwrap().fan_out == vec![ig.index()]);
+    }
+
+    #[test]
+    fn test_feedback() {
+        // The output of b leads back into a, so each sample of the impulse
+        // goes around the loop once more, halved, one sample later.
+        let looped = || {
+            let mut cs = ComplexSound::new(1.0, 1.0);
+            let a = cs.add_standard_block(StandardBlock::from_modifier(Gain::new(1.0)));
+            let b = cs.add_standard_block(StandardBlock::from_modifier(Gain::new(0.5)));
+            cs.add_connection(cs.get_input_gain(), a);
+            cs.add_connection(a, b);
+            cs.add_connection(b, a);
+            cs.add_connection(b, cs.get_output_gain());
+            cs
+        };
+
+        let cs = looped();
+        let plan = cs.get_plan();
+        assert_eq!(plan.levels().len(), 3);
+        assert!(plan.is_loop(1) && !plan.is_loop(0) && !plan.is_loop(2));
+        assert_eq!(plan.ops()[2].delayed, vec![plan.ops()[1].node]);
+
+        for &len in &[1, 7, 64, 480] {
+            let mut cs = looped();
+            let mut t = vec![0.0; 960];
+            t[0] = 1.0;
+            for c in t.chunks_mut(len) {
+                cs.process_block(c);
+            }
+
+            for (i, x) in t.iter().take(20).enumerate() {
+                assert!((x - 0.5f32.powi(i as i32 + 1)).abs() < 1e-9);
+            }
+            assert_eq!(cs.tail(), None);
+        }
+
+        // A node connected to itself is a loop of its own.
+        let mut cs = ComplexSound::new(1.0, 1.0);
+        let a = cs.add_standard_block(StandardBlock::from_modifier(Gain::new(0.5)));
+        cs.add_connection(cs.get_input_gain(), a);
+        cs.add_connection(a, a);
+        cs.add_connection(a, cs.get_output_gain());
+
+        let mut t = vec![0.0; 16];
+        t[0] = 1.0;
+        for c in t.chunks_mut(5) {
+            cs.process_block(c);
+        }
+        for (i, x) in t.iter().enumerate() {
+            assert!((x - 0.5f32.powi(i as i32 + 1)).abs() < 1e-9);
+        }
+    }
+
     fn normalize_write(db: bae_rs::MathT, mut t: bae_rs::SampleTrackT, d: &mut dyn std::io::Write) {
         normalize(db, &mut t);
 
         write_wav(vec![t], 24, d, false).expect("Failed to write wav file");
     }
+
+    #[test]
+    fn test_freeze() {
+        let ctx = bae_rs::Context::default();
+        let rate = bae_rs::SAMPLE_RATE as bae_rs::MathT;
+        let clip: Vec<Mono> = (0..1000).map(|i| Mono::from_sample((i as f32 * 0.05).sin())).collect();
+        let wav = || MonoWav::from_track(rate, clip.clone());
+        let source = || Chain::new(wav(), LowPass::new(2000.0, 0.7));
+
+        fn render(s: &mut dyn Sound, n: usize) -> Vec<f32> {
+            let mut t = vec![0.0; n];
+            for c in t.chunks_mut(100) {
+                c.iter_mut().for_each(|x| *x = 1.0);
+                s.process_block(c);
+            }
+            t
+        }
+        fn compare(a: &[f32], b: &[f32]) {
+            assert_eq!(a.len(), b.len());
+            assert!(a.iter().zip(b).all(|(a, b)| (a - b).abs() < 1e-6));
+        }
+
+        // A frozen sound plays what its source would, ignoring its input, and
+        // finishes with it.
+        let live = render(&mut source(), 4800);
+        let mut frozen = FrozenSound::new(source(), &ctx, 48_000);
+        let len = frozen.buffer().len();
+        assert!(len > 1000 && len < 4800);
+        compare(&render(&mut frozen, 4800), &live);
+        assert!(frozen.is_finished());
+
+        // Renders are shared through the cache, and can be made on another
+        // thread.
+        let mut cache = AssetCache::new(1 << 20);
+        let a = FrozenSound::cached(source(), &ctx, 48_000, AssetKey::Hash(1), &mut cache);
+        let b = FrozenSound::cached(source(), &ctx, 48_000, AssetKey::Hash(1), &mut cache);
+        assert!(a.buffer().ptr_eq(b.buffer()));
+        assert_eq!(cache.stats().hits, 1);
+        let job = FrozenSound::spawn(source(), &ctx, 48_000);
+        compare(job.wait().buffer().samples(), a.buffer().samples());
+        compare(&render(&mut a.voice(), 4800), &live);
+
+        // Borrowing the source thaws the sound, which carries on from the same
+        // position.
+        let mut frozen = FrozenSound::new(Chain::from_generator(wav()), &ctx, 48_000);
+        let mut t = render(&mut frozen, 500);
+        frozen.source_mut();
+        assert!(!frozen.is_frozen());
+        t.extend(render(&mut frozen, 500));
+        compare(&t, &render(&mut Chain::from_generator(wav()), 1000));
+        frozen.refreeze();
+        assert!(frozen.is_frozen());
+        assert_eq!(frozen.buffer().len(), 1000);
+        assert_eq!(frozen.tail(), Some(0));
+
+        // Only regions without live inputs or outputs other than the frozen
+        // node can be frozen, and the rest of the graph keeps processing.
+        let complex = || {
+            let mut cs = ComplexSound::new(1.0, 1.0);
+            let s = cs.add_standard_block(StandardBlock::from_generator(wav()));
+            let lp = cs.add_standard_block(StandardBlock::from_modifier(LowPass::new(2000.0, 0.7)));
+            let g = cs.add_standard_block(StandardBlock::from_modifier(Gain::new(0.5)));
+            cs.add_connection(s, lp);
+            cs.add_connection(lp, cs.get_output_gain());
+            cs.add_connection(cs.get_input_gain(), g);
+            cs.add_connection(g, cs.get_output_gain());
+            (cs, s, lp, g)
+        };
+
+        let (mut cs, s, lp, g) = complex();
+        assert!(!cs.freeze(g, &ctx, 48_000));
+        assert!(!cs.freeze(cs.get_output_gain(), &ctx, 48_000));
+        assert!(cs.freeze(lp, &ctx, 48_000));
+        assert!(cs.is_frozen(s) && cs.is_frozen(lp) && !cs.is_frozen(g));
+        assert!(cs.frozen_buffer(lp).is_some() && cs.frozen_buffer(s).is_none());
+        compare(&render(&mut cs, 4800), &render(&mut complex().0, 4800));
+
+        let (mut other, _, lp2, _) = complex();
+        let mut cache = AssetCache::new(1 << 20);
+        assert!(cs.freeze_cached(lp, &ctx, 48_000, AssetKey::Hash(2), &mut cache));
+        assert!(other.freeze_cached(lp2, &ctx, 48_000, AssetKey::Hash(2), &mut cache));
+        assert!(cs.frozen_buffer(lp).unwrap().ptr_eq(other.frozen_buffer(lp2).unwrap()));
+
+        // Changes to the region thaw it.
+        cs.add_connection(s, g);
+        assert!(!cs.is_frozen(s) && !cs.is_frozen(lp));
+        assert!(!cs.freeze(lp, &ctx, 48_000));
+        cs.remove_connection(s, g);
+        assert!(cs.freeze(lp, &ctx, 48_000));
+        cs.get_block_mut(s);
+        assert!(!cs.is_frozen(lp));
+
+        // A commit thaws the regions over the following blocks, playing their
+        // render until their blocks have caught up. Filters start again from
+        // silence, so the output settles back shortly after.
+        let mut t = render(&mut other, 600);
+        let editor = other.editor();
+        editor.commit();
+        t.extend(render(&mut other, 100));
+        assert!(other.is_frozen(lp2));
+        t.extend(render(&mut other, 100));
+        assert!(!other.is_frozen(lp2));
+        t.extend(render(&mut other, 800));
+        let reference = render(&mut complex().0, 1600);
+        compare(&t[..800], &reference[..800]);
+        compare(&t[1100..], &reference[1100..]);
+    }
 }
@@ -0,0 +1,175 @@
+extern crate bae_rs;
+
+#[cfg(test)]
+mod tests {
+    use std::sync::Arc;
+    use bae_rs::{*, channels::*, generators::*, modifiers::*, sounds::*, tools::*};
+
+    fn sine_channel(f: MathT) -> ChannelSP<Mono> {
+        let mut c = StandardChannel::<Mono>::new(1.0);
+        c.add_sound(Box::new(SimpleSound::new(1.0, 1.0,
+            Arc::new(StandardBlock::from_generator(Sine::new(f)))
+        )));
+
+        Box::new(c)
+    }
+
+    fn output(m: &Mixer<Mono>) -> Vec<SampleT> {
+        m.get_output().iter().map(|x| x.mono).collect()
+    }
+
+    #[test]
+    fn test_mixer_routing() {
+        let mut m = Mixer::<Mono>::new();
+        let master = m.master();
+        let a = m.add_bus();
+        let b = m.add_bus();
+        assert_eq!(m.bus_count(), 3);
+        assert_eq!(m.get_output_bus(a), Some(master));
+        assert_eq!(m.get_output_bus(master), None);
+
+        m.add_channel(a, sine_channel(440.0)).unwrap();
+        m.add_channel(b, sine_channel(220.0)).unwrap();
+        assert!(m.set_output(b, a));
+        m.set_bus_gain(a, 0.5);
+        m.set_bus_gain(b, 0.25);
+        m.set_bus_gain(master, 2.0);
+
+        // Routes which would feed back are rejected.
+        assert!(!m.set_output(a, b));
+        assert!(!m.add_send(a, b, 1.0, TapPoint::PreFader));
+        assert!(!m.add_send(a, a, 1.0, TapPoint::PreFader));
+        assert!(!m.set_output(master, a));
+        assert_eq!(m.get_output_bus(a), Some(master));
+
+        let (mut x, mut y) = (Sine::new(440.0), Sine::new(220.0));
+        for _ in 0..3 {
+            m.process();
+            for o in output(&m) {
+                let e = 2.0 * 0.5 * (x.process() + 0.25 * y.process());
+                assert!((o - e).abs() < 1e-6);
+            }
+        }
+
+        // Removing a bus reroutes the buses feeding it to the master bus.
+        assert!(m.remove_bus(a));
+        assert!(!m.remove_bus(a));
+        assert!(!m.remove_bus(master));
+        assert_eq!(m.get_output_bus(b), Some(master));
+        assert!(m.get_channels(a).is_none());
+
+        m.process();
+        for o in output(&m) {
+            assert!((o - 2.0 * 0.25 * y.process()).abs() < 1e-6);
+        }
+
+        // New buses reuse the buffers of removed ones.
+        let c = m.add_bus();
+        assert_ne!(c, a);
+        assert_eq!(m.bus_count(), 3);
+    }
+
+    #[test]
+    fn test_mixer_sends() {
+        let mut m = Mixer::<Mono>::new();
+        let dry = m.add_bus();
+        let pre = m.add_bus();
+        let post = m.add_bus();
+
+        m.add_channel(dry, sine_channel(440.0)).unwrap();
+        assert!(m.add_send(dry, pre, 0.5, TapPoint::PreFader));
+        assert!(m.add_send(dry, post, 0.5, TapPoint::PostFader));
+        assert!(m.add_effect(post, Gain::new(2.0)));
+        assert_eq!(m.effect_count(post), Some(1));
+        m.set_bus_gain(dry, 0.0);
+
+        // Only the pre-fader send passes signal with the fader down.
+        let mut s = Sine::new(440.0);
+        m.process();
+        for o in output(&m) {
+            assert!((o - 0.5 * s.process()).abs() < 1e-6);
+        }
+
+        let l = m.get_level(dry, 0, TapPoint::PreFader).unwrap();
+        assert!(l.peak > 0.99 && l.peak <= 1.0);
+        assert!((l.rms - 0.5f32.sqrt()).abs() < 0.01);
+        assert_eq!(m.get_level(dry, 0, TapPoint::PostFader).unwrap().peak, 0.0);
+        assert_eq!(m.get_level(post, 0, TapPoint::PreFader).unwrap().peak, 0.0);
+        assert!(m.get_level(dry, 1, TapPoint::PreFader).is_none());
+
+        m.set_bus_gain(dry, 1.0);
+        assert!(m.set_send_gain(dry, pre, 0.0));
+        m.process();
+        for o in output(&m) {
+            assert!((o - 2.0 * s.process()).abs() < 1e-6);
+        }
+        let l = m.get_level(post, 0, TapPoint::PostFader).unwrap();
+        assert!(l.peak > 0.99 && l.peak <= 1.0);
+
+        assert!(m.remove_send(dry, post));
+        assert!(!m.remove_send(dry, post));
+        assert!(m.clear_effects(post));
+        m.process();
+        for o in output(&m) {
+            assert!((o - s.process()).abs() < 1e-6);
+        }
+    }
+
+    struct Failing(usize);
+
+    impl std::io::Write for Failing {
+        fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+            if self.0 < buf.len() {
+                return Err(std::io::Error::new(std::io::ErrorKind::Other, "full"));
+            }
+            self.0 -= buf.len();
+            Ok(buf.len())
+        }
+
+        fn flush(&mut self) -> std::io::Result<()> {
+            Ok(())
+        }
+    }
+
+    #[test]
+    fn test_offline_render() {
+        use std::io::Cursor;
+        use bae_rs::utils::read_wav;
+
+        let mixer = || {
+            let mut m = Mixer::<Mono>::new();
+            let master = m.master();
+            m.add_channel(master, sine_channel(440.0));
+            m
+        };
+
+        let mut direct = mixer();
+        let mut expected = Vec::new();
+        while expected.len() < 10_000 {
+            direct.process();
+            expected.extend(output(&direct));
+        }
+
+        let mut r = OfflineRenderer::new(24, false);
+        r.set_chunk_frames(1000);
+        r.set_queue_depth(2);
+
+        for _ in 0..2 {
+            let mut m = mixer();
+            let file = r.render(&mut m, 10_000, Cursor::new(Vec::new())).unwrap().into_inner();
+            assert_eq!(file.len(), 44 + 10_000 * 3);
+
+            let (h, t) = read_wav(&mut Cursor::new(file)).unwrap();
+            assert_eq!(h.sampling_rate, SAMPLE_RATE as u32);
+            assert_eq!(t.len(), 1);
+            assert_eq!(t[0].len(), 10_000);
+            for (a, b) in t[0].iter().zip(&expected) {
+                assert!((a - b).abs() < 1e-6);
+            }
+        }
+
+        let mut m = mixer();
+        assert!(r.render(&mut m, 10_000, Failing(5000)).is_err());
+        assert!(r.render(&mut m, 10_000, Failing(0)).is_err());
+    }
+}
@@ -18,6 +18,240 @@ mod tests {
         write_wav(vec![t], 24, &mut File::create(".junk/utils/wavwrite.wav").unwrap(), false).unwrap();
     }
 
+    #[test]
+    fn test_spsc() {
+        let (mut p, mut c) = spsc::spsc::<usize>(3);
+        assert_eq!(p.capacity(), 4);
+
+        for i in 0..4 {
+            assert!(p.push(i).is_ok());
+        }
+        assert_eq!(p.push(4), Err(4));
+        assert_eq!(c.pop(), Some(0));
+        assert!(p.push(4).is_ok());
+
+        let t = std::thread::spawn(move || {
+            for i in 5..10_000 {
+                while p.push(i).is_err() {
+                    std::thread::yield_now();
+                }
+            }
+        });
+
+        let mut expected = 1;
+        while expected < 10_000 {
+            if let Some(v) = c.pop() {
+                assert_eq!(v, expected);
+                expected += 1;
+            } else {
+                std::thread::yield_now();
+            }
+        }
+
+        t.join().unwrap();
+        assert!(c.is_empty());
+    }
+
+    #[test]
+    fn test_topological_levels() {
+        let levels = topo::topological_levels(5, &[(0, 1), (1, 2), (1, 3), (2, 4), (3, 4), (4, 4)]);
+        assert_eq!(levels, vec![vec![0], vec![1], vec![2, 3], vec![4]]);
+
+        let levels = topo::topological_levels(3, &[(0, 1), (1, 2), (2, 1)]);
+        assert_eq!(levels, vec![vec![0], vec![1], vec![2]]);
+
+        let levels = topo::topological_levels(2, &[(0, 1), (1, 0)]);
+        assert_eq!(levels, vec![vec![0], vec![1]]);
+    }
+
+    #[test]
+    fn test_strongly_connected() {
+        let comps = topo::strongly_connected(6, &[(0, 1), (1, 2), (2, 1), (2, 3), (3, 3), (4, 5), (5, 4), (3, 4)]);
+        assert_eq!(comps, vec![0, 1, 1, 2, 3, 3]);
+
+        let comps = topo::strongly_connected(3, &[(0, 1), (1, 2)]);
+        assert_eq!(comps, vec![0, 1, 2]);
+    }
+
+    #[test]
+    fn test_simd() {
+        use bae_rs::sample_format::*;
+
+        let src: Vec<f32> = (0..37).map(|i| (i as f32 * 0.37).sin() * 1.5).collect();
+        let base: Vec<f32> = (0..37).map(|i| (i as f32 * 0.11).cos()).collect();
+
+        let (mut a, mut b) = (base.clone(), base.clone());
+        simd::mix(&mut a, &src, 0.3);
+        simd::scalar::mix(&mut b, &src, 0.3);
+        assert_eq!(a, b);
+
+        simd::mix_ramp(&mut a, &src, 0.2, 0.013);
+        simd::scalar::mix_ramp(&mut b, &src, 0.2, 0.013);
+        assert_eq!(a, b);
+
+        simd::add(&mut a, &src);
+        simd::scalar::add(&mut b, &src);
+        simd::mul(&mut a, 0.7);
+        simd::scalar::mul(&mut b, 0.7);
+        assert_eq!(a, b);
+
+        let (mut a, mut b) = (src.clone(), src.clone());
+        simd::clip(&mut a, -1.0, 1.0);
+        simd::scalar::clip(&mut b, -1.0, 1.0);
+        assert_eq!(a, b);
+        assert!(a.iter().all(|x| x.abs() <= 1.0));
+
+        let (mut l, mut r) = (vec![0.0; 37], vec![0.0; 37]);
+        simd::pan(&src, &mut l, &mut r, 0.25, 0.75);
+        assert!(l.iter().zip(&src).all(|(x, s)| *x == s * 0.25));
+        assert!(r.iter().zip(&src).all(|(x, s)| *x == s * 0.75));
+
+        let mut i = vec![0.0; 74];
+        simd::interleave2(&src, &base, &mut i);
+        let mut j = vec![0.0; 74];
+        simd::scalar::interleave2(&src, &base, &mut j);
+        assert_eq!(i, j);
+
+        simd::deinterleave2(&i, &mut l, &mut r);
+        assert_eq!(l, src);
+        assert_eq!(r, base);
+
+        let track: StereoTrackT = src.iter().zip(&base).map(|(l, r)| Stereo::from(*l, *r)).collect();
+        let mut p = PlanarBuffer::new(0, 0);
+        p.read_track(&track);
+        assert_eq!(p.channels(), 2);
+        assert_eq!(p.channel(0), &src[..]);
+        assert_eq!(p.channel(1), &base[..]);
+
+        let mut out = vec![Stereo::new(); 37];
+        p.write_track(&mut out);
+        assert!(out.iter().zip(&track).all(|(a, b)| a.left == b.left && a.right == b.right));
+
+        write_wav_planar(&p, 16, &mut File::create(".junk/utils/planar.wav").unwrap(), true).unwrap();
+    }
+
+    #[test]
+    fn test_panning() {
+        use bae_rs::sample_format::*;
+        use std::convert::TryFrom;
+        use std::f64::consts::FRAC_PI_2;
+
+        for i in 0..=100 {
+            let p = i as f64 / 100.0;
+            let (c, s) = constant_power(p);
+            assert!((c as f64 - (p * FRAC_PI_2).cos()).abs() < 1e-6);
+            assert!((s as f64 - (p * FRAC_PI_2).sin()).abs() < 1e-6);
+        }
+
+        let (c, u) = (Stereo::to_sample_format(1.0, 0.0f32), Stereo::from_sample(1.0));
+        assert_eq!((c.left, c.right), (u.left, u.right));
+        let l = Stereo::to_sample_format(1.0, -1.0f32);
+        assert_eq!((l.left, l.right), (1.0, 0.0));
+        let r = Stereo::to_sample_format(1.0, 2.0f64);
+        assert_eq!((r.left, r.right), (0.0, 1.0));
+
+        // Sounds on a speaker play from it alone, and sounds between two
+        // play from both at constant power, including behind the listener.
+        let mut g = [0.0; 6];
+        pan_gains::<Surround51>(0.0, &mut g);
+        assert_eq!(g, [0.0, 0.0, 1.0, 0.0, 0.0, 0.0]);
+        pan_gains::<Surround51>(70.0, &mut g);
+        assert!((g[1] - 0.5f32.sqrt()).abs() < 1e-6 && (g[5] - 0.5f32.sqrt()).abs() < 1e-6);
+        assert_eq!(g[0] + g[2] + g[3] + g[4], 0.0);
+        let mut h = [0.0; 6];
+        pan_gains::<Surround51>(180.0, &mut g);
+        pan_gains::<Surround51>(-180.0, &mut h);
+        assert_eq!(g, h);
+        assert!((g[4] - g[5]).abs() < 1e-6 && g[4] > 0.0);
+
+        let mut g = [0.0; 8];
+        for a in (-360..360).step_by(7) {
+            pan_gains::<Surround71>(a as f64, &mut g);
+            assert!((g.iter().map(|x| x * x).sum::<f32>() - 1.0).abs() < 1e-5);
+            assert_eq!(g[3], 0.0);
+        }
+
+        let s = Surround71::to_sample_format(0.5, Azimuth(90.0));
+        assert_eq!(s.side_right, 0.5);
+        assert_eq!(s.channels().iter().sum::<f32>(), 0.5);
+
+        for x in [-0.5, 0.25, 1.0] {
+            assert!((Surround21::from_sample(x).into_sample() - x).abs() < 1e-6);
+            assert!((Surround51::from_sample(x).into_sample() - x).abs() < 1e-6);
+            assert!((Surround71::from_sample(x).into_sample() - x).abs() < 1e-6);
+        }
+
+        let mut s = Surround51::new();
+        s.set_channel(4, 0.5);
+        assert_eq!(s.surround_left, 0.5);
+        let v: Vec<i16> = s.into();
+        assert_eq!(v, vec![0, 0, 0, 0, 16384, 0]);
+        assert_eq!(Surround51::try_from(v).unwrap().get_channel(4), sample_from_i16(16384));
+        assert!(Surround71::try_from(vec![0i16; 7]).is_err());
+    }
+
+    #[test]
+    fn test_batch_conversion() {
+        use bae_rs::sample_format::*;
+
+        let mut f: Vec<f32> = (0..1001).map(|i| (i as f32 * 0.0123).sin() * 1.2).collect();
+        f.extend_from_slice(&[0.5 / 32767.0, -0.5 / 32767.0, 1.5 / 32767.0, 0.49999997 / 32767.0, 0.0, -0.0, 2.0, -2.0, std::f32::NAN]);
+
+        let mut i16s = vec![0i16; f.len()];
+        samples_to_i16(&f, &mut i16s, false, None);
+        for (x, y) in f.iter().zip(&i16s) {
+            assert_eq!(sample_to_i16(*x), *y);
+        }
+
+        let mut back = vec![0.0; f.len()];
+        samples_from_i16(&i16s, &mut back);
+        for (x, y) in i16s.iter().zip(&back) {
+            assert_eq!(sample_from_i16(*x).to_bits(), y.to_bits());
+        }
+
+        let i24s: Vec<i32> = f.iter().map(|x| sample_to_i24(*x)).collect();
+        samples_from_i24(&i24s, &mut back);
+        for (x, y) in i24s.iter().zip(&back) {
+            assert_eq!(sample_from_i24(*x).to_bits(), y.to_bits());
+        }
+
+        let bytes: Vec<u8> = f.iter().flat_map(|x| sample_to_i24_bytes(x.max(-1.0).min(1.0)).to_vec()).collect();
+        samples_from_i24_bytes(&bytes, &mut back);
+        for (x, y) in f.iter().zip(&back) {
+            assert!((x.max(-1.0).min(1.0) - y).abs() < 1e-6 || x.is_nan());
+        }
+
+        let mut dithered = vec![0i16; f.len()];
+        samples_to_i16(&f, &mut dithered, true, Some(&mut Dither::new(7)));
+        for (x, y) in f.iter().zip(&dithered) {
+            if !x.is_nan() {
+                assert!((sample_to_i16(x.max(-1.0).min(1.0)) as i32 - *y as i32).abs() <= 1);
+            }
+        }
+
+        let l: Vec<f32> = f[..1000].to_vec();
+        let r: Vec<f32> = f[1..1001].to_vec();
+        let mut inter = vec![0i16; 2000];
+        interleave_i16(&[&l, &r], &mut inter, true, None);
+
+        let mut tracks = vec![vec![0.0; 1000]; 2];
+        deinterleave_i16(&inter, &mut tracks);
+        for (c, t) in [&l, &r].iter().enumerate() {
+            for (i, x) in t.iter().enumerate() {
+                assert_eq!(inter[2 * i + c], sample_to_i16(x.max(-1.0).min(1.0)));
+                assert_eq!(tracks[c][i], sample_from_i16(inter[2 * i + c]));
+            }
+        }
+
+        let mut file = Vec::new();
+        write_wav(vec![l.clone(), r.clone()], 24, &mut file, true).unwrap();
+        let (_, read) = read_wav(&mut std::io::Cursor::new(file)).unwrap();
+        assert_eq!(read.len(), 2);
+        for (x, y) in l.iter().zip(&read[0]) {
+            assert_eq!(*y, sample_from_i24(sample_to_i24(x.max(-1.0).min(1.0))));
+        }
+    }
+
     #[test]
     fn test_resampler() {
         use bae_rs::SampleT;
@@ -56,4 +290,241 @@ mod tests {
             assert!(float_equal(s, i.into_sample(), std::f32::EPSILON, |x| x.abs()));
         }
     }
+
+    #[test]
+    fn test_asset_cache() {
+        use bae_rs::utils::asset_cache::*;
+        use bae_rs::generators::{Generator, MonoWav};
+
+        let buffer = |n: usize| SampleBuffer::new(vec![0.5; n], bae_rs::SAMPLE_RATE as bae_rs::MathT);
+        let mut c = AssetCache::new(3500);
+
+        let a = c.insert(AssetKey::Hash(1), buffer(500));
+        c.insert(AssetKey::Hash(2), buffer(250));
+        assert_eq!(c.stats().resident_bytes, 3000);
+
+        // Using the first asset makes the second the least recently used.
+        assert!(c.get(&AssetKey::Hash(1)).unwrap().ptr_eq(&a));
+        assert!(c.get(&AssetKey::Hash(3)).is_none());
+        c.insert(AssetKey::Hash(3), buffer(250));
+
+        assert!(c.contains(&AssetKey::Hash(1)));
+        assert!(!c.contains(&AssetKey::Hash(2)));
+        assert!(c.contains(&AssetKey::Hash(3)));
+
+        let s = c.stats();
+        assert_eq!((s.hits, s.misses, s.evictions, s.evicted_bytes), (1, 1, 1, 1000));
+        assert_eq!((s.entries, s.resident_bytes), (2, 3000));
+
+        // Too large to ever be cached.
+        let big = c.insert(AssetKey::Hash(4), buffer(2000));
+        assert_eq!(big.len(), 2000);
+        assert!(!c.contains(&AssetKey::Hash(4)));
+
+        c.set_budget(1000);
+        assert_eq!(c.stats().entries, 1);
+        assert!(c.contains(&AssetKey::Hash(3)));
+
+        // Voices share the data of the asset, even after it's evicted.
+        let mut w = MonoWav::from_buffer(&a);
+        let v = w.clone();
+        assert!(std::sync::Arc::ptr_eq(w.get().get_data(), v.get().get_data()));
+        assert!(std::sync::Arc::ptr_eq(w.get().get_data(), a.samples()));
+        assert_eq!(w.process(), 0.5);
+    }
+
+    #[test]
+    fn test_resampler_modes() {
+        use bae_rs::{SampleT, MathT, SAMPLE_RATE};
+        use bae_rs::utils::asset_cache::SampleBuffer;
+
+        let rate = 44_100.0;
+        let f = 440.0;
+        let sine: Vec<SampleT> = (0..20_000)
+            .map(|i| (2.0 * std::f64::consts::PI * f * i as MathT / rate).sin() as SampleT)
+            .collect();
+        let b = SampleBuffer::new(sine, rate);
+
+        for m in &[Interpolation::Linear, Interpolation::Cubic, Interpolation::Sinc] {
+            // Block processing matches per-sample processing, across loop
+            // wraps and past the end of the data.
+            for &(ls, le) in &[(0, 0), (1000, 1500), (19_990, 20_000)] {
+                let mut a = MonoResampler::from_buffer(&b, ls, le);
+                a.set_interpolation(*m);
+                let mut c = a.clone();
+
+                let mut ya = vec![0.0; 30_000];
+                let mut yc = vec![0.0; 30_000];
+                for y in &mut ya {
+                    *y = a.process();
+                }
+                for y in yc.chunks_mut(333) {
+                    c.process_block(y);
+                }
+                assert_eq!(ya, yc);
+            }
+
+            // Resampled output follows the ideal signal, away from the ends.
+            let mut r = MonoResampler::from_buffer(&b, 0, 0);
+            r.set_interpolation(*m);
+            let mut y = vec![0.0; 20_000];
+            r.process_block(&mut y);
+
+            let tolerance = match m {
+                Interpolation::Linear => 1e-3,
+                Interpolation::Cubic => 1e-5,
+                Interpolation::Sinc => 2e-3,
+            };
+            for (i, y) in y.iter().enumerate().skip(16).take(20_000) {
+                let t = i as MathT / SAMPLE_RATE as MathT;
+                if t * rate < 19_980.0 {
+                    let x = (2.0 * std::f64::consts::PI * f * t).sin();
+                    assert!((x - *y as MathT).abs() < tolerance, "{:?} {} {} {}", m, i, x, y);
+                }
+            }
+        }
+
+        // The fixed-point position stays exact far into long files, and
+        // doesn't drift over many loops.
+        let mut r = MonoResampler::new(vec![bae_rs::Mono::from(0.0); 4], SAMPLE_RATE as MathT, 0, 4);
+        r.set_position((1u64 << 30) as MathT + 0.25);
+        assert_eq!(r.get_position(), (1u64 << 30) as MathT + 0.25);
+
+        r.set_position(0.0);
+        r.set_playback_speed(0.75);
+        let mut y = vec![0.0; 100_000];
+        r.process_block(&mut y);
+        assert_eq!(r.get_position(), (100_000.0 * 0.75) % 4.0);
+    }
+    #[test]
+    fn test_automation() {
+        use std::time::Duration;
+        use bae_rs::{generators::*, modifiers::*};
+
+        // The fast approximations stay close to the exact functions.
+        for i in -1000..1000 {
+            let x = i as f64 * 0.0031;
+            if (x / std::f64::consts::FRAC_PI_2).fract().abs() > 1e-3 {
+                assert!((fast_tan(x) - x.tan()).abs() <= 1e-7 * x.tan().abs().max(1.0));
+            }
+
+            let db = i as f64 * 0.15;
+            assert!((fast_db_to_linear(db) / db_to_linear(db) - 1.0).abs() < 1e-6);
+        }
+        assert_eq!(fast_db_to_linear(-10_000.0), 0.0);
+
+        // Ramps land on their targets after the given number of samples.
+        let mut r = Ramp::new(100.0);
+        r.ramp_over(200.0, 4, Curve::Linear);
+        assert_eq!([r.next(), r.next(), r.next(), r.next()], [125.0, 150.0, 175.0, 200.0]);
+        assert!(!r.is_active());
+
+        r.ramp_over(800.0, 2, Curve::Exponential);
+        assert!((r.next() - 400.0).abs() < 1e-9);
+        assert_eq!(r.advance(10), 800.0);
+        assert!(!r.is_active());
+
+        r.ramp_over(-1.0, 2, Curve::Exponential);
+        assert_eq!(r.next(), 399.5);
+
+        // Frequencies and cutoffs are updated at control rate and reach their
+        // targets.
+        let mut g = Automated::frequency(Sine::new(220.0));
+        g.ramp_to(440.0, Duration::from_millis(10), Curve::Exponential);
+        let mut t = vec![0.0; 1000];
+        g.process_block(&mut t[..100]);
+        let f = g.get().get_frequency();
+        assert!(f > 220.0 && f < 440.0);
+        g.process_block(&mut t);
+        assert!((g.get().get_frequency() - 440.0).abs() < 1e-9);
+
+        let mut m = Automated::new(LowPass::new(100.0, 0.5), 100.0, LowPass::glide_central_frequency);
+        m.ramp_to(5000.0, Duration::from_millis(100), Curve::Exponential);
+        let mut n = Noise::new();
+        let mut t: Vec<f32> = (0..9600).map(|_| n.process()).collect();
+        for b in t.chunks_mut(100) {
+            m.process_block(b);
+        }
+        assert!(t.iter().all(|x| x.is_finite()));
+        assert_eq!(m.get().get_central_frequency(), 5000.0);
+
+        // Exponential envelope stages reach their levels on time.
+        let mut a = ADSR::with_curve(
+            Duration::from_millis(1), Duration::from_millis(10), -12.0,
+            Duration::from_millis(20), Curve::Exponential,
+        );
+        let mut t = vec![1.0; 48 + 480 + 100];
+        a.process_block(&mut t);
+        assert_eq!(t[47], 1.0);
+        assert!((a.get_gain() - db_to_linear(-12.0)).abs() < 1e-9);
+        a.release();
+        let mut t = vec![1.0; 960];
+        a.process_block(&mut t);
+        assert!(t[959].abs() < 1e-4);
+        assert_eq!(a.get_gain(), 0.0);
+    }
+
+    #[test]
+    fn test_wav_writer() {
+        use std::io::{Cursor, Seek, SeekFrom};
+        use bae_rs::utils::wav_writer::*;
+
+        let l: Vec<f32> = (0..1001).map(|i| (i as f32 * 0.01).sin()).collect();
+        let r: Vec<f32> = l.iter().map(|x| -x).collect();
+
+        let mut c = Cursor::new(Vec::new());
+        c.seek(SeekFrom::Start(4)).unwrap();
+        let mut w = WavWriter::new(c, 2, 44_100, 16).unwrap();
+        w.write(&[&l[..500], &r[..500]], false).unwrap();
+        w.write(&[&l[500..], &r[500..]], false).unwrap();
+        assert!(w.write(&[&l[..], &r[..10]], false).is_err());
+        assert_eq!(w.frames(), 1001);
+
+        let file = w.finish().unwrap().into_inner();
+        assert_eq!(file.len(), 4 + 44 + 1001 * 4);
+        let (h, t) = read_wav(&mut &file[4..]).unwrap();
+        assert_eq!((h.channel_count, h.sampling_rate, h.bits_per_sample), (2, 44_100, 16));
+        for (a, b) in t[0].iter().zip(&l).chain(t[1].iter().zip(&r)) {
+            assert!((a - b).abs() < 1e-4);
+        }
+
+        let mut w = WavWriter::with_frames(Vec::new(), 1, 44_100, 8, 1001).unwrap();
+        w.write(&[&l], false).unwrap();
+        assert!(w.write(&[&l[..1]], false).is_err());
+        let file = w.finish().unwrap();
+        assert_eq!(file.len(), 44 + 1001 + 1);
+        assert_eq!(&file[4..8], &(36u32 + 1002).to_le_bytes());
+        assert_eq!(&file[40..44], &1001u32.to_le_bytes());
+
+        let mut w = WavWriter::with_frames(Vec::new(), 1, 44_100, 24, 1001).unwrap();
+        w.write(&[&l[..10]], false).unwrap();
+        assert!(w.finish().is_err());
+        assert!(WavWriter::with_frames(Vec::new(), 1, 44_100, 12, 1).is_err());
+    }
+
+    #[test]
+    fn test_fft() {
+        let fft = fft::Fft::new(64);
+        let signal: Vec<f32> = (0..64).map(|i| ((i * 7 % 13) as f32 - 6.0) / 6.0).collect();
+
+        let mut re = signal.clone();
+        let mut im = vec![0.0; 64];
+        fft.forward(&mut re, &mut im);
+
+        for k in 0..64 {
+            let (mut dr, mut di) = (0.0f64, 0.0f64);
+            for (n, x) in signal.iter().enumerate() {
+                let w = -2.0 * std::f64::consts::PI * (k * n) as f64 / 64.0;
+                dr += *x as f64 * w.cos();
+                di += *x as f64 * w.sin();
+            }
+            assert!((re[k] as f64 - dr).abs() < 1e-4 && (im[k] as f64 - di).abs() < 1e-4);
+        }
+
+        fft.inverse(&mut re, &mut im);
+        for (a, b) in re.iter().zip(&signal) {
+            assert!((a - b).abs() < 1e-5);
+        }
+        assert!(im.iter().all(|x| x.abs() < 1e-5));
+    }
 }